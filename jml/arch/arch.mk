@@ -1,5 +1,8 @@
 LIBARCH_SOURCES := \
         simd_vector.cc \
+	simd_vector_sse2.cc \
+	simd_vector_avx2.cc \
+	simd_vector_avx512.cc \
         demangle.cc \
 	tick_counter.cc \
 	cpuid.cc \
@@ -26,6 +29,12 @@ endif
 $(eval $(call library,arch,$(LIBARCH_SOURCES),$(LIBARCH_LINK)))
 $(eval $(call set_single_compile_option,simd_vector.cc,-funsafe-loop-optimizations -Wunsafe-loop-optimizations))
 
+# The kernels for each instruction set must give bit for bit the same
+# results, so must never have a multiply and an add fused.
+$(eval $(call set_compile_option,simd_vector_sse2.cc simd_vector_avx2.cc simd_vector_avx512.cc,-ffp-contract=off))
+$(eval $(call set_single_compile_option,simd_vector_avx2.cc,-mavx2))
+$(eval $(call set_single_compile_option,simd_vector_avx512.cc,-mavx512f))
+
 $(eval $(call library,exception_hook,exception_hook.cc,arch dl))
 
 $(eval $(call library,node_exception_tracing,node_exception_tracing.cc,exception_hook arch dl))
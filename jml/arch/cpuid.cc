@@ -30,6 +30,7 @@ enum {
     CPUID_MONITOR_MWAIT = 5,
     CPUID_THERMAL_POWER = 6,
     CPUID_DCA_ACCESS = 7,
+    CPUID_STRUCTURED_FEATURES = 7,
     CPUID_EXT_LEVEL =      0x80000000,
     CPUID_EXT_FEATURES =   0x80000001,
     CPUID_EXT_BRAND1 =     0x80000002,
@@ -83,6 +84,22 @@ cpuid(uint32_t request, uint32_t ecx = 0)
     return result;
 }
 
+/** Return which register states the operating system saves on a context
+    switch.  Only valid if the CPU has the osxsave flag set.
+*/
+uint64_t xgetbv()
+{
+    uint32_t eax, edx;
+    asm volatile ("xgetbv" : "=a" (eax), "=d" (edx) : "c" (0));
+    return (uint64_t(edx) << 32) | eax;
+}
+
+enum {
+    XCR0_SSE_STATE = 1 << 1,
+    XCR0_AVX_STATE = 1 << 2,
+    XCR0_AVX512_STATE = 7 << 5    ///< opmask, upper zmm0-15, zmm16-31
+};
+
 } // file scope
 
 uint32_t cpuid_flags()
@@ -139,6 +156,7 @@ std::string model_id()
 CPU_Info::CPU_Info()
 {
     cpuid_level = cpuid_extlevel = standard1 = standard2 = extended = amd = 0;
+    structured = 0;
 
     cpuid_level = cpuid(CPUID_LEVEL).eax;
     cpuid_extlevel = cpuid(CPUID_EXT_LEVEL).eax;
@@ -162,6 +180,18 @@ CPU_Info::CPU_Info()
         amd = r.ecx;
     }
 
+    if (cpuid_level >= CPUID_STRUCTURED_FEATURES)
+        structured = cpuid(CPUID_STRUCTURED_FEATURES, 0).ebx;
+
+    // The AVX instructions fault unless the kernel saves the registers they
+    // use, so only advertise them if it does.
+    uint64_t xcr0 = osxsave ? xgetbv() : 0;
+    uint64_t avxState = XCR0_SSE_STATE | XCR0_AVX_STATE;
+    if ((xcr0 & avxState) != avxState)
+        avx = avx2 = avx512f = avx512dq = 0;
+    if ((xcr0 & XCR0_AVX512_STATE) != XCR0_AVX512_STATE)
+        avx512f = avx512dq = 0;
+
 #if 0
     if (fpu) cerr << "fpu ";
 
@@ -84,11 +84,33 @@ struct CPU_Info {
             uint32_t xtpr:1;      // 14
             uint32_t res6:3;      // 15, 16, 17
             uint32_t dca:1;       // 18
-            uint32_t res7:14;
+            uint32_t res7:8;
+            uint32_t osxsave:1;   // 27
+            uint32_t avx:1;       // 28
+            uint32_t res8:3;
         };
         uint32_t standard2;
     };
 
+    // Structured extended flags (leaf 7).  The AVX flags here and above are
+    // only set if the operating system saves the wider registers.
+    union {
+        struct {
+            uint32_t fsgsbase:1;  // 0
+            uint32_t res1_s:2;
+            uint32_t bmi1:1;
+            uint32_t res2_s:1;    // 4
+            uint32_t avx2:1;
+            uint32_t res3_s:2;
+            uint32_t bmi2:1;      // 8
+            uint32_t res4_s:7;
+            uint32_t avx512f:1;   // 16
+            uint32_t avx512dq:1;
+            uint32_t res5_s:14;
+        };
+        uint32_t structured;
+    };
+
     // Entended1 flags for AMD
     union {
         struct {
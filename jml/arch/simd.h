@@ -39,6 +39,12 @@ JML_ALWAYS_INLINE bool has_sse3() { return cpu_info().sse3; }
 
 JML_ALWAYS_INLINE bool has_pni() { return cpu_info().pni; }
 
+JML_ALWAYS_INLINE bool has_avx() { return cpu_info().avx; }
+
+JML_ALWAYS_INLINE bool has_avx2() { return cpu_info().avx2; }
+
+JML_ALWAYS_INLINE bool has_avx512f() { return cpu_info().avx512f; }
+
 
 #endif // __i686__
 
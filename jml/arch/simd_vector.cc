@@ -36,121 +36,6 @@ namespace ML {
 namespace SIMD {
 namespace Generic {
 
-template<typename X>
-int ptr_align(const X * p) 
-{
-    return size_t(p) & 15;
-} JML_PURE_FN
-
-
-void vec_scale(const float * x, float k, float * r, size_t n)
-{
-    v4sf kkkk = vec_splat(k);
-    unsigned i = 0;
-
-    if (false) ;
-    else {
-        for (; i + 16 <= n;  i += 16) {
-            v4sf xxxx0 = __builtin_ia32_loadups(x + i + 0);
-            xxxx0 *= kkkk;
-            v4sf xxxx1 = __builtin_ia32_loadups(x + i + 4);
-            __builtin_ia32_storeups(r + i + 0, xxxx0);
-            xxxx1 *= kkkk;
-            v4sf xxxx2 = __builtin_ia32_loadups(x + i + 8);
-            __builtin_ia32_storeups(r + i + 4, xxxx1);
-            xxxx2 *= kkkk;
-            v4sf xxxx3 = __builtin_ia32_loadups(x + i + 12);
-            __builtin_ia32_storeups(r + i + 8, xxxx2);
-            xxxx3 *= kkkk;
-            __builtin_ia32_storeups(r + i + 12, xxxx3);
-        }
-    
-        for (; i + 4 <= n;  i += 4) {
-            v4sf xxxx0 = __builtin_ia32_loadups(x + i + 0);
-            xxxx0 *= kkkk;
-            __builtin_ia32_storeups(r + i + 0, xxxx0);
-        }
-    }
-    
-    for (; i < n;  ++i) r[i] = k * x[i];
-}
-
-void vec_add(const float * x, const float * y, float * r, size_t n)
-{
-    unsigned i = 0;
-
-    if (false) ;
-    else {
-        //cerr << "unoptimized" << endl;
-
-        for (; i + 16 <= n;  i += 16) {
-            v4sf yyyy0 = __builtin_ia32_loadups(y + i + 0);
-            v4sf xxxx0 = __builtin_ia32_loadups(x + i + 0);
-            v4sf yyyy1 = __builtin_ia32_loadups(y + i + 4);
-            yyyy0 += xxxx0;
-            v4sf xxxx1 = __builtin_ia32_loadups(x + i + 4);
-            __builtin_ia32_storeups(r + i + 0, yyyy0);
-            v4sf yyyy2 = __builtin_ia32_loadups(y + i + 8);
-            yyyy1 += xxxx1;
-            v4sf xxxx2 = __builtin_ia32_loadups(x + i + 8);
-            __builtin_ia32_storeups(r + i + 4, yyyy1);
-            v4sf yyyy3 = __builtin_ia32_loadups(y + i + 12);
-            yyyy2 += xxxx2;
-            v4sf xxxx3 = __builtin_ia32_loadups(x + i + 12);
-            __builtin_ia32_storeups(r + i + 8, yyyy2);
-            yyyy3 += xxxx3;
-            __builtin_ia32_storeups(r + i + 12, yyyy3);
-        }
-
-        for (; i + 4 <= n;  i += 4) {
-            v4sf yyyy0 = __builtin_ia32_loadups(y + i + 0);
-            v4sf xxxx0 = __builtin_ia32_loadups(x + i + 0);
-            yyyy0 += xxxx0;
-            __builtin_ia32_storeups(r + i + 0, yyyy0);
-        }
-        
-        for (; i < n;  ++i) r[i] = x[i] + y[i];
-    }
-}
-
-void vec_prod(const float * x, const float * y, float * r, size_t n)
-{
-    unsigned i = 0;
-
-    if (false) ;
-    else {
-        //cerr << "unoptimized" << endl;
-        
-        for (; i + 16 <= n;  i += 16) {
-            v4sf yyyy0 = __builtin_ia32_loadups(y + i + 0);
-            v4sf xxxx0 = __builtin_ia32_loadups(x + i + 0);
-            v4sf yyyy1 = __builtin_ia32_loadups(y + i + 4);
-            yyyy0 *= xxxx0;
-            v4sf xxxx1 = __builtin_ia32_loadups(x + i + 4);
-            __builtin_ia32_storeups(r + i + 0, yyyy0);
-            v4sf yyyy2 = __builtin_ia32_loadups(y + i + 8);
-            yyyy1 *= xxxx1;
-            v4sf xxxx2 = __builtin_ia32_loadups(x + i + 8);
-            __builtin_ia32_storeups(r + i + 4, yyyy1);
-            v4sf yyyy3 = __builtin_ia32_loadups(y + i + 12);
-            yyyy2 *= xxxx2;
-            v4sf xxxx3 = __builtin_ia32_loadups(x + i + 12);
-            __builtin_ia32_storeups(r + i + 8, yyyy2);
-            yyyy3 *= xxxx3;
-            __builtin_ia32_storeups(r + i + 12, yyyy3);
-        }
-
-        for (; i + 4 <= n;  i += 4) {
-            v4sf yyyy0 = __builtin_ia32_loadups(y + i + 0);
-            v4sf xxxx0 = __builtin_ia32_loadups(x + i + 0);
-            yyyy0 *= xxxx0;
-            __builtin_ia32_storeups(r + i + 0, yyyy0);
-        }
-        
-        for (; i < n;  ++i) r[i] = x[i] * y[i];
-    }
-}
-
 void vec_prod(const float * x, const double * y, float * r, size_t n)
 {
     unsigned i = 0;
@@ -203,143 +88,6 @@ void vec_prod(const double * x, const double * y, float * r, size_t n)
     for (; i < n;  ++i) r[i] = x[i] * y[i];
 }
 
-void vec_add(const float * x, float k, const float * y, float * r, size_t n)
-{
-    v4sf kkkk = vec_splat(k);
-    unsigned i = 0;
-
-    //bool alignment_unimportant = true;  // nehalem?
-
-    if (false && n >= 16 && (ptr_align(x) == ptr_align(y) && ptr_align(y) == ptr_align(r))) {
-
-        /* Align everything on 16 byte boundaries */
-        if (ptr_align(x) != 0) {
-            int needed_to_align = (16 - ptr_align(x)) / 4;
-            
-            for (unsigned i = 0;  i < needed_to_align;  ++i)
-                r[i] = x[i] + k * y[i];
-
-            r += needed_to_align;  x += needed_to_align;  y += needed_to_align;
-            n -= needed_to_align;
-        }
-
-        //cerr << "optimized" << endl;
-
-        while (n > 16) {
-            const v4sf * xx = reinterpret_cast<const v4sf *>(x);
-            const v4sf * yy = reinterpret_cast<const v4sf *>(y);
-            v4sf * rr = reinterpret_cast<v4sf *>(r);
-            
-            v4sf yyyy0 = yy[0];
-            v4sf xxxx0 = xx[0];
-            yyyy0 *= kkkk;
-            v4sf yyyy1 = yy[1];
-            yyyy0 += xxxx0;
-            v4sf xxxx1 = xx[1];
-            rr[0] = yyyy0;
-            yyyy1 *= kkkk;
-            v4sf yyyy2 = yy[2];
-            yyyy1 += xxxx1;
-            v4sf xxxx2 = xx[2];
-            rr[1] = yyyy1;
-            yyyy2 *= kkkk;
-            v4sf yyyy3 = yy[3];
-            yyyy2 += xxxx2;
-            v4sf xxxx3 = xx[3];
-            rr[2] = yyyy2;
-            yyyy3 *= kkkk;
-            yyyy3 += xxxx3;
-            rr[3] = yyyy3;
-
-            r += 16;  x += 16;  y += 16;  n -= 16;
-        }
-
-        for (unsigned i = 0;  i < n;  ++i) r[i] = x[i] + k * y[i];
-    }
-    else {
-        //cerr << "unoptimized" << endl;
-
-        for (; i + 16 <= n;  i += 16) {
-            v4sf yyyy0 = __builtin_ia32_loadups(y + i + 0);
-            v4sf xxxx0 = __builtin_ia32_loadups(x + i + 0);
-            yyyy0 *= kkkk;
-            v4sf yyyy1 = __builtin_ia32_loadups(y + i + 4);
-            yyyy0 += xxxx0;
-            v4sf xxxx1 = __builtin_ia32_loadups(x + i + 4);
-            __builtin_ia32_storeups(r + i + 0, yyyy0);
-            yyyy1 *= kkkk;
-            v4sf yyyy2 = __builtin_ia32_loadups(y + i + 8);
-            yyyy1 += xxxx1;
-            v4sf xxxx2 = __builtin_ia32_loadups(x + i + 8);
-            __builtin_ia32_storeups(r + i + 4, yyyy1);
-            yyyy2 *= kkkk;
-            v4sf yyyy3 = __builtin_ia32_loadups(y + i + 12);
-            yyyy2 += xxxx2;
-            v4sf xxxx3 = __builtin_ia32_loadups(x + i + 12);
-            __builtin_ia32_storeups(r + i + 8, yyyy2);
-            yyyy3 *= kkkk;
-            yyyy3 += xxxx3;
-            __builtin_ia32_storeups(r + i + 12, yyyy3);
-        }
-
-        for (; i + 4 <= n;  i += 4) {
-            v4sf yyyy0 = __builtin_ia32_loadups(y + i + 0);
-            v4sf xxxx0 = __builtin_ia32_loadups(x + i + 0);
-            yyyy0 *= kkkk;
-            yyyy0 += xxxx0;
-            __builtin_ia32_storeups(r + i + 0, yyyy0);
-        }
-
-        for (; i < n;  ++i) r[i] = x[i] + k * y[i];
-    }
-}
-
-void vec_add(const float * x, const float * k, const float * y, float * r,
-             size_t n)
-{
-    unsigned i = 0;
-
-    if (true) {
-        for (; i + 16 <= n;  i += 16) {
-            v4sf yyyy0 = __builtin_ia32_loadups(y + i + 0);
-            v4sf kkkk0 = __builtin_ia32_loadups(k + i + 0);
-            v4sf xxxx0 = __builtin_ia32_loadups(x + i + 0);
-            yyyy0 *= kkkk0;
-            v4sf yyyy1 = __builtin_ia32_loadups(y + i + 4);
-            v4sf kkkk1 = __builtin_ia32_loadups(k + i + 4);
-            yyyy0 += xxxx0;
-            v4sf xxxx1 = __builtin_ia32_loadups(x + i + 4);
-            __builtin_ia32_storeups(r + i + 0, yyyy0);
-            yyyy1 *= kkkk1;
-            v4sf yyyy2 = __builtin_ia32_loadups(y + i + 8);
-            v4sf kkkk2 = __builtin_ia32_loadups(k + i + 8);
-            yyyy1 += xxxx1;
-            v4sf xxxx2 = __builtin_ia32_loadups(x + i + 8);
-            __builtin_ia32_storeups(r + i + 4, yyyy1);
-            yyyy2 *= kkkk2;
-            v4sf yyyy3 = __builtin_ia32_loadups(y + i + 12);
-            v4sf kkkk3 = __builtin_ia32_loadups(k + i + 12);
-            yyyy2 += xxxx2;
-            v4sf xxxx3 = __builtin_ia32_loadups(x + i + 12);
-            __builtin_ia32_storeups(r + i + 8, yyyy2);
-            yyyy3 *= kkkk3;
-            yyyy3 += xxxx3;
-            __builtin_ia32_storeups(r + i + 12, yyyy3);
-        }
-
-        for (; i + 4 <= n;  i += 4) {
-            v4sf yyyy0 = __builtin_ia32_loadups(y + i + 0);
-            v4sf xxxx0 = __builtin_ia32_loadups(x + i + 0);
-            v4sf kkkk0 = __builtin_ia32_loadups(k + i + 0);
-            yyyy0 *= kkkk0;
-            yyyy0 += xxxx0;
-            __builtin_ia32_storeups(r + i + 0, yyyy0);
-        }
-
-        for (; i < n;  ++i) r[i] = x[i] + k[i] * y[i];
-    }
-}
-
 void vec_add(const float * x, float k, const double * y, float * r, size_t n)
 {
     for (unsigned i = 0; i < n;  ++i) r[i] = x[i] + k * y[i];
@@ -352,264 +100,11 @@ float vec_dotprod(const float * x, const float * y, size_t n)
     return res;
 }
 
-void vec_scale(const double * x, double k, double * r, size_t n)
-{
-    v2df kk = vec_splat(k);
-    unsigned i = 0;
-
-    if (false) ;
-    else {
-        for (; i + 8 <= n;  i += 8) {
-            v2df xx0 = __builtin_ia32_loadupd(x + i + 0);
-            xx0 *= kk;
-            v2df xx1 = __builtin_ia32_loadupd(x + i + 2);
-            __builtin_ia32_storeupd(r + i + 0, xx0);
-            xx1 *= kk;
-            v2df xx2 = __builtin_ia32_loadupd(x + i + 4);
-            __builtin_ia32_storeupd(r + i + 2, xx1);
-            xx2 *= kk;
-            v2df xx3 = __builtin_ia32_loadupd(x + i + 6);
-            __builtin_ia32_storeupd(r + i + 4, xx2);
-            xx3 *= kk;
-            __builtin_ia32_storeupd(r + i + 6, xx3);
-        }
-    
-        for (; i + 2 <= n;  i += 2) {
-            v2df xx0 = __builtin_ia32_loadupd(x + i + 0);
-            xx0 *= kk;
-            __builtin_ia32_storeupd(r + i + 0, xx0);
-        }
-    }
-    
-    for (; i < n;  ++i) r[i] = k * x[i];
-}
-
-void vec_add(const double * x, double k, const double * y, double * r,
-             size_t n)
-{
-    v2df kk = vec_splat(k);
-    unsigned i = 0;
-
-    if (true) {
-        for (; i + 8 <= n;  i += 8) {
-            v2df yy0 = __builtin_ia32_loadupd(y + i + 0);
-            v2df xx0 = __builtin_ia32_loadupd(x + i + 0);
-            yy0 *= kk;
-            yy0 += xx0;
-            __builtin_ia32_storeupd(r + i + 0, yy0);
-
-            v2df yy1 = __builtin_ia32_loadupd(y + i + 2);
-            v2df xx1 = __builtin_ia32_loadupd(x + i + 2);
-            yy1 *= kk;
-            yy1 += xx1;
-            __builtin_ia32_storeupd(r + i + 2, yy1);
-            
-            v2df yy2 = __builtin_ia32_loadupd(y + i + 4);
-            v2df xx2 = __builtin_ia32_loadupd(x + i + 4);
-            yy2 *= kk;
-            yy2 += xx2;
-            __builtin_ia32_storeupd(r + i + 4, yy2);
-
-            v2df yy3 = __builtin_ia32_loadupd(y + i + 6);
-            v2df xx3 = __builtin_ia32_loadupd(x + i + 6);
-            yy3 *= kk;
-            yy3 += xx3;
-            __builtin_ia32_storeupd(r + i + 6, yy3);
-
-        }
-
-        for (; i + 2 <= n;  i += 2) {
-            v2df yy0 = __builtin_ia32_loadupd(y + i + 0);
-            v2df xx0 = __builtin_ia32_loadupd(x + i + 0);
-            yy0 *= kk;
-            yy0 += xx0;
-            __builtin_ia32_storeupd(r + i + 0, yy0);
-        }
-    }
-
-    for (;  i < n;  ++i) r[i] = x[i] + k * y[i];
-}
-
-void vec_add(const double * x, const double * k, const double * y,
-             double * r, size_t n)
-{
-    unsigned i = 0;
-    if (true) {
-        for (; i + 8 <= n;  i += 8) {
-            v2df yy0 = __builtin_ia32_loadupd(y + i + 0);
-            v2df xx0 = __builtin_ia32_loadupd(x + i + 0);
-            v2df kk0 = __builtin_ia32_loadupd(k + i + 0);
-            yy0 *= kk0;
-            yy0 += xx0;
-            __builtin_ia32_storeupd(r + i + 0, yy0);
-
-            v2df yy1 = __builtin_ia32_loadupd(y + i + 2);
-            v2df xx1 = __builtin_ia32_loadupd(x + i + 2);
-            v2df kk1 = __builtin_ia32_loadupd(k + i + 2);
-            yy1 *= kk1;
-            yy1 += xx1;
-            __builtin_ia32_storeupd(r + i + 2, yy1);
-            
-            v2df yy2 = __builtin_ia32_loadupd(y + i + 4);
-            v2df xx2 = __builtin_ia32_loadupd(x + i + 4);
-            v2df kk2 = __builtin_ia32_loadupd(k + i + 4);
-            yy2 *= kk2;
-            yy2 += xx2;
-            __builtin_ia32_storeupd(r + i + 4, yy2);
-
-            v2df yy3 = __builtin_ia32_loadupd(y + i + 6);
-            v2df xx3 = __builtin_ia32_loadupd(x + i + 6);
-            v2df kk3 = __builtin_ia32_loadupd(k + i + 6);
-            yy3 *= kk3;
-            yy3 += xx3;
-            __builtin_ia32_storeupd(r + i + 6, yy3);
-        }
-
-        for (; i + 2 <= n;  i += 2) {
-            v2df yy0 = __builtin_ia32_loadupd(y + i + 0);
-            v2df xx0 = __builtin_ia32_loadupd(x + i + 0);
-            v2df kk0 = __builtin_ia32_loadupd(k + i + 0);
-            yy0 *= kk0;
-            yy0 += xx0;
-            __builtin_ia32_storeupd(r + i + 0, yy0);
-        }
-    }
-
-    for (;  i < n;  ++i) r[i] = x[i] + k[i] * y[i];
-}
-
-double vec_dotprod(const double * x, const double * y, size_t n)
-{
-    unsigned i = 0;
-    double result = 0.0;
-
-    if (true) {
-        v2df rr = vec_splat(0.0);
-
-        for (; i + 8 <= n;  i += 8) {
-            v2df yy0 = __builtin_ia32_loadupd(y + i + 0);
-            v2df xx0 = __builtin_ia32_loadupd(x + i + 0);
-            yy0 *= xx0;
-            rr += yy0;
-
-            v2df yy1 = __builtin_ia32_loadupd(y + i + 2);
-            v2df xx1 = __builtin_ia32_loadupd(x + i + 2);
-            yy1 *= xx1;
-            rr += yy1;
-            
-            v2df yy2 = __builtin_ia32_loadupd(y + i + 4);
-            v2df xx2 = __builtin_ia32_loadupd(x + i + 4);
-            yy2 *= xx2;
-            rr += yy2;
-
-            v2df yy3 = __builtin_ia32_loadupd(y + i + 6);
-            v2df xx3 = __builtin_ia32_loadupd(x + i + 6);
-            yy3 *= xx3;
-            rr += yy3;
-        }
-
-        for (; i + 2 <= n;  i += 2) {
-            v2df yy0 = __builtin_ia32_loadupd(y + i + 0);
-            v2df xx0 = __builtin_ia32_loadupd(x + i + 0);
-            yy0 *= xx0;
-            rr += yy0;
-        }
-
-        double results[2];
-        *(v2df *)results = rr;
-
-        result = results[0] + results[1];
-    }
-
-    for (; i < n;  ++i) result += x[i] * y[i];
-
-    return result;
-}
-
 void vec_minus(const float * x, const float * y, float * r, size_t n)
 {
     for (unsigned i = 0;  i < n;  ++i) r[i] = x[i] - y[i];
 }
 
-double vec_accum_prod3(const float * x, const float * y, const float * z,
-                       size_t n)
-{
-    double res = 0.0;
-    unsigned i = 0;
-
-    if (true) {
-        v2df rr = vec_splat(0.0);
-
-        for (; i + 16 <= n;  i += 16) {
-            v4sf yyyy0 = __builtin_ia32_loadups(y + i + 0);
-            v4sf xxxx0 = __builtin_ia32_loadups(x + i + 0);
-            yyyy0 *= xxxx0;
-            v4sf zzzz0 = __builtin_ia32_loadups(z + i + 0);
-            yyyy0 *= zzzz0;
-            v2df dd0a = __builtin_ia32_cvtps2pd(yyyy0);
-            yyyy0 = __builtin_ia32_shufps(yyyy0, yyyy0, 14);
-            v2df dd0b = __builtin_ia32_cvtps2pd(yyyy0);
-            rr += dd0a;
-            rr += dd0b;
-
-            v4sf yyyy1 = __builtin_ia32_loadups(y + i + 4);
-            v4sf xxxx1 = __builtin_ia32_loadups(x + i + 4);
-            yyyy1 *= xxxx1;
-            v4sf zzzz1 = __builtin_ia32_loadups(z + i + 4);
-            yyyy1 *= zzzz1;
-            v2df dd1a = __builtin_ia32_cvtps2pd(yyyy1);
-            yyyy1 = __builtin_ia32_shufps(yyyy1, yyyy1, 14);
-            v2df dd1b = __builtin_ia32_cvtps2pd(yyyy1);
-            rr += dd1a;
-            rr += dd1b;
-            
-            v4sf yyyy2 = __builtin_ia32_loadups(y + i + 8);
-            v4sf xxxx2 = __builtin_ia32_loadups(x + i + 8);
-            yyyy2 *= xxxx2;
-            v4sf zzzz2 = __builtin_ia32_loadups(z + i + 8);
-            yyyy2 *= zzzz2;
-            v2df dd2a = __builtin_ia32_cvtps2pd(yyyy2);
-            yyyy2 = __builtin_ia32_shufps(yyyy2, yyyy2, 14);
-            v2df dd2b = __builtin_ia32_cvtps2pd(yyyy2);
-            rr += dd2a;
-            rr += dd2b;
-
-            v4sf yyyy3 = __builtin_ia32_loadups(y + i + 12);
-            v4sf xxxx3 = __builtin_ia32_loadups(x + i + 12);
-            yyyy3 *= xxxx3;
-            v4sf zzzz3 = __builtin_ia32_loadups(z + i + 12);
-            yyyy3 *= zzzz3;
-            v2df dd3a = __builtin_ia32_cvtps2pd(yyyy3);
-            yyyy3 = __builtin_ia32_shufps(yyyy3, yyyy3, 14);
-            v2df dd3b = __builtin_ia32_cvtps2pd(yyyy3);
-            rr += dd3a;
-            rr += dd3b;
-        }
-
-        for (; i + 4 <= n;  i += 4) {
-            v4sf yyyy0 = __builtin_ia32_loadups(y + i + 0);
-            v4sf xxxx0 = __builtin_ia32_loadups(x + i + 0);
-            yyyy0 *= xxxx0;
-            v4sf zzzz0 = __builtin_ia32_loadups(z + i + 0);
-            yyyy0 *= zzzz0;
-
-            v2df dd1 = __builtin_ia32_cvtps2pd(yyyy0);
-            yyyy0 = __builtin_ia32_shufps(yyyy0, yyyy0, 14);
-            v2df dd2 = __builtin_ia32_cvtps2pd(yyyy0);
-            rr += dd1;
-            rr += dd2;
-        }
-
-        double results[2];
-        *(v2df *)results = rr;
-
-        res = results[0] + results[1];
-    }
-        
-    for (;  i < n;  ++i) res += x[i] * y[i] * z[i];
-    return res;
-}
-
 double vec_accum_prod3(const float * x, const float * y, const double * z,
                        size_t n)
 {
@@ -760,75 +255,6 @@ double vec_sum(const double * x, size_t n)
     return res;
 }
 
-double vec_dotprod_dp(const float * x, const float * y, size_t n)
-{
-    double res = 0.0;
-    unsigned i = 0;
-
-    if (true) {
-        v2df rr = vec_splat(0.0);
-
-        for (; i + 16 <= n;  i += 16) {
-            v4sf yyyy0 = __builtin_ia32_loadups(y + i + 0);
-            v4sf xxxx0 = __builtin_ia32_loadups(x + i + 0);
-            yyyy0 *= xxxx0;
-            v2df dd0a = __builtin_ia32_cvtps2pd(yyyy0);
-            yyyy0 = __builtin_ia32_shufps(yyyy0, yyyy0, 14);
-            v2df dd0b = __builtin_ia32_cvtps2pd(yyyy0);
-            rr += dd0a;
-            rr += dd0b;
-
-            v4sf yyyy1 = __builtin_ia32_loadups(y + i + 4);
-            v4sf xxxx1 = __builtin_ia32_loadups(x + i + 4);
-            yyyy1 *= xxxx1;
-            v2df dd1a = __builtin_ia32_cvtps2pd(yyyy1);
-            yyyy1 = __builtin_ia32_shufps(yyyy1, yyyy1, 14);
-            v2df dd1b = __builtin_ia32_cvtps2pd(yyyy1);
-            rr += dd1a;
-            rr += dd1b;
-            
-            v4sf yyyy2 = __builtin_ia32_loadups(y + i + 8);
-            v4sf xxxx2 = __builtin_ia32_loadups(x + i + 8);
-            yyyy2 *= xxxx2;
-            v2df dd2a = __builtin_ia32_cvtps2pd(yyyy2);
-            yyyy2 = __builtin_ia32_shufps(yyyy2, yyyy2, 14);
-            v2df dd2b = __builtin_ia32_cvtps2pd(yyyy2);
-            rr += dd2a;
-            rr += dd2b;
-
-            v4sf yyyy3 = __builtin_ia32_loadups(y + i + 12);
-            v4sf xxxx3 = __builtin_ia32_loadups(x + i + 12);
-            yyyy3 *= xxxx3;
-            v2df dd3a = __builtin_ia32_cvtps2pd(yyyy3);
-            yyyy3 = __builtin_ia32_shufps(yyyy3, yyyy3, 14);
-            v2df dd3b = __builtin_ia32_cvtps2pd(yyyy3);
-            rr += dd3a;
-            rr += dd3b;
-        }
-
-        for (; i + 4 <= n;  i += 4) {
-            v4sf yyyy0 = __builtin_ia32_loadups(y + i + 0);
-            v4sf xxxx0 = __builtin_ia32_loadups(x + i + 0);
-            yyyy0 *= xxxx0;
-            
-            v2df dd1 = __builtin_ia32_cvtps2pd(yyyy0);
-            yyyy0 = __builtin_ia32_shufps(yyyy0, yyyy0, 14);
-            v2df dd2 = __builtin_ia32_cvtps2pd(yyyy0);
-            rr += dd1;
-            rr += dd2;
-        }
-
-        double results[2];
-        *(v2df *)results = rr;
-
-        res = results[0] + results[1];
-    }
-        
-
-    for (;  i < n;  ++i) res += x[i] * y[i];
-    return res;
-}
-
 double vec_dotprod_dp(const double * x, const float * y, size_t n)
 {
     double res = 0.0;
@@ -896,43 +322,6 @@ double vec_sum_dp(const float * x, size_t n)
     return res;
 }
 
-void vec_add(const double * x, const double * y, double * r, size_t n)
-{
-    unsigned i = 0;
-    if (true) {
-        for (; i + 8 <= n;  i += 8) {
-            v2df yy0 = __builtin_ia32_loadupd(y + i + 0);
-            v2df xx0 = __builtin_ia32_loadupd(x + i + 0);
-            yy0 += xx0;
-            __builtin_ia32_storeupd(r + i + 0, yy0);
-
-            v2df yy1 = __builtin_ia32_loadupd(y + i + 2);
-            v2df xx1 = __builtin_ia32_loadupd(x + i + 2);
-            yy1 += xx1;
-            __builtin_ia32_storeupd(r + i + 2, yy1);
-            
-            v2df yy2 = __builtin_ia32_loadupd(y + i + 4);
-            v2df xx2 = __builtin_ia32_loadupd(x + i + 4);
-            yy2 += xx2;
-            __builtin_ia32_storeupd(r + i + 4, yy2);
-
-            v2df yy3 = __builtin_ia32_loadupd(y + i + 6);
-            v2df xx3 = __builtin_ia32_loadupd(x + i + 6);
-            yy3 += xx3;
-            __builtin_ia32_storeupd(r + i + 6, yy3);
-        }
-
-        for (; i + 2 <= n;  i += 2) {
-            v2df yy0 = __builtin_ia32_loadupd(y + i + 0);
-            v2df xx0 = __builtin_ia32_loadupd(x + i + 0);
-            yy0 += xx0;
-            __builtin_ia32_storeupd(r + i + 0, yy0);
-        }
-    }
-
-    for (;  i < n;  ++i) r[i] = x[i] * y[i];
-}
-
 void vec_add(const double * x, double k, const float * y, double * r, size_t n)
 {
     unsigned i = 0;
@@ -981,58 +370,21 @@ void vec_add(const double * x, double k, const float * y, double * r, size_t n)
             yy1        *= kk;
 
             v2df xx0    = __builtin_ia32_loadupd(x + i + 0);
-            yy0        += xx0;
-            __builtin_ia32_storeupd(r + i + 0, yy0);
-
-            v2df xx1    = __builtin_ia32_loadupd(x + i + 2);
-            yy1        += xx1;
-            __builtin_ia32_storeupd(r + i + 2, yy1);
-        }
-    }
-
-    for (;  i < n;  ++i) r[i] = x[i] + k * y[i];
-}
-
-void vec_add(const double * x, const float * y, double * r, size_t n)
-{
-    for (unsigned i = 0;  i < n;  ++i) r[i] = x[i] * y[i];
-}
-
-void vec_prod(const double * x, const double * y, double * r, size_t n)
-{
-    unsigned i = 0;
-    if (true) {
-        for (; i + 8 <= n;  i += 8) {
-            v2df yy0 = __builtin_ia32_loadupd(y + i + 0);
-            v2df xx0 = __builtin_ia32_loadupd(x + i + 0);
-            yy0 *= xx0;
-            __builtin_ia32_storeupd(r + i + 0, yy0);
-
-            v2df yy1 = __builtin_ia32_loadupd(y + i + 2);
-            v2df xx1 = __builtin_ia32_loadupd(x + i + 2);
-            yy1 *= xx1;
-            __builtin_ia32_storeupd(r + i + 2, yy1);
-            
-            v2df yy2 = __builtin_ia32_loadupd(y + i + 4);
-            v2df xx2 = __builtin_ia32_loadupd(x + i + 4);
-            yy2 *= xx2;
-            __builtin_ia32_storeupd(r + i + 4, yy2);
-
-            v2df yy3 = __builtin_ia32_loadupd(y + i + 6);
-            v2df xx3 = __builtin_ia32_loadupd(x + i + 6);
-            yy3 *= xx3;
-            __builtin_ia32_storeupd(r + i + 6, yy3);
-        }
-
-        for (; i + 2 <= n;  i += 2) {
-            v2df yy0 = __builtin_ia32_loadupd(y + i + 0);
-            v2df xx0 = __builtin_ia32_loadupd(x + i + 0);
-            yy0 *= xx0;
+            yy0        += xx0;
             __builtin_ia32_storeupd(r + i + 0, yy0);
+
+            v2df xx1    = __builtin_ia32_loadupd(x + i + 2);
+            yy1        += xx1;
+            __builtin_ia32_storeupd(r + i + 2, yy1);
         }
     }
 
-    for (;  i < n;  ++i) r[i] = x[i] * y[i];
+    for (;  i < n;  ++i) r[i] = x[i] + k * y[i];
+}
+
+void vec_add(const double * x, const float * y, double * r, size_t n)
+{
+    for (unsigned i = 0;  i < n;  ++i) r[i] = x[i] * y[i];
 }
 
 void vec_prod(const double * x, const float * y, double * r, size_t n)
@@ -1087,231 +439,6 @@ void vec_prod(const double * x, const float * y, double * r, size_t n)
     for (;  i < n;  ++i) r[i] = x[i] * y[i];
 }
 
-void vec_k1_x_plus_k2_y_z(double k1, const double * x,
-                          double k2, const double * y, const double * z,
-                          double * r, size_t n)
-{
-    unsigned i = 0;
-
-    v2df kk1 = vec_splat(k1);
-    v2df kk2 = vec_splat(k2);
-
-    if (true) {
-        for (; i + 8 <= n;  i += 8) {
-            v2df yy0 = __builtin_ia32_loadupd(y + i + 0);
-            v2df xx0 = __builtin_ia32_loadupd(x + i + 0);
-            v2df zz0 = __builtin_ia32_loadupd(z + i + 0);
-            yy0 *= kk2;
-            xx0 *= kk1;
-            yy0 *= zz0;
-            yy0 += xx0;
-            __builtin_ia32_storeupd(r + i + 0, yy0);
-
-            v2df yy1 = __builtin_ia32_loadupd(y + i + 2);
-            v2df xx1 = __builtin_ia32_loadupd(x + i + 2);
-            v2df zz1 = __builtin_ia32_loadupd(z + i + 2);
-            yy1 *= kk2;
-            xx1 *= kk1;
-            yy1 *= zz1;
-            yy1 += xx1;
-            __builtin_ia32_storeupd(r + i + 2, yy1);
-            
-            v2df yy2 = __builtin_ia32_loadupd(y + i + 4);
-            v2df xx2 = __builtin_ia32_loadupd(x + i + 4);
-            v2df zz2 = __builtin_ia32_loadupd(z + i + 4);
-            yy2 *= kk2;
-            xx2 *= kk1;
-            yy2 *= zz2;
-            yy2 += xx2;
-            __builtin_ia32_storeupd(r + i + 4, yy2);
-
-            v2df yy3 = __builtin_ia32_loadupd(y + i + 6);
-            v2df xx3 = __builtin_ia32_loadupd(x + i + 6);
-            v2df zz3 = __builtin_ia32_loadupd(z + i + 6);
-            yy3 *= kk2;
-            xx3 *= kk1;
-            yy3 *= zz3;
-            yy3 += xx3;
-            __builtin_ia32_storeupd(r + i + 6, yy3);
-        }
-
-        for (; i + 2 <= n;  i += 2) {
-            v2df yy0 = __builtin_ia32_loadupd(y + i + 0);
-            v2df xx0 = __builtin_ia32_loadupd(x + i + 0);
-            v2df zz0 = __builtin_ia32_loadupd(z + i + 0);
-            yy0 *= kk2;
-            xx0 *= kk1;
-            yy0 *= zz0;
-            yy0 += xx0;
-            __builtin_ia32_storeupd(r + i + 0, yy0);
-        }
-    }
-
-    for (;  i < n;  ++i) r[i] = k1 * x[i] + k2 * y[i] * z[i];
-}
-
-void vec_k1_x_plus_k2_y_z(float k1, const float * x,
-                          float k2, const float * y, const float * z,
-                          float * r, size_t n)
-{
-    unsigned i = 0;
-
-    v4sf kkkk1 = vec_splat(k1);
-    v4sf kkkk2 = vec_splat(k2);
-
-    if (true) {
-        for (; i + 16 <= n;  i += 16) {
-            v4sf yyyy0 = __builtin_ia32_loadups(y + i + 0);
-            v4sf xxxx0 = __builtin_ia32_loadups(x + i + 0);
-            v4sf zzzz0 = __builtin_ia32_loadups(z + i + 0);
-            yyyy0 *= kkkk2;
-            xxxx0 *= kkkk1;
-            yyyy0 *= zzzz0;
-            yyyy0 += xxxx0;
-            __builtin_ia32_storeups(r + i + 0, yyyy0);
-
-            v4sf yyyy1 = __builtin_ia32_loadups(y + i + 4);
-            v4sf xxxx1 = __builtin_ia32_loadups(x + i + 4);
-            v4sf zzzz1 = __builtin_ia32_loadups(z + i + 4);
-            yyyy1 *= kkkk2;
-            xxxx1 *= kkkk1;
-            yyyy1 *= zzzz1;
-            yyyy1 += xxxx1;
-            __builtin_ia32_storeups(r + i + 4, yyyy1);
-            
-            v4sf yyyy2 = __builtin_ia32_loadups(y + i + 8);
-            v4sf xxxx2 = __builtin_ia32_loadups(x + i + 8);
-            v4sf zzzz2 = __builtin_ia32_loadups(z + i + 8);
-            yyyy2 *= kkkk2;
-            xxxx2 *= kkkk1;
-            yyyy2 *= zzzz2;
-            yyyy2 += xxxx2;
-            __builtin_ia32_storeups(r + i + 8, yyyy2);
-
-            v4sf yyyy3 = __builtin_ia32_loadups(y + i + 12);
-            v4sf xxxx3 = __builtin_ia32_loadups(x + i + 12);
-            v4sf zzzz3 = __builtin_ia32_loadups(z + i + 12);
-            yyyy3 *= kkkk2;
-            xxxx3 *= kkkk1;
-            yyyy3 *= zzzz3;
-            yyyy3 += xxxx3;
-            __builtin_ia32_storeups(r + i + 12, yyyy3);
-        }
-
-        for (; i + 4 <= n;  i += 4) {
-            v4sf yyyy0 = __builtin_ia32_loadups(y + i + 0);
-            v4sf xxxx0 = __builtin_ia32_loadups(x + i + 0);
-            v4sf zzzz0 = __builtin_ia32_loadups(z + i + 0);
-            yyyy0 *= kkkk2;
-            xxxx0 *= kkkk1;
-            yyyy0 *= zzzz0;
-            yyyy0 += xxxx0;
-            __builtin_ia32_storeups(r + i + 0, yyyy0);
-        }
-    }
-
-    for (;  i < n;  ++i) r[i] = k1 * x[i] + k2 * y[i] * z[i];
-}
-
-void vec_add_sqr(const float * x, float k, const float * y, float * r, size_t n)
-{
-    unsigned i = 0;
-
-    if (true) {
-        v4sf kkkk = vec_splat(k);
-        //cerr << "unoptimized" << endl;
-
-        for (; i + 16 <= n;  i += 16) {
-            v4sf yyyy0 = __builtin_ia32_loadups(y + i + 0);
-            v4sf xxxx0 = __builtin_ia32_loadups(x + i + 0);
-            yyyy0 *= yyyy0;
-            yyyy0 *= kkkk;
-            v4sf yyyy1 = __builtin_ia32_loadups(y + i + 4);
-            yyyy1 *= yyyy1;
-            yyyy0 += xxxx0;
-            v4sf xxxx1 = __builtin_ia32_loadups(x + i + 4);
-            __builtin_ia32_storeups(r + i + 0, yyyy0);
-            yyyy1 *= kkkk;
-            v4sf yyyy2 = __builtin_ia32_loadups(y + i + 8);
-            yyyy1 += xxxx1;
-            yyyy2 *= yyyy2;
-            v4sf xxxx2 = __builtin_ia32_loadups(x + i + 8);
-            __builtin_ia32_storeups(r + i + 4, yyyy1);
-            yyyy2 *= kkkk;
-            v4sf yyyy3 = __builtin_ia32_loadups(y + i + 12);
-            yyyy2 += xxxx2;
-            yyyy3 *= yyyy3;
-            v4sf xxxx3 = __builtin_ia32_loadups(x + i + 12);
-            __builtin_ia32_storeups(r + i + 8, yyyy2);
-            yyyy3 *= kkkk;
-            yyyy3 += xxxx3;
-            __builtin_ia32_storeups(r + i + 12, yyyy3);
-        }
-
-        for (; i + 4 <= n;  i += 4) {
-            v4sf yyyy0 = __builtin_ia32_loadups(y + i + 0);
-            v4sf xxxx0 = __builtin_ia32_loadups(x + i + 0);
-            yyyy0 *= yyyy0;
-            yyyy0 *= kkkk;
-            yyyy0 += xxxx0;
-            __builtin_ia32_storeups(r + i + 0, yyyy0);
-        }
-
-        for (; i < n;  ++i) r[i] = x[i] + k * (y[i] * y[i]);
-    }
-}
-
-void vec_add_sqr(const double * x, double k, const double * y, double * r,
-                 size_t n)
-{
-    v2df kk = vec_splat(k);
-    unsigned i = 0;
-
-    if (true) {
-        for (; i + 8 <= n;  i += 8) {
-            v2df yy0 = __builtin_ia32_loadupd(y + i + 0);
-            v2df xx0 = __builtin_ia32_loadupd(x + i + 0);
-            yy0 *= yy0;
-            yy0 *= kk;
-            yy0 += xx0;
-            __builtin_ia32_storeupd(r + i + 0, yy0);
-
-            v2df yy1 = __builtin_ia32_loadupd(y + i + 2);
-            v2df xx1 = __builtin_ia32_loadupd(x + i + 2);
-            yy1 *= yy1;
-            yy1 *= kk;
-            yy1 += xx1;
-            __builtin_ia32_storeupd(r + i + 2, yy1);
-            
-            v2df yy2 = __builtin_ia32_loadupd(y + i + 4);
-            v2df xx2 = __builtin_ia32_loadupd(x + i + 4);
-            yy2 *= yy2;
-            yy2 *= kk;
-            yy2 += xx2;
-            __builtin_ia32_storeupd(r + i + 4, yy2);
-
-            v2df yy3 = __builtin_ia32_loadupd(y + i + 6);
-            v2df xx3 = __builtin_ia32_loadupd(x + i + 6);
-            yy3 *= yy3;
-            yy3 *= kk;
-            yy3 += xx3;
-            __builtin_ia32_storeupd(r + i + 6, yy3);
-
-        }
-
-        for (; i + 2 <= n;  i += 2) {
-            v2df yy0 = __builtin_ia32_loadupd(y + i + 0);
-            v2df xx0 = __builtin_ia32_loadupd(x + i + 0);
-            yy0 *= yy0;
-            yy0 *= kk;
-            yy0 += xx0;
-            __builtin_ia32_storeupd(r + i + 0, yy0);
-        }
-    }
-
-    for (;  i < n;  ++i) r[i] = x[i] + k * (y[i] * y[i]);
-}
-
 void vec_add_sqr(const float * x, float k, const double * y, float * r, size_t n)
 {
     for (unsigned i = 0; i < n;  ++i) r[i] = x[i] + k * (y[i] * y[i]);
@@ -1646,6 +773,149 @@ void vec_min_max_el(const float * x, float * mins, float * maxs, size_t n)
     }
 }
 
+
+/*****************************************************************************/
+/* DISPATCHED KERNELS                                                        */
+/*****************************************************************************/
+
+/* These call the version for the widest instruction set that the CPU
+   supports, which is looked up the first time one of them is called.  The
+   branch always goes the same way, so costs next to nothing.
+*/
+
+namespace {
+
+enum KernelIsa {
+    ISA_SSE2,
+    ISA_AVX2,
+    ISA_AVX512
+};
+
+KernelIsa detect_kernel_isa()
+{
+    if (has_avx512f()) return ISA_AVX512;
+    if (has_avx2()) return ISA_AVX2;
+    return ISA_SSE2;
+}
+
+KernelIsa kernel_isa()
+{
+    static const KernelIsa result = detect_kernel_isa();
+    return result;
+}
+
+} // file scope
+
+#define JML_DISPATCH_KERNEL(call) \
+    switch (kernel_isa()) { \
+    case ISA_AVX512: return AVX512::call; \
+    case ISA_AVX2:   return AVX2::call; \
+    default:         return SSE2::call; \
+    }
+
+const char * vec_kernel_isa()
+{
+    switch (kernel_isa()) {
+    case ISA_AVX512: return "avx512";
+    case ISA_AVX2:   return "avx2";
+    default:         return "sse2";
+    }
+}
+
+void vec_scale(const float * x, float k, float * r, size_t n)
+{
+    JML_DISPATCH_KERNEL(vec_scale(x, k, r, n));
+}
+
+void vec_add(const float * x, const float * y, float * r, size_t n)
+{
+    JML_DISPATCH_KERNEL(vec_add(x, y, r, n));
+}
+
+void vec_add(const float * x, float k, const float * y, float * r, size_t n)
+{
+    JML_DISPATCH_KERNEL(vec_add(x, k, y, r, n));
+}
+
+void vec_add(const float * x, const float * k, const float * y, float * r,
+             size_t n)
+{
+    JML_DISPATCH_KERNEL(vec_add(x, k, y, r, n));
+}
+
+void vec_prod(const float * x, const float * y, float * r, size_t n)
+{
+    JML_DISPATCH_KERNEL(vec_prod(x, y, r, n));
+}
+
+void vec_add_sqr(const float * x, float k, const float * y, float * r, size_t n)
+{
+    JML_DISPATCH_KERNEL(vec_add_sqr(x, k, y, r, n));
+}
+
+void vec_k1_x_plus_k2_y_z(float k1, const float * x,
+                          float k2, const float * y, const float * z,
+                          float * r, size_t n)
+{
+    JML_DISPATCH_KERNEL(vec_k1_x_plus_k2_y_z(k1, x, k2, y, z, r, n));
+}
+
+void vec_scale(const double * x, double k, double * r, size_t n)
+{
+    JML_DISPATCH_KERNEL(vec_scale(x, k, r, n));
+}
+
+void vec_add(const double * x, const double * y, double * r, size_t n)
+{
+    JML_DISPATCH_KERNEL(vec_add(x, y, r, n));
+}
+
+void vec_add(const double * x, double k, const double * y, double * r,
+             size_t n)
+{
+    JML_DISPATCH_KERNEL(vec_add(x, k, y, r, n));
+}
+
+void vec_add(const double * x, const double * k, const double * y,
+             double * r, size_t n)
+{
+    JML_DISPATCH_KERNEL(vec_add(x, k, y, r, n));
+}
+
+void vec_prod(const double * x, const double * y, double * r, size_t n)
+{
+    JML_DISPATCH_KERNEL(vec_prod(x, y, r, n));
+}
+
+void vec_add_sqr(const double * x, double k, const double * y, double * r,
+                 size_t n)
+{
+    JML_DISPATCH_KERNEL(vec_add_sqr(x, k, y, r, n));
+}
+
+void vec_k1_x_plus_k2_y_z(double k1, const double * x,
+                          double k2, const double * y, const double * z,
+                          double * r, size_t n)
+{
+    JML_DISPATCH_KERNEL(vec_k1_x_plus_k2_y_z(k1, x, k2, y, z, r, n));
+}
+
+double vec_dotprod(const double * x, const double * y, size_t n)
+{
+    JML_DISPATCH_KERNEL(vec_dotprod(x, y, n));
+}
+
+double vec_dotprod_dp(const float * x, const float * y, size_t n)
+{
+    JML_DISPATCH_KERNEL(vec_dotprod_dp(x, y, n));
+}
+
+double vec_accum_prod3(const float * x, const float * y, const float * z,
+                       size_t n)
+{
+    JML_DISPATCH_KERNEL(vec_accum_prod3(x, y, z, n));
+}
+
 } // namespace Generic
 
 } // namespace SIMD
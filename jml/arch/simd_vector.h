@@ -183,19 +183,67 @@ double vec_kl(const float * p, const float * q, size_t n);
 // Simultaneous min and max
 void vec_min_max_el(const float * x, float * mins, float * maxs, size_t n);
 
+// Name of the instruction set that the kernels below are run with: "sse2",
+// "avx2" or "avx512".
+const char * vec_kernel_isa();
+
 } // namespace Generic
 
+/* Kernels with a version for each instruction set, which all give exactly
+   the same results.  The versions above call the best one that the CPU
+   supports, which is chosen the first time that they are called; the ones
+   in each namespace are there for testing and benchmarking.
+*/
+#define JML_SIMD_VECTOR_KERNELS \
+    void vec_scale(const float * x, float factor, float * r, size_t n); \
+    void vec_add(const float * x, const float * y, float * r, size_t n); \
+    void vec_add(const float * x, float k, const float * y, float * r, \
+                 size_t n); \
+    void vec_add(const float * x, const float * k, const float * y, \
+                 float * r, size_t n); \
+    void vec_prod(const float * x, const float * y, float * r, size_t n); \
+    void vec_add_sqr(const float * x, float k, const float * y, float * r, \
+                     size_t n); \
+    void vec_k1_x_plus_k2_y_z(float k1, const float * x, \
+                              float k2, const float * y, const float * z, \
+                              float * r, size_t n); \
+    void vec_scale(const double * x, double factor, double * r, size_t n); \
+    void vec_add(const double * x, const double * y, double * r, size_t n); \
+    void vec_add(const double * x, double k, const double * y, double * r, \
+                 size_t n); \
+    void vec_add(const double * x, const double * k, const double * y, \
+                 double * r, size_t n); \
+    void vec_prod(const double * x, const double * y, double * r, size_t n); \
+    void vec_add_sqr(const double * x, double k, const double * y, \
+                     double * r, size_t n); \
+    void vec_k1_x_plus_k2_y_z(double k1, const double * x, \
+                              double k2, const double * y, const double * z, \
+                              double * r, size_t n); \
+    double vec_dotprod(const double * x, const double * y, size_t n); \
+    double vec_dotprod_dp(const float * x, const float * y, size_t n); \
+    double vec_accum_prod3(const float * x, const float * y, \
+                           const float * z, size_t n);
+
 #if JML_USE_SSE1
 
 namespace SSE1 {
 } // namespace SSE1
 
 namespace SSE2 {
+JML_SIMD_VECTOR_KERNELS
 } // namespace SSE2
 
 namespace SSE3 {
 } // namespace SSE3
 
+namespace AVX2 {
+JML_SIMD_VECTOR_KERNELS
+} // namespace AVX2
+
+namespace AVX512 {
+JML_SIMD_VECTOR_KERNELS
+} // namespace AVX512
+
 #endif /* __i686 */
 
 using namespace Generic;
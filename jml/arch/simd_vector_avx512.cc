@@ -0,0 +1,113 @@
+/* simd_vector_avx512.cc
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   AVX-512 versions of the SIMD vector kernels.  This file is compiled with
+   -mavx512f, so must only be called once the CPU is known to support it.
+*/
+
+#include "simd_vector.h"
+#define JML_SIMD_VECTOR_BYTES 64
+#include "simd_vector_kernels.h"
+
+
+namespace ML {
+namespace SIMD {
+namespace AVX512 {
+
+void vec_scale(const float * x, float k, float * r, size_t n)
+{
+    Kernels::vec_scale(x, k, r, n);
+}
+
+void vec_add(const float * x, const float * y, float * r, size_t n)
+{
+    Kernels::vec_add(x, y, r, n);
+}
+
+void vec_add(const float * x, float k, const float * y, float * r, size_t n)
+{
+    Kernels::vec_add(x, k, y, r, n);
+}
+
+void vec_add(const float * x, const float * k, const float * y, float * r,
+             size_t n)
+{
+    Kernels::vec_add(x, k, y, r, n);
+}
+
+void vec_prod(const float * x, const float * y, float * r, size_t n)
+{
+    Kernels::vec_prod(x, y, r, n);
+}
+
+void vec_add_sqr(const float * x, float k, const float * y, float * r, size_t n)
+{
+    Kernels::vec_add_sqr(x, k, y, r, n);
+}
+
+void vec_k1_x_plus_k2_y_z(float k1, const float * x,
+                          float k2, const float * y, const float * z,
+                          float * r, size_t n)
+{
+    Kernels::vec_k1_x_plus_k2_y_z(k1, x, k2, y, z, r, n);
+}
+
+void vec_scale(const double * x, double k, double * r, size_t n)
+{
+    Kernels::vec_scale(x, k, r, n);
+}
+
+void vec_add(const double * x, const double * y, double * r, size_t n)
+{
+    Kernels::vec_add(x, y, r, n);
+}
+
+void vec_add(const double * x, double k, const double * y, double * r,
+             size_t n)
+{
+    Kernels::vec_add(x, k, y, r, n);
+}
+
+void vec_add(const double * x, const double * k, const double * y,
+             double * r, size_t n)
+{
+    Kernels::vec_add(x, k, y, r, n);
+}
+
+void vec_prod(const double * x, const double * y, double * r, size_t n)
+{
+    Kernels::vec_prod(x, y, r, n);
+}
+
+void vec_add_sqr(const double * x, double k, const double * y, double * r,
+                 size_t n)
+{
+    Kernels::vec_add_sqr(x, k, y, r, n);
+}
+
+void vec_k1_x_plus_k2_y_z(double k1, const double * x,
+                          double k2, const double * y, const double * z,
+                          double * r, size_t n)
+{
+    Kernels::vec_k1_x_plus_k2_y_z(k1, x, k2, y, z, r, n);
+}
+
+double vec_dotprod(const double * x, const double * y, size_t n)
+{
+    return Kernels::vec_dotprod(x, y, n);
+}
+
+double vec_dotprod_dp(const float * x, const float * y, size_t n)
+{
+    return Kernels::vec_dotprod_dp(x, y, n);
+}
+
+double vec_accum_prod3(const float * x, const float * y, const float * z,
+                       size_t n)
+{
+    return Kernels::vec_accum_prod3(x, y, z, n);
+}
+
+} // namespace AVX512
+} // namespace SIMD
+} // namespace ML
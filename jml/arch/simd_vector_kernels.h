@@ -0,0 +1,318 @@
+/* simd_vector_kernels.h                                           -*- C++ -*-
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Vector kernels written once, for whatever instruction set the including
+   file is compiled for.
+*/
+
+/* This file is only included by the simd_vector_*.cc files, each of which
+   is compiled with the code generation options for one instruction set and
+   defines JML_SIMD_VECTOR_BYTES to the width of its vector registers.
+
+   Everything is in an anonymous namespace, so that the linker can never use
+   the copy compiled with one set of options in place of another.
+
+   The elementwise kernels perform exactly the same operations in the same
+   order as the SSE2 versions in simd_vector_sse2.cc, and so produce
+   exactly the same results.  The files must be compiled with
+   -ffp-contract=off so that the compiler can't fuse a multiply and an add,
+   which would round differently.
+
+   The reductions accumulate into 16 lanes, where lane j sums the products
+   of elements i with i % 16 == j, over all of the complete blocks of 16
+   elements.  The lanes are then summed pairwise as a tree and the
+   remaining elements are added one by one.  That order is the same
+   whatever the vector width, so that a model gives exactly the same
+   results on every machine, and has enough independent additions to keep
+   the floating point units busy.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include "jml/compiler/compiler.h"
+
+#ifndef JML_SIMD_VECTOR_BYTES
+#  error "JML_SIMD_VECTOR_BYTES must be defined before including this file"
+#endif
+
+
+namespace ML {
+namespace SIMD {
+namespace {
+namespace Kernels {
+
+typedef float Floats __attribute__((__vector_size__(JML_SIMD_VECTOR_BYTES)));
+typedef double Doubles __attribute__((__vector_size__(JML_SIMD_VECTOR_BYTES)));
+
+/// Floats which convert to a full vector of doubles
+typedef float HalfFloats
+    __attribute__((__vector_size__(JML_SIMD_VECTOR_BYTES / 2)));
+
+enum {
+    FLOATS = sizeof(Floats) / sizeof(float),
+    DOUBLES = sizeof(Doubles) / sizeof(double),
+    LANES = 16,
+    LANE_VECTORS = LANES / DOUBLES
+};
+
+template<typename V, typename F>
+JML_ALWAYS_INLINE V load(const F * p)
+{
+    V result;
+    std::memcpy(&result, p, sizeof(result));
+    return result;
+}
+
+template<typename V, typename F>
+JML_ALWAYS_INLINE void store(F * p, const V & v)
+{
+    std::memcpy(p, &v, sizeof(v));
+}
+
+template<typename V, typename F>
+JML_ALWAYS_INLINE V splat(F val)
+{
+    V result;
+    for (unsigned i = 0;  i < sizeof(V) / sizeof(F);  ++i)
+        result[i] = val;
+    return result;
+}
+
+/** The 16 lanes of a reduction, held in as many vectors as needed. */
+struct Lanes {
+    Lanes()
+    {
+        for (unsigned v = 0;  v < LANE_VECTORS;  ++v)
+            vec[v] = Doubles{};
+    }
+
+    Doubles vec[LANE_VECTORS];
+
+    /** Sum the lanes as a tree, adding the upper half of the lanes onto
+        the lower half until there is only one left.
+    */
+    double sum() const
+    {
+        double l[LANES];
+        std::memcpy(l, vec, sizeof(l));
+        for (unsigned width = LANES / 2;  width > 0;  width /= 2)
+            for (unsigned j = 0;  j < width;  ++j)
+                l[j] += l[j + width];
+        return l[0];
+    }
+};
+
+
+/*****************************************************************************/
+/* FLOAT ELEMENTWISE                                                         */
+/*****************************************************************************/
+
+inline void vec_scale(const float * x, float k, float * r, size_t n)
+{
+    Floats kk = splat<Floats>(k);
+    size_t i = 0;
+    for (; i + FLOATS <= n;  i += FLOATS)
+        store(r + i, load<Floats>(x + i) * kk);
+    for (; i < n;  ++i) r[i] = k * x[i];
+}
+
+inline void vec_add(const float * x, const float * y, float * r, size_t n)
+{
+    size_t i = 0;
+    for (; i + FLOATS <= n;  i += FLOATS)
+        store(r + i, load<Floats>(y + i) + load<Floats>(x + i));
+    for (; i < n;  ++i) r[i] = x[i] + y[i];
+}
+
+inline void vec_add(const float * x, float k, const float * y, float * r,
+                    size_t n)
+{
+    Floats kk = splat<Floats>(k);
+    size_t i = 0;
+    for (; i + FLOATS <= n;  i += FLOATS)
+        store(r + i, load<Floats>(y + i) * kk + load<Floats>(x + i));
+    for (; i < n;  ++i) r[i] = x[i] + k * y[i];
+}
+
+inline void vec_add(const float * x, const float * k, const float * y,
+                    float * r, size_t n)
+{
+    size_t i = 0;
+    for (; i + FLOATS <= n;  i += FLOATS)
+        store(r + i,
+              load<Floats>(y + i) * load<Floats>(k + i) + load<Floats>(x + i));
+    for (; i < n;  ++i) r[i] = x[i] + k[i] * y[i];
+}
+
+inline void vec_prod(const float * x, const float * y, float * r, size_t n)
+{
+    size_t i = 0;
+    for (; i + FLOATS <= n;  i += FLOATS)
+        store(r + i, load<Floats>(y + i) * load<Floats>(x + i));
+    for (; i < n;  ++i) r[i] = x[i] * y[i];
+}
+
+inline void vec_add_sqr(const float * x, float k, const float * y, float * r,
+                        size_t n)
+{
+    Floats kk = splat<Floats>(k);
+    size_t i = 0;
+    for (; i + FLOATS <= n;  i += FLOATS) {
+        Floats yy = load<Floats>(y + i);
+        store(r + i, (yy * yy) * kk + load<Floats>(x + i));
+    }
+    for (; i < n;  ++i) r[i] = x[i] + k * (y[i] * y[i]);
+}
+
+inline void vec_k1_x_plus_k2_y_z(float k1, const float * x,
+                                 float k2, const float * y, const float * z,
+                                 float * r, size_t n)
+{
+    Floats kk1 = splat<Floats>(k1), kk2 = splat<Floats>(k2);
+    size_t i = 0;
+    for (; i + FLOATS <= n;  i += FLOATS)
+        store(r + i,
+              (load<Floats>(y + i) * kk2) * load<Floats>(z + i)
+              + load<Floats>(x + i) * kk1);
+    for (; i < n;  ++i) r[i] = k1 * x[i] + k2 * y[i] * z[i];
+}
+
+
+/*****************************************************************************/
+/* DOUBLE ELEMENTWISE                                                        */
+/*****************************************************************************/
+
+inline void vec_scale(const double * x, double k, double * r, size_t n)
+{
+    Doubles kk = splat<Doubles>(k);
+    size_t i = 0;
+    for (; i + DOUBLES <= n;  i += DOUBLES)
+        store(r + i, load<Doubles>(x + i) * kk);
+    for (; i < n;  ++i) r[i] = k * x[i];
+}
+
+inline void vec_add(const double * x, const double * y, double * r, size_t n)
+{
+    size_t i = 0;
+    for (; i + DOUBLES <= n;  i += DOUBLES)
+        store(r + i, load<Doubles>(y + i) + load<Doubles>(x + i));
+    for (; i < n;  ++i) r[i] = x[i] + y[i];
+}
+
+inline void vec_add(const double * x, double k, const double * y, double * r,
+                    size_t n)
+{
+    Doubles kk = splat<Doubles>(k);
+    size_t i = 0;
+    for (; i + DOUBLES <= n;  i += DOUBLES)
+        store(r + i, load<Doubles>(y + i) * kk + load<Doubles>(x + i));
+    for (; i < n;  ++i) r[i] = x[i] + k * y[i];
+}
+
+inline void vec_add(const double * x, const double * k, const double * y,
+                    double * r, size_t n)
+{
+    size_t i = 0;
+    for (; i + DOUBLES <= n;  i += DOUBLES)
+        store(r + i,
+              load<Doubles>(y + i) * load<Doubles>(k + i)
+              + load<Doubles>(x + i));
+    for (; i < n;  ++i) r[i] = x[i] + k[i] * y[i];
+}
+
+inline void vec_prod(const double * x, const double * y, double * r, size_t n)
+{
+    size_t i = 0;
+    for (; i + DOUBLES <= n;  i += DOUBLES)
+        store(r + i, load<Doubles>(y + i) * load<Doubles>(x + i));
+    for (; i < n;  ++i) r[i] = x[i] * y[i];
+}
+
+inline void vec_add_sqr(const double * x, double k, const double * y,
+                        double * r, size_t n)
+{
+    Doubles kk = splat<Doubles>(k);
+    size_t i = 0;
+    for (; i + DOUBLES <= n;  i += DOUBLES) {
+        Doubles yy = load<Doubles>(y + i);
+        store(r + i, (yy * yy) * kk + load<Doubles>(x + i));
+    }
+    for (; i < n;  ++i) r[i] = x[i] + k * (y[i] * y[i]);
+}
+
+inline void vec_k1_x_plus_k2_y_z(double k1, const double * x,
+                                 double k2, const double * y, const double * z,
+                                 double * r, size_t n)
+{
+    Doubles kk1 = splat<Doubles>(k1), kk2 = splat<Doubles>(k2);
+    size_t i = 0;
+    for (; i + DOUBLES <= n;  i += DOUBLES)
+        store(r + i,
+              (load<Doubles>(y + i) * kk2) * load<Doubles>(z + i)
+              + load<Doubles>(x + i) * kk1);
+    for (; i < n;  ++i) r[i] = k1 * x[i] + k2 * y[i] * z[i];
+}
+
+
+/*****************************************************************************/
+/* REDUCTIONS                                                                */
+/*****************************************************************************/
+
+inline double vec_dotprod(const double * x, const double * y, size_t n)
+{
+    Lanes lanes;
+    size_t i = 0;
+    for (; i + LANES <= n;  i += LANES) {
+        for (unsigned v = 0;  v < LANE_VECTORS;  ++v) {
+            size_t j = i + v * DOUBLES;
+            lanes.vec[v] += load<Doubles>(x + j) * load<Doubles>(y + j);
+        }
+    }
+
+    double result = lanes.sum();
+    for (; i < n;  ++i) result += x[i] * y[i];
+    return result;
+}
+
+inline double vec_dotprod_dp(const float * x, const float * y, size_t n)
+{
+    Lanes lanes;
+    size_t i = 0;
+    for (; i + LANES <= n;  i += LANES) {
+        for (unsigned v = 0;  v < LANE_VECTORS;  ++v) {
+            size_t j = i + v * DOUBLES;
+            HalfFloats prod = load<HalfFloats>(x + j) * load<HalfFloats>(y + j);
+            lanes.vec[v] += __builtin_convertvector(prod, Doubles);
+        }
+    }
+
+    double result = lanes.sum();
+    for (; i < n;  ++i) result += x[i] * y[i];
+    return result;
+}
+
+inline double vec_accum_prod3(const float * x, const float * y,
+                              const float * z, size_t n)
+{
+    Lanes lanes;
+    size_t i = 0;
+    for (; i + LANES <= n;  i += LANES) {
+        for (unsigned v = 0;  v < LANE_VECTORS;  ++v) {
+            size_t j = i + v * DOUBLES;
+            HalfFloats prod = load<HalfFloats>(x + j) * load<HalfFloats>(y + j)
+                * load<HalfFloats>(z + j);
+            lanes.vec[v] += __builtin_convertvector(prod, Doubles);
+        }
+    }
+
+    double result = lanes.sum();
+    for (; i < n;  ++i) result += x[i] * y[i] * z[i];
+    return result;
+}
+
+} // namespace Kernels
+} // file scope
+} // namespace SIMD
+} // namespace ML
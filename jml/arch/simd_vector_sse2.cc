@@ -0,0 +1,727 @@
+/* simd_vector_sse2.cc
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   SSE2 versions of the SIMD vector kernels that have a version for each
+   instruction set.
+*/
+
+#include "simd_vector.h"
+#define JML_SIMD_VECTOR_BYTES 16
+#include "simd_vector_kernels.h"
+#include "jml/compiler/compiler.h"
+#include "sse2.h"
+
+
+namespace ML {
+namespace SIMD {
+namespace SSE2 {
+
+template<typename X>
+int ptr_align(const X * p) 
+{
+    return size_t(p) & 15;
+}
+
+
+/*****************************************************************************/
+/* ELEMENTWISE                                                               */
+/*****************************************************************************/
+
+void vec_scale(const float * x, float k, float * r, size_t n)
+{
+    v4sf kkkk = vec_splat(k);
+    unsigned i = 0;
+
+    if (false) ;
+    else {
+        for (; i + 16 <= n;  i += 16) {
+            v4sf xxxx0 = __builtin_ia32_loadups(x + i + 0);
+            xxxx0 *= kkkk;
+            v4sf xxxx1 = __builtin_ia32_loadups(x + i + 4);
+            __builtin_ia32_storeups(r + i + 0, xxxx0);
+            xxxx1 *= kkkk;
+            v4sf xxxx2 = __builtin_ia32_loadups(x + i + 8);
+            __builtin_ia32_storeups(r + i + 4, xxxx1);
+            xxxx2 *= kkkk;
+            v4sf xxxx3 = __builtin_ia32_loadups(x + i + 12);
+            __builtin_ia32_storeups(r + i + 8, xxxx2);
+            xxxx3 *= kkkk;
+            __builtin_ia32_storeups(r + i + 12, xxxx3);
+        }
+    
+        for (; i + 4 <= n;  i += 4) {
+            v4sf xxxx0 = __builtin_ia32_loadups(x + i + 0);
+            xxxx0 *= kkkk;
+            __builtin_ia32_storeups(r + i + 0, xxxx0);
+        }
+    }
+    
+    for (; i < n;  ++i) r[i] = k * x[i];
+}
+
+void vec_add(const float * x, const float * y, float * r, size_t n)
+{
+    unsigned i = 0;
+
+    if (false) ;
+    else {
+        //cerr << "unoptimized" << endl;
+
+        for (; i + 16 <= n;  i += 16) {
+            v4sf yyyy0 = __builtin_ia32_loadups(y + i + 0);
+            v4sf xxxx0 = __builtin_ia32_loadups(x + i + 0);
+            v4sf yyyy1 = __builtin_ia32_loadups(y + i + 4);
+            yyyy0 += xxxx0;
+            v4sf xxxx1 = __builtin_ia32_loadups(x + i + 4);
+            __builtin_ia32_storeups(r + i + 0, yyyy0);
+            v4sf yyyy2 = __builtin_ia32_loadups(y + i + 8);
+            yyyy1 += xxxx1;
+            v4sf xxxx2 = __builtin_ia32_loadups(x + i + 8);
+            __builtin_ia32_storeups(r + i + 4, yyyy1);
+            v4sf yyyy3 = __builtin_ia32_loadups(y + i + 12);
+            yyyy2 += xxxx2;
+            v4sf xxxx3 = __builtin_ia32_loadups(x + i + 12);
+            __builtin_ia32_storeups(r + i + 8, yyyy2);
+            yyyy3 += xxxx3;
+            __builtin_ia32_storeups(r + i + 12, yyyy3);
+        }
+
+        for (; i + 4 <= n;  i += 4) {
+            v4sf yyyy0 = __builtin_ia32_loadups(y + i + 0);
+            v4sf xxxx0 = __builtin_ia32_loadups(x + i + 0);
+            yyyy0 += xxxx0;
+            __builtin_ia32_storeups(r + i + 0, yyyy0);
+        }
+        
+        for (; i < n;  ++i) r[i] = x[i] + y[i];
+    }
+}
+
+void vec_prod(const float * x, const float * y, float * r, size_t n)
+{
+    unsigned i = 0;
+
+    if (false) ;
+    else {
+        //cerr << "unoptimized" << endl;
+        
+        for (; i + 16 <= n;  i += 16) {
+            v4sf yyyy0 = __builtin_ia32_loadups(y + i + 0);
+            v4sf xxxx0 = __builtin_ia32_loadups(x + i + 0);
+            v4sf yyyy1 = __builtin_ia32_loadups(y + i + 4);
+            yyyy0 *= xxxx0;
+            v4sf xxxx1 = __builtin_ia32_loadups(x + i + 4);
+            __builtin_ia32_storeups(r + i + 0, yyyy0);
+            v4sf yyyy2 = __builtin_ia32_loadups(y + i + 8);
+            yyyy1 *= xxxx1;
+            v4sf xxxx2 = __builtin_ia32_loadups(x + i + 8);
+            __builtin_ia32_storeups(r + i + 4, yyyy1);
+            v4sf yyyy3 = __builtin_ia32_loadups(y + i + 12);
+            yyyy2 *= xxxx2;
+            v4sf xxxx3 = __builtin_ia32_loadups(x + i + 12);
+            __builtin_ia32_storeups(r + i + 8, yyyy2);
+            yyyy3 *= xxxx3;
+            __builtin_ia32_storeups(r + i + 12, yyyy3);
+        }
+
+        for (; i + 4 <= n;  i += 4) {
+            v4sf yyyy0 = __builtin_ia32_loadups(y + i + 0);
+            v4sf xxxx0 = __builtin_ia32_loadups(x + i + 0);
+            yyyy0 *= xxxx0;
+            __builtin_ia32_storeups(r + i + 0, yyyy0);
+        }
+        
+        for (; i < n;  ++i) r[i] = x[i] * y[i];
+    }
+}
+
+void vec_add(const float * x, float k, const float * y, float * r, size_t n)
+{
+    v4sf kkkk = vec_splat(k);
+    unsigned i = 0;
+
+    //bool alignment_unimportant = true;  // nehalem?
+
+    if (false && n >= 16 && (ptr_align(x) == ptr_align(y) && ptr_align(y) == ptr_align(r))) {
+
+        /* Align everything on 16 byte boundaries */
+        if (ptr_align(x) != 0) {
+            int needed_to_align = (16 - ptr_align(x)) / 4;
+            
+            for (unsigned i = 0;  i < needed_to_align;  ++i)
+                r[i] = x[i] + k * y[i];
+
+            r += needed_to_align;  x += needed_to_align;  y += needed_to_align;
+            n -= needed_to_align;
+        }
+
+        //cerr << "optimized" << endl;
+
+        while (n > 16) {
+            const v4sf * xx = reinterpret_cast<const v4sf *>(x);
+            const v4sf * yy = reinterpret_cast<const v4sf *>(y);
+            v4sf * rr = reinterpret_cast<v4sf *>(r);
+            
+            v4sf yyyy0 = yy[0];
+            v4sf xxxx0 = xx[0];
+            yyyy0 *= kkkk;
+            v4sf yyyy1 = yy[1];
+            yyyy0 += xxxx0;
+            v4sf xxxx1 = xx[1];
+            rr[0] = yyyy0;
+            yyyy1 *= kkkk;
+            v4sf yyyy2 = yy[2];
+            yyyy1 += xxxx1;
+            v4sf xxxx2 = xx[2];
+            rr[1] = yyyy1;
+            yyyy2 *= kkkk;
+            v4sf yyyy3 = yy[3];
+            yyyy2 += xxxx2;
+            v4sf xxxx3 = xx[3];
+            rr[2] = yyyy2;
+            yyyy3 *= kkkk;
+            yyyy3 += xxxx3;
+            rr[3] = yyyy3;
+
+            r += 16;  x += 16;  y += 16;  n -= 16;
+        }
+
+        for (unsigned i = 0;  i < n;  ++i) r[i] = x[i] + k * y[i];
+    }
+    else {
+        //cerr << "unoptimized" << endl;
+
+        for (; i + 16 <= n;  i += 16) {
+            v4sf yyyy0 = __builtin_ia32_loadups(y + i + 0);
+            v4sf xxxx0 = __builtin_ia32_loadups(x + i + 0);
+            yyyy0 *= kkkk;
+            v4sf yyyy1 = __builtin_ia32_loadups(y + i + 4);
+            yyyy0 += xxxx0;
+            v4sf xxxx1 = __builtin_ia32_loadups(x + i + 4);
+            __builtin_ia32_storeups(r + i + 0, yyyy0);
+            yyyy1 *= kkkk;
+            v4sf yyyy2 = __builtin_ia32_loadups(y + i + 8);
+            yyyy1 += xxxx1;
+            v4sf xxxx2 = __builtin_ia32_loadups(x + i + 8);
+            __builtin_ia32_storeups(r + i + 4, yyyy1);
+            yyyy2 *= kkkk;
+            v4sf yyyy3 = __builtin_ia32_loadups(y + i + 12);
+            yyyy2 += xxxx2;
+            v4sf xxxx3 = __builtin_ia32_loadups(x + i + 12);
+            __builtin_ia32_storeups(r + i + 8, yyyy2);
+            yyyy3 *= kkkk;
+            yyyy3 += xxxx3;
+            __builtin_ia32_storeups(r + i + 12, yyyy3);
+        }
+
+        for (; i + 4 <= n;  i += 4) {
+            v4sf yyyy0 = __builtin_ia32_loadups(y + i + 0);
+            v4sf xxxx0 = __builtin_ia32_loadups(x + i + 0);
+            yyyy0 *= kkkk;
+            yyyy0 += xxxx0;
+            __builtin_ia32_storeups(r + i + 0, yyyy0);
+        }
+
+        for (; i < n;  ++i) r[i] = x[i] + k * y[i];
+    }
+}
+
+void vec_add(const float * x, const float * k, const float * y, float * r,
+             size_t n)
+{
+    unsigned i = 0;
+
+    if (true) {
+        for (; i + 16 <= n;  i += 16) {
+            v4sf yyyy0 = __builtin_ia32_loadups(y + i + 0);
+            v4sf kkkk0 = __builtin_ia32_loadups(k + i + 0);
+            v4sf xxxx0 = __builtin_ia32_loadups(x + i + 0);
+            yyyy0 *= kkkk0;
+            v4sf yyyy1 = __builtin_ia32_loadups(y + i + 4);
+            v4sf kkkk1 = __builtin_ia32_loadups(k + i + 4);
+            yyyy0 += xxxx0;
+            v4sf xxxx1 = __builtin_ia32_loadups(x + i + 4);
+            __builtin_ia32_storeups(r + i + 0, yyyy0);
+            yyyy1 *= kkkk1;
+            v4sf yyyy2 = __builtin_ia32_loadups(y + i + 8);
+            v4sf kkkk2 = __builtin_ia32_loadups(k + i + 8);
+            yyyy1 += xxxx1;
+            v4sf xxxx2 = __builtin_ia32_loadups(x + i + 8);
+            __builtin_ia32_storeups(r + i + 4, yyyy1);
+            yyyy2 *= kkkk2;
+            v4sf yyyy3 = __builtin_ia32_loadups(y + i + 12);
+            v4sf kkkk3 = __builtin_ia32_loadups(k + i + 12);
+            yyyy2 += xxxx2;
+            v4sf xxxx3 = __builtin_ia32_loadups(x + i + 12);
+            __builtin_ia32_storeups(r + i + 8, yyyy2);
+            yyyy3 *= kkkk3;
+            yyyy3 += xxxx3;
+            __builtin_ia32_storeups(r + i + 12, yyyy3);
+        }
+
+        for (; i + 4 <= n;  i += 4) {
+            v4sf yyyy0 = __builtin_ia32_loadups(y + i + 0);
+            v4sf xxxx0 = __builtin_ia32_loadups(x + i + 0);
+            v4sf kkkk0 = __builtin_ia32_loadups(k + i + 0);
+            yyyy0 *= kkkk0;
+            yyyy0 += xxxx0;
+            __builtin_ia32_storeups(r + i + 0, yyyy0);
+        }
+
+        for (; i < n;  ++i) r[i] = x[i] + k[i] * y[i];
+    }
+}
+
+void vec_scale(const double * x, double k, double * r, size_t n)
+{
+    v2df kk = vec_splat(k);
+    unsigned i = 0;
+
+    if (false) ;
+    else {
+        for (; i + 8 <= n;  i += 8) {
+            v2df xx0 = __builtin_ia32_loadupd(x + i + 0);
+            xx0 *= kk;
+            v2df xx1 = __builtin_ia32_loadupd(x + i + 2);
+            __builtin_ia32_storeupd(r + i + 0, xx0);
+            xx1 *= kk;
+            v2df xx2 = __builtin_ia32_loadupd(x + i + 4);
+            __builtin_ia32_storeupd(r + i + 2, xx1);
+            xx2 *= kk;
+            v2df xx3 = __builtin_ia32_loadupd(x + i + 6);
+            __builtin_ia32_storeupd(r + i + 4, xx2);
+            xx3 *= kk;
+            __builtin_ia32_storeupd(r + i + 6, xx3);
+        }
+    
+        for (; i + 2 <= n;  i += 2) {
+            v2df xx0 = __builtin_ia32_loadupd(x + i + 0);
+            xx0 *= kk;
+            __builtin_ia32_storeupd(r + i + 0, xx0);
+        }
+    }
+    
+    for (; i < n;  ++i) r[i] = k * x[i];
+}
+
+void vec_add(const double * x, double k, const double * y, double * r,
+             size_t n)
+{
+    v2df kk = vec_splat(k);
+    unsigned i = 0;
+
+    if (true) {
+        for (; i + 8 <= n;  i += 8) {
+            v2df yy0 = __builtin_ia32_loadupd(y + i + 0);
+            v2df xx0 = __builtin_ia32_loadupd(x + i + 0);
+            yy0 *= kk;
+            yy0 += xx0;
+            __builtin_ia32_storeupd(r + i + 0, yy0);
+
+            v2df yy1 = __builtin_ia32_loadupd(y + i + 2);
+            v2df xx1 = __builtin_ia32_loadupd(x + i + 2);
+            yy1 *= kk;
+            yy1 += xx1;
+            __builtin_ia32_storeupd(r + i + 2, yy1);
+            
+            v2df yy2 = __builtin_ia32_loadupd(y + i + 4);
+            v2df xx2 = __builtin_ia32_loadupd(x + i + 4);
+            yy2 *= kk;
+            yy2 += xx2;
+            __builtin_ia32_storeupd(r + i + 4, yy2);
+
+            v2df yy3 = __builtin_ia32_loadupd(y + i + 6);
+            v2df xx3 = __builtin_ia32_loadupd(x + i + 6);
+            yy3 *= kk;
+            yy3 += xx3;
+            __builtin_ia32_storeupd(r + i + 6, yy3);
+
+        }
+
+        for (; i + 2 <= n;  i += 2) {
+            v2df yy0 = __builtin_ia32_loadupd(y + i + 0);
+            v2df xx0 = __builtin_ia32_loadupd(x + i + 0);
+            yy0 *= kk;
+            yy0 += xx0;
+            __builtin_ia32_storeupd(r + i + 0, yy0);
+        }
+    }
+
+    for (;  i < n;  ++i) r[i] = x[i] + k * y[i];
+}
+
+void vec_add(const double * x, const double * k, const double * y,
+             double * r, size_t n)
+{
+    unsigned i = 0;
+    if (true) {
+        for (; i + 8 <= n;  i += 8) {
+            v2df yy0 = __builtin_ia32_loadupd(y + i + 0);
+            v2df xx0 = __builtin_ia32_loadupd(x + i + 0);
+            v2df kk0 = __builtin_ia32_loadupd(k + i + 0);
+            yy0 *= kk0;
+            yy0 += xx0;
+            __builtin_ia32_storeupd(r + i + 0, yy0);
+
+            v2df yy1 = __builtin_ia32_loadupd(y + i + 2);
+            v2df xx1 = __builtin_ia32_loadupd(x + i + 2);
+            v2df kk1 = __builtin_ia32_loadupd(k + i + 2);
+            yy1 *= kk1;
+            yy1 += xx1;
+            __builtin_ia32_storeupd(r + i + 2, yy1);
+            
+            v2df yy2 = __builtin_ia32_loadupd(y + i + 4);
+            v2df xx2 = __builtin_ia32_loadupd(x + i + 4);
+            v2df kk2 = __builtin_ia32_loadupd(k + i + 4);
+            yy2 *= kk2;
+            yy2 += xx2;
+            __builtin_ia32_storeupd(r + i + 4, yy2);
+
+            v2df yy3 = __builtin_ia32_loadupd(y + i + 6);
+            v2df xx3 = __builtin_ia32_loadupd(x + i + 6);
+            v2df kk3 = __builtin_ia32_loadupd(k + i + 6);
+            yy3 *= kk3;
+            yy3 += xx3;
+            __builtin_ia32_storeupd(r + i + 6, yy3);
+        }
+
+        for (; i + 2 <= n;  i += 2) {
+            v2df yy0 = __builtin_ia32_loadupd(y + i + 0);
+            v2df xx0 = __builtin_ia32_loadupd(x + i + 0);
+            v2df kk0 = __builtin_ia32_loadupd(k + i + 0);
+            yy0 *= kk0;
+            yy0 += xx0;
+            __builtin_ia32_storeupd(r + i + 0, yy0);
+        }
+    }
+
+    for (;  i < n;  ++i) r[i] = x[i] + k[i] * y[i];
+}
+
+void vec_add(const double * x, const double * y, double * r, size_t n)
+{
+    unsigned i = 0;
+    if (true) {
+        for (; i + 8 <= n;  i += 8) {
+            v2df yy0 = __builtin_ia32_loadupd(y + i + 0);
+            v2df xx0 = __builtin_ia32_loadupd(x + i + 0);
+            yy0 += xx0;
+            __builtin_ia32_storeupd(r + i + 0, yy0);
+
+            v2df yy1 = __builtin_ia32_loadupd(y + i + 2);
+            v2df xx1 = __builtin_ia32_loadupd(x + i + 2);
+            yy1 += xx1;
+            __builtin_ia32_storeupd(r + i + 2, yy1);
+            
+            v2df yy2 = __builtin_ia32_loadupd(y + i + 4);
+            v2df xx2 = __builtin_ia32_loadupd(x + i + 4);
+            yy2 += xx2;
+            __builtin_ia32_storeupd(r + i + 4, yy2);
+
+            v2df yy3 = __builtin_ia32_loadupd(y + i + 6);
+            v2df xx3 = __builtin_ia32_loadupd(x + i + 6);
+            yy3 += xx3;
+            __builtin_ia32_storeupd(r + i + 6, yy3);
+        }
+
+        for (; i + 2 <= n;  i += 2) {
+            v2df yy0 = __builtin_ia32_loadupd(y + i + 0);
+            v2df xx0 = __builtin_ia32_loadupd(x + i + 0);
+            yy0 += xx0;
+            __builtin_ia32_storeupd(r + i + 0, yy0);
+        }
+    }
+
+    for (;  i < n;  ++i) r[i] = x[i] + y[i];
+}
+
+void vec_prod(const double * x, const double * y, double * r, size_t n)
+{
+    unsigned i = 0;
+    if (true) {
+        for (; i + 8 <= n;  i += 8) {
+            v2df yy0 = __builtin_ia32_loadupd(y + i + 0);
+            v2df xx0 = __builtin_ia32_loadupd(x + i + 0);
+            yy0 *= xx0;
+            __builtin_ia32_storeupd(r + i + 0, yy0);
+
+            v2df yy1 = __builtin_ia32_loadupd(y + i + 2);
+            v2df xx1 = __builtin_ia32_loadupd(x + i + 2);
+            yy1 *= xx1;
+            __builtin_ia32_storeupd(r + i + 2, yy1);
+            
+            v2df yy2 = __builtin_ia32_loadupd(y + i + 4);
+            v2df xx2 = __builtin_ia32_loadupd(x + i + 4);
+            yy2 *= xx2;
+            __builtin_ia32_storeupd(r + i + 4, yy2);
+
+            v2df yy3 = __builtin_ia32_loadupd(y + i + 6);
+            v2df xx3 = __builtin_ia32_loadupd(x + i + 6);
+            yy3 *= xx3;
+            __builtin_ia32_storeupd(r + i + 6, yy3);
+        }
+
+        for (; i + 2 <= n;  i += 2) {
+            v2df yy0 = __builtin_ia32_loadupd(y + i + 0);
+            v2df xx0 = __builtin_ia32_loadupd(x + i + 0);
+            yy0 *= xx0;
+            __builtin_ia32_storeupd(r + i + 0, yy0);
+        }
+    }
+
+    for (;  i < n;  ++i) r[i] = x[i] * y[i];
+}
+
+void vec_k1_x_plus_k2_y_z(double k1, const double * x,
+                          double k2, const double * y, const double * z,
+                          double * r, size_t n)
+{
+    unsigned i = 0;
+
+    v2df kk1 = vec_splat(k1);
+    v2df kk2 = vec_splat(k2);
+
+    if (true) {
+        for (; i + 8 <= n;  i += 8) {
+            v2df yy0 = __builtin_ia32_loadupd(y + i + 0);
+            v2df xx0 = __builtin_ia32_loadupd(x + i + 0);
+            v2df zz0 = __builtin_ia32_loadupd(z + i + 0);
+            yy0 *= kk2;
+            xx0 *= kk1;
+            yy0 *= zz0;
+            yy0 += xx0;
+            __builtin_ia32_storeupd(r + i + 0, yy0);
+
+            v2df yy1 = __builtin_ia32_loadupd(y + i + 2);
+            v2df xx1 = __builtin_ia32_loadupd(x + i + 2);
+            v2df zz1 = __builtin_ia32_loadupd(z + i + 2);
+            yy1 *= kk2;
+            xx1 *= kk1;
+            yy1 *= zz1;
+            yy1 += xx1;
+            __builtin_ia32_storeupd(r + i + 2, yy1);
+            
+            v2df yy2 = __builtin_ia32_loadupd(y + i + 4);
+            v2df xx2 = __builtin_ia32_loadupd(x + i + 4);
+            v2df zz2 = __builtin_ia32_loadupd(z + i + 4);
+            yy2 *= kk2;
+            xx2 *= kk1;
+            yy2 *= zz2;
+            yy2 += xx2;
+            __builtin_ia32_storeupd(r + i + 4, yy2);
+
+            v2df yy3 = __builtin_ia32_loadupd(y + i + 6);
+            v2df xx3 = __builtin_ia32_loadupd(x + i + 6);
+            v2df zz3 = __builtin_ia32_loadupd(z + i + 6);
+            yy3 *= kk2;
+            xx3 *= kk1;
+            yy3 *= zz3;
+            yy3 += xx3;
+            __builtin_ia32_storeupd(r + i + 6, yy3);
+        }
+
+        for (; i + 2 <= n;  i += 2) {
+            v2df yy0 = __builtin_ia32_loadupd(y + i + 0);
+            v2df xx0 = __builtin_ia32_loadupd(x + i + 0);
+            v2df zz0 = __builtin_ia32_loadupd(z + i + 0);
+            yy0 *= kk2;
+            xx0 *= kk1;
+            yy0 *= zz0;
+            yy0 += xx0;
+            __builtin_ia32_storeupd(r + i + 0, yy0);
+        }
+    }
+
+    for (;  i < n;  ++i) r[i] = k1 * x[i] + k2 * y[i] * z[i];
+}
+
+void vec_k1_x_plus_k2_y_z(float k1, const float * x,
+                          float k2, const float * y, const float * z,
+                          float * r, size_t n)
+{
+    unsigned i = 0;
+
+    v4sf kkkk1 = vec_splat(k1);
+    v4sf kkkk2 = vec_splat(k2);
+
+    if (true) {
+        for (; i + 16 <= n;  i += 16) {
+            v4sf yyyy0 = __builtin_ia32_loadups(y + i + 0);
+            v4sf xxxx0 = __builtin_ia32_loadups(x + i + 0);
+            v4sf zzzz0 = __builtin_ia32_loadups(z + i + 0);
+            yyyy0 *= kkkk2;
+            xxxx0 *= kkkk1;
+            yyyy0 *= zzzz0;
+            yyyy0 += xxxx0;
+            __builtin_ia32_storeups(r + i + 0, yyyy0);
+
+            v4sf yyyy1 = __builtin_ia32_loadups(y + i + 4);
+            v4sf xxxx1 = __builtin_ia32_loadups(x + i + 4);
+            v4sf zzzz1 = __builtin_ia32_loadups(z + i + 4);
+            yyyy1 *= kkkk2;
+            xxxx1 *= kkkk1;
+            yyyy1 *= zzzz1;
+            yyyy1 += xxxx1;
+            __builtin_ia32_storeups(r + i + 4, yyyy1);
+            
+            v4sf yyyy2 = __builtin_ia32_loadups(y + i + 8);
+            v4sf xxxx2 = __builtin_ia32_loadups(x + i + 8);
+            v4sf zzzz2 = __builtin_ia32_loadups(z + i + 8);
+            yyyy2 *= kkkk2;
+            xxxx2 *= kkkk1;
+            yyyy2 *= zzzz2;
+            yyyy2 += xxxx2;
+            __builtin_ia32_storeups(r + i + 8, yyyy2);
+
+            v4sf yyyy3 = __builtin_ia32_loadups(y + i + 12);
+            v4sf xxxx3 = __builtin_ia32_loadups(x + i + 12);
+            v4sf zzzz3 = __builtin_ia32_loadups(z + i + 12);
+            yyyy3 *= kkkk2;
+            xxxx3 *= kkkk1;
+            yyyy3 *= zzzz3;
+            yyyy3 += xxxx3;
+            __builtin_ia32_storeups(r + i + 12, yyyy3);
+        }
+
+        for (; i + 4 <= n;  i += 4) {
+            v4sf yyyy0 = __builtin_ia32_loadups(y + i + 0);
+            v4sf xxxx0 = __builtin_ia32_loadups(x + i + 0);
+            v4sf zzzz0 = __builtin_ia32_loadups(z + i + 0);
+            yyyy0 *= kkkk2;
+            xxxx0 *= kkkk1;
+            yyyy0 *= zzzz0;
+            yyyy0 += xxxx0;
+            __builtin_ia32_storeups(r + i + 0, yyyy0);
+        }
+    }
+
+    for (;  i < n;  ++i) r[i] = k1 * x[i] + k2 * y[i] * z[i];
+}
+
+void vec_add_sqr(const float * x, float k, const float * y, float * r, size_t n)
+{
+    unsigned i = 0;
+
+    if (true) {
+        v4sf kkkk = vec_splat(k);
+        //cerr << "unoptimized" << endl;
+
+        for (; i + 16 <= n;  i += 16) {
+            v4sf yyyy0 = __builtin_ia32_loadups(y + i + 0);
+            v4sf xxxx0 = __builtin_ia32_loadups(x + i + 0);
+            yyyy0 *= yyyy0;
+            yyyy0 *= kkkk;
+            v4sf yyyy1 = __builtin_ia32_loadups(y + i + 4);
+            yyyy1 *= yyyy1;
+            yyyy0 += xxxx0;
+            v4sf xxxx1 = __builtin_ia32_loadups(x + i + 4);
+            __builtin_ia32_storeups(r + i + 0, yyyy0);
+            yyyy1 *= kkkk;
+            v4sf yyyy2 = __builtin_ia32_loadups(y + i + 8);
+            yyyy1 += xxxx1;
+            yyyy2 *= yyyy2;
+            v4sf xxxx2 = __builtin_ia32_loadups(x + i + 8);
+            __builtin_ia32_storeups(r + i + 4, yyyy1);
+            yyyy2 *= kkkk;
+            v4sf yyyy3 = __builtin_ia32_loadups(y + i + 12);
+            yyyy2 += xxxx2;
+            yyyy3 *= yyyy3;
+            v4sf xxxx3 = __builtin_ia32_loadups(x + i + 12);
+            __builtin_ia32_storeups(r + i + 8, yyyy2);
+            yyyy3 *= kkkk;
+            yyyy3 += xxxx3;
+            __builtin_ia32_storeups(r + i + 12, yyyy3);
+        }
+
+        for (; i + 4 <= n;  i += 4) {
+            v4sf yyyy0 = __builtin_ia32_loadups(y + i + 0);
+            v4sf xxxx0 = __builtin_ia32_loadups(x + i + 0);
+            yyyy0 *= yyyy0;
+            yyyy0 *= kkkk;
+            yyyy0 += xxxx0;
+            __builtin_ia32_storeups(r + i + 0, yyyy0);
+        }
+
+        for (; i < n;  ++i) r[i] = x[i] + k * (y[i] * y[i]);
+    }
+}
+
+void vec_add_sqr(const double * x, double k, const double * y, double * r,
+                 size_t n)
+{
+    v2df kk = vec_splat(k);
+    unsigned i = 0;
+
+    if (true) {
+        for (; i + 8 <= n;  i += 8) {
+            v2df yy0 = __builtin_ia32_loadupd(y + i + 0);
+            v2df xx0 = __builtin_ia32_loadupd(x + i + 0);
+            yy0 *= yy0;
+            yy0 *= kk;
+            yy0 += xx0;
+            __builtin_ia32_storeupd(r + i + 0, yy0);
+
+            v2df yy1 = __builtin_ia32_loadupd(y + i + 2);
+            v2df xx1 = __builtin_ia32_loadupd(x + i + 2);
+            yy1 *= yy1;
+            yy1 *= kk;
+            yy1 += xx1;
+            __builtin_ia32_storeupd(r + i + 2, yy1);
+            
+            v2df yy2 = __builtin_ia32_loadupd(y + i + 4);
+            v2df xx2 = __builtin_ia32_loadupd(x + i + 4);
+            yy2 *= yy2;
+            yy2 *= kk;
+            yy2 += xx2;
+            __builtin_ia32_storeupd(r + i + 4, yy2);
+
+            v2df yy3 = __builtin_ia32_loadupd(y + i + 6);
+            v2df xx3 = __builtin_ia32_loadupd(x + i + 6);
+            yy3 *= yy3;
+            yy3 *= kk;
+            yy3 += xx3;
+            __builtin_ia32_storeupd(r + i + 6, yy3);
+
+        }
+
+        for (; i + 2 <= n;  i += 2) {
+            v2df yy0 = __builtin_ia32_loadupd(y + i + 0);
+            v2df xx0 = __builtin_ia32_loadupd(x + i + 0);
+            yy0 *= yy0;
+            yy0 *= kk;
+            yy0 += xx0;
+            __builtin_ia32_storeupd(r + i + 0, yy0);
+        }
+    }
+
+    for (;  i < n;  ++i) r[i] = x[i] + k * (y[i] * y[i]);
+}
+
+
+/*****************************************************************************/
+/* REDUCTIONS                                                                */
+/*****************************************************************************/
+
+/* These are shared with the other instruction sets, so that the sums are
+   always added up in the same order; see simd_vector_kernels.h.
+*/
+
+double vec_dotprod(const double * x, const double * y, size_t n)
+{
+    return Kernels::vec_dotprod(x, y, n);
+}
+
+double vec_dotprod_dp(const float * x, const float * y, size_t n)
+{
+    return Kernels::vec_dotprod_dp(x, y, n);
+}
+
+double vec_accum_prod3(const float * x, const float * y, const float * z,
+                       size_t n)
+{
+    return Kernels::vec_accum_prod3(x, y, z, n);
+}
+
+} // namespace SSE2
+} // namespace SIMD
+} // namespace ML
@@ -14,3 +14,4 @@ $(eval $(call test,vm_test,arch,boost))
 $(eval $(call test,info_test,arch,boost))
 $(eval $(call test,rtti_utils_test,arch,boost))
 $(eval $(call test,thread_specific_test,arch boost_thread,boost))
+$(eval $(call program,simd_vector_bench,arch boost_program_options))
@@ -0,0 +1,174 @@
+/* simd_vector_bench.cc
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Throughput of each of the SIMD vector kernels, for each of the
+   instruction sets that the CPU supports.
+*/
+
+#include "jml/arch/simd_vector.h"
+#include "jml/arch/timers.h"
+#include "jml/arch/format.h"
+
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/parsers.hpp>
+#include <boost/program_options/variables_map.hpp>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+
+using namespace std;
+using namespace ML;
+
+
+namespace {
+
+vector<float> xf, yf, zf, rf;
+vector<double> xd, yd, zd, rd;
+
+// Somewhere for the reductions to write their results, so that they can't
+// be optimized away
+volatile double sink;
+
+struct Kernel {
+    const char * name;
+    std::function<void (size_t)> run;
+};
+
+#define KERNELS(isa)                                                    \
+    {                                                                   \
+        { "vec_scale float", [] (size_t n)                              \
+          { SIMD::isa::vec_scale(&xf[0], 1.1f, &rf[0], n); } },         \
+        { "vec_add float", [] (size_t n)                                \
+          { SIMD::isa::vec_add(&xf[0], &yf[0], &rf[0], n); } },         \
+        { "vec_add k float", [] (size_t n)                              \
+          { SIMD::isa::vec_add(&xf[0], 0.3f, &yf[0], &rf[0], n); } },   \
+        { "vec_add k[] float", [] (size_t n)                            \
+          { SIMD::isa::vec_add(&xf[0], &zf[0], &yf[0], &rf[0], n); } }, \
+        { "vec_prod float", [] (size_t n)                               \
+          { SIMD::isa::vec_prod(&xf[0], &yf[0], &rf[0], n); } },        \
+        { "vec_add_sqr float", [] (size_t n)                            \
+          { SIMD::isa::vec_add_sqr(&xf[0], 0.7f, &yf[0], &rf[0], n); } }, \
+        { "vec_k1_x_plus_k2_y_z float", [] (size_t n)                   \
+          { SIMD::isa::vec_k1_x_plus_k2_y_z(0.1f, &xf[0], 1.9f, &yf[0], \
+                                            &zf[0], &rf[0], n); } },    \
+        { "vec_scale double", [] (size_t n)                             \
+          { SIMD::isa::vec_scale(&xd[0], 1.1, &rd[0], n); } },          \
+        { "vec_add double", [] (size_t n)                               \
+          { SIMD::isa::vec_add(&xd[0], &yd[0], &rd[0], n); } },         \
+        { "vec_add k double", [] (size_t n)                             \
+          { SIMD::isa::vec_add(&xd[0], 0.3, &yd[0], &rd[0], n); } },    \
+        { "vec_add k[] double", [] (size_t n)                           \
+          { SIMD::isa::vec_add(&xd[0], &zd[0], &yd[0], &rd[0], n); } }, \
+        { "vec_prod double", [] (size_t n)                              \
+          { SIMD::isa::vec_prod(&xd[0], &yd[0], &rd[0], n); } },        \
+        { "vec_add_sqr double", [] (size_t n)                           \
+          { SIMD::isa::vec_add_sqr(&xd[0], 0.7, &yd[0], &rd[0], n); } }, \
+        { "vec_k1_x_plus_k2_y_z double", [] (size_t n)                  \
+          { SIMD::isa::vec_k1_x_plus_k2_y_z(0.1, &xd[0], 1.9, &yd[0],   \
+                                            &zd[0], &rd[0], n); } },    \
+        { "vec_dotprod double", [] (size_t n)                           \
+          { sink = SIMD::isa::vec_dotprod(&xd[0], &yd[0], n); } },      \
+        { "vec_dotprod_dp float", [] (size_t n)                         \
+          { sink = SIMD::isa::vec_dotprod_dp(&xf[0], &yf[0], n); } },   \
+        { "vec_accum_prod3 float", [] (size_t n)                        \
+          { sink = SIMD::isa::vec_accum_prod3(&xf[0], &yf[0], &zf[0], n); } }, \
+    }
+
+/** Return the number of values per second processed by the kernel. */
+double measure(const Kernel & kernel, size_t n, double seconds)
+{
+    // Warm up the caches and find how many calls take about 10ms
+    size_t calls = 1;
+    for (;;) {
+        Timer timer;
+        for (size_t i = 0;  i < calls;  ++i)
+            kernel.run(n);
+        if (timer.elapsed_wall() > 0.01)
+            break;
+        calls *= 2;
+    }
+
+    size_t total = 0;
+    Timer timer;
+    while (timer.elapsed_wall() < seconds) {
+        for (size_t i = 0;  i < calls;  ++i)
+            kernel.run(n);
+        total += calls;
+    }
+
+    return total * n / timer.elapsed_wall();
+}
+
+} // file scope
+
+int main(int argc, char ** argv)
+{
+    using namespace boost::program_options;
+
+    vector<size_t> sizes = { 16, 256, 4096, 65536, 1048576 };
+    double seconds = 0.2;
+
+    options_description options;
+    options.add_options()
+        ("size,n", value(&sizes)->multitoken(),
+         "number of values in the vectors")
+        ("seconds,s", value(&seconds),
+         "time to run each kernel for")
+        ("help,h", "print this message");
+
+    variables_map vm;
+    store(command_line_parser(argc, argv).options(options).run(), vm);
+    notify(vm);
+
+    if (vm.count("help")) {
+        cerr << options << endl;
+        return 1;
+    }
+
+    size_t maxSize = 0;
+    for (size_t n: sizes)
+        maxSize = std::max(maxSize, n);
+
+    for (auto v: { &xf, &yf, &zf, &rf })
+        v->resize(maxSize);
+    for (auto v: { &xd, &yd, &zd, &rd })
+        v->resize(maxSize);
+
+    for (size_t i = 0;  i < maxSize;  ++i) {
+        xd[i] = xf[i] = rand() / double(RAND_MAX);
+        yd[i] = yf[i] = rand() / double(RAND_MAX);
+        zd[i] = zf[i] = rand() / double(RAND_MAX);
+    }
+
+    vector<string> isas = { "sse2" };
+    vector<vector<Kernel> > kernels = { KERNELS(SSE2) };
+    if (has_avx2()) {
+        isas.push_back("avx2");
+        kernels.push_back(KERNELS(AVX2));
+    }
+    if (has_avx512f()) {
+        isas.push_back("avx512");
+        kernels.push_back(KERNELS(AVX512));
+    }
+
+    cout << "dispatched kernels use " << SIMD::vec_kernel_isa() << endl;
+    cout << "throughput in millions of values per second" << endl;
+
+    for (size_t n: sizes) {
+        cout << endl << format("%-30s", format("%zd values", n).c_str());
+        for (auto & isa: isas)
+            cout << format("%10s", isa.c_str());
+        cout << endl;
+
+        for (unsigned k = 0;  k < kernels[0].size();  ++k) {
+            cout << format("%-30s", kernels[0][k].name);
+            for (unsigned i = 0;  i < isas.size();  ++i) {
+                double rate = measure(kernels[i][k], n, seconds);
+                cout << format("%10.0f", rate / 1000000.0) << flush;
+            }
+            cout << endl;
+        }
+    }
+}
@@ -15,6 +15,8 @@
 #include <boost/test/floating_point_comparison.hpp>
 #include <vector>
 #include <set>
+#include <map>
+#include <string>
 #include <iostream>
 #include <cmath>
 
@@ -540,3 +542,152 @@ BOOST_AUTO_TEST_CASE( vec_exp_test )
     vec_exp_test_cases<float, double>();
     vec_exp_test_cases<double, double>();
 }
+
+/* The kernels with a version for each instruction set must give exactly the
+   same results whichever one is used.  They are all run on the same inputs,
+   at every alignment and with enough sizes to exercise the ends of the
+   loops, and the outputs are compared bit for bit with SSE2.
+*/
+
+struct KernelSet {
+    const char * isa;
+
+    void (*scale_f)(const float *, float, float *, size_t);
+    void (*add_f)(const float *, const float *, float *, size_t);
+    void (*add_k_f)(const float *, float, const float *, float *, size_t);
+    void (*add_kv_f)(const float *, const float *, const float *, float *,
+                     size_t);
+    void (*prod_f)(const float *, const float *, float *, size_t);
+    void (*add_sqr_f)(const float *, float, const float *, float *, size_t);
+    void (*k1_x_plus_k2_y_z_f)(float, const float *, float, const float *,
+                               const float *, float *, size_t);
+
+    void (*scale_d)(const double *, double, double *, size_t);
+    void (*add_d)(const double *, const double *, double *, size_t);
+    void (*add_k_d)(const double *, double, const double *, double *, size_t);
+    void (*add_kv_d)(const double *, const double *, const double *,
+                     double *, size_t);
+    void (*prod_d)(const double *, const double *, double *, size_t);
+    void (*add_sqr_d)(const double *, double, const double *, double *,
+                      size_t);
+    void (*k1_x_plus_k2_y_z_d)(double, const double *, double,
+                               const double *, const double *, double *,
+                               size_t);
+
+    double (*dotprod_d)(const double *, const double *, size_t);
+    double (*dotprod_dp_f)(const float *, const float *, size_t);
+    double (*accum_prod3_f)(const float *, const float *, const float *,
+                            size_t);
+};
+
+#define KERNEL_SET(isa)                                                 \
+    { #isa,                                                             \
+      SIMD::isa::vec_scale, SIMD::isa::vec_add, SIMD::isa::vec_add,     \
+      SIMD::isa::vec_add, SIMD::isa::vec_prod, SIMD::isa::vec_add_sqr,  \
+      SIMD::isa::vec_k1_x_plus_k2_y_z,                                  \
+      SIMD::isa::vec_scale, SIMD::isa::vec_add, SIMD::isa::vec_add,     \
+      SIMD::isa::vec_add, SIMD::isa::vec_prod, SIMD::isa::vec_add_sqr,  \
+      SIMD::isa::vec_k1_x_plus_k2_y_z,                                  \
+      SIMD::isa::vec_dotprod, SIMD::isa::vec_dotprod_dp,                \
+      SIMD::isa::vec_accum_prod3 }
+
+/** Run every kernel of the set on the given part of the inputs, and return
+    the raw bytes of each of their outputs.
+*/
+map<string, string>
+run_kernels(const KernelSet & k, size_t offset, size_t n)
+{
+    enum { MAX = 256 };
+    static float xf[MAX], yf[MAX], zf[MAX];
+    static double xd[MAX], yd[MAX], zd[MAX];
+    static bool initialized = false;
+
+    if (!initialized) {
+        // Values over many orders of magnitude and of both signs, so that
+        // the rounding would show any difference in the order of operations
+        srand(42);
+        auto random = [] ()
+            {
+                return (rand() / double(RAND_MAX) - 0.5)
+                    * exp(rand() % 20 - 10.0);
+            };
+
+        for (unsigned i = 0;  i < MAX;  ++i) {
+            xd[i] = random();  yd[i] = random();  zd[i] = random();
+            xf[i] = xd[i];  yf[i] = yd[i];  zf[i] = zd[i];
+        }
+        initialized = true;
+    }
+
+    BOOST_REQUIRE(offset + n <= MAX);
+
+    const float * x = xf + offset, * y = yf + offset, * z = zf + offset;
+    float r[MAX];
+
+    const double * xx = xd + offset, * yy = yd + offset, * zz = zd + offset;
+    double rr[MAX];
+
+    map<string, string> result;
+
+    auto record = [&] (const char * name, const void * data, size_t bytes)
+        {
+            result[name] = string((const char *)data, bytes);
+        };
+
+    k.scale_f(x, 1.1f, r, n);                 record("scale_f", r, n * 4);
+    k.add_f(x, y, r, n);                      record("add_f", r, n * 4);
+    k.add_k_f(x, 0.3f, y, r, n);              record("add_k_f", r, n * 4);
+    k.add_kv_f(x, z, y, r, n);                record("add_kv_f", r, n * 4);
+    k.prod_f(x, y, r, n);                     record("prod_f", r, n * 4);
+    k.add_sqr_f(x, 0.7f, y, r, n);            record("add_sqr_f", r, n * 4);
+    k.k1_x_plus_k2_y_z_f(0.1f, x, 1.9f, y, z, r, n);
+    record("k1_x_plus_k2_y_z_f", r, n * 4);
+
+    k.scale_d(xx, 1.1, rr, n);                record("scale_d", rr, n * 8);
+    k.add_d(xx, yy, rr, n);                   record("add_d", rr, n * 8);
+    k.add_k_d(xx, 0.3, yy, rr, n);            record("add_k_d", rr, n * 8);
+    k.add_kv_d(xx, zz, yy, rr, n);            record("add_kv_d", rr, n * 8);
+    k.prod_d(xx, yy, rr, n);                  record("prod_d", rr, n * 8);
+    k.add_sqr_d(xx, 0.7, yy, rr, n);          record("add_sqr_d", rr, n * 8);
+    k.k1_x_plus_k2_y_z_d(0.1, xx, 1.9, yy, zz, rr, n);
+    record("k1_x_plus_k2_y_z_d", rr, n * 8);
+
+    double d;
+    d = k.dotprod_d(xx, yy, n);               record("dotprod_d", &d, 8);
+    d = k.dotprod_dp_f(x, y, n);              record("dotprod_dp_f", &d, 8);
+    d = k.accum_prod3_f(x, y, z, n);          record("accum_prod3_f", &d, 8);
+
+    return result;
+}
+
+BOOST_AUTO_TEST_CASE( test_kernel_isa_equivalence )
+{
+    cerr << "kernels use " << SIMD::vec_kernel_isa() << endl;
+
+    KernelSet sse2 = KERNEL_SET(SSE2);
+
+    vector<KernelSet> others;
+    if (has_avx2())
+        others.push_back(KERNEL_SET(AVX2));
+    else cerr << "no AVX2; not testing its kernels" << endl;
+    if (has_avx512f())
+        others.push_back(KERNEL_SET(AVX512));
+    else cerr << "no AVX-512; not testing its kernels" << endl;
+
+    for (auto & other: others) {
+        for (size_t offset = 0;  offset < 16;  ++offset) {
+            for (size_t n = 0;  n <= 100;  ++n) {
+                auto expected = run_kernels(sse2, offset, n);
+                auto actual = run_kernels(other, offset, n);
+
+                for (auto & e: expected) {
+                    BOOST_CHECK_MESSAGE(actual[e.first] == e.second,
+                                        other.isa << " " << e.first
+                                        << " differs from SSE2 with offset "
+                                        << offset << " and " << n
+                                        << " values");
+                }
+            }
+        }
+    }
+}
@@ -78,13 +78,14 @@ Function_Profiler __profiler(var);
 /*****************************************************************************/
 
 Boosted_Stumps::Boosted_Stumps()
+    : optimized_(false)
 {
 }
 
 Boosted_Stumps::
 Boosted_Stumps(const std::shared_ptr<const Feature_Space> & feature_space,
                const Feature & predicted)
-    : Classifier_Impl(feature_space, predicted)
+    : Classifier_Impl(feature_space, predicted), optimized_(false)
 {
     output = RAW;
 }
@@ -92,6 +93,7 @@ Boosted_Stumps(const std::shared_ptr<const Feature_Space> & feature_space,
 Boosted_Stumps::
 Boosted_Stumps(DB::Store_Reader & reader,
                const std::shared_ptr<const Feature_Space> & feature_space)
+    : optimized_(false)
 {
     this->reconstitute(reader, feature_space);
 }
@@ -100,7 +102,8 @@ Boosted_Stumps::
 Boosted_Stumps(const std::shared_ptr<const Feature_Space> & feature_space,
                const Feature & predicted,
                size_t label_count)
-    : Classifier_Impl(feature_space, predicted, label_count)
+    : Classifier_Impl(feature_space, predicted, label_count),
+      optimized_(false)
 {
 }
 
@@ -142,6 +145,41 @@ struct Results_Single {
     
 };
 
+/** Transform the raw outputs in place as asked for by the output setting.
+    Returns the total of the transformed outputs.
+*/
+double transform_output(float * result, size_t nl,
+                        Boosted_Stumps::Output output)
+{
+    double total = 0.0;
+
+    if (output == Boosted_Stumps::LOGIT
+        || output == Boosted_Stumps::LOGIT_NORM) {
+        for (unsigned i = 0;  i < nl;  ++i) {
+            /* Avoid an overflow from the exp. */
+            if (result[i] > fp_traits<float>::max_exp_arg * 0.9)
+                result[i] = fp_traits<float>::max_exp_arg * 0.9;
+            double e = exp(result[i]);
+            double x = e / (e + (1.0 / e));
+            total += x;
+            result[i] = x;
+        }
+        if (output == Boosted_Stumps::LOGIT_NORM) {
+            if ((float)total == 0.0F) {
+                cerr << "warning: boosted stumps says no results are correct"
+                     << endl;
+                std::fill(result, result + nl, 1.0f / nl);
+            }
+            else {
+                for (unsigned i = 0;  i < nl;  ++i)
+                    result[i] /= total;
+            }
+        }
+    }
+
+    return total;
+}
+
 } // file scope
 
 distribution<float>
@@ -169,28 +207,7 @@ predict(const Feature_Set & features,
     //result.normalize();
     //result -= 0.5;
 
-    double total = 0.0;
-
-    if (output == LOGIT || output == LOGIT_NORM) {
-        for (unsigned i = 0;  i < result.size();  ++i) {
-            /* Avoid an overflow from the exp. */
-            if (result[i] > fp_traits<float>::max_exp_arg * 0.9)
-                result[i] = fp_traits<float>::max_exp_arg * 0.9;
-            double e = exp(result[i]);
-            double x = e / (e + (1.0 / e));
-            total += x;
-            result[i] = x;
-        }
-        if (output == LOGIT_NORM) {
-            if ((float)total == 0.0F) {
-                cerr << "warning: boosted stumps says no results are correct"
-                     << endl;
-                result.fill(1);  // assign all elements
-                result.normalize();
-            }
-            else result /= total;
-        }
-    }
+    double total = transform_output(&result[0], result.size(), output);
 
     for (unsigned i = 0;  i < result.size();  ++i) {
         if (!finite(result[i])) {
@@ -251,11 +268,128 @@ predict(int label, const Feature_Set & features,
     return result;
 }
 
+bool
+Boosted_Stumps::
+optimization_supported() const
+{
+    return true;
+}
+
+bool
+Boosted_Stumps::
+predict_is_optimized() const
+{
+    return optimized_;
+}
+
+bool
+Boosted_Stumps::
+optimize_impl(Optimization_Info & info)
+{
+    int nl = label_count();
+
+    flat_stumps.clear();
+    flat_actions.clear();
+
+    for (const_iterator it = begin();  it != end();  ++it) {
+        const Split & split = it->split;
+
+        Flat_Stump flat;
+        flat.feature = info.get_optimized_index(split.feature());
+        flat.split_val = split.split_val();
+        flat.op = split.op();
+        flat_stumps.push_back(flat);
+
+        /* In the order of the values that Split::apply() returns */
+        const Label_Dist * preds[3];
+        preds[false] = &it->action.pred_false;
+        preds[true] = &it->action.pred_true;
+        preds[MISSING] = &it->action.pred_missing;
+
+        for (unsigned b = 0;  b < 3;  ++b) {
+            const Label_Dist & pred = *preds[b];
+            for (unsigned l = 0;  l < nl;  ++l)
+                flat_actions.push_back(l < pred.size() ? pred[l] : 0.0f);
+        }
+    }
+
+    return optimized_ = true;
+}
+
+void
+Boosted_Stumps::
+optimized_predict_batch_impl(const float * const * columns, size_t n,
+                             const Optimization_Info & info,
+                             double * accum,
+                             double weight) const
+{
+    int nl = label_count();
+    size_t ns = flat_stumps.size();
+
+    /* The outputs are held label by label, so that adding a stump's
+       output to each example is a loop over contiguous values. */
+    enum { BLOCK = 256 };
+    vector<float> results(nl * BLOCK);
+    int branch[BLOCK];
+    float result[nl];
+
+    for (size_t start = 0;  start < n;  start += BLOCK) {
+        size_t nb = std::min<size_t>(n - start, BLOCK);
+
+        for (unsigned l = 0;  l < nl;  ++l) {
+            float init = 0.0f;
+            if (bias.size()) init += bias[l];
+            std::fill(&results[l * BLOCK], &results[l * BLOCK] + nb, init);
+        }
+
+        /* Add in the stumps in the same order as predict() does, so that
+           the rounding is the same. */
+        for (size_t s = 0;  s < ns;  ++s) {
+            const Flat_Stump & stump = flat_stumps[s];
+            const float * col = columns[stump.feature] + start;
+
+            /* Same as Split::apply(), without the branches. */
+            for (size_t i = 0;  i < nb;  ++i) {
+                float val = col[i];
+                int less = val < stump.split_val;
+                int equal = val == stump.split_val;
+                int b = ((less | (equal << 1) | 4) >> stump.op) & 1;
+                branch[i] = std::isnan(val) ? MISSING : b;
+            }
+
+            const float * action = &flat_actions[s * 3 * nl];
+            for (unsigned l = 0;  l < nl;  ++l) {
+                float * res = &results[l * BLOCK];
+                for (size_t i = 0;  i < nb;  ++i)
+                    res[i] += action[branch[i] * nl + l];
+            }
+        }
+
+        for (size_t i = 0;  i < nb;  ++i) {
+            for (unsigned l = 0;  l < nl;  ++l)
+                result[l] = results[l * BLOCK + i];
+
+            for (unsigned l = 0;  l < nl;  ++l)
+                if (!finite(result[l]))
+                    throw Exception("Boosted_Stumps::predict_batch(): "
+                                    "non-finite result");
+
+            transform_output(result, nl, output);
+
+            double * out = accum + (start + i) * nl;
+            for (unsigned l = 0;  l < nl;  ++l)
+                out[l] += weight * result[l];
+        }
+    }
+}
+
 Boosted_Stumps::iterator Boosted_Stumps::
 insert(const Stump & stump, float weight)
 {
     if (stump.split.feature() == MISSING_FEATURE) return end();
 
+    optimized_ = false;
+
     iterator it = find(stump.split);
     if (it == end())
         return iterator
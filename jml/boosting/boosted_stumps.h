@@ -120,6 +120,9 @@ public:
         bias.swap(other.bias);
         sum_missing.swap(other.sum_missing);
         std::swap(predicted_, other.predicted_);
+        std::swap(optimized_, other.optimized_);
+        flat_stumps.swap(other.flat_stumps);
+        flat_actions.swap(other.flat_actions);
     }
 
     using Classifier_Impl::predict;
@@ -163,6 +166,26 @@ public:
     void predict_core(const Feature_Set & features, const Results & results)
         const;
 
+    /** Optimization is only used by the batch predict; the other optimized
+        predict methods go through the normal predict.  It needs to be
+        redone if the stumps are changed.
+    */
+    virtual bool optimization_supported() const;
+
+    virtual bool predict_is_optimized() const;
+
+    virtual bool optimize_impl(Optimization_Info & info);
+
+    /** Batch predict over the flattened stumps.  Each stump is applied to
+        all of the examples in the batch before moving on to the next, so
+        its test and its outputs are loaded only once per batch.
+    */
+    virtual void
+    optimized_predict_batch_impl(const float * const * columns, size_t n,
+                                 const Optimization_Info & info,
+                                 double * accum,
+                                 double weight = 1.0) const;
+
     /** Calculate the accuracy.  This can be done much quicker with the
         boosted stumps as it only needs to look at the index for the features
         that it has learned a stump for, and these are nicely indexed
@@ -256,6 +279,20 @@ public:
     merge(const Classifier_Impl & other, float weight = 1.0) const;
     
 private:
+    /** The stumps flattened by optimize(), in the same order as the map. */
+    struct Flat_Stump {
+        int feature;        ///< Index of the optimized feature to test
+        float split_val;    ///< Value to test against
+        int op;             ///< Split::Op for the test
+    };
+
+    bool optimized_;
+    std::vector<Flat_Stump> flat_stumps;
+
+    /** For each stump, label_count() outputs for each of false, true and
+        MISSING. */
+    std::vector<float> flat_actions;
+
     /** For reconstituting old classifiers only */
     Boosted_Stumps(const std::shared_ptr<const Feature_Space>
                        & feature_space,
@@ -411,10 +411,8 @@ Optimization_Info
 Classifier_Impl::
 optimize(const Feature_Set & feature_set)
 {
-    if (!optimization_supported())
-        return Optimization_Info();
-
-    // Extract the list of features, and continue
+    // Extract the list of features, and continue.  Even when optimization
+    // isn't supported, the info remembers them for predict_batch().
     vector<Feature> features;
     features.reserve(feature_set.size());
 
@@ -597,6 +595,137 @@ optimized_predict_impl(int label,
     return predict(label, fset, context);
 }
 
+void
+Classifier_Impl::
+optimized_predict_batch_impl(const float * const * columns, size_t n,
+                             const Optimization_Info & info,
+                             double * accum,
+                             double weight) const
+{
+    int nf = info.features_out();
+    int nl = label_count();
+
+    float fv[nf];
+
+    for (size_t i = 0;  i < n;  ++i) {
+        for (unsigned j = 0;  j < nf;  ++j)
+            fv[j] = columns[j][i];
+
+        if (predict_is_optimized()) {
+            optimized_predict_impl(fv, info, accum + i * nl, weight);
+            continue;
+        }
+
+        // Convert to standard feature set, then call classical predict
+        Dense_Feature_Set fset(make_unowned_sp(info.to_features), fv);
+        Label_Dist result = predict(fset);
+        for (unsigned l = 0;  l < nl;  ++l)
+            accum[i * nl + l] += weight * result[l];
+    }
+}
+
+namespace {
+
+/** Number of examples that predict_batch() works on at once, so that the
+    accumulators stay in the cache. */
+enum { PREDICT_BATCH_SIZE = 256 };
+
+} // file scope
+
+void
+Classifier_Impl::
+predict_batch(const float * features, size_t stride, size_t n,
+              const Optimization_Info & info,
+              float * output) const
+{
+    int nl = label_count();
+
+    /* A classifier that doesn't support optimization gets back an info that
+       only knows which feature each column is.  Those are predicted
+       example by example through a feature set, which needs its features
+       in order. */
+    if (!info) {
+        const vector<Feature> & from = info.from_features;
+        int nc = from.size();
+
+        vector<int> order(nc);
+        for (unsigned j = 0;  j < nc;  ++j)
+            order[j] = j;
+        std::sort(order.begin(), order.end(),
+                  [&] (int j1, int j2) { return from[j1] < from[j2]; });
+
+        auto sorted = std::make_shared<vector<Feature> >();
+        for (unsigned j = 0;  j < nc;  ++j)
+            sorted->push_back(from[order[j]]);
+
+        float fv[nc];
+
+        for (size_t i = 0;  i < n;  ++i) {
+            for (unsigned j = 0;  j < nc;  ++j)
+                fv[j] = features[order[j] * stride + i];
+
+            Dense_Feature_Set fset(sorted, fv);
+            Label_Dist result = predict(fset);
+            std::copy(result.begin(), result.end(), output + i * nl);
+        }
+
+        return;
+    }
+
+    int nf = info.features_out();
+
+    /* Find the column for each of the features the classifier uses. */
+    const float * columns[nf];
+    std::fill(columns, columns + nf, (const float *)0);
+    for (unsigned j = 0;  j < info.indexes.size();  ++j)
+        if (info.indexes[j] != -1)
+            columns[info.indexes[j]] = features + j * stride;
+
+    const float * block[nf];
+    vector<double> accum(PREDICT_BATCH_SIZE * nl);
+
+    for (size_t start = 0;  start < n;  start += PREDICT_BATCH_SIZE) {
+        size_t nb = std::min<size_t>(n - start, PREDICT_BATCH_SIZE);
+
+        for (unsigned j = 0;  j < nf;  ++j)
+            block[j] = columns[j] + start;
+
+        std::fill(accum.begin(), accum.begin() + nb * nl, 0.0);
+
+        if (predict_is_optimized())
+            optimized_predict_batch_impl(block, nb, info, &accum[0]);
+        else Classifier_Impl::optimized_predict_batch_impl(block, nb, info,
+                                                           &accum[0]);
+
+        std::copy(accum.begin(), accum.begin() + nb * nl,
+                  output + start * nl);
+    }
+}
+
+void
+Classifier_Impl::
+predict_batch(int label,
+              const float * features, size_t stride, size_t n,
+              const Optimization_Info & info,
+              float * output) const
+{
+    int nl = label_count();
+    if (label < 0 || label >= nl)
+        throw Exception("Classifier_Impl::predict_batch(): "
+                        "label %d out of range", label);
+
+    vector<float> all(PREDICT_BATCH_SIZE * nl);
+
+    for (size_t start = 0;  start < n;  start += PREDICT_BATCH_SIZE) {
+        size_t nb = std::min<size_t>(n - start, PREDICT_BATCH_SIZE);
+
+        predict_batch(features + start, stride, nb, info, &all[0]);
+
+        for (size_t i = 0;  i < nb;  ++i)
+            output[start + i] = all[i * nl + label];
+    }
+}
+
 namespace {
 
 struct Accuracy_Job_Info {
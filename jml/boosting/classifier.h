@@ -360,6 +360,32 @@ public:
                           const Optimization_Info & info,
                           PredictionContext * context = 0) const;
 
+    /** Predict a whole batch of examples at once, for all labels.
+
+        The features are a dense, column major matrix with one column for
+        each of the features that info was created for, in the same order,
+        so that feature j of example i is features[j * stride + i].  The
+        output is row major, with label_count() values for each of the n
+        examples.  The results are the same as calling the optimized
+        predict on each example in turn.
+
+        Classifiers that can work over a batch in one go override
+        optimized_predict_batch_impl(); the others are called example by
+        example.  So are classifiers that don't support optimization at
+        all, in which case info is the uninitialized one that optimize()
+        returned and the columns are its from_features.
+    */
+    void predict_batch(const float * features, size_t stride, size_t n,
+                       const Optimization_Info & info,
+                       float * output) const;
+
+    /** Same, but writes only the given label, with one value per
+        example. */
+    void predict_batch(int label,
+                       const float * features, size_t stride, size_t n,
+                       const Optimization_Info & info,
+                       float * output) const;
+
     //protected:
 
     /** Function to override to perform the optimization.  Default will
@@ -391,6 +417,22 @@ public:
                            const float * features,
                            const Optimization_Info & info,
                            PredictionContext * context = 0) const;
+
+    /** Optimized predict for a batch of examples.  columns has one pointer
+        per optimized feature (in the order of info.to_features), each to
+        the n values of that feature.  The prediction for example i is
+        multiplied by weight and added to accum[i * label_count()] onwards.
+
+        Overrides are only called if predict_is_optimized().  The default
+        implementation gathers each example into a vector and calls the
+        optimized predict above, or the normal one if the classifier isn't
+        optimized.
+    */
+    virtual void
+    optimized_predict_batch_impl(const float * const * columns, size_t n,
+                                 const Optimization_Info & info,
+                                 double * accum,
+                                 double weight = 1.0) const;
     
 public:
     /** Run the classifier over the entire dataset, calling the predict
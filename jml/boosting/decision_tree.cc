@@ -30,14 +30,14 @@ namespace ML {
 /*****************************************************************************/
 
 Decision_Tree::Decision_Tree()
-    : encoding(OE_PROB), optimized_(false)
+    : encoding(OE_PROB), optimized_(false), flat_depth(0)
 {
 }
 
 Decision_Tree::
 Decision_Tree(DB::Store_Reader & store,
               const std::shared_ptr<const Feature_Space> & fs)
-    : optimized_(false)
+    : optimized_(false), flat_depth(0)
 {
     throw Exception("Decision_Tree constructor(reconst): not implemented");
 }
@@ -47,7 +47,8 @@ Decision_Tree(std::shared_ptr<const Feature_Space> feature_space,
               const Feature & predicted)
     : Classifier_Impl(feature_space, predicted),
       encoding(OE_PROB),
-      optimized_(false)
+      optimized_(false),
+      flat_depth(0)
 {
 }
     
@@ -64,6 +65,9 @@ swap(Decision_Tree & other)
     std::swap(tree, other.tree);
     std::swap(encoding, other.encoding);
     std::swap(optimized_, other.optimized_);
+    flat_nodes.swap(other.flat_nodes);
+    flat_leaves.swap(other.flat_leaves);
+    std::swap(flat_depth, other.flat_depth);
 }
 
 namespace {
@@ -207,6 +211,12 @@ Decision_Tree::
 optimize_impl(Optimization_Info & info)
 {
     optimize_recursive(info, tree.root);
+
+    flat_nodes.clear();
+    flat_leaves.clear();
+    flat_depth = 0;
+    flatten_recursive(info, tree.root, 0);
+
     optimized_ = true;
     return true;
 }
@@ -227,6 +237,53 @@ optimize_recursive(Optimization_Info & info,
     optimize_recursive(info, node.child_missing);
 }
 
+int
+Decision_Tree::
+flatten_recursive(const Optimization_Info & info,
+                  const Tree::Ptr & ptr, int depth)
+{
+    int index = flat_nodes.size();
+    flat_nodes.push_back(Flat_Node());
+
+    Flat_Node node;
+    node.leaf = -1;
+
+    if (!ptr.node()) {
+        /* Leaf or missing child; stay here whatever the value is. */
+        node.feature = 0;
+        node.split_val = 0.0;
+        node.op = Split::NOT_MISSING;
+        node.child[false] = node.child[true] = node.child[MISSING] = index;
+
+        if (ptr) {
+            int nl = label_count();
+            const Label_Dist & pred = ptr.leaf()->pred;
+            node.leaf = flat_leaves.size();
+            flat_leaves.resize(flat_leaves.size() + nl);
+            int ncopy = std::min<int>(nl, pred.size());
+            std::copy(pred.begin(), pred.begin() + ncopy,
+                      flat_leaves.begin() + node.leaf);
+        }
+
+        flat_depth = std::max(flat_depth, depth);
+    }
+    else {
+        const Tree::Node & tnode = *ptr.node();
+        node.feature = info.get_optimized_index(tnode.split.feature());
+        node.split_val = tnode.split.split_val();
+        node.op = tnode.split.op();
+        node.child[true]
+            = flatten_recursive(info, tnode.child_true, depth + 1);
+        node.child[false]
+            = flatten_recursive(info, tnode.child_false, depth + 1);
+        node.child[MISSING]
+            = flatten_recursive(info, tnode.child_missing, depth + 1);
+    }
+
+    flat_nodes[index] = node;
+    return index;
+}
+
 Label_Dist
 Decision_Tree::
 optimized_predict_impl(const float * features,
@@ -271,6 +328,50 @@ optimized_predict_impl(int label,
     return results;
 }
 
+void
+Decision_Tree::
+optimized_predict_batch_impl(const float * const * columns, size_t n,
+                             const Optimization_Info & info,
+                             double * accum,
+                             double weight) const
+{
+    int nl = label_count();
+    const Flat_Node * nodes = &flat_nodes[0];
+
+    /* Enough examples go down together that the loads for one don't have
+       to wait for the loads of the one before. */
+    enum { BLOCK = 64 };
+    int current[BLOCK];
+
+    for (size_t start = 0;  start < n;  start += BLOCK) {
+        size_t nb = std::min<size_t>(n - start, BLOCK);
+
+        std::fill(current, current + nb, 0);
+
+        for (int d = 0;  d < flat_depth;  ++d) {
+            for (size_t i = 0;  i < nb;  ++i) {
+                const Flat_Node & node = nodes[current[i]];
+                float val = columns[node.feature][start + i];
+
+                /* Same as Split::apply(), without the branches. */
+                int less = val < node.split_val;
+                int equal = val == node.split_val;
+                int result = ((less | (equal << 1) | 4) >> node.op) & 1;
+                current[i] = node.child[std::isnan(val) ? MISSING : result];
+            }
+        }
+
+        for (size_t i = 0;  i < nb;  ++i) {
+            int leaf = nodes[current[i]].leaf;
+            if (leaf == -1) continue;
+            const float * pred = &flat_leaves[leaf];
+            double * out = accum + (start + i) * nl;
+            for (unsigned l = 0;  l < nl;  ++l)
+                out[l] += weight * pred[l];
+        }
+    }
+}
+
 template<class GetFeatures, class Results>
 void
 Decision_Tree::
@@ -633,6 +734,9 @@ reconstitute(DB::Store_Reader & store,
         throw Exception("Decision_Tree::reconstitute: read bad marker at end");
 
     optimized_ = false;
+    flat_nodes.clear();
+    flat_leaves.clear();
+    flat_depth = 0;
 }
     
 std::string
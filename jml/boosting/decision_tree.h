@@ -56,6 +56,23 @@ public:
     Output_Encoding encoding;  ///< How the outputs are represented
     bool optimized_;           ///< Is predict() optimized?
 
+    /** The tree flattened into an array by optimize(), for the batch
+        predict.  Leaves and missing children are nodes whose children all
+        point back to themselves, so that every example can take the same
+        number of steps whatever the depth of the leaf it ends up at.
+    */
+    struct Flat_Node {
+        int feature;        ///< Index of the optimized feature to test
+        float split_val;    ///< Value to test against
+        int op;             ///< Split::Op for the test
+        int child[3];       ///< Next node for false, true and MISSING
+        int leaf;           ///< Offset of the leaf's prediction, or -1
+    };
+
+    std::vector<Flat_Node> flat_nodes;
+    std::vector<float> flat_leaves;   ///< label_count() values per leaf
+    int flat_depth;                   ///< Steps to reach every leaf
+
     using Classifier_Impl::predict;
 
     virtual float predict(int label, const Feature_Set & features,
@@ -83,6 +100,10 @@ public:
     void optimize_recursive(Optimization_Info & info,
                             const Tree::Ptr & ptr);
 
+    /** Add the given subtree to flat_nodes, returning its index. */
+    int flatten_recursive(const Optimization_Info & info,
+                          const Tree::Ptr & ptr, int depth);
+
     /** Optimized predict for a dense feature vector.
         This is the worker function that all classifiers that implement the
         optimized predict should override.  The default implementation will
@@ -105,6 +126,16 @@ public:
                            const Optimization_Info & info,
                            PredictionContext * context = 0) const;
 
+    /** Batch predict over the flattened tree.  All of the examples in a
+        batch step down the tree together, once per level, with the child
+        to go to chosen arithmetically rather than by branching.
+    */
+    virtual void
+    optimized_predict_batch_impl(const float * const * columns, size_t n,
+                                 const Optimization_Info & info,
+                                 double * accum,
+                                 double weight = 1.0) const;
+
     template<class GetFeatures, class Results>
     void predict_recursive_impl(const GetFeatures & get_features,
                                 Results & results,
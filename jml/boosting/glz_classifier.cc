@@ -223,6 +223,54 @@ optimized_predict_impl(int label,
     return do_predict_impl(label, features_c, &feature_indexes[0]);
 }
 
+void
+GLZ_Classifier::
+optimized_predict_batch_impl(const float * const * columns, size_t n,
+                             const Optimization_Info & info,
+                             double * accum_out,
+                             double weight) const
+{
+    int nl = label_count();
+    size_t nf = features.size();
+
+    enum { BLOCK = 256 };
+    float vals[BLOCK];
+    vector<double> accum(nl * BLOCK);
+
+    for (size_t start = 0;  start < n;  start += BLOCK) {
+        size_t nb = std::min<size_t>(n - start, BLOCK);
+
+        std::fill(accum.begin(), accum.end(), 0.0);
+
+        for (unsigned j = 0;  j < nf;  ++j) {
+            const float * col = columns[feature_indexes[j]] + start;
+            for (size_t i = 0;  i < nb;  ++i)
+                vals[i] = decode_value(col[i], features[j]);
+
+            /* The product is done in single precision, as in do_accum(),
+               so that the results are exactly the same. */
+            for (unsigned l = 0;  l < nl;  ++l) {
+                float w = weights[l][j];
+                double * acc = &accum[l * BLOCK];
+                for (size_t i = 0;  i < nb;  ++i)
+                    acc[i] += vals[i] * w;
+            }
+        }
+
+        for (unsigned l = 0;  l < nl;  ++l) {
+            double * acc = &accum[l * BLOCK];
+            if (add_bias) {
+                float bias = weights[l][nf];
+                for (size_t i = 0;  i < nb;  ++i)
+                    acc[i] += bias;
+            }
+            for (size_t i = 0;  i < nb;  ++i)
+                accum_out[(start + i) * nl + l]
+                    += weight * apply_link_inverse(acc[i], link);
+        }
+    }
+}
+
 float
 GLZ_Classifier::
 decode_value(float feat_val, const Feature_Spec & spec) const
@@ -145,6 +145,16 @@ public:
                            const Optimization_Info & info,
                            PredictionContext * context = 0) const;
 
+    /** Batch predict.  The examples in a block are scored together, one
+        feature at a time, so that the inner loop runs over a contiguous
+        column of values and can be vectorized.
+    */
+    virtual void
+    optimized_predict_batch_impl(const float * const * columns, size_t n,
+                                 const Optimization_Info & info,
+                                 double * accum,
+                                 double weight = 1.0) const;
+
 #ifndef JML_TESTING_GLZ_CLASSIFIER
 protected:
 #endif
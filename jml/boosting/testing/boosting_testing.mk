@@ -3,11 +3,13 @@ $(eval $(call test,split_test,boosting,boost))
 $(eval $(call test,decision_tree_multithreaded_test,boosting utils arch worker_task,boost))
 $(eval $(call test,decision_tree_unlimited_depth_test,boosting utils arch worker_task,boost))
 $(eval $(call test,glz_classifier_test,boosting utils arch worker_task,boost))
+$(eval $(call test,predict_batch_test,boosting utils arch worker_task,boost))
 $(eval $(call test,probabilizer_test,boosting utils arch,boost))
 $(eval $(call test,feature_info_test,boosting utils arch,boost))
 $(eval $(call test,weighted_training_test,boosting,boost))
 
 $(eval $(call program,dataset_nan_test,boosting utils arch boosting_tools))
+$(eval $(call program,predict_batch_bench,boosting utils arch worker_task boost_program_options))
 
 ifeq ($(CUDA_ENABLED),1)
 $(eval $(call test,split_cuda_test,boosting_cuda,boost))
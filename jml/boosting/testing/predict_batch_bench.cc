@@ -0,0 +1,174 @@
+/* predict_batch_bench.cc
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Throughput of the batch predict against the optimized predict called
+   example by example, for each of the classifiers with a batch kernel.
+*/
+
+#include "jml/boosting/decision_tree_generator.h"
+#include "jml/boosting/boosted_stumps_generator.h"
+#include "jml/boosting/glz_classifier_generator.h"
+#include "jml/boosting/training_data.h"
+#include "jml/boosting/dense_features.h"
+#include "jml/boosting/feature_info.h"
+#include "jml/utils/smart_ptr_utils.h"
+#include "jml/arch/timers.h"
+#include "jml/arch/format.h"
+
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/parsers.hpp>
+#include <boost/program_options/variables_map.hpp>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+
+using namespace std;
+using namespace ML;
+
+
+namespace {
+
+// Somewhere for the results to go, so that they can't be optimized away
+volatile float sink;
+
+/** Return the number of examples per second that run() gets through,
+    where each call to run() does n examples. */
+template<typename Fn>
+double measure(const Fn & run, size_t n, double seconds)
+{
+    // Warm up the caches
+    run();
+
+    size_t total = 0;
+    Timer timer;
+    while (timer.elapsed_wall() < seconds) {
+        run();
+        total += n;
+    }
+
+    return total / timer.elapsed_wall();
+}
+
+} // file scope
+
+int main(int argc, char ** argv)
+{
+    using namespace boost::program_options;
+
+    size_t nfv = 100000;
+    int nf = 20;
+    int max_depth = 10;
+    int max_iter = 200;
+    double seconds = 1.0;
+
+    options_description options;
+    options.add_options()
+        ("examples,n", value(&nfv), "number of examples to predict")
+        ("features,f", value(&nf), "number of features")
+        ("max-depth", value(&max_depth), "depth of the decision tree")
+        ("max-iter", value(&max_iter), "number of boosted stumps")
+        ("seconds,s", value(&seconds), "time to run each test for")
+        ("help,h", "print this message");
+
+    variables_map vm;
+    store(command_line_parser(argc, argv).options(options).run(), vm);
+    notify(vm);
+
+    if (vm.count("help")) {
+        cerr << options << endl;
+        return 1;
+    }
+
+    Dense_Feature_Space fs;
+    fs.add_feature("LABEL", Feature_Info(BOOLEAN, false, true));
+    for (unsigned j = 1;  j <= nf;  ++j)
+        fs.add_feature(format("feature%d", j), REAL);
+
+    std::shared_ptr<Dense_Feature_Space> fsp(make_unowned_sp(fs));
+
+    /* The label depends on a few of the features, with some noise, so that
+       the classifiers have something to learn. */
+    Training_Data data(fsp);
+    vector<distribution<float> > rows;
+
+    for (unsigned i = 0;  i < nfv;  ++i) {
+        distribution<float> features(nf + 1);
+        for (unsigned j = 1;  j <= nf;  ++j)
+            features[j] = rand() / double(RAND_MAX);
+        if (i % 11 == 0)
+            features[1] = std::numeric_limits<float>::quiet_NaN();
+        features[0] = (features[2] + features[3] * features[nf]
+                       + 0.2 * rand() / double(RAND_MAX)) > 0.8;
+        if (i < 10000)
+            data.add_example(fs.encode(features));
+        rows.push_back(features);
+    }
+
+    vector<float> columns((nf + 1) * nfv);
+    for (unsigned i = 0;  i < nfv;  ++i)
+        for (unsigned j = 0;  j <= nf;  ++j)
+            columns[j * nfv + i] = rows[i][j];
+
+    Configuration config;
+    config.parse_string(format("verbosity=0\nmax_depth=%d\n"
+                               "max_iter=%d\nmin_iter=%d\n",
+                               max_depth, max_iter, max_iter),
+                        "inbuilt config file");
+
+    vector<Feature> features = fs.features();
+    features.erase(features.begin(), features.begin() + 1);
+
+    distribution<float> training_weights(data.example_count(), 1);
+
+    Decision_Tree_Generator dt;
+    Boosted_Stumps_Generator bs;
+    GLZ_Classifier_Generator glz;
+
+    vector<pair<string, Classifier_Generator *> > generators = {
+        { "decision tree", &dt },
+        { "boosted stumps", &bs },
+        { "glz", &glz }
+    };
+
+    cout << "throughput in thousands of examples per second over "
+         << nfv << " examples" << endl << endl;
+    cout << format("%-20s%15s%15s%10s", "", "predict", "predict_batch",
+                   "speedup")
+         << endl;
+
+    for (auto & g: generators) {
+        g.second->configure(config);
+        g.second->init(fsp, fs.features()[0]);
+
+        Thread_Context context;
+        std::shared_ptr<Classifier_Impl> classifier
+            = g.second->generate(context, data, training_weights, features);
+
+        Optimization_Info info = classifier->optimize(fs.features());
+
+        int nl = classifier->label_count();
+        vector<float> output(nfv * nl);
+
+        auto single = [&] ()
+            {
+                for (unsigned i = 0;  i < nfv;  ++i)
+                    sink = classifier->predict(&rows[i][0], info)[0];
+            };
+
+        auto batch = [&] ()
+            {
+                classifier->predict_batch(&columns[0], nfv, nfv, info,
+                                          &output[0]);
+                sink = output[0];
+            };
+
+        double singleRate = measure(single, nfv, seconds);
+        double batchRate = measure(batch, nfv, seconds);
+
+        cout << format("%-20s%15.1f%15.1f%9.2fx",
+                       g.first.c_str(), singleRate / 1000.0,
+                       batchRate / 1000.0, batchRate / singleRate)
+             << endl;
+    }
+}
@@ -0,0 +1,169 @@
+/* predict_batch_test.cc
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Test that the batch predict gives exactly the same results as the
+   optimized predict, example by example, or as the normal predict for
+   classifiers that can't be optimized.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include <vector>
+#include <iostream>
+#include <stdlib.h>
+
+#include "jml/boosting/decision_tree_generator.h"
+#include "jml/boosting/boosted_stumps_generator.h"
+#include "jml/boosting/glz_classifier_generator.h"
+#include "jml/boosting/naive_bayes_generator.h"
+#include "jml/boosting/training_data.h"
+#include "jml/boosting/dense_features.h"
+#include "jml/boosting/feature_info.h"
+#include "jml/utils/smart_ptr_utils.h"
+#include "jml/arch/format.h"
+
+using namespace ML;
+using namespace std;
+
+static const char * config_options = "\
+verbosity=0\n\
+max_iter=20\n\
+min_iter=20\n\
+max_depth=5\n\
+";
+
+const unsigned nfv = 1000;
+const unsigned nf = 4;
+
+float NaN = std::numeric_limits<float>::quiet_NaN();
+
+/** Make a dataset where the label depends on all of the features, and the
+    first feature is sometimes missing.  The rows are returned in
+    values. */
+void make_dataset(Dense_Feature_Space & fs, Training_Data & data,
+                  vector<distribution<float> > & values)
+{
+    srand(1);
+
+    for (unsigned i = 0;  i < nfv;  ++i) {
+        distribution<float> features(nf + 1);
+
+        for (unsigned j = 1;  j <= nf;  ++j)
+            features[j] = rand() % 100 / 10.0;
+        if (i % 7 == 0)
+            features[1] = NaN;
+
+        features[0] = (features[2] + features[3] > features[4] + 3.0);
+
+        data.add_example(fs.encode(features));
+        values.push_back(features);
+    }
+}
+
+void test_classifier(Classifier_Generator & generator)
+{
+    Dense_Feature_Space fs;
+    fs.add_feature("LABEL", Feature_Info(BOOLEAN, false, true));
+    for (unsigned j = 1;  j <= nf;  ++j)
+        fs.add_feature(format("feature%d", j), REAL);
+
+    std::shared_ptr<Dense_Feature_Space> fsp(make_unowned_sp(fs));
+
+    Training_Data data(fsp);
+    vector<distribution<float> > values;
+    make_dataset(fs, data, values);
+
+    Configuration config;
+    config.parse_string(config_options, "inbuilt config file");
+
+    generator.configure(config);
+    generator.init(fsp, fs.features()[0]);
+
+    distribution<float> training_weights(nfv, 1);
+
+    vector<Feature> features = fs.features();
+    features.erase(features.begin(), features.begin() + 1);
+
+    Thread_Context context;
+
+    std::shared_ptr<Classifier_Impl> classifier
+        = generator.generate(context, data, data, training_weights,
+                             training_weights, features);
+
+    int nl = classifier->label_count();
+
+    Optimization_Info info = classifier->optimize(fs.features());
+    bool optimized = classifier->optimization_supported();
+    BOOST_REQUIRE_EQUAL(bool(info), optimized);
+    BOOST_CHECK_EQUAL(classifier->predict_is_optimized(), optimized);
+
+    // Column major, with a stride that isn't the number of examples
+    size_t stride = nfv + 3;
+    vector<float> columns((nf + 1) * stride);
+    for (unsigned i = 0;  i < nfv;  ++i)
+        for (unsigned j = 0;  j <= nf;  ++j)
+            columns[j * stride + i] = values[i][j];
+
+    vector<float> output(nfv * nl);
+    classifier->predict_batch(&columns[0], stride, nfv, info, &output[0]);
+
+    vector<float> output_label(nfv);
+    classifier->predict_batch(nl - 1, &columns[0], stride, nfv, info,
+                              &output_label[0]);
+
+    int wrong = 0;
+    for (unsigned i = 0;  i < nfv;  ++i) {
+        Label_Dist expected = optimized
+            ? classifier->predict(&values[i][0], info)
+            : classifier->predict(*fs.encode(values[i]));
+        BOOST_REQUIRE_EQUAL(expected.size(), nl);
+        for (unsigned l = 0;  l < nl;  ++l) {
+            if (output[i * nl + l] != expected[l]) {
+                if (++wrong < 10)
+                    cerr << "example " << i << " label " << l
+                         << ": batch " << output[i * nl + l]
+                         << " expected " << expected[l] << endl;
+            }
+        }
+        BOOST_CHECK_EQUAL(output_label[i], expected[nl - 1]);
+    }
+
+    BOOST_CHECK_EQUAL(wrong, 0);
+
+    // A part of the batch gives the same results as the whole
+    vector<float> output2(10 * nl);
+    classifier->predict_batch(&columns[0] + 500, stride, 10, info,
+                              &output2[0]);
+    for (unsigned i = 0;  i < 10 * nl;  ++i)
+        BOOST_CHECK_EQUAL(output2[i], output[500 * nl + i]);
+
+    BOOST_CHECK_THROW(classifier->predict_batch(nl, &columns[0], stride, nfv,
+                                                info, &output_label[0]),
+                      Exception);
+}
+
+BOOST_AUTO_TEST_CASE( test_predict_batch_decision_tree )
+{
+    Decision_Tree_Generator generator;
+    test_classifier(generator);
+}
+
+BOOST_AUTO_TEST_CASE( test_predict_batch_boosted_stumps )
+{
+    Boosted_Stumps_Generator generator;
+    test_classifier(generator);
+}
+
+BOOST_AUTO_TEST_CASE( test_predict_batch_glz )
+{
+    GLZ_Classifier_Generator generator;
+    test_classifier(generator);
+}
+
+BOOST_AUTO_TEST_CASE( test_predict_batch_not_optimized )
+{
+    Naive_Bayes_Generator generator;
+    test_classifier(generator);
+}
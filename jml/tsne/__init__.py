@@ -13,6 +13,10 @@ def tsne_core(array, num_dims=2, **kwargs):
     return _tsne.tsne(array, num_dims, **kwargs)
 
 
+def sparse_tsne(X, num_dims=2, perplexity=30.0, **kwargs):
+    return _tsne.sparse_tsne(X, num_dims, perplexity, **kwargs)
+
+
 def pca(X, no_dims=50):
     """
     Runs PCA on the NxD array X in order to reduce its dimensionality to
@@ -35,12 +39,21 @@ def pca(X, no_dims=50):
 
 
 def tsne(X, num_dims=2, initial_dims=50, perplexity=30.0, use_pca=True,
-         **kwargs):
+         method="exact", **kwargs):
+    """
+    Method is "exact" for the O(n^2) algorithm, or "barnes_hut" for the
+    O(n log n) approximation over the nearest neighbours.
+    """
 
     if use_pca:
         X = pca(X, initial_dims)
     (n, d) = X.shape
 
+    if method == "barnes_hut":
+        return sparse_tsne(X, num_dims, perplexity, **kwargs)
+    elif method != "exact":
+        raise ValueError("unknown t-SNE method " + method)
+
     D = vectors_to_distances(X)
 
     P = distances_to_probabilities(D, perplexity=perplexity)
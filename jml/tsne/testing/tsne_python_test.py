@@ -93,5 +93,18 @@ def test_tsne():
 
 test_tsne()
 
+def test_sparse_tsne():
+    global digits
+
+    X = digits[range(250), ...]
+
+    Y = tsne.tsne(X, 2, 50, 20.0, use_pca=True, method="barnes_hut",
+                  max_iter=300, theta=0.5)
+
+    assert Y.shape == (250, 2)
+
+
+test_sparse_tsne()
+
 #sys.exit(1)
 
@@ -280,3 +280,106 @@ BOOST_AUTO_TEST_CASE( test_distance_to_probability_big )
     boost::multi_array<float, 2> reduction JML_UNUSED
         = tsne(probabilities, 2);
 }
+
+BOOST_AUTO_TEST_CASE( test_sparse_probabilities )
+{
+    string input_file = Environment::instance()["JML_TOP"]
+        + "/tsne/testing/mnist2500_X_min.txt.gz";
+
+    filter_istream stream(input_file);
+    Parse_Context context(input_file, stream);
+
+    int nd = 784;
+    int nx = 200;
+
+    boost::multi_array<float, 2> data(boost::extents[nx][nd]);
+
+    for (unsigned i = 0;  i < nx;  ++i) {
+        for (unsigned j = 0;  j < nd;  ++j) {
+            float f = context.expect_float();
+            data[i][j] = f;
+            context.expect_whitespace();
+        }
+
+        context.expect_eol();
+    }
+
+    boost::multi_array<float, 2> distances
+        = vectors_to_distances(data);
+
+    // With a few neighbours, they need to be the nearest ones
+    int k = 15;
+    TSNE_Sparse_Prob sparse
+        = sparse_distances_to_probabilities(data, 1e-5, 5.0, k);
+
+    BOOST_REQUIRE_EQUAL(sparse.size(), nx);
+
+    for (unsigned i = 0;  i < nx;  ++i) {
+        BOOST_REQUIRE_EQUAL(sparse.offsets[i + 1] - sparse.offsets[i], k);
+
+        distribution<float> D_row(&distances[i][0], &distances[i][0] + nx);
+        D_row[i] = INFINITY;
+        std::sort(D_row.begin(), D_row.end());
+
+        double total = 0.0;
+        for (int e = sparse.offsets[i];  e < sparse.offsets[i + 1];  ++e) {
+            int j = sparse.indexes[e];
+            BOOST_CHECK_NE(j, i);
+            BOOST_CHECK_LE(distances[i][j], D_row[k - 1] * 1.0001);
+            total += sparse.values[e];
+        }
+
+        BOOST_CHECK_CLOSE(total, 1.0, 0.001);
+    }
+
+    // With all of the neighbours, it's the same as the full version
+    boost::multi_array<float, 2> probabilities
+        = distances_to_probabilities(distances, 1e-5, 20.0);
+
+    TSNE_Sparse_Prob all
+        = sparse_distances_to_probabilities(data, 1e-5, 20.0, nx - 1);
+
+    for (unsigned i = 0;  i < nx;  ++i) {
+        for (int e = all.offsets[i];  e < all.offsets[i + 1];  ++e) {
+            int j = all.indexes[e];
+            if (probabilities[i][j] < 1e-6) continue;
+            BOOST_CHECK_CLOSE(all.values[e], probabilities[i][j], 0.1);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_sparse_tsne )
+{
+    string input_file = Environment::instance()["JML_TOP"]
+        + "/tsne/testing/mnist2500_X_min.txt.gz";
+
+    filter_istream stream(input_file);
+    Parse_Context context(input_file, stream);
+
+    int nd = 784;
+    int nx = 2500;
+
+    boost::multi_array<float, 2> data(boost::extents[nx][nd]);
+
+    cerr << "loading " << nx << " examples...";
+    for (unsigned i = 0;  i < nx;  ++i) {
+        for (unsigned j = 0;  j < nd;  ++j) {
+            float f = context.expect_float();
+            data[i][j] = f;
+            context.expect_whitespace();
+        }
+
+        context.expect_eol();
+    }
+    cerr << "done." << endl;
+
+    TSNE_Sparse_Prob probabilities
+        = sparse_distances_to_probabilities(data);
+
+    boost::multi_array<float, 2> reduction
+        = tsne(probabilities, 2);
+
+    for (unsigned i = 0;  i < nx;  ++i)
+        for (unsigned j = 0;  j < 2;  ++j)
+            BOOST_CHECK(isfinite(reduction[i][j]));
+}
@@ -26,6 +26,8 @@
 #include "jml/utils/guard.h"
 #include <boost/bind.hpp>
 #include "jml/utils/environment.h"
+#include <queue>
+#include <algorithm>
 
 using namespace std;
 
@@ -422,6 +424,204 @@ distances_to_probabilities(boost::multi_array<float, 2> & D,
     return P;
 }
 
+/** Vantage point tree over the rows of X, used to find the nearest
+    neighbours of each point without calculating all of the distances.
+
+    Each node holds a point and the median distance from it to the points
+    below it; those closer than the median are on the left and the rest
+    on the right, so that whole subtrees can be skipped when searching.
+*/
+struct VP_Tree {
+
+    VP_Tree(const boost::multi_array<float, 2> & X)
+        : X(X), d(X.shape()[1])
+    {
+        int n = X.shape()[0];
+        items.resize(n);
+        for (unsigned i = 0;  i < n;  ++i)
+            items[i] = i;
+        nodes.reserve(n);
+
+        boost::mt19937 rng;
+        build(0, n, rng);
+    }
+
+    /** Find the k nearest neighbours of point i, not including itself.
+        They are returned nearest first, along with their distances.
+    */
+    void search(int i, int k,
+                std::vector<int> & indexes,
+                std::vector<float> & distances) const
+    {
+        Heap heap;
+        float tau = INFINITY;
+        search(0, i, k, heap, tau);
+
+        indexes.resize(heap.size());
+        distances.resize(heap.size());
+        for (int j = heap.size() - 1;  j >= 0;  --j) {
+            distances[j] = heap.top().first;
+            indexes[j] = heap.top().second;
+            heap.pop();
+        }
+    }
+
+    float distance(int i, int j) const
+    {
+        const float * xi = &X[i][0];
+        const float * xj = &X[j][0];
+        double total = 0.0;
+        for (unsigned k = 0;  k < d;  ++k) {
+            float diff = xi[k] - xj[k];
+            total += diff * diff;
+        }
+        return sqrt(total);
+    }
+
+private:
+    struct Node {
+        int index;        ///< Point at this node
+        float threshold;  ///< Median distance to the points below
+        int left;         ///< Node for points closer than threshold
+        int right;        ///< Node for the rest of the points
+    };
+
+    const boost::multi_array<float, 2> & X;
+    int d;
+    std::vector<int> items;
+    std::vector<Node> nodes;
+
+    /** Max heap of (distance, index) of the nearest points so far. */
+    typedef std::priority_queue<std::pair<float, int> > Heap;
+
+    int build(int lower, int upper, boost::mt19937 & rng)
+    {
+        if (upper == lower)
+            return -1;
+
+        int index = nodes.size();
+        nodes.push_back(Node());
+
+        Node node;
+        node.threshold = 0.0;
+        node.left = node.right = -1;
+
+        if (upper - lower > 1) {
+            // Random vantage point, then split the rest about the median
+            int i = lower + rng() % (upper - lower);
+            std::swap(items[lower], items[i]);
+
+            int vp = items[lower];
+            int median = (upper + lower) / 2;
+
+            std::nth_element(items.begin() + lower + 1,
+                             items.begin() + median,
+                             items.begin() + upper,
+                             [&] (int a, int b)
+                             {
+                                 return distance(vp, a) < distance(vp, b);
+                             });
+
+            node.threshold = distance(vp, items[median]);
+            node.left = build(lower + 1, median, rng);
+            node.right = build(median, upper, rng);
+        }
+
+        node.index = items[lower];
+        nodes[index] = node;
+        return index;
+    }
+
+    void search(int n, int target, int k, Heap & heap, float & tau) const
+    {
+        if (n == -1)
+            return;
+
+        const Node & node = nodes[n];
+        float dist = distance(node.index, target);
+
+        if (node.index != target && dist < tau) {
+            if (heap.size() == k)
+                heap.pop();
+            heap.push(std::make_pair(dist, node.index));
+            if (heap.size() == k)
+                tau = heap.top().first;
+        }
+
+        // Look first on the side that the target is on, as it's more likely
+        // to tighten tau so that the other side can be skipped
+        if (dist < node.threshold) {
+            if (dist - tau <= node.threshold)
+                search(node.left, target, k, heap, tau);
+            if (dist + tau >= node.threshold)
+                search(node.right, target, k, heap, tau);
+        }
+        else {
+            if (dist + tau >= node.threshold)
+                search(node.right, target, k, heap, tau);
+            if (dist - tau <= node.threshold)
+                search(node.left, target, k, heap, tau);
+        }
+    }
+};
+
+TSNE_Sparse_Prob
+sparse_distances_to_probabilities(const boost::multi_array<float, 2> & X,
+                                  double tolerance,
+                                  double perplexity,
+                                  int num_neighbours)
+{
+    int n = X.shape()[0];
+
+    if (num_neighbours == -1)
+        num_neighbours = 3 * perplexity;
+    int k = std::min(num_neighbours, n - 1);
+    if (k < 1)
+        throw Exception("sparse_distances_to_probabilities: need at least "
+                        "one neighbour");
+
+    VP_Tree tree(X);
+
+    TSNE_Sparse_Prob result;
+    result.offsets.resize(n + 1);
+    result.indexes.resize(n * k);
+    result.values.resize(n * k);
+    for (unsigned i = 0;  i <= n;  ++i)
+        result.offsets[i] = i * k;
+
+    distribution<float> beta(n, 1.0);
+
+    auto doRow = [&] (int i)
+        {
+            std::vector<int> indexes;
+            std::vector<float> distances;
+            tree.search(i, k, indexes, distances);
+
+            distribution<float> D_row(k);
+            for (unsigned j = 0;  j < k;  ++j)
+                D_row[j] = distances[j] * distances[j];
+
+            distribution<float> P_row;
+            try {
+                boost::tie(P_row, beta[i])
+                    = binary_search_perplexity(D_row, perplexity, -1,
+                                               tolerance);
+            } catch (const std::exception & exc) {
+                P_row = distribution<float>(k, 1.0 / k);
+            }
+
+            std::copy(indexes.begin(), indexes.end(),
+                      &result.indexes[i * k]);
+            std::copy(P_row.begin(), P_row.end(), &result.values[i * k]);
+        };
+
+    run_in_parallel_blocked(0, n, doRow);
+
+    cerr << "mean sigma is " << sqrt(1.0 / beta).mean() << endl;
+
+    return result;
+}
+
 boost::multi_array<float, 2>
 pca(boost::multi_array<float, 2> & coords, int num_dims)
 {
@@ -1173,4 +1373,408 @@ tsne(const boost::multi_array<float, 2> & probs,
     return Y;
 }
 
+
+namespace {
+
+/** Space partitioning tree (quadtree in 2 dimensions, octree in 3) over
+    the points of the embedding, used to approximate the repulsive forces
+    in the manner of Barnes and Hut.
+
+    Each cell knows how many points are in it and where their centre of
+    mass is.  A leaf holds a single point, or several identical ones.
+*/
+struct SP_Tree {
+
+    enum { MAX_DIMS = 3, MAX_DEPTH = 48 };
+
+    SP_Tree(const boost::multi_array<float, 2> & Y)
+        : Y(Y), d(Y.shape()[1]), nchildren(1 << d)
+    {
+        int n = Y.shape()[0];
+
+        Cell root;
+        for (unsigned k = 0;  k < d;  ++k) {
+            float minv = INFINITY, maxv = -INFINITY;
+            for (unsigned i = 0;  i < n;  ++i) {
+                minv = std::min(minv, Y[i][k]);
+                maxv = std::max(maxv, Y[i][k]);
+            }
+            root.center[k] = 0.5f * (minv + maxv);
+            root.width[k] = 0.5f * (maxv - minv) + 1e-5f;
+        }
+        cells.reserve(2 * n);
+        cells.push_back(root);
+
+        for (unsigned i = 0;  i < n;  ++i)
+            insert(i);
+    }
+
+    /** Add the repulsive forces on point i into neg_f, and its
+        contribution to the normalization Z into sum_Q.
+    */
+    void non_edge_forces(int i, float theta2, double * neg_f,
+                         double & sum_Q) const
+    {
+        non_edge_forces(0, &Y[i][0], theta2, neg_f, sum_Q);
+    }
+
+private:
+    struct Cell {
+        Cell()
+            : size(0), point(-1), children(-1)
+        {
+            std::fill(center_of_mass, center_of_mass + MAX_DIMS, 0.0f);
+        }
+
+        float center[MAX_DIMS];          ///< Middle of the cell
+        float width[MAX_DIMS];           ///< Half of the size of the cell
+        float center_of_mass[MAX_DIMS];  ///< Average of the points in it
+        int size;                        ///< Number of points in the cell
+        int point;                       ///< Point in a leaf, or -1
+        int children;                    ///< Index of first child, or -1
+    };
+
+    const boost::multi_array<float, 2> & Y;
+    int d;
+    int nchildren;
+    std::vector<Cell> cells;
+
+    bool same_point(int i, int j) const
+    {
+        for (unsigned k = 0;  k < d;  ++k)
+            if (Y[i][k] != Y[j][k]) return false;
+        return true;
+    }
+
+    /** Which child of the cell the point goes into. */
+    int child_for(const Cell & cell, const float * y) const
+    {
+        int result = 0;
+        for (unsigned k = 0;  k < d;  ++k)
+            if (y[k] > cell.center[k]) result |= (1 << k);
+        return cell.children + result;
+    }
+
+    void add_to(Cell & cell, const float * y, int count)
+    {
+        for (unsigned k = 0;  k < d;  ++k)
+            cell.center_of_mass[k]
+                = (cell.center_of_mass[k] * cell.size + y[k] * count)
+                / (cell.size + count);
+        cell.size += count;
+    }
+
+    void subdivide(int c)
+    {
+        int first = cells.size();
+        for (unsigned ch = 0;  ch < nchildren;  ++ch) {
+            Cell child;
+            for (unsigned k = 0;  k < d;  ++k) {
+                float hw = 0.5f * cells[c].width[k];
+                child.width[k] = hw;
+                child.center[k] = cells[c].center[k]
+                    + ((ch & (1 << k)) ? hw : -hw);
+            }
+            cells.push_back(child);
+        }
+        cells[c].children = first;
+    }
+
+    void insert(int i)
+    {
+        const float * y = &Y[i][0];
+
+        for (int c = 0, depth = 0;  ;  ++depth) {
+            add_to(cells[c], y, 1);
+
+            if (cells[c].children != -1) {
+                c = child_for(cells[c], y);
+                continue;
+            }
+
+            if (cells[c].point == -1) {
+                cells[c].point = i;
+                return;
+            }
+
+            // Identical points (or ones too close together to separate)
+            // share a leaf
+            if (same_point(cells[c].point, i) || depth >= MAX_DEPTH)
+                return;
+
+            // Push the points that were already here down into a child
+            int old = cells[c].point;
+            int old_count = cells[c].size - 1;
+            subdivide(c);
+            cells[c].point = -1;
+
+            int oc = child_for(cells[c], &Y[old][0]);
+            cells[oc].point = old;
+            add_to(cells[oc], &Y[old][0], old_count);
+
+            c = child_for(cells[c], y);
+        }
+    }
+
+    void non_edge_forces(int c, const float * y, float theta2,
+                         double * neg_f, double & sum_Q) const
+    {
+        const Cell & cell = cells[c];
+        if (cell.size == 0)
+            return;
+
+        float D = 0.0, max_width = 0.0;
+        float diff[MAX_DIMS];
+        for (unsigned k = 0;  k < d;  ++k) {
+            diff[k] = y[k] - cell.center_of_mass[k];
+            D += diff[k] * diff[k];
+            max_width = std::max(max_width, 2.0f * cell.width[k]);
+        }
+
+        bool leaf = cell.children == -1;
+
+        if (leaf || max_width * max_width < theta2 * D) {
+            int size = cell.size;
+
+            // A point doesn't repel itself or its duplicates
+            if (leaf && std::equal(y, y + d, &Y[cell.point][0])) {
+                --size;
+                D = 0.0;
+            }
+
+            float Q = 1.0f / (1.0f + D);
+            sum_Q += size * Q;
+            float mult = size * Q * Q;
+            for (unsigned k = 0;  k < d;  ++k)
+                neg_f[k] += mult * diff[k];
+            return;
+        }
+
+        for (unsigned ch = 0;  ch < nchildren;  ++ch)
+            non_edge_forces(cell.children + ch, y, theta2, neg_f, sum_Q);
+    }
+};
+
+/** Symmetrize the probabilities and normalize them so that they sum to
+    one, as P + P^T is done for the full matrix.
+*/
+TSNE_Sparse_Prob
+symmetrize(const TSNE_Sparse_Prob & probs)
+{
+    int n = probs.size();
+
+    std::vector<std::vector<std::pair<int, float> > > rows(n);
+
+    double total = 0.0;
+
+    for (unsigned i = 0;  i < n;  ++i) {
+        for (int e = probs.offsets[i];  e < probs.offsets[i + 1];  ++e) {
+            int j = probs.indexes[e];
+            float p = probs.values[e];
+            if (j < 0 || j >= n)
+                throw Exception("sparse probabilities index out of range");
+            if (j == i) continue;
+            rows[i].push_back(std::make_pair(j, p));
+            rows[j].push_back(std::make_pair(i, p));
+            total += 2.0 * p;
+        }
+    }
+
+    if (total == 0.0)
+        throw Exception("sparse probabilities are all zero");
+
+    TSNE_Sparse_Prob result;
+    result.offsets.push_back(0);
+
+    for (unsigned i = 0;  i < n;  ++i) {
+        std::sort(rows[i].begin(), rows[i].end());
+        for (unsigned e = 0;  e < rows[i].size();  ++e) {
+            int j = rows[i][e].first;
+            double p = rows[i][e].second;
+            while (e + 1 < rows[i].size() && rows[i][e + 1].first == j)
+                p += rows[i][++e].second;
+            result.indexes.push_back(j);
+            result.values.push_back(p / total);
+        }
+        result.offsets.push_back(result.indexes.size());
+        std::vector<std::pair<int, float> >().swap(rows[i]);
+    }
+
+    return result;
+}
+
+} // file scope
+
+/** Gradient of the cost for the approximate t-SNE.
+
+    The attractive part of formula 5 in (Van der Maaten and Hinton, 2008)
+    only needs the pairs with a non-zero p_ij.  The repulsive part,
+
+    sum_j q_ij d_ij (y_i - y_j) = (1 / Z) sum_j d_ij^2 (y_i - y_j)
+
+    is approximated by the tree, which also gives Z.  Returns the cost if
+    calc_cost is set.
+*/
+double tsne_calc_gradient_sparse(boost::multi_array<float, 2> & dY,
+                                 const boost::multi_array<float, 2> & Y,
+                                 const TSNE_Sparse_Prob & P,
+                                 float pfactor,
+                                 double theta,
+                                 float min_prob,
+                                 bool calc_cost)
+{
+    int n = Y.shape()[0];
+    int d = Y.shape()[1];
+
+    SP_Tree tree(Y);
+
+    std::vector<double> pos_f(n * d), neg_f(n * d), sum_Q(n);
+
+    float theta2 = theta * theta;
+
+    auto doPoint = [&] (int i)
+        {
+            const float * yi = &Y[i][0];
+            double * pos = &pos_f[i * d];
+
+            for (int e = P.offsets[i];  e < P.offsets[i + 1];  ++e) {
+                const float * yj = &Y[P.indexes[e]][0];
+                float D = 0.0;
+                for (unsigned k = 0;  k < d;  ++k)
+                    D += (yi[k] - yj[k]) * (yi[k] - yj[k]);
+                float mult = pfactor * P.values[e] / (1.0f + D);
+                for (unsigned k = 0;  k < d;  ++k)
+                    pos[k] += mult * (yi[k] - yj[k]);
+            }
+
+            tree.non_edge_forces(i, theta2, &neg_f[i * d], sum_Q[i]);
+        };
+
+    run_in_parallel_blocked(0, n, doPoint);
+
+    double Z = 0.0;
+    for (unsigned i = 0;  i < n;  ++i)
+        Z += sum_Q[i];
+
+    for (unsigned i = 0;  i < n;  ++i)
+        for (unsigned k = 0;  k < d;  ++k)
+            dY[i][k] = 4.0 * (pos_f[i * d + k] - neg_f[i * d + k] / Z);
+
+    if (!calc_cost)
+        return 0.0;
+
+    // KL divergence over the non-zero p_ij
+    double cost = 0.0;
+    for (unsigned i = 0;  i < n;  ++i) {
+        const float * yi = &Y[i][0];
+        for (int e = P.offsets[i];  e < P.offsets[i + 1];  ++e) {
+            const float * yj = &Y[P.indexes[e]][0];
+            float D = 0.0;
+            for (unsigned k = 0;  k < d;  ++k)
+                D += (yi[k] - yj[k]) * (yi[k] - yj[k]);
+            double p = pfactor * P.values[e];
+            double q = std::max<double>(min_prob, 1.0 / ((1.0 + D) * Z));
+            cost += p * log(p / q);
+        }
+    }
+
+    return cost;
+}
+
+boost::multi_array<float, 2>
+tsne(const TSNE_Sparse_Prob & probs,
+     int num_dims,
+     const TSNE_Params & params,
+     const TSNE_Callback & callback)
+{
+    int n = probs.size();
+    int d = num_dims;
+
+    if (d < 1 || d > 3)
+        throw Exception("Barnes-Hut t-SNE only supports 1 to 3 dimensions");
+
+    // Symmetrize and probabilize P
+    TSNE_Sparse_Prob P = symmetrize(probs);
+
+    cerr << "sparse probabilities: " << P.values.size() << " non-zero for "
+         << n << " points" << endl;
+
+    boost::mt19937 rng;
+    boost::normal_distribution<float> norm;
+
+    boost::variate_generator<boost::mt19937,
+                             boost::normal_distribution<float> >
+        randn(rng, norm);
+
+    boost::multi_array<float, 2> Y(boost::extents[n][d]);
+    for (unsigned i = 0;  i < n;  ++i)
+        for (unsigned j = 0;  j < d;  ++j)
+            Y[i][j] = 0.01 * randn();
+
+    // We boost P by 4 in early iterations to force the clusters to be
+    // spread apart
+    float pfactor = 4.0;
+
+    Timer timer;
+
+    boost::multi_array<float, 2> dY(boost::extents[n][d]);
+    boost::multi_array<float, 2> iY(boost::extents[n][d]);
+    boost::multi_array<float, 2> gains(boost::extents[n][d]);
+    std::fill(gains.data(), gains.data() + gains.num_elements(), 1.0f);
+
+    if (callback
+        && !callback(-1, INFINITY, "init")) return Y;
+
+    for (int iter = 0;  iter < params.max_iter;  ++iter) {
+
+        boost::timer t;
+
+        bool calc_cost = (iter + 1) % 100 == 0 || iter == params.max_iter - 1;
+
+        double cost = tsne_calc_gradient_sparse(dY, Y, P, pfactor,
+                                                params.theta,
+                                                params.min_prob,
+                                                calc_cost);
+
+        t_dY += t.elapsed();  t.restart();
+
+        if (callback
+            && !callback(iter, INFINITY, "gradient")) return Y;
+
+        float momentum = (iter < 20
+                          ? params.initial_momentum
+                          : params.final_momentum);
+
+        tsne_update(Y, dY, iY, gains, iter == 0, momentum, params.eta,
+                    params.min_gain);
+
+        if (callback
+            && !callback(iter, INFINITY, "update")) return Y;
+
+        t_update += t.elapsed();  t.restart();
+
+        recenter_about_origin(Y);
+
+        if (callback
+            && !callback(iter, INFINITY, "recenter")) return Y;
+
+        t_recenter += t.elapsed();  t.restart();
+
+        if (calc_cost) {
+            cerr << format("iteration %4d cost %6.3f  ",
+                           iter + 1, cost)
+                 << timer.elapsed() << endl;
+            timer.restart();
+        }
+
+        t_cost += t.elapsed();  t.restart();
+
+        // Stop lying about P values if we're finished
+        if (iter == 100)
+            pfactor = 1.0;
+    }
+
+    return Y;
+}
+
 } // namespace ML
@@ -18,6 +18,7 @@
 #include "jml/stats/distribution.h"
 #include <boost/multi_array.hpp>
 #include <boost/function.hpp>
+#include <vector>
 
 namespace ML {
 
@@ -83,6 +84,41 @@ distances_to_probabilities(boost::multi_array<float, 2> & D,
                            double tolerance = 1e-5,
                            double perplexity = 30.0);
 
+/** Probabilities that are zero for all but a few pairs of points, held
+    as a compressed sparse row matrix.  The non-zero entries of row i
+    are values[offsets[i]] to values[offsets[i + 1] - 1], which are in the
+    columns given by the same entries of indexes.
+*/
+struct TSNE_Sparse_Prob {
+    std::vector<int> offsets;
+    std::vector<int> indexes;
+    std::vector<float> values;
+
+    /** Number of rows (points) in the matrix. */
+    int size() const
+    {
+        return offsets.empty() ? 0 : offsets.size() - 1;
+    }
+};
+
+/** Sparse version of vectors_to_distances and distances_to_probabilities
+    together, for when the full n x n matrix is too big.
+
+    The num_neighbours nearest neighbours of each point in X are found with
+    a vantage point tree, and only their distances are converted into
+    probabilities with the given perplexity; the probabilities for all of
+    the other points are taken as zero.  Takes O(n log n) time and O(n k)
+    memory.
+
+    If num_neighbours is -1, 3 * perplexity neighbours are used, which
+    is enough for almost all of the probability mass.
+*/
+TSNE_Sparse_Prob
+sparse_distances_to_probabilities(const boost::multi_array<float, 2> & X,
+                                  double tolerance = 1e-5,
+                                  double perplexity = 30.0,
+                                  int num_neighbours = -1);
+
 /** Perform a principal component analysis.  This routine will reduce a
     (n x d) matrix to a (n x e) matrix, where e < d (and is possibly far less).
     The num_dims parameter gives the preferred value of e; it is possible that
@@ -100,7 +136,8 @@ struct TSNE_Params {
           final_momentum(0.8),
           eta(500),
           min_gain(0.01),
-          min_prob(1e-12)
+          min_prob(1e-12),
+          theta(0.5)
     {
     }
 
@@ -110,6 +147,13 @@ struct TSNE_Params {
     double eta;
     double min_gain;
     double min_prob;
+
+    /** Accuracy of the Barnes-Hut approximation used by the sparse
+        version.  A group of points is treated as a single point once the
+        size of its cell is less than theta times its distance; 0 means no
+        approximation.
+    */
+    double theta;
 };
 
 // Function that will be used as a callback to provide progress to a calling
@@ -129,6 +173,20 @@ tsne(const boost::multi_array<float, 2> & probs,
      const TSNE_Params & params = TSNE_Params(),
      const TSNE_Callback & callback = TSNE_Callback());
 
+/** Approximate t-SNE from sparse probabilities, in O(n log n) time per
+    iteration.  The attractive forces are only calculated between the
+    pairs of points with a non-zero probability, and the repulsive forces
+    between all of the points are approximated with a Barnes-Hut tree
+    over the embedding.  The gradient is calculated in parallel.
+
+    Only embeddings of up to 3 dimensions are supported.
+*/
+boost::multi_array<float, 2>
+tsne(const TSNE_Sparse_Prob & probs,
+     int num_dims = 2,
+     const TSNE_Params & params = TSNE_Params(),
+     const TSNE_Callback & callback = TSNE_Callback());
+
 
 } // namespace ML
 
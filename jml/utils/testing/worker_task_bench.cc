@@ -0,0 +1,146 @@
+/* worker_task_bench.cc
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   How the worker task scales with the number of threads, for fine grained
+   jobs.
+*/
+
+#include "jml/utils/worker_task.h"
+#include "jml/utils/guard.h"
+#include "jml/arch/timers.h"
+#include "jml/arch/format.h"
+#include "jml/arch/atomic_ops.h"
+
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/parsers.hpp>
+#include <boost/program_options/variables_map.hpp>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <math.h>
+
+using namespace std;
+using namespace ML;
+
+
+namespace {
+
+// Somewhere for the jobs to write their results, so that they can't be
+// optimized away
+volatile double sink;
+
+/** A small amount of work; about as much as updating a handful of weights
+    in a boosting iteration. */
+double work(int i, int amount)
+{
+    double result = i;
+    for (int j = 0;  j < amount;  ++j)
+        result = result * 0.999 + sqrt(result + j);
+    return result;
+}
+
+struct Benchmark {
+    const char * name;
+    std::function<void (Worker_Task &, int njobs, int amount)> run;
+};
+
+/** Lots of jobs added to a single group from the calling thread, as the
+    boosting code does. */
+void runGroup(Worker_Task & worker, int njobs, int amount)
+{
+    int group = worker.get_group(NO_JOB, "bench");
+    {
+        Call_Guard guard(std::bind(&Worker_Task::unlock_group,
+                                   &worker, group));
+        for (int i = 0;  i < njobs;  ++i)
+            worker.add([=] () { sink = work(i, amount); }, "", group);
+    }
+    worker.run_until_finished(group);
+}
+
+/** A range split up by run_in_parallel_blocked. */
+void runBlocked(Worker_Task & worker, int njobs, int amount)
+{
+    run_in_parallel_blocked(0, njobs,
+                            [=] (int i) { sink = work(i, amount); },
+                            -1, "", "", worker);
+}
+
+/** Nested ranges, where each job spawns more jobs from inside a worker
+    thread. */
+void runNested(Worker_Task & worker, int njobs, int amount)
+{
+    int outer = 64;
+    auto doOuter = [&] (int o)
+        {
+            run_in_parallel(0, njobs / outer,
+                            [=] (int i) { sink = work(i, amount); },
+                            -1, "", "", worker);
+        };
+    run_in_parallel(0, outer, doOuter, -1, "", "", worker);
+}
+
+} // file scope
+
+int main(int argc, char ** argv)
+{
+    using namespace boost::program_options;
+
+    vector<int> threads = { 1, 2, 4, 8, 16, 32, 64 };
+    int njobs = 1000000;
+    int amount = 10;
+    int repeats = 3;
+
+    options_description options;
+    options.add_options()
+        ("threads,t", value(&threads)->multitoken(),
+         "numbers of threads to test with")
+        ("jobs,n", value(&njobs),
+         "number of jobs to run in each benchmark")
+        ("amount,a", value(&amount),
+         "amount of work in each job")
+        ("repeats,r", value(&repeats),
+         "number of times to run each benchmark; the best is kept")
+        ("help,h", "print this message");
+
+    variables_map vm;
+    store(command_line_parser(argc, argv).options(options).run(), vm);
+    notify(vm);
+
+    if (vm.count("help")) {
+        cerr << options << endl;
+        return 1;
+    }
+
+    vector<Benchmark> benchmarks = {
+        { "group", runGroup },
+        { "blocked", runBlocked },
+        { "nested", runNested }
+    };
+
+    cout << "millions of jobs per second for " << njobs
+         << " jobs of size " << amount << endl << endl;
+
+    cout << format("%-10s", "threads");
+    for (auto & b: benchmarks)
+        cout << format("%12s", b.name);
+    cout << endl;
+
+    for (int n: threads) {
+        // The calling thread works too
+        Worker_Task worker(n - 1);
+
+        cout << format("%-10d", n);
+        for (auto & b: benchmarks) {
+            double best = INFINITY;
+            for (int r = 0;  r < repeats;  ++r) {
+                Timer timer;
+                b.run(worker, njobs, amount);
+                best = std::min(best, timer.elapsed_wall());
+            }
+            cout << format("%12.2f", njobs / best / 1000000.0) << flush;
+        }
+        cout << endl;
+    }
+}
@@ -13,6 +13,7 @@
 #include <boost/thread/barrier.hpp>
 #include <boost/bind.hpp>
 #include <vector>
+#include <algorithm>
 #include <stdint.h>
 #include <iostream>
 
@@ -160,3 +161,77 @@ BOOST_AUTO_TEST_CASE( test_exception )
                           std::exception);
     }
 }
+
+BOOST_AUTO_TEST_CASE( test_groups_and_parents )
+{
+    for (int nthreads: { 0, 1, 4, 16 }) {
+        Worker_Task worker(nthreads);
+
+        int childrenFinished = 0, parentFinished = 0;
+        int jobsRun = 0;
+
+        int parent = worker.get_group([&] () { ++parentFinished; }, "parent");
+        {
+            Call_Guard guard(boost::bind(&Worker_Task::unlock_group,
+                                         boost::ref(worker),
+                                         parent));
+
+            for (unsigned i = 0;  i < 10;  ++i) {
+                // The finish jobs run with the group lock held, so they're
+                // serialized
+                int child = worker.get_group([&] () { ++childrenFinished; },
+                                             "child", parent);
+                Call_Guard guard(boost::bind(&Worker_Task::unlock_group,
+                                             boost::ref(worker),
+                                             child));
+                for (unsigned j = 0;  j < 100;  ++j)
+                    worker.add([&] () { atomic_add(jobsRun, 1); }, "", child);
+            }
+        }
+
+        worker.run_until_finished(parent);
+
+        // The parent can only finish once all of its children have
+        BOOST_CHECK_EQUAL(jobsRun, 1000);
+        BOOST_CHECK_EQUAL(childrenFinished, 10);
+        BOOST_CHECK_EQUAL(parentFinished, 1);
+        BOOST_CHECK_EQUAL(worker.queued(), 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_run_in_parallel )
+{
+    for (int nthreads: { 0, 1, 4, 16 }) {
+        Worker_Task worker(nthreads);
+
+        // Every value is done exactly once
+        vector<int> done(100000);
+        run_in_parallel_blocked(0, done.size(),
+                                [&] (int i) { done[i] += 1; },
+                                -1, "", "", worker);
+        BOOST_CHECK_EQUAL(std::count(done.begin(), done.end(), 1),
+                          done.size());
+
+        // Including when the jobs are nested and very unbalanced
+        int total = 0;
+        auto doOuter = [&] (int i)
+            {
+                run_in_parallel(0, i * i,
+                                [&] (int) { atomic_add(total, 1); },
+                                -1, "", "", worker);
+            };
+        run_in_parallel(0, 32, doOuter, -1, "", "", worker);
+        BOOST_CHECK_EQUAL(total, 31 * 32 * 63 / 6);
+
+        // An exception stops the range and comes out of the call
+        JML_TRACE_EXCEPTIONS(false);
+        auto doThrow = [&] (int i)
+            {
+                if (i == 5000)
+                    throw Exception("there was an exception");
+            };
+        BOOST_CHECK_THROW(run_in_parallel(0, 10000, doThrow,
+                                          -1, "", "", worker),
+                          std::exception);
+    }
+}
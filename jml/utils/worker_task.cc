@@ -51,6 +51,34 @@ const Job NO_JOB;
 /* WORKER_TASK                                                               */
 /*****************************************************************************/
 
+namespace {
+
+/** The worker task that the current thread is a worker for, and the index
+    of its queue.  A thread that isn't one of our workers uses the shared
+    queue. */
+__thread const Worker_Task * current_task = 0;
+__thread int current_thread = -1;
+
+/** State for choosing the thread to steal from. */
+__thread unsigned steal_seed = 0;
+
+unsigned steal_random()
+{
+    // xorshift; seeded from the address of the thread's state
+    unsigned x = steal_seed;
+    if (x == 0) x = (unsigned)(size_t)&steal_seed | 1;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    steal_seed = x;
+    return x;
+}
+
+/** Most jobs a worker moves from the shared queue to its own at once. */
+enum { MAX_SHARED_BATCH = 32 };
+
+} // file scope
+
 Worker_Task &
 Worker_Task::
 instance(int thr)
@@ -61,9 +89,8 @@ instance(int thr)
 
 Worker_Task::
 Worker_Task(int threads)
-    : jobs_sem(0), finished_sem(1), state_change_sem(0), shutdown_sem(0),
-      next_group(0), next_job(0), num_queued(0),
-      num_running(0), force_finished(false)
+    : next_group(0), next_job(0), num_queued(0),
+      num_running(0), num_sleeping(0), force_finished(false)
 {
     if (threads == -1)
         threads = num_cpus();
@@ -72,9 +99,15 @@ Worker_Task(int threads)
 
     //cerr << "creating worker task with " << threads << " threads" << endl;
 
+    /* The queues need to exist before any of the threads look at them. */
+    for (unsigned i = 0;  i < threads;  ++i)
+        queues.emplace_back(new Job_Queue());
+
     /* Create our threads */
     for (unsigned i = 0;  i < threads;  ++i)
-        workerThreads_.emplace_back(new std::thread(std::bind(&Worker_Task::runWorkerThread, this)));
+        workerThreads_.emplace_back
+            (new std::thread(std::bind(&Worker_Task::runWorkerThread,
+                                       this, i)));
 }
 
 Worker_Task::
@@ -83,25 +116,21 @@ Worker_Task::
     log("~Worker_Task: stopping worker task\n");
     force_finished = true;
 
-    // Wake up all tasks by providing jobs
-    for (unsigned i = 0;  i < threads_;  ++i)
-        jobs_sem.release();
-
     /* TODO: finish all tasks */
-    if (jobs.size() || groups.size())
-        cerr << "at the end, there were " << jobs.size()
+    if (num_queued || groups.size())
+        cerr << "at the end, there were " << num_queued
              << " jobs outstanding and "
              << groups.size() << " groups outstanding" << endl;
 
-    for (unsigned i = 0;  i < threads_;  ++i)
-        shutdown_sem.acquire();
+    // Wake up all of the threads so that they see that we're finished
+    {
+        std::unique_lock<std::mutex> guard(sleep_lock);
+        sleep_cond.notify_all();
+    }
 
     // Join all worker threads
-    for (auto & t: workerThreads_) {
-        while (!t->joinable())
-            ML::sleep(0.01);
+    for (auto & t: workerThreads_)
         t->join();
-    }
 
     log("~Worker_Task: stopped worker task\n");
 }
@@ -117,29 +146,20 @@ get_group(const Job & group_finish, const std::string & info_str,
 
     Guard guard(lock);
     Id id = next_group++;
-    groups[id].finished = group_finish;
-    groups[id].parent_group = parent_group;
-    groups[id].locked = locked;
-    groups[id].info = info_str;
-
-    /* Add a job for the group.  This allows us to keep track of where the child
-       jobs get inserted. */
-    Job_Info info(group_finish, Job(),
-                  format("job for group %lld: ", id) + info_str, -1, id);
-    
-    Jobs::iterator where = jobs.end();
+    Group_Info & info = groups[id];
+    info.finished = group_finish;
+    info.parent_group = parent_group;
+    info.locked = locked;
+    info.info = info_str;
 
-    /* Insert it at the end of its parent's jobs if it has one. */
     if (parent_group != -1) {
-        groups[parent_group].groups_outstanding += 1;
-        where = groups[parent_group].group_job;
+        auto it = groups.find(parent_group);
+        if (it == groups.end())
+            throw Exception("Worker_Task::get_group(): parent group "
+                            "info has none");
+        it->second.groups_outstanding += 1;
     }
     
-    Jobs::iterator it = jobs.insert(where, info);
-    groups[id].group_job = it;
-    
-    notify_state_changed();
-    
     return id;
 }
 
@@ -151,47 +171,40 @@ void Worker_Task::unlock_group(int group)
         throw Exception("Worker_Task::unlock_group(): group info has none");
     groups[group].locked = false;
     check_finished_ul(group);
+    guard.unlock();
 
-    notify_state_changed();
+    wake_all();
 }
 
 Worker_Task::Id
 Worker_Task::
 add(const Job & job, const Job & error, const std::string & job_info, Id group)
 {
-    /* Wait to manupulate */
-    Guard guard(lock);
     Job_Info info(job, error, job_info, next_job++, group);
 
-    /* Find where to put it. */
-
     if (group != -1) {
-        if (!groups.count(group))
+        Guard guard(lock);
+
+        auto it = groups.find(group);
+        if (it == groups.end())
             throw Exception("Worker_Task::add(): group info has none");
 
-        Group_Info & group_info = groups[group];
+        Group_Info & group_info = it->second;
         if (group_info.exc) {
             log("ignoring job addition to an error group\n");
             return -1;
         }
         ++group_info.jobs_outstanding;
-        
-        /* Jobs::iterator it = */ jobs.insert(group_info.group_job, info);
+
+        /* The group can't go away until this job is finished, so the job
+           can hold on to it without the lock. */
+        info.group_info = &group_info;
     }
-    else jobs.push_back(info);
-    
-    ++num_queued;
-    
-    jobs_sem.release();  // release one to allow something to run the job
-    
-    /* If this is the first job running, then we are no longer finished so we
-       acquire the finished semaphore. */
-    if (num_queued + num_running == 1)
-        finished_sem.acquire();
 
-    notify_state_changed();
-    
-    return info.id;
+    Id id = info.id;
+    push_job(std::move(info));
+
+    return id;
 }
 
 Worker_Task::Id
@@ -203,11 +216,19 @@ add(const Job & job, const std::string & job_info, Id group)
 
 void Worker_Task::finish_all()
 {
-    /* Wait until we are finished */
-    finished_sem.acquire();
+    /* Lend our thread until everything is done */
+    auto isFinished = [&] () { return num_queued + num_running == 0; };
+
+    while (!isFinished()) {
+        Job_Info info;
+        if (try_get_job(info)) {
+            run_job(info);
+            finish_job(info);
+            continue;
+        }
 
-    /* Let something else finish */
-    finished_sem.release();
+        wait_for_work(isFinished);
+    }
 }
 
 void Worker_Task::clear_all()
@@ -215,232 +236,307 @@ void Worker_Task::clear_all()
     throw Exception("Worker_Task::clear_all(): not implemented");
 }
 
-int Worker_Task::runWorkerThread()
+int Worker_Task::runWorkerThread(int thread)
 {
     //cerr << "worker function" << endl;
     
+    current_task = this;
+    current_thread = thread;
+
     /* This is the worker function.  We grab work while there is any until it
        is time to exit. */
+
+    auto never = [] () { return false; };
     
     while (!force_finished) {
         
-        log("runWorkerThread: getting job\n");
-        Job_Info info = get_job();
-        log("runWorkerThread: got job: " + to_string(info.id) + "\n");
-
-        if (force_finished) break;
-
-        try {
-            log("runWorkerThread: running job\n");
-            //cerr << "thread " << ACE_OS::thr_self() << " is running job "
-            //     << info.id << " (" << info.info << ")" << endl;
-            if (!info.invalidGroup) {
-                info.job();
-            }
-            else {
-                log("skipping job from invalid group\n");
-            }
+        Job_Info info;
+        if (try_get_job(info)) {
+            log("runWorkerThread: got job: " + to_string(info.id) + "\n");
+            run_job(info);
+            finish_job(info);
+            continue;
         }
-        catch (const std::exception & exc) {
-            log("runWorkerThread: job exception: " + string(exc.what())
-                + "\n");
-            // TODO: make this exception go to the calling process
-            //cerr << "thread " << ACE_OS::thr_self() << " running job "
-            //     << info.id << " (" << info.info << "): " << endl;
-            //cerr << "warning: job threw exception: "
-            //     << exc.what() << endl;
-            try {
-                if (info.error) info.error();
-            }
-            catch (const std::exception & exc) {
-                cerr << "warning: job error function throw exception: "
-                     << exc.what() << endl;
-            }
 
-            /* Indicate that the job's group had an error. */
-            if (info.group != -1) {
-                Guard guard(lock);
-                Group_Info & group_info = groups[info.group];
-                if (!group_info.exc) {
-                    /* When a job fails in a group, all remaining jobs from
-                       this group are marked for skipping and the queue is
-                       cleaned up gradually via get_job/finish_job. This
-                       marking is performed by both the worker and control
-                       threads. When it is known that all jobs have been fully
-                       executed or skipped, the group is then removed and the
-                       exception rethrown from the control thread. */
-                    group_info.exc = current_exception();
-                    mark_group_jobs_invalid_ul(group_info, info.group);
-                }
-            }
+        /* Nothing to do.  Spin for a while, as more work usually turns up
+           quickly, and then go to sleep. */
+        bool found = false;
+        for (unsigned i = 0;  i < 100 && !found && !force_finished;  ++i) {
+            sched_yield();
+            found = num_queued > 0;
         }
-        //cerr << "thread " << ACE_OS::thr_self() << " is finished job "
-        //     << info.id << " (" << info.info << ")" << endl;
-        finish_job(info);
+
+        if (!found)
+            wait_for_work(never);
     }
 
-    shutdown_sem.release();
+    current_task = 0;
+    current_thread = -1;
     
     return 0;
 }
 
-void Worker_Task::notify_state_changed()
+Worker_Task::Job_Queue &
+Worker_Task::
+local_queue() const
 {
-    // must be called with the lock held
-    for (set<Semaphore *>::const_iterator it = state_semaphores.begin();
-         it != state_semaphores.end();  ++it)
-        (*it)->release();
+    if (current_task == this)
+        return *queues[current_thread];
+    return const_cast<Job_Queue &>(shared_queue);
 }
 
-void Worker_Task::add_state_semaphore(Semaphore & sem)
+int
+Worker_Task::
+local_queued() const
 {
-    Guard guard(lock);
-    if (state_semaphores.count(&sem))
-        throw Exception("same state semaphore added twice");
-    state_semaphores.insert(&sem);
+    return local_queue().size;
 }
 
-void Worker_Task::remove_state_semaphore(Semaphore & sem)
+void
+Worker_Task::
+push_job(Job_Info && info)
 {
-    Guard guard(lock);
-    if (!state_semaphores.count(&sem))
-        throw Exception("state semaphore was lost");
-    state_semaphores.erase(&sem);
+    Job_Queue & queue = local_queue();
+    {
+        std::unique_lock<Spinlock> guard(queue.lock);
+        queue.jobs.emplace_back(std::move(info));
+        ++queue.size;
+    }
+
+    /* Only count it once it can be found, so that a thread that sees that
+       there are jobs queued will find one. */
+    ++num_queued;
+
+    wake_one();
 }
 
-void Worker_Task::run_until_released(Semaphore & sem, int group)
-{
-    /* We check at every change in state for either a) the semaphore
-       being free or b) a job being available. */
+bool
+Worker_Task::
+try_get_job(Job_Info & info)
+{
+    if (force_finished) return false;
+
+    bool found = false;
+
+    if (current_task == this) {
+        /* Our own queue, most recent first */
+        Job_Queue & queue = *queues[current_thread];
+        if (queue.size) {
+            std::unique_lock<Spinlock> guard(queue.lock);
+            if (!queue.jobs.empty()) {
+                info = std::move(queue.jobs.back());
+                queue.jobs.pop_back();
+                --queue.size;
+                found = true;
+            }
+        }
+    }
 
-    Semaphore state_semaphore(0);
-    add_state_semaphore(state_semaphore);
+    if (!found) found = take_shared_jobs(info);
+    if (!found) found = steal_job(info);
+    if (!found) return false;
 
-    /* Make sure we remove this semaphore at the end. */
-    Call_Guard guard(boost::bind(&Worker_Task::remove_state_semaphore,
-                                 this, boost::ref(state_semaphore)));
-    
-    while (sem.tryacquire() == -1) {
+    /* Running goes up before queued goes down, so that the total never
+       looks like zero while there is a job in flight. */
+    ++num_running;
+    --num_queued;
+    if (info.group_info)
+        ++info.group_info->jobs_running;
 
-        /* Run a job, if there is one old job to finish. */
-        
-        Job_Info info;
-        if (try_get_job(info, group)) {
-            // release lock here
-
-            try {
-                if (!info.invalidGroup) {
-                    info.job();
-                }
-                else {
-                    log("skipping job from invalid group\n");
-                }
-            }
-            catch (const std::exception & exc) {
-                // TODO: make this exception go to the calling process
-                cerr << "warning: job threw exception: "
-                     << exc.what() << endl;
-                try {
-                    if (info.error) info.error();
-                }
-                catch (const std::exception & exc) {
-                    cerr << "warning: job error function throw exception: "
-                         << exc.what() << endl;
-                }
-            }
+    return true;
+}
 
-            finish_job(info);
+bool
+Worker_Task::
+take_shared_jobs(Job_Info & info)
+{
+    if (shared_queue.size == 0)
+        return false;
 
-            continue;
+    Job_Queue * own = current_task == this ? queues[current_thread].get() : 0;
+
+    /* A worker takes a batch, so that a big block of jobs added from
+       outside doesn't have every thread fighting over the shared queue. */
+    std::vector<Job_Info> batch;
+    {
+        std::unique_lock<Spinlock> guard(shared_queue.lock);
+        if (shared_queue.jobs.empty())
+            return false;
+
+        info = std::move(shared_queue.jobs.front());
+        shared_queue.jobs.pop_front();
+
+        if (own) {
+            size_t n = std::min<size_t>(shared_queue.jobs.size()
+                                        / (threads_ + 1),
+                                        MAX_SHARED_BATCH);
+            batch.reserve(n);
+            for (unsigned i = 0;  i < n;  ++i) {
+                batch.emplace_back(std::move(shared_queue.jobs.front()));
+                shared_queue.jobs.pop_front();
+            }
         }
 
-        /* Wait for a state change. */
-        state_semaphore.acquire();
+        shared_queue.size -= 1 + batch.size();
     }
-    
-    sem.release();
+
+    if (!batch.empty()) {
+        /* Push them so that the oldest is at the back, and so will be run
+           first. */
+        std::unique_lock<Spinlock> guard(own->lock);
+        for (auto it = batch.rbegin(); it != batch.rend();  ++it)
+            own->jobs.emplace_back(std::move(*it));
+        own->size += batch.size();
+    }
+
+    return true;
 }
 
-void
+bool
 Worker_Task::
-cancel_group(Group_Info & group_info, int group)
+steal_job(Job_Info & info)
 {
-    Guard guard(lock);
-    cancel_group_ul(group_info, group);
+    if (queues.empty())
+        return false;
+
+    unsigned n = queues.size();
+    unsigned start = steal_random() % n;
+
+    for (unsigned i = 0;  i < n;  ++i) {
+        unsigned victim = (start + i) % n;
+        if (current_task == this && victim == current_thread)
+            continue;
+
+        Job_Queue & queue = *queues[victim];
+        if (queue.size == 0)
+            continue;
+
+        /* If someone else is in there, try the next one rather than
+           waiting. */
+        std::unique_lock<Spinlock> guard(queue.lock, std::try_to_lock);
+        if (!guard || queue.jobs.empty())
+            continue;
+
+        /* The oldest job is the one highest up the tree, and so the one
+           most likely to give us a big chunk of work. */
+        info = std::move(queue.jobs.front());
+        queue.jobs.pop_front();
+        --queue.size;
+        return true;
+    }
+
+    return false;
 }
 
 void
 Worker_Task::
-cancel_group_ul(Group_Info & group_info, int group)
+run_job(Job_Info & info)
 {
-    log("cancel_group_ul\n");
-    //cerr << "thread " << ACE_OS::thr_self() << " cancel_group() "
-    //     << group_info.info << endl;
-    
-    /* We clean up the group by scanning through its list of tasks, removing
-       those that haven't run yet, and calling all of the handlers. */
-    Jobs::iterator it = jobs.begin();
-        
-    /* Iterate through this group's jobs. */
-        
-    while (it != group_info.group_job) {
-        while (it != group_info.group_job
-               && (it->id == -1 || !in_group(*it, group))) ++it;
-            
-        if (it == group_info.group_job) break;
-            
-        /* Remove this job. */
-        //cerr << "removing job " << it->id << " (" << it->info
-        //     << ")" << endl;
-
-            
-        Jobs::iterator next = it;
-        ++next;
-        remove_job_ul(it);
-        it = next;
+    Group_Info * group_info = info.group_info;
+
+    if (group_info && group_info->failed) {
+        log("skipping job from invalid group\n");
+        return;
+    }
+
+    try {
+        //cerr << "thread " << ACE_OS::thr_self() << " is running job "
+        //     << info.id << " (" << info.info << ")" << endl;
+        info.job();
+    }
+    catch (const std::exception & exc) {
+        log("run_job: job exception: " + string(exc.what()) + "\n");
+        try {
+            if (info.error) info.error();
+        }
+        catch (const std::exception & exc) {
+            cerr << "warning: job error function throw exception: "
+                 << exc.what() << endl;
+        }
+
+        /* Indicate that the job's group had an error. */
+        if (group_info) {
+            Guard guard(lock);
+            if (!group_info->exc) {
+                /* When a job fails in a group, all remaining jobs from
+                   this group are skipped as they come off the queues.
+                   When it is known that all jobs have been fully
+                   executed or skipped, the group is then removed and the
+                   exception rethrown from the control thread. */
+                group_info->exc = current_exception();
+                group_info->failed = true;
+            }
+        }
+        else {
+            // TODO: make this exception go to the calling process
+            cerr << "warning: job threw exception: "
+                 << exc.what() << endl;
+        }
     }
-    
-    log("finished clearning jobs for group " + to_string(group) + "\n");
 }
 
 void
 Worker_Task::
-mark_group_jobs_invalid_ul(Group_Info & group_info, int group)
+wait_for_work(const std::function<bool ()> & done, bool poll)
 {
-    log("mark_group_jobs_invalid_ul\n");
+    std::unique_lock<std::mutex> guard(sleep_lock);
 
-    if (group == -1) {
-        throw ML::Exception("cannot mark group -1 as invalid");
-    }
+    /* Anything that makes us want to wake up changes its state before it
+       looks at num_sleeping, and we look at the state after we increment
+       it, so either we see the change or they see that we're here. */
+    ++num_sleeping;
 
-    for (Jobs::iterator it = jobs.begin(); it != group_info.group_job; it++) {
-        if (it->group == group) {
-            it->invalidGroup = true;
-        }
+    if (!force_finished && num_queued == 0 && !done()) {
+        if (poll)
+            sleep_cond.wait_for(guard, std::chrono::milliseconds(1));
+        else sleep_cond.wait(guard);
     }
 
-    log("mark_group_jobs_invalid_ul done\n");
+    --num_sleeping;
 }
 
 void
 Worker_Task::
-wait_group_finished(Group_Info & group_info, int group)
+wake_one()
 {
-    // cancel_group(group_info, group);
-    /* Wait until everything has stopped running in this group. */
+    if (num_sleeping == 0)
+        return;
+    std::unique_lock<std::mutex> guard(sleep_lock);
+    sleep_cond.notify_one();
+}
 
-    Semaphore state_semaphore(0);
-    add_state_semaphore(state_semaphore);
+void
+Worker_Task::
+wake_all()
+{
+    if (num_sleeping == 0)
+        return;
+    std::unique_lock<std::mutex> guard(sleep_lock);
+    sleep_cond.notify_all();
+}
 
-    /* Make sure we remove this semaphore at the end. */
-    Call_Guard guard(boost::bind(&Worker_Task::remove_state_semaphore,
-                                 this, boost::ref(state_semaphore)));
-    
-    while (group_info.jobs_running > 0)
-        state_semaphore.acquire();
+void Worker_Task::run_until_released(Semaphore & sem, int group)
+{
+    /* We check between each job and every millisecond when idle for the
+       semaphore being free. */
+
+    auto never = [] () { return false; };
+
+    while (sem.tryacquire() == -1) {
+
+        /* Run a job, if there is one old job to finish. */
+        
+        Job_Info info;
+        if (try_get_job(info)) {
+            run_job(info);
+            finish_job(info);
+            continue;
+        }
 
-    /* Group should be finished. */
-    log("group finished\n");
+        wait_for_work(never, true /* poll */);
+    }
+    
+    sem.release();
 }
 
 void
@@ -479,100 +575,57 @@ run_until_finished(int group, bool unlock)
     */
     Group_Info & group_info = group_it->second;
 
-    /* Create a semaphore so that we get notified of state changes. */
-    Semaphore state_semaphore(0);
-    add_state_semaphore(state_semaphore);
-    
-    /* Make sure we remove this semaphore at the end. */
-    Call_Guard state_guard(boost::bind(&Worker_Task::remove_state_semaphore,
-                                       this, boost::ref(state_semaphore)));
+    auto isFinished = [&] ()
+        {
+            return group_info.jobs_outstanding
+                + group_info.groups_outstanding == 0;
+        };
     
     for (;;) {
         //cerr << "thread " << ACE_OS::thr_self() << " is waiting for group "
         //     << group << " to finish" << endl;
 
         /* Is the group finished?  If so, we can get out of here. */
-        {
-            if (group_info.jobs_outstanding
-                + group_info.jobs_running
-                + group_info.groups_outstanding == 0) {
-                /* We're finished */
-
-                /* If the group had an error, clean up the group structures,
-                 * then rethrow the exception that occurred. */
-                if (group_info.exc) {
-                    //cerr << "thread " << ACE_OS::thr_self()
-                    //     << " had a group error" << endl;
-
-                    /* Save and replace the exception ptr, as we're about to
-                       remove the group. */
-                    exception_ptr exc = group_info.exc;
-                    group_info.exc = exception_ptr();
-
-                    /* Unlock the group to allow everything to finish. */
-                    unlock_guard.clear();
-                    unlock_group(group);
-
-                    /* Done; throw the exception. */
-                    if (exc)
-                        rethrow_exception(exc);
-                }
-                else
-                    return;
+        if (isFinished()) {
+            /* If the group had an error, clean up the group structures,
+             * then rethrow the exception that occurred. */
+            exception_ptr exc;
+            {
+                /* Save and replace the exception ptr, as we're about to
+                   remove the group. */
+                Guard guard(lock);
+                exc = group_info.exc;
+                group_info.exc = exception_ptr();
+            }
+
+            if (exc) {
+                //cerr << "thread " << ACE_OS::thr_self()
+                //     << " had a group error" << endl;
+
+                /* Unlock the group to allow everything to finish. */
+                unlock_guard.clear();
+                unlock_group(group);
+
+                /* Done; throw the exception. */
+                rethrow_exception(exc);
             }
+
+            return;
         }
 
-        /* Run a job if we can */
+        /* Run a job if we can.  It may not be from our group, but if
+           we don't run it then we may be waiting on a group whose jobs
+           are stuck behind it. */
         Job_Info info;
-        log("run_until_finished: try to get job\n");
-        if (try_get_job(info, group)) {
+        if (try_get_job(info)) {
             log("run_until_finished: got job: " + to_string(info.id) + "\n");
-            try {
-                //cerr << "thread " << ACE_OS::thr_self() << " is running job "
-                //     << info.id << " (" << info.info << ")" << endl;
-                log("run_until_finished: running job\n");
-                if (!info.invalidGroup) {
-                    info.job();
-                }
-                else {
-                    log("skipping job from invalid group\n");
-                }
-
-                //cerr << "thread " << ACE_OS::thr_self() << " finished job "
-                //     << info.id << " (" << info.info << ")" << endl;
-            }
-            catch (const std::exception & exc) {
-                log("run_until_finished: job exception\n");
-                // TODO: make this exception go to the calling process
-                //cerr << "thread " << ACE_OS::thr_self() << " running job "
-                //     << info.id << " (" << info.info << "):" << endl;
-                // cerr << "run_until_finished: warning: job threw exception: "
-                //      << exc.what() << endl;
-                try {
-                    if (info.error) info.error();
-                }
-                catch (const std::exception & exc) {
-                    cerr << "warning: job error function throw exception: "
-                         << exc.what() << endl;
-                }
-
-                /* Indicate that the job's group had an error. */
-                if (info.group != -1) {
-                    Guard guard(lock);
-                    Group_Info & group_info = groups[info.group];
-                    if (!group_info.exc) {
-                        group_info.exc = current_exception();
-                        mark_group_jobs_invalid_ul(group_info, info.group);
-                    }
-                }
-            }
+            run_job(info);
             finish_job(info);
-            
-            continue;  // no state change needed
+            continue;
         }
         
         /* Wait for a state change. */
-        state_semaphore.acquire();
+        wait_for_work(isFinished);
     }
 }
 
@@ -582,268 +635,57 @@ lend_thread(int group)
 {
     /* Run a job if we can */
     Job_Info info;
-    if (try_get_job(info, group)) {
-        try {
-            //cerr << "thread " << ACE_OS::thr_self() << " is running job "
-            //     << info.id << " (" << info.info << ")" << endl;
-            if (!info.invalidGroup) {
-                info.job();
-            }
-            else {
-                log("skipping job from invalid group\n");
-            }
-        }
-        catch (const std::exception & exc) {
-            // TODO: make this exception go to the calling process
-            //cerr << "thread " << ACE_OS::thr_self() << " running job "
-            //     << info.id << " (" << info.info << "):" << endl;
-            cerr << "warning: job threw exception: "
-                 << exc.what() << endl;
-            try {
-                if (info.error) info.error();
-            }
-            catch (const std::exception & exc) {
-                cerr << "warning: job error function throw exception: "
-                     << exc.what() << endl;
-            }
-
-            /* Indicate that the job's group had an error. */
-            if (info.group != -1) {
-                Guard guard(lock);
-                Group_Info & group_info = groups[info.group];
-                if (!group_info.exc) {
-                    group_info.exc = current_exception();
-                    cancel_group_ul(group_info, info.group);
-                }
-            }
-        }
-        //cerr << "thread " << ACE_OS::thr_self() << " finished job "
-        //     << info.id << " (" << info.info << ")" << endl;
+    if (try_get_job(info)) {
+        run_job(info);
         finish_job(info);
     }
 }
 
-bool Worker_Task::in_group(const Job_Info & info, int group)
-{
-    if (group == -1) return true;
-    
-    /* Check all parents. */
-    if (info.group == group) return true;
-    else if (info.group == -1) return false;
-    else {
-        Group_Info * group_info = &groups[info.group];
-        
-        while (group_info) {
-            Id parent = group_info->parent_group;
-
-            if (parent == -1) group_info = 0;
-            else {
-                if (!groups.count(parent))
-                    throw Exception("Worker_Task::in_group(): invalid "
-                                    "group number");
-                group_info = &groups[parent];
-            }
-        }
-    }
-
-    return false;
-}
-
-Worker_Task::Job_Info
-Worker_Task::get_job(int group)
-{
-    /* Block until we can acquire a semaphore to have jobs. */
-    for (unsigned i = 0;  i < 100;  ++i) {
-        if (jobs_sem.tryacquire() == 0) {
-            return get_job_impl(group);
-        }
-        sched_yield();
-    }
-    jobs_sem.acquire();
-
-    return get_job_impl(group);
-}
-
-bool Worker_Task::try_get_job(Worker_Task::Job_Info & job, int group)
-{
-    if (jobs_sem.tryacquire() == -1) return false;
-    
-    job = get_job_impl(group);
-    return true;
-}
-
-Worker_Task::Job_Info Worker_Task::get_job_impl(int group)
-{
-    //cerr << "thread " << ACE_OS::thr_self()
-    //     << " is getting a job in group " << group
-    //     << endl;
-    if (force_finished) return Job_Info();
-
-    for (unsigned i = 0;  i < 100;  ++i) {
-        Guard guard(lock, std::try_to_lock);
-        if (guard)
-            return get_job_impl_ul(group);
-        sched_yield();
-    }
-
-    Guard guard(lock);
-
-    //static int numJobs = 0;
-    //cerr << "getting job " << ++numJobs << endl;
-
-    return get_job_impl_ul(group);
-}
-
-Worker_Task::Job_Info
-Worker_Task::
-get_job_impl_ul(int group)
-{
-    //cerr << "thread " << ACE_OS::thr_self()
-    //     << " is getting a job in group " << group
-    //     << endl;
-    if (force_finished) return Job_Info();
-
-    Jobs::iterator it;
-
-    if (group == -1) {
-        it = jobs.begin();
-
-        /* Try to find one whose id isn't -1 but which is in the group
-           anyway. */
-        while (it != jobs.end() && it->id == -1) ++it;
-        
-        if (it == jobs.end())
-            throw Exception("get_job(): internal error: "
-                            "semaphore acquired with zero jobs");
-    }
-    else {
-        map<Id, Group_Info>::const_iterator group_it
-            = groups.find(group);
-        if (group_it == groups.end()) {
-            //throw Exception("iterator not found in group");
-            cerr << "couldn't find group " << group << " in  list"
-                 << endl;
-            return get_job_impl_ul(-1);
-        }
-        else if (group_it->second.exc)
-            return get_job_impl_ul(-1);  // group has an error; we don't do it
-        else it = jobs.begin();
-        
-        /* Try to find one whose id isn't -1 but which is in the group
-           anyway. */
-        while (it != group_it->second.group_job
-               && (it->id == -1 || !in_group(*it, group)))
-            ++it;
-        
-        /* If we didn't find one in our group, we select any job at all
-           so that we make some progress. */
-        if (it == group_it->second.group_job || !in_group(*it, group))
-            return get_job_impl_ul(-1);
-    }
-    
-    Job_Info result = *it;
-    ++num_running;
-
-    if (result.group != -1) ++groups[result.group].jobs_running;
-    
-    --num_queued;
-    jobs.erase(it);
-
-    notify_state_changed();
-
-    return result;
-}
-
 void
 Worker_Task::
 finish_job(const Job_Info & info)
 {
-    Guard guard(lock, std::defer_lock);
-
-    for (unsigned i = 0;  i < 100;  ++i) {
-        guard.try_lock();
-        if (guard) break;
-    }
-
-    if (!guard)
-        guard.lock();
-
     --num_running;
     
     /* Finish off the group if we need to. */
-    Id group = info.group;
-    if (group != -1) {
-
-        if (!groups.count(group))
-            throw Exception("Worker_Task::finish_job(): invalid group number");
-
-        Group_Info * group_info = &groups[group];
+    if (info.group_info) {
+        Group_Info * group_info = info.group_info;
 
-        --group_info->jobs_outstanding;
         --group_info->jobs_running;
 
-        if (group_info->jobs_outstanding < 0)
-            throw Exception("Worker_Task::finish_job(): "
-                            "group has negative outstanding count");
+        /* Once this is decremented, the group may be removed at any time
+           by another thread, so we can't touch it again. */
+        int outstanding = --group_info->jobs_outstanding;
 
-        if (group_info->jobs_running < 0)
+        if (outstanding < 0)
             throw Exception("Worker_Task::finish_job(): "
-                            "group has negative running count");
-        
-        check_finished_ul(group);
-    }
-    
-    if (num_queued + num_running == 0) finished_sem.release();
-
-    notify_state_changed();
-}
-
-void
-Worker_Task::
-remove_job_ul(const Jobs::iterator & it)
-{
-    --num_queued;
-    
-    if (jobs_sem.tryacquire() == -1) {
-        log(string("remove_job_ul error:\n")
-            + "errno = " + to_string(errno) + "\n"
-            + "error = " + strerror(errno) + "\n"
-            + "Worker_Task::remove_job_ul(): couldn't acquire the job "
-            + "semaphore\n"
-            + "force_finished = " + to_string(force_finished) + "\n");
-        dump();
-        abort();
-    }
-
-    /* Finish off the group if we need to. */
-    Id group = it->group;
-    if (group != -1) {
-
-        if (!groups.count(group))
-            throw Exception("Worker_Task::finish_job(): invalid group number");
-
-        Group_Info * group_info = &groups[group];
+                            "group has negative outstanding count");
 
-        --group_info->jobs_outstanding;
+        if (outstanding == 0) {
+            {
+                Guard guard(lock);
+                if (groups.count(info.group))
+                    check_finished_ul(info.group);
+            }
 
-        if (group_info->jobs_outstanding < 0)
-            throw Exception("Worker_Task::finish_job(): "
-                            "group has negative outstanding count");
-        
-        check_finished_ul(group);
+            wake_all();
+        }
     }
-
-    jobs.erase(it);
-    
-    if (num_queued + num_running == 0) finished_sem.release();
     
-    notify_state_changed();
+    if (num_queued + num_running == 0)
+        wake_all();
 }
 
 bool Worker_Task::check_finished(Id group)
 {
-    Guard guard(lock);
-    return check_finished_ul(group);
+    bool result;
+    {
+        Guard guard(lock);
+        result = check_finished_ul(group);
+    }
+
+    wake_all();
+    return result;
 }
 
 bool Worker_Task::check_finished_ul(Id group)
@@ -873,9 +715,6 @@ bool Worker_Task::check_finished_ul(Id group)
             cerr << "Worker_Task::check_finished(): " << exc.what() << endl;
         }
         
-        /* Get rid of the job for the group. */
-        jobs.erase(group_info->group_job);
-
         Id parent = group_info->parent_group;
 
         if (parent == -1) group_info = 0;
@@ -895,8 +734,6 @@ bool Worker_Task::check_finished_ul(Id group)
         }
         groups.erase(group);
         group = parent;
-
-        notify_state_changed();
     }
     
     return false;
@@ -941,8 +778,8 @@ dump(std::ostream & stream, int indent) const
     stream << i << "  jobs running       = " << jobs_running << endl;
     stream << i << "  groups outstanding = " << groups_outstanding << endl;
     stream << i << "  parent group       = " << parent_group << endl;
-    stream << i << "  group job          = " << &(*group_job) << endl;
     stream << i << "  locked             = " << locked << endl;
+    stream << i << "  failed             = " << failed << endl;
     stream << i << "  exc              = "   << (bool)exc << endl;
     stream << i << "  finished set       = " << (bool)finished << endl;
 }
@@ -954,21 +791,22 @@ dump() const
     std::ostream & stream = cerr;
 
     stream << "Worker_Task @ " << this << endl;
-    stream << "  number of jobs   = " << jobs.size() << endl;
     stream << "  next group       = " << next_group << endl;
     stream << "  next job         = " << next_job << endl;
     stream << "  num queued       = " << num_queued << endl;
     stream << "  num running      = " << num_running << endl;
     stream << "  number of groups = " << groups.size() << endl;
-    stream << "  state semaphores = " << state_semaphores.size() << endl;
+    stream << "  num sleeping     = " << num_sleeping << endl;
     stream << "  force finishned  = " << force_finished << endl;
     stream << endl;
-    stream << "  jobs:" << endl;
-    int i = 0;
-    for (Jobs::const_iterator it = jobs.begin();  it != jobs.end();  ++it, ++i) {
-        stream << "   " << i << ":" << endl;
-        it->dump(cerr, 4);
-    }
+
+    /* The jobs themselves can't be looked at without locking the queues,
+       which we may be called with held. */
+    stream << "  queues:" << endl;
+    for (unsigned i = 0;  i < queues.size();  ++i)
+        stream << "   thread " << i << ": " << queues[i]->size
+               << " jobs" << endl;
+    stream << "   shared: " << shared_queue.size << " jobs" << endl;
     stream << "  groups:" << endl;
     for (map<Id, Group_Info>::const_iterator it = groups.begin();
          it != groups.end();  ++it) {
@@ -12,12 +12,15 @@
 #include "jml/arch/format.h"
 #include "jml/arch/spinlock.h"
 #include "jml/arch/semaphore.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <functional>
-#include <list>
 #include <map>
+#include <memory>
 #include <mutex>
-#include <set>
 #include <thread>
+#include <vector>
 
 
 namespace ML {
@@ -46,12 +49,18 @@ int num_threads();
    The jobs can be arranged in groups, with a job that gets run once the
    group is finished, and the groups can be arranged in a hierarchy.
 
-   The jobs are scheduled such that with any group, jobs belonging to an
-   earlier subgroup are all scheduled before any belonging to a later
-   subgroup, regardless of the order in which they are scheduled.  (This
-   corresponds to a depth first search through the group tree).  The effect
-   is to guarantee that the average number of groups outstanding will be
-   as small as possible.
+   Each worker thread has its own queue of jobs.  A job added from a worker
+   thread goes onto the back of that thread's queue, and the thread takes
+   its next job from the back too, so it works depth first through the jobs
+   it created itself; a thread with nothing to do steals the oldest job from
+   the front of another thread's queue.  Jobs added from any other thread go
+   onto a shared queue, from which the workers take them in batches.  The
+   effect is that the threads only touch each other's state when they run
+   out of work, and the number of groups outstanding stays small.
+
+   The group structure is only locked when groups are created, finished or
+   have jobs added to them; running a job is lock free as far as the group
+   is concerned.
 
    It works multithreaded, and deals with all locking and unlocking.
 */
@@ -75,10 +84,6 @@ public:
         is finished.  Note that if nothing is ever added to the group, it won't
         be finished automatically unless check_finished() is called.
 
-        It will be inserted into the jobs list just after the last job with
-        the same parent group, so that the children of parent groups will be
-        completed in preference to their sisters.
-
         If lock is set to true, then it will not ever be automatically removed
         until it is unlocked.  This stops a newly-created group from being
         instantly removed.
@@ -113,6 +118,58 @@ public:
         run_until_finished(group);
     }
 
+    /** Run doWork over each value in the range [first, last) in multiple
+        threads, splitting the range as threads become free.
+
+        The whole range starts as a single job.  Whoever runs it works
+        through it grain values at a time, and each time its own queue is
+        empty (meaning that any other threads that are idle have already
+        stolen everything it had) it splits off the top half of what is left
+        as a new job.  Ranges are thus only split when there is somebody to
+        give the work to, and an unbalanced range is rebalanced as it runs.
+    */
+    template<typename It, typename It2, typename Fn>
+    void do_range(It first, It2 last, Fn doWork, int grain = 1,
+                  std::string groupName = "", std::string jobName = "")
+    {
+        if (grain < 1) grain = 1;
+
+        int group;
+        {
+            int parent = -1;  // no parent group
+            group = get_group(NO_JOB, groupName, parent);
+            Call_Guard guard(std::bind(&Worker_Task::unlock_group,
+                                         this,
+                                         group));
+
+            std::function<void (It, It)> doRange;
+            doRange = [&] (It begin, It end)
+                {
+                    while (begin != end) {
+                        while (ptrdiff_t(end - begin) > grain
+                               && local_queued() == 0) {
+                            It mid = begin + (end - begin) / 2;
+                            add(std::bind(doRange, mid, end), jobName, group);
+                            end = mid;
+                        }
+
+                        It stop = ptrdiff_t(end - begin) > grain
+                            ? begin + grain : end;
+                        for (; begin != stop;  ++begin)
+                            doWork(begin);
+                    }
+                };
+
+            if (first != last)
+                add(std::bind(doRange, first, It(last)), jobName, group);
+
+            /* doRange must live until the group is finished, so we need to
+               wait here rather than outside of the block. */
+            guard.clear();
+            run_until_finished(group, true /* unlock */);
+        }
+    }
+
 private:
     /** Add a job that belongs to the given group.  Jobs which are scheduled into
         the same group will be scheduled together.  If there is an exception or
@@ -129,6 +186,8 @@ public:
     /** Check if a group is finished, and if so call its finish job. */
     bool check_finished(Id group);
 
+    /** Lend the calling thread to the worker task until there are no jobs
+        left queued or running. */
     void finish_all();
     
     void clear_all();
@@ -142,56 +201,55 @@ public:
     /** Return the number of jobs that have finished. */
     int finished() const;
 
+    /** Return the number of jobs waiting in the queue that a job added from
+        the calling thread would go on to.  For a worker thread this is its
+        own queue; for any other thread it's the shared queue.
+    */
+    int local_queued() const;
+
     /** This function lends the calling thread to the worker task until the
-        given semaphore is released.  The semaphore will be checked on each
-        state change.  If the group argument is given, then this thread
-        will only schedule jobs from the given group (or its children), which
-        can be used to avoid the thread being used for other work in the
-        task.
-
-        If any of the jobs throw an exception, then another exception will
-        be thrown from the given job.
+        given semaphore is released.  The semaphore will be checked between
+        each job, and at least once a millisecond when there is nothing to
+        do.  Any job at all may be run, whatever its group.
     */
     void run_until_released(Semaphore & sem, int group = -1);
 
     /** Lend the calling thread to the worker task until the given group
-        has finished.
+        has finished.  While waiting, the thread runs whatever jobs are
+        available, so that the group's jobs (which may be in another
+        thread's queue) get done even when there are no worker threads.
 
         An exception in a group job is handled by throwing an exception from
         this function.
     */
     void run_until_finished(int group, bool unlock = false);
 
-    /** Lend the calling thread to the worker task for a single job in the
-        given group and then return.
-
-        An exception in a group job is handled by throwing an exception from
-        this function.
+    /** Lend the calling thread to the worker task for a single job, if
+        there is one, and then return.
     */
     void lend_thread(int group);
 
-    int runWorkerThread();
+    int runWorkerThread(int thread);
 
 private:
     int threads_;
 
     std::vector<std::unique_ptr<std::thread> > workerThreads_;
     
-    struct Job_Info;
+    struct Group_Info;
 
-    typedef std::list<Job_Info> Jobs;
-    
     struct Job_Info {
-        Job_Info() : id(-1), group(-1) {}
+        Job_Info() : id(-1), group(-1), group_info(0) {}
         Job_Info(const Job & job, const Job & error,
-                 const std::string & info, Id id, Id group = -1)
+                 const std::string & info, Id id, Id group = -1,
+                 Group_Info * group_info = 0)
             : job(job), error(error), id(id), group(group),
-              invalidGroup(false), info(info) {}
+              group_info(group_info), info(info) {}
         Job job;
         Job error;
-        Id id;    // if -1, this is a group end marker
+        Id id;
         Id group;
-        bool invalidGroup; // true is group has error set
+        Group_Info * group_info;  ///< Stays valid until the job is finished
         std::string info;
         void dump(std::ostream & stream, int indent = 0) const;
     };
@@ -200,96 +258,103 @@ private:
         Group_Info()
             : jobs_outstanding(0), jobs_running(0),
               groups_outstanding(0), parent_group(0),
-              locked(false)
+              locked(false), failed(false)
         {
         }
 
         Job finished;
-        int jobs_outstanding;      ///< Number of jobs waiting for
-        int jobs_running;          ///< Number of jobs that are running
-        int groups_outstanding;    ///< Number of groups waiting for
+        std::atomic<int> jobs_outstanding;   ///< Jobs queued or running
+        std::atomic<int> jobs_running;       ///< Number of jobs that are running
+        std::atomic<int> groups_outstanding; ///< Number of groups waiting for
         Id parent_group;           ///< Group to notify when finished
-        Jobs::iterator group_job;  ///< Job for the group; always last
         bool locked;
+        std::atomic<bool> failed;  ///< A job threw; skip the rest of them
         std::exception_ptr exc;    ///< Exception to rethrow
         std::string info;
 
         void dump(std::ostream & stream, int indent = 0) const;
     };
 
-    /** Get a job. */
-    Job_Info get_job(int group = -1);
-
-    /** Tries to get a job, but doesn't fail if there isn't one. */
-    bool try_get_job(Job_Info & info, int group = -1);
+    /** A queue of jobs.  The owner pushes and pops at the back; thieves
+        take from the front.  The size is kept separately so that it can be
+        looked at without taking the lock.
+    */
+    struct Job_Queue {
+        Job_Queue() : size(0) {}
 
-    /** Implementation of the get_job methods.  Requires that the jobs_sem
-        be acquired. */
-    Job_Info get_job_impl(int group);
-    
-    /** Unlocked implementation of the get_job methods.  Requires that the
-        jobs_sem be acquired and that the lock already be held. */
-    Job_Info get_job_impl_ul(int group);
-    
-    void finish_job(const Job_Info & info);
+        Spinlock lock;
+        std::deque<Job_Info> jobs;
+        std::atomic<int> size;
+    };
 
-    void remove_job_ul(const Jobs::iterator & it);
+    /** One queue per worker thread, plus the shared queue that jobs added
+        from other threads go on to. */
+    std::vector<std::unique_ptr<Job_Queue> > queues;
+    Job_Queue shared_queue;
 
-    void add_state_semaphore(Semaphore & sem);
+    /** Return the queue that a job added from this thread goes on to. */
+    Job_Queue & local_queue() const;
 
-    void remove_state_semaphore(Semaphore & sem);
+    /** Queue a job and wake up a thread to run it if one is sleeping. */
+    void push_job(Job_Info && info);
 
-    void notify_state_changed();
+    /** Tries to get a job from anywhere, without waiting.  Looks in the
+        calling thread's own queue, then the shared queue and then tries
+        to steal from the other threads. */
+    bool try_get_job(Job_Info & info);
 
-    // Check_finished, bit without the lock held
-    bool check_finished_ul(Id group);
+    bool take_shared_jobs(Job_Info & info);
 
-    /** Is the given job in the group?  Searches up the parent hierarchy. */
-    bool in_group(const Job_Info & info, int group);
+    bool steal_job(Job_Info & info);
 
-    /** Removes all queued jobs in the group.  Running jobs are left alone. */
-    void cancel_group(Group_Info & group_info, int group);
+    /** Run the job, recording any exception against its group. */
+    void run_job(Job_Info & info);
+    
+    void finish_job(const Job_Info & info);
 
-    /** Removes all queued jobs in the group.  Running jobs are left alone. 
-        Lock must already be held. */
-    void cancel_group_ul(Group_Info & group_info, int group);
+    /** Sleep until there is a job queued somewhere, done() returns true, or
+        we are shutting down.  If poll is set, also return after at most a
+        millisecond. */
+    void wait_for_work(const std::function<bool ()> & done,
+                       bool poll = false);
 
-    /** Marks invalid all the jobs belonging to a group, so that the worker threads can
-     * skip those jobs easily and in a lockless manner */
-    void mark_group_jobs_invalid_ul(Group_Info & group_info, int group);
+    /** Wake up the threads that are sleeping in wait_for_work(). */
+    void wake_one();
+    void wake_all();
 
-    /** Waits for running jobs to finish. */
-    void wait_group_finished(Group_Info & group_info, int group);
+    // Check_finished, bit without the lock held
+    bool check_finished_ul(Id group);
 
     typedef std::mutex Lock;
     //typedef Spinlock Lock;
     typedef std::unique_lock<Lock> Guard;
 
-    Semaphore jobs_sem, finished_sem, state_change_sem, shutdown_sem;
+    std::atomic<Id> next_group;
+    std::atomic<Id> next_job;
+    std::atomic<int> num_queued;
+    std::atomic<int> num_running;
 
-    /** Jobs we are running. */
-    Jobs jobs;
-    Id next_group;
-    Id next_job;
-    int num_queued;
-    int num_running;
+    /** Protects the groups. */
     Lock lock;
 
     /** Groups that are currently running. */
     std::map<Id, Group_Info> groups;
 
-    /** Semaphores that get released on each state change. */
-    std::set<Semaphore *> state_semaphores;
+    /** Threads sleep on this when there is nothing to do. */
+    std::mutex sleep_lock;
+    std::condition_variable sleep_cond;
+    std::atomic<int> num_sleeping;
 
-    volatile bool force_finished;
+    std::atomic<bool> force_finished;
 
     /* Dump everything to cerr; for debugging */
     void dump() const;
 };
 
-/** Run a set of jobs in multiple threads.  The iterator will be iterated
-    through the range and the doWork function will be called with each
-    value of the iterator in a different thread.
+/** Run a set of jobs in multiple threads.  The doWork function will be
+    called with each value of the iterator in the range, and each call can
+    run in a different thread; the range is split up as threads become
+    free to take parts of it.
 */
 template<typename It, typename It2, typename Fn>
 void run_in_parallel(It first, It2 last, Fn doWork, int parent = -1,
@@ -297,9 +362,13 @@ void run_in_parallel(It first, It2 last, Fn doWork, int parent = -1,
                      Worker_Task & worker
                          = Worker_Task::instance(num_threads() - 1))
 {
-    worker.do_group(first, last, doWork, parent, groupName, jobName);
+    worker.do_range(first, last, doWork, 1 /* grain */, groupName, jobName);
 }
 
+/** As run_in_parallel, but for a large number of small calls.  The range
+    is never split into parts of less than 1/64th of what each thread would
+    get if it were divided evenly.
+*/
 template<typename RAIt, typename RAIt2, typename Fn>
 void run_in_parallel_blocked(RAIt first, RAIt2 last,
                              Fn doWork,
@@ -310,28 +379,8 @@ void run_in_parallel_blocked(RAIt first, RAIt2 last,
                                  = Worker_Task::instance(num_threads() - 1))
 {
     int numJobs = last - first;
-    if (numJobs < 16 * num_threads()) {
-        // less than 16 jobs per thread... do it directly
-        worker.do_group(first, last, doWork, parent, groupName, jobName);
-    }
-    else {
-        // Split into sub-groups such that we have roughly 16 jobs per
-        // thread
-        int numPerGroup = numJobs / num_threads() / 16;
-        int numGroups
-            = (numJobs / numPerGroup)
-            + (numJobs % numPerGroup != 0); // extra if there is a remainder
-
-        auto doGroup = [&] (int groupNum)
-            {
-                RAIt it = first + groupNum * numPerGroup;
-                for (int i = 0;  i < numPerGroup && it != last;  ++i, ++it)
-                    doWork(it);
-            };
-        
-        worker.do_group<int>(0, numGroups, doGroup, parent, groupName, jobName);
-    }
+    int grain = numJobs / (64 * (worker.threads() + 1));
+    worker.do_range(first, last, doWork, grain, groupName, jobName);
 }
 
-
 } // namespace ML
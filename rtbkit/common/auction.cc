@@ -23,6 +23,8 @@
 #include <ace/High_Res_Timer.h>
 #include <ace/Dev_Poll_Reactor.h>
 #include <set>
+#include <mutex>
+#include <sched.h>
 
 using namespace std;
 using namespace ML;
@@ -218,7 +220,8 @@ createDescription(AuctionResponseDescription & d) {
 
 Auction::
 Auction()
-    : isZombie(false), exchangeConnector(nullptr), data(new Data())
+    : isZombie(false), exchangeConnector(nullptr),
+      state(0), data(0), snapshots(0)
 {
 }
 
@@ -226,35 +229,46 @@ Auction::
 Auction(ExchangeConnector * exchangeConnector,
         HandleAuction handleAuction,
         std::shared_ptr<BidRequest> request,
-        const std::string & requestStr,
+        std::string requestStr,
         const std::string & requestStrFormat,
         Date start,
         Date expiry)
     : isZombie(false), start(start), expiry(expiry),
       request(request),
-      requestStr(requestStr),
+      requestStr(std::move(requestStr)),
       requestStrFormat(requestStrFormat),
       exchangeConnector(exchangeConnector),
       handleAuction(handleAuction),
-      data(new Data(numSpots()))
+      spots(numSpots()),
+      state(0), data(0), snapshots(0)
 {
     ML::atomic_add(created, 1);
 
     this->id = request->auctionId;
-    this->requestSerialized = request->serializeToString();
 }
 
 Auction::
 ~Auction()
 {
-    // Clean up the chain of data pointers
-    Data * d = data;
+    for (Spot & spot: spots) {
+        Bid * b = spot.bids;
+        while (b) {
+            Bid * b2 = b->next;
+            delete b;
+            b = b2;
+        }
+    }
+
+    // Clean up the chain of snapshots
+    Data * d = snapshots;
     while (d) {
         Data * d2 = d->oldData;
         delete d;
         d = d2;
     }
 
+    delete data;
+
     ML::atomic_add(destroyed, 1);
 }
 
@@ -275,13 +289,102 @@ timeUsed(Date now) const
     return start.secondsUntil(now);
 }
 
+bool
+Auction::
+enter()
+{
+    int current = state;
+    for (;;) {
+        if (current & FINISHED)
+            return false;
+        if (ML::cmp_xchg(state, current, current + WRITER))
+            return true;
+    }
+}
+
+void
+Auction::
+leave()
+{
+    ML::atomic_add(state, -WRITER);
+}
+
+bool
+Auction::
+close()
+{
+    int current = state;
+    for (;;) {
+        if (current & FINISHED)
+            return false;
+        if (ML::cmp_xchg(state, current, current | FINISHED))
+            break;
+    }
+
+    // Wait for any setResponse() calls that got in before us to push their
+    // bids.  They don't block, so this is short.
+    while (state != FINISHED)
+        sched_yield();
+
+    return true;
+}
+
+Auction::Data *
+Auction::
+collect(WinLoss winnerStatus) const
+{
+    std::unique_ptr<Data> result(new Data(spots.size()));
+
+    result->tooLate = state & FINISHED;
+
+    std::vector<const Bid *> bids;
+
+    for (unsigned spotNum = 0;  spotNum < spots.size();  ++spotNum) {
+        const Spot & spot = spots[spotNum];
+        const Bid * best = spot.best;
+        if (!best) continue;
+
+        // A bid is pushed before it can become the best one, so reading
+        // the best bid first means that it's always in the list we walk.
+        bids.clear();
+        for (const Bid * b = spot.bids;  b;  b = b->next)
+            bids.push_back(b);
+
+        auto & responses = result->responses[spotNum];
+        responses.reserve(bids.size());
+
+        responses.push_back(best->response);
+        responses.back().localStatus = winnerStatus;
+
+        for (auto it = bids.rbegin(), end = bids.rend();  it != end;  ++it) {
+            if (*it == best) continue;
+            responses.push_back((*it)->response);
+            responses.back().localStatus = WinLoss::LOSS;
+        }
+    }
+
+    {
+        std::lock_guard<ML::Spinlock> guard(dataSourcesLock);
+        result->dataSources = dataSources;
+    }
+
+    return result.release();
+}
+
+void
+Auction::
+publish(Data * newData)
+{
+    Data * current = 0;
+    if (!ML::cmp_xchg(this->data, current, newData))
+        throw ML::Exception("auction data published twice");
+}
+
 Auction::WinLoss
 Auction::
 setResponse(int spotNum, Response newResponse)
 {
-    Data * current = this->data;
-
-    if (spotNum < 0 || spotNum >= current->responses.size())
+    if (spotNum < 0 || spotNum >= spots.size())
         throw ML::Exception("invalid spot number in response");
 
     if (newResponse.price.maxPrice.isNegative()
@@ -289,61 +392,59 @@ setResponse(int spotNum, Response newResponse)
         || newResponse.creativeId == -1)
         return WinLoss::INVALID;
 
-    if (current->tooLate)
+    if (!enter())
         return WinLoss::TOOLATE;
 
+    newResponse.localStatus = WinLoss::PENDING;
+    Bid * bid = new Bid(std::move(newResponse));
+    const Price & price = bid->response.price;
+
+    Spot & spot = spots[spotNum];
+
+    Bid * head = spot.bids;
+    do {
+        bid->next = head;
+    } while (!ML::cmp_xchg(spot.bids, head, bid));
+
+    /* Filter on priority first, then on price.  If both are the same,
+       whichever bid came first wins.
+    */
+    Bid * best = spot.best;
+    while (!best
+           || price.priority > best->response.price.priority
+           || (price.priority == best->response.price.priority
+               && price.maxPrice > best->response.price.maxPrice)) {
+        if (ML::cmp_xchg(spot.best, best, bid))
+            break;
+    }
 
-    WinLoss result;
+    leave();
 
-    auto_ptr<Data> newData(new Data());
+    return WinLoss::PENDING;
+}
 
-    for (;;) {
-        if (current->tooLate)
-            return WinLoss::TOOLATE;
-        
-        *newData = *current;
-
-        bool hasExisting = current->hasValidResponse(spotNum);
-
-        result = newResponse.localStatus = WinLoss::PENDING;
-        newData->responses[spotNum].push_back(newResponse);
-
-        if (hasExisting) {
-            auto & spot = newData->responses[spotNum];
-            
-            // Filter on priority first.
-            if (newResponse.price.priority >
-                current->winningResponse(spotNum).price.priority) {
-                std::swap(spot.front(), spot.back());
-            }
-            // If not filter on price
-            else if(newResponse.price.priority ==
-                    current->winningResponse(spotNum).price.priority &&
-                    newResponse.price.maxPrice >
-                    current->winningResponse(spotNum).price.maxPrice) {
-                 std::swap(spot.front(), spot.back());
-            }
-            else {
-                // Do nothing, whichever bid came first wins.
-            }
-
-            spot.back().localStatus = WinLoss::LOSS;
-        }
+const Auction::Data *
+Auction::
+getCurrentData() const
+{
+    if (data)
+        return data;
 
+    // Not finished yet, so hand out a snapshot that lives as long as we do
+    Data * newData = collect(WinLoss::PENDING);
+    Data * current = snapshots;
+    do {
         newData->oldData = current;
+    } while (!ML::cmp_xchg(snapshots, current, newData));
 
-        if (!ML::cmp_xchg(this->data, current, newData.get())) continue;
-        newData.release();
-        return result;
-    }
+    return newData;
 }
 
 const std::vector<std::vector<Auction::Response> > & 
 Auction::
 getResponses() const
 {
-    const Data * current = this->data;
-    return current->responses;
+    return getCurrentData()->responses;
 }
 
 void
@@ -352,59 +453,25 @@ addDataSources(const std::set<std::string> & sources)
 {
     if (sources.empty()) return;
 
-    Data * current = this->data;
-    unique_ptr<Data> newData(new Data);
-
-    for (;;) {
-
-        std::set<std::string> newSources = current->dataSources;
-        newSources.insert(sources.begin(), sources.end());
-
-        // Nothing new was added, just bail.
-        if (newSources.size() == current->dataSources.size()) return;
-
-        if (!newData) newData.reset(new Data);
-        *newData = *current;
-        std::swap(newData->dataSources, newSources);
-
-        if (!ML::cmp_xchg(this->data, current, newData.get())) continue;
-        newData.release();
-        return;
-    }
+    std::lock_guard<ML::Spinlock> guard(dataSourcesLock);
+    dataSources.insert(sources.begin(), sources.end());
 }
 
 const std::set<std::string> &
 Auction::
 getDataSources() const
 {
-    const Data * current = this->data;
-    return current->dataSources;
+    return getCurrentData()->dataSources;
 }
 
 bool
 Auction::
 finish()
 {
-    Data * current = this->data;
-
-    for (;;) {
-        if (current->tooLate)
-            return false;
-
-        auto_ptr<Data> newData(new Data(*current));
-
-        for (unsigned spotNum = 0;  spotNum < numSpots(); ++spotNum) {
-            if (newData->hasValidResponse(spotNum))
-                newData->responses[spotNum][0].localStatus = WinLoss::WIN;
-        }
-        
-        newData->oldData = current;
-        newData->tooLate = true;
+    if (!close())
+        return false;
 
-        if (!ML::cmp_xchg(this->data, current, newData.get())) continue;
-        newData.release();
-        break;
-    }
+    publish(collect(WinLoss::WIN));
 
     handleAuction(shared_from_this());
 
@@ -415,29 +482,13 @@ bool
 Auction::
 setError(const std::string & error, const std::string & details)
 {
-    Data * current = this->data;
-
-    for (;;) {
-        if (current->tooLate)
-            return false;
-
-        auto_ptr<Data> newData(new Data(*current));
-        
-        newData->error = error;
-        newData->details = details;
-
-        for (unsigned spotNum = 0;  spotNum < numSpots();  ++spotNum) {
-            if (newData->hasValidResponse(spotNum)) {
-                newData->responses[spotNum][0].localStatus = WinLoss::LOSS;
-            }
-        }
-        newData->oldData = current;
-        newData->tooLate = true;
+    if (!close())
+        return false;
 
-        if (!ML::cmp_xchg(this->data, current, newData.get())) continue;
-        newData.release();
-        break;
-    }
+    std::unique_ptr<Data> newData(collect(WinLoss::LOSS));
+    newData->error = error;
+    newData->details = details;
+    publish(newData.release());
 
     handleAuction(shared_from_this());
     
@@ -446,16 +497,16 @@ setError(const std::string & error, const std::string & details)
 
 bool
 Auction::
-tooLate()
+tooLate() const
 {
-    return data->tooLate;
+    return state & FINISHED;
 }
 
 std::string
 Auction::
 status() const
 {
-    Data * current = this->data;
+    const Data * current = getCurrentData();
 
     string result = ML::format("Auction: %d imp", (int)numSpots());
     if (current->tooLate) result += " tooLate";
@@ -479,7 +530,7 @@ getResponseJson(int spotNum) const
 {
     Json::Value result;
 
-    Data * current = this->data;
+    const Data * current = getCurrentData();
 
     if (!current->error.empty()) {
         result["error"] = current->error;
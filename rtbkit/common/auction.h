@@ -19,9 +19,11 @@
 #include "soa/jsoncpp/json.h"
 #include "soa/types/date.h"
 #include "jml/arch/atomic_ops.h"
+#include "jml/arch/spinlock.h"
 #include "jml/arch/exception.h"
 #include "jml/utils/compact_vector.h"
 #include "jml/db/persistent_fwd.h"
+#include "soa/utils/object_pool.h"
 
 namespace RTBKIT {
 
@@ -49,7 +51,7 @@ struct Auction : public std::enable_shared_from_this<Auction> {
     Auction(ExchangeConnector * exchangeConnector,
             HandleAuction handleAuction,
             std::shared_ptr<BidRequest> request,
-            const std::string & requestStr,
+            std::string requestStr,
             const std::string & requestStrFormat,
             Date start,
             Date expiry);
@@ -72,7 +74,14 @@ struct Auction : public std::enable_shared_from_this<Auction> {
     std::shared_ptr<BidRequest>  request;
     std::string requestStr;  ///< Stringified version of request
     std::string requestStrFormat;  ///< Format of stringified request
-    std::string requestSerialized; ///< Serialized bid request (canonical)
+
+    /** Serialized bid request (canonical).  This is computed on demand as
+        it costs more than the rest of creating the auction put together.
+    */
+    std::string requestSerialized() const
+    {
+        return request->serializeToString();
+    }
 
     ///< AugmentationList for each augmentors.
     std::unordered_map<std::string, AugmentationList> augmentations;
@@ -87,7 +96,7 @@ struct Auction : public std::enable_shared_from_this<Auction> {
     /** If this value is set, then the bid has already been sent of and it's
         too late to modify the object any more.
     */
-    bool tooLate();
+    bool tooLate() const;
 
     struct Price {
         Price(Amount maxPrice = Amount(), float priority = 0.0)
@@ -198,13 +207,14 @@ struct Auction : public std::enable_shared_from_this<Auction> {
         static void createDescription(AuctionResponseDescription&);
     };
 
-    /** Modify the given response.  The boolean return code says whether or
-        not this response was accepted (due to it being the maximum-priority
-        response).
+    /** Add a response for the given spot.  The response is appended to the
+        spot's bids and becomes the winning one if it has a higher priority,
+        or the same priority and a higher price, than the current winner.
 
-        Returns the (local) status of the response.
+        Returns the (local) status of the response, which is PENDING unless
+        the response is invalid or the auction is already finished.
 
-        Thread safe.
+        Thread safe and lock free; only the new response is copied.
     */
     WinLoss setResponse(int spotNum, Response newResponse);
 
@@ -250,7 +260,11 @@ struct Auction : public std::enable_shared_from_this<Auction> {
     ExchangeConnector * exchangeConnector; ///< Exchange connector for auction
     HandleAuction handleAuction;   ///< Callback for when auction is finished
 
-    struct Data {
+    /** Read only view of the responses of an auction, as used by the
+        exchange connectors.  The responses for each spot start with the
+        winning one, followed by the others in the order they came in.
+    */
+    struct Data : public Datacratic::PooledNew<Data> {
         Data()
             : tooLate(false), oldData(0)
         {
@@ -290,13 +304,61 @@ struct Auction : public std::enable_shared_from_this<Auction> {
         std::string error, details;
     };
 
-    const Data * getCurrentData() const
-    {
-        return data;
-    }
+    /** Return the responses of the auction.  Once the auction is finished
+        this is built once and never changes; before that, each call returns
+        a new snapshot of the bids so far, which stays valid for the lifetime
+        of the auction.
+    */
+    const Data * getCurrentData() const;
 
 private:
-    Data * data;
+    /** A response made for a spot.  Bids are pushed onto the front of their
+        spot's list and never removed until the auction is destroyed, so the
+        list can be walked without locking.
+    */
+    struct Bid : public Datacratic::PooledNew<Bid> {
+        Bid(Response response)
+            : response(std::move(response)), next(0)
+        {
+        }
+
+        Response response;
+        Bid * next;
+    };
+
+    struct Spot {
+        Spot()
+            : bids(0), best(0)
+        {
+        }
+
+        Bid * bids;  ///< Most recent first
+        Bid * best;  ///< Winning bid so far
+    };
+
+    /** Bits of state.  The low bit is set when the auction is finished;
+        the rest counts the setResponse() calls in progress, so that finish()
+        can wait for them before it reads the bids.
+    */
+    enum {
+        FINISHED = 1,
+        WRITER = 2
+    };
+
+    bool enter();
+    void leave();
+    bool close();
+    Data * collect(WinLoss winnerStatus) const;
+    void publish(Data * newData);
+
+    std::vector<Spot> spots;
+    volatile int state;
+
+    mutable ML::Spinlock dataSourcesLock;
+    std::set<std::string> dataSources;
+
+    Data * data;               ///< Final responses, once finished
+    mutable Data * snapshots;  ///< Views handed out before it finished
 
 public:
     /// Memory leak tracking
@@ -23,6 +23,7 @@
 #include "tags.h"
 #include "rtbkit/openrtb/openrtb.h"
 #include "rtbkit/common/plugin_interface.h"
+#include "soa/utils/object_pool.h"
 
 namespace RTBKIT {
 
@@ -266,7 +267,10 @@ using OpenRTB::AuctionType;
 /* BID REQUEST                                                               */
 /*****************************************************************************/
 
-struct BidRequest {
+/** Bid requests are allocated from a pool, as one is created for every
+    request received.
+*/
+struct BidRequest : public Datacratic::PooledNew<BidRequest> {
     BidRequest()
         : auctionType(AuctionType::SECOND_PRICE), timeAvailableMs(0.0),
           isTest(false) 
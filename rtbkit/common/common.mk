@@ -8,7 +8,7 @@ LIBBIDREQUEST_SOURCES := \
 	expand_variable.cc 
 
 LIBBIDREQUEST_LINK := \
-	types boost_regex db openrtb value_description
+	types boost_regex db openrtb value_description boost_thread
 
 $(eval $(call library,bid_request,$(LIBBIDREQUEST_SOURCES),$(LIBBIDREQUEST_LINK)))
 
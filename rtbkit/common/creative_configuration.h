@@ -5,7 +5,9 @@
 
 #pragma once
 
+#include <cstdio>
 #include <initializer_list>
+#include <memory>
 #include <string>
 #include <vector>
 #include <map>
@@ -37,59 +39,70 @@ public:
     };
 
     typedef std::function<std::string &(std::string &)> ExpanderFilterCallable;
-    typedef std::map<std::string, ExpanderFilterCallable> ExpanderFilterMap;
     typedef std::function<std::string(const Context &)> ExpanderCallable;
-    typedef std::map<std::string, ExpanderCallable> ExpanderMap;
 
-    struct Expander;
+    /** Appends the value of a variable to the output buffer. */
+    typedef std::function<void (const Context &, std::string &)> ExpanderWriter;
+    typedef std::map<std::string, ExpanderWriter> ExpanderMap;
+
+    /** Applies a filter in place to the characters of the output buffer
+        from the given position to the end.
+    */
+    typedef std::function<void (std::string &, size_t)> ExpanderFilterWriter;
+    typedef std::map<std::string, ExpanderFilterWriter> ExpanderFilterMap;
+
+    struct Template;
+    typedef std::shared_ptr<const Template> TemplatePtr;
 
     CreativeConfiguration(const std::string& exchange)
     : exchange_(exchange)
     {
+        const std::string exchangeName = exchange;
+
         expanderDict_ = {
         {
-                "exchange",
-                std::bind(&CreativeConfiguration::exchange_, this)
+            "exchange",
+            [exchangeName](const Context& ctx, std::string& out)
+            { out += exchangeName; }
         },
 
         {
             "creative.id",
-            [](const Context& ctx)
-            { return std::to_string(ctx.creative.id); }
+            [](const Context& ctx, std::string& out)
+            { appendInt(out, ctx.creative.id); }
         },
 
         {
             "creative.name",
-            [](const Context& ctx)
-            { return ctx.creative.name; }
+            [](const Context& ctx, std::string& out)
+            { out += ctx.creative.name; }
         },
 
         {
             "creative.width",
-            [](const Context& ctx)
-            { return std::to_string(ctx.creative.format.width); }
+            [](const Context& ctx, std::string& out)
+            { appendInt(out, ctx.creative.format.width); }
         },
 
         {
             "creative.height",
-            [](const Context& ctx)
-            { return std::to_string(ctx.creative.format.height); }
+            [](const Context& ctx, std::string& out)
+            { appendInt(out, ctx.creative.format.height); }
         },
 
         {
             "bidrequest.id",
-            [](const Context& ctx)
-            { return ctx.bidrequest.auctionId.toString(); }
+            [](const Context& ctx, std::string& out)
+            { appendId(out, ctx.bidrequest.auctionId); }
         },
 
         {
             "bidrequest.user.id",
-            [](const Context& ctx) -> std::string
+            [](const Context& ctx, std::string& out)
             {
                 if ( ctx.bidrequest.user){
-                    return ctx.bidrequest.user->id.toString();
+                    appendId(out, ctx.bidrequest.user->id);
                 }
-                return "";
             }
         },
 
@@ -98,13 +111,13 @@ public:
             /* [this](const Context& ctx)  this triggers a gcc bug:
                 * http://gcc.gnu.org/bugzilla/show_bug.cgi?id=58824
                 */
-            [](const Context& ctx) -> std::string
+            [](const Context& ctx, std::string& out)
             {
                 auto const& br = ctx.bidrequest;
                 if (br.site && br.site->publisher) {
-                    return br.site->publisher->id.toString();
+                    appendId(out, br.site->publisher->id);
                 } else if (br.app && br.app->publisher) {
-                    return br.app->publisher->id.toString();
+                    appendId(out, br.app->publisher->id);
                 } else {
                     std::cerr << "In bid request: " << br.toJson().toString()
                                 << " no publisher id found" << std::endl;
@@ -116,52 +129,69 @@ public:
 
         {
             "bidrequest.timestamp",
-            [](const Context& ctx)
-            { return std::to_string( ctx.bidrequest.timestamp.secondsSinceEpoch() ); }
+            [](const Context& ctx, std::string& out)
+            { out += std::to_string( ctx.bidrequest.timestamp.secondsSinceEpoch() ); }
         },
 
         {
             "response.account",
-            [](const Context& ctx)
-            { return ctx.response.account.toString(); }
+            [](const Context& ctx, std::string& out)
+            { out += ctx.response.account.toString(); }
         },
         {
             "imp.id",
-            [](const Context& context)
-            { return context.bidrequest.imp[context.spotNum].id.toString(); }
+            [](const Context& context, std::string& out)
+            { appendId(out, context.bidrequest.imp[context.spotNum].id); }
         }
         };
 
         filters_ = {
             {
                 "lower",
-                [](std::string& value) -> std::string&
+                [](std::string& out, size_t begin)
                 {
-                    boost::algorithm::to_lower(value);
-                    return value;
+                    for (size_t i = begin;  i < out.size();  ++i)
+                        out[i] = tolower(out[i]);
                 }
             },
             {
                 "upper",
-                [](std::string& value) -> std::string&
+                [](std::string& out, size_t begin)
                 {
-                    boost::algorithm::to_upper(value);
-                    return value;
+                    for (size_t i = begin;  i < out.size();  ++i)
+                        out[i] = toupper(out[i]);
                 }
             },
             {
                 "urlencode",
-                [](std::string& value) -> std::string&
+                [](std::string& out, size_t begin)
                 {
-                    std::string result;
-                    for (auto c: value) {
-                        if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~')
-                            result += c;
-                        else result += ML::format("%%%02X", c);
+                    auto isUnreserved = [](unsigned char c)
+                    {
+                        return isalnum(c) || c == '-' || c == '_'
+                            || c == '.' || c == '~';
+                    };
+
+                    size_t end = out.size(), extra = 0;
+                    for (size_t i = begin;  i < end;  ++i)
+                        if (!isUnreserved(out[i]))
+                            extra += 2;
+                    if (!extra)
+                        return;
+
+                    // Encode from the back so that it can be done in place
+                    static const char hex[] = "0123456789ABCDEF";
+                    out.resize(end + extra);
+                    for (size_t i = end, j = end + extra;  i > begin;) {
+                        unsigned char c = out[--i];
+                        if (isUnreserved(c))
+                            out[--j] = c;
+                        else {
+                            out[--j] = hex[c & 15];
+                            out[--j] = hex[c >> 4];
+                            out[--j] = '%';
+                        }
                     }
-
-                    value = std::move(result);
-                    return value;
                 }
             },
         };
@@ -178,30 +208,78 @@ public:
     handleCreativeCompatibility(const Creative& creative,
                                 const bool includeReasons) const;
 
+    /** Compile a template into a program that can be run from any number
+        of threads at once.  Throws if it refers to an unknown variable or
+        filter.
+    */
+    TemplatePtr compile(const std::string& templateString) const;
+
+    /** Expand a template that was compiled when a creative's snippets were
+        checked by handleCreativeCompatibility().  Templates that weren't
+        are returned unchanged.
+    */
     std::string expand(const std::string& templateString,
                        const Context& context) const;
 
+    /** Same, but appending to the given buffer, which can be reused from
+        one call to the next.
+    */
+    void expand(const std::string& templateString,
+                const Context& context,
+                std::string& out) const;
+
     void addExpanderVariable(const std::string& key, ExpanderCallable value)
     {
-        expanderDict_[key] = value;
+        expanderDict_[key] = [value](const Context& ctx, std::string& out)
+            {
+                out += value(ctx);
+            };
+    }
+
+    /** Add a variable that appends its value straight into the output. */
+    void addExpanderWriter(const std::string& key, ExpanderWriter writer)
+    {
+        expanderDict_[key] = writer;
     }
 
     void addExpanderFilter(const std::string& filter,
                            ExpanderFilterCallable callable)
     {
-        filters_[filter] = callable;
+        filters_[filter] = [callable](std::string& out, size_t begin)
+            {
+                std::string value(out, begin);
+                out.replace(begin, std::string::npos, callable(value));
+            };
+    }
+
+    /** Add a filter that works directly on the output buffer. */
+    void addExpanderFilterWriter(const std::string& filter,
+                                 ExpanderFilterWriter writer)
+    {
+        filters_[filter] = writer;
     }
 
 private:
     std::vector<ExpandVariable>
     extractVariables(const std::string& snippet) const;
 
-    Expander
-    generateExpander(const std::vector<ExpandVariable>& variables) const;
-
-    ExpanderCallable getAssociatedCallable(ExpandVariable const& var) const;
+    ExpanderWriter getAssociatedWriter(ExpandVariable const& var) const;
     std::string jsonValueToStr(Json::Value const& val) const;
 
+    static void appendInt(std::string& out, long long value)
+    {
+        char buf[24];
+        int len = snprintf(buf, sizeof(buf), "%lld", value);
+        out.append(buf, len);
+    }
+
+    static void appendId(std::string& out, const Datacratic::Id& id)
+    {
+        if (id.type == Datacratic::Id::STR)
+            out.append(id.stringData(), id.stringLength());
+        else out += id.toString();
+    }
+
     ExpanderMap expanderDict_;
     ExpanderFilterMap filters_;
 
@@ -211,12 +289,53 @@ private:
     /**
      * The map is mutable because it is populated in the
      * getCreativeCompatibility and this member function is required to be
-     * const
+     * const.  The templates themselves are immutable, so they are used
+     * outside of the lock.
      */
-    mutable std::unordered_map<std::string, Expander> expanders_;
+    mutable std::unordered_map<std::string, TemplatePtr> expanders_;
     mutable boost::shared_mutex mutex_;
 };
 
+
+/*****************************************************************************/
+/* TEMPLATE                                                                  */
+/*****************************************************************************/
+
+/** A compiled template: a flat program where each step copies a span of
+    the template's literal text and then appends the value of a variable,
+    running its filters over what was just appended.
+*/
+template <typename CreativeData>
+struct CreativeConfiguration<CreativeData>::Template
+{
+    struct Step {
+        size_t literalBegin;
+        size_t literalEnd;
+        ExpanderWriter variable;              ///< Empty for the last step
+        std::vector<ExpanderFilterWriter> filters;
+    };
+
+    std::string source;
+    std::vector<Step> program;
+
+    void expand(const Context& ctx, std::string& out) const
+    {
+        out.reserve(out.size() + source.size());
+
+        for (auto const& step : program) {
+            out.append(source, step.literalBegin,
+                       step.literalEnd - step.literalBegin);
+            if (!step.variable)
+                continue;
+
+            size_t begin = out.size();
+            step.variable(ctx, out);
+            for (auto const& filter : step.filters)
+                filter(out, begin);
+        }
+    }
+};
+
 template <typename CreativeData>
 const std::string CreativeConfiguration<CreativeData>::VARIABLE_MARKER_BEGIN = "%{";
 
@@ -295,9 +414,9 @@ CreativeConfiguration<CreativeData>::handleCreativeCompatibility(
             if (field.isSnippet()) {
                 // assume string
                 auto const& snippet = value.asString();
-                auto expander = generateExpander(extractVariables(snippet));
+                auto compiled = compile(snippet);
                 boost::unique_lock<boost::shared_mutex> lock(mutex_);
-                expanders_[snippet] = expander;
+                expanders_[snippet] = compiled;
             }
         }
     }
@@ -334,8 +453,8 @@ CreativeConfiguration<CreativeData>::extractVariables(
 }
 
 template <typename CreativeData>
-typename CreativeConfiguration<CreativeData>::ExpanderCallable
-CreativeConfiguration<CreativeData>::getAssociatedCallable(
+typename CreativeConfiguration<CreativeData>::ExpanderWriter
+CreativeConfiguration<CreativeData>::getAssociatedWriter(
     ExpandVariable const& var) const
 {
     auto it = expanderDict_.find(var.getVariable());
@@ -366,15 +485,15 @@ CreativeConfiguration<CreativeData>::getAssociatedCallable(
     };
 
     if (section == "creative") {
-        return [getter](const Context & context) {
-            return getter(context.creative.toJson(), context);
+        return [getter](const Context & context, std::string & out) {
+            out += getter(context.creative.toJson(), context);
         };
     } else if (section == "bidrequest") {
-        return [getter](const Context & context) {
-            return getter(context.bidrequest.toJson(), context);
+        return [getter](const Context & context, std::string & out) {
+            out += getter(context.bidrequest.toJson(), context);
         };
     } else if (section == "meta") {
-        return [this, getter](const Context & context) {
+        return [this, getter](const Context & context, std::string & out) {
             Json::Reader reader;
             Json::Value val;
             if (!reader.parse(context.response.meta, val)) {
@@ -383,7 +502,7 @@ CreativeConfiguration<CreativeData>::getAssociatedCallable(
                           << ", meta: " << context.response.meta << std::endl;
             }
 
-            return getter(val, context);
+            out += getter(val, context);
         };
     }
 
@@ -392,51 +511,38 @@ CreativeConfiguration<CreativeData>::getAssociatedCallable(
 
 
 template <typename CreativeData>
-typename CreativeConfiguration<CreativeData>::Expander
-CreativeConfiguration<CreativeData>::generateExpander(
-    const std::vector<ExpandVariable>& variables) const
+typename CreativeConfiguration<CreativeData>::TemplatePtr
+CreativeConfiguration<CreativeData>::compile(
+    const std::string& templateString) const
 {
-    Expander expander;
-    for (auto const& variable : variables) {
-        auto callable = getAssociatedCallable(variable);
+    auto result = std::make_shared<Template>();
+    result->source = templateString;
 
-        ExpanderFilterCallable filterFn;
+    size_t literalBegin = 0;
+    for (auto const& variable : extractVariables(templateString)) {
+        typename Template::Step step;
+        step.literalBegin = literalBegin;
+        step.literalEnd = variable.getReplaceLocation().first;
+        step.variable = getAssociatedWriter(variable);
 
-        auto const& filters = variable.getFilters();
-        for (auto const& filter : filters) {
+        for (auto const& filter : variable.getFilters()) {
             auto it = filters_.find(filter);
             if (it == filters_.end()) {
                 throw std::runtime_error("Invalid filter: " + filter);
             }
-
-            auto currentFilter = it->second;
-            if (filterFn) {
-                filterFn = [currentFilter, filterFn](std::string& value)
-                    -> std::string&
-                {
-                    return currentFilter(filterFn(value));
-                };
-            } else {
-                filterFn = currentFilter;
-            }
+            step.filters.push_back(it->second);
         }
 
-        if (filterFn) {
-
-            expander.addFunctor(
-                    variable,
-                    [filterFn, callable](Context const & ctx) {
-                        std::string result = callable(ctx);
-                        filterFn(result);
-                        return result;
-            });
-        } else {
-            expander.addFunctor(variable, callable);
-        }
+        result->program.push_back(std::move(step));
+        literalBegin = variable.getReplaceLocation().second;
     }
 
-    expander.finalize();
-    return expander;
+    typename Template::Step last;
+    last.literalBegin = literalBegin;
+    last.literalEnd = templateString.size();
+    result->program.push_back(std::move(last));
+
+    return result;
 }
 
 template <typename CreativeData>
@@ -467,43 +573,31 @@ std::string
 CreativeConfiguration<CreativeData>::expand(const std::string& templateString,
                                             const Context& context) const
 {
-    boost::shared_lock<boost::shared_mutex> lock(mutex_);
-    auto const& expander = expanders_[templateString];
-    return expander.expand(templateString, context);
+    std::string result;
+    expand(templateString, context, result);
+    return result;
 }
 
 template <typename CreativeData>
-struct CreativeConfiguration<CreativeData>::Expander
+void
+CreativeConfiguration<CreativeData>::expand(const std::string& templateString,
+                                            const Context& context,
+                                            std::string& out) const
 {
-    typedef std::vector<std::pair<ExpandVariable, ExpanderCallable>> FunctorCollection;
-
-    void addFunctor(const ExpandVariable& var, ExpanderCallable fn)
+    TemplatePtr compiled;
     {
-        collection.push_back(std::make_pair(var, fn));
+        boost::shared_lock<boost::shared_mutex> lock(mutex_);
+        auto it = expanders_.find(templateString);
+        if (it != expanders_.end())
+            compiled = it->second;
     }
 
-    void finalize()
-    {
-        std::reverse(collection.begin(), collection.end());
-    }
-
-    std::string expand(std::string toExpand, const Context& ctx) const
-    {
-        for (auto& element : collection) {
-            auto const& var = element.first;
-            auto const& fn = element.second;
-
-            auto const& location = var.getReplaceLocation();
-
-            toExpand.replace(
-                location.first, location.second - location.first, fn(ctx));
-        }
-
-        return toExpand;
+    if (!compiled) {
+        out += templateString;
+        return;
     }
 
-    FunctorCollection collection;
-
-};
+    compiled->expand(context, out);
+}
 
 } // namespace RTBKIT
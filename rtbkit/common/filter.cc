@@ -40,14 +40,9 @@ biddableSpots()
         std::unordered_map<unsigned, SmallIntVector> biddableCreatives;
 
         for (unsigned crId = 0; crId < creatives_[impId].size(); ++crId) {
-            const auto& configs = creatives_[impId][crId];
-
-            for (size_t config = configs.next();
-                 config < configs.size();
-                 config = configs.next(config + 1))
-            {
-                biddableCreatives[config].push_back(crId);
-            }
+            creatives_[impId][crId].forEach([&] (size_t config) {
+                        biddableCreatives[config].push_back(crId);
+                    });
         }
 
         for (const auto& entry : biddableCreatives)
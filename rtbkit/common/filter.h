@@ -15,6 +15,7 @@
 #include <string>
 #include <memory>
 #include <functional>
+#include <cstring>
 
 
 namespace RTBKIT {
@@ -50,6 +51,18 @@ struct ConfigSet
         defaultValue(defaultValue ? ~Word(0) : 0)
     {}
 
+    /** Creates a set that already has room for capacity configs and so never
+        has to be expanded to hold a config below that. When both sides of an
+        operation have the same width, it reduces to a loop over the words
+        with no expansion and no default value to fill in. FilterPool uses
+        this to give all the sets in a FilterState the same fixed width.
+     */
+    ConfigSet(bool defaultValue, size_t capacity) :
+        defaultValue(defaultValue ? ~Word(0) : 0)
+    {
+        expand(capacity);
+    }
+
 
     size_t size() const
     {
@@ -108,22 +121,46 @@ struct ConfigSet
     {
         if (bitfield.empty()) return !defaultValue;
 
-        for (size_t i = 0; i < bitfield.size(); ++i) {
-            if (bitfield[i]) return false;
+        const Word* words = bitfield.unsafe_raw_data();
+        size_t n = bitfield.size();
+
+        size_t i = 0;
+        for (; i + Block <= n; i += Block) {
+            Words x = load(words + i);
+            Word any = 0;
+            for (size_t j = 0; j < Block; ++j) any |= x[j];
+            if (any) return false;
+        }
+        for (; i < n; ++i) {
+            if (words[i]) return false;
         }
         return true;
     }
 
+    /* The operations work on a block of words at a time through the
+       compiler's generic vectors, which become one AVX2 instruction per block
+       when compiled for it and two SSE2 instructions otherwise.
+     */
 #define RTBKIT_CONFIG_SET_OP(_op_)                                      \
     ConfigSet& operator _op_ (const ConfigSet& other)                   \
     {                                                                   \
         expand(other.size());                                           \
                                                                         \
-        for (size_t i = 0; i < other.bitfield.size(); ++i)              \
-            bitfield[i] _op_ other.bitfield[i];                         \
+        Word* words = bitfield.unsafe_raw_data();                       \
+        const Word* otherWords = other.bitfield.unsafe_raw_data();      \
+        size_t n = other.bitfield.size();                               \
                                                                         \
-        for (size_t i = other.bitfield.size(); i < bitfield.size(); ++i) \
-            bitfield[i] _op_ other.defaultValue;                        \
+        size_t i = 0;                                                   \
+        for (; i + Block <= n; i += Block) {                            \
+            Words x = load(words + i);                                  \
+            x _op_ load(otherWords + i);                                \
+            store(words + i, x);                                        \
+        }                                                               \
+        for (; i < n; ++i)                                              \
+            words[i] _op_ otherWords[i];                                \
+                                                                        \
+        for (i = n; i < bitfield.size(); ++i)                           \
+            words[i] _op_ other.defaultValue;                           \
                                                                         \
         return *this;                                                   \
     }
@@ -155,8 +192,16 @@ struct ConfigSet
     ConfigSet& negate()
     {
         defaultValue = ~defaultValue;
-        for (size_t i = 0; i < bitfield.size(); ++i)
-            bitfield[i] = ~bitfield[i];
+
+        Word* words = bitfield.unsafe_raw_data();
+        size_t n = bitfield.size();
+
+        size_t i = 0;
+        for (; i + Block <= n; i += Block)
+            store(words + i, ~load(words + i));
+        for (; i < n; ++i)
+            words[i] = ~words[i];
+
         return *this;
     }
 
@@ -192,6 +237,22 @@ struct ConfigSet
         return size();
     }
 
+    /** Calls onConfig with every config id that is part of the bitfield, in
+        increasing order. Each word is only read once and its set bits are
+        cleared as they're found, which is cheaper than calling next() in a
+        loop.
+     */
+    template<typename Fn>
+    void forEach(Fn&& onConfig) const
+    {
+        const Word* words = bitfield.unsafe_raw_data();
+
+        for (size_t i = 0; i < bitfield.size(); ++i) {
+            for (Word value = words[i]; value; value &= value - 1)
+                onConfig(i * Div + ML::lowest_bit(value));
+        }
+    }
+
     std::string print() const
     {
         std::stringstream ss;
@@ -203,6 +264,21 @@ struct ConfigSet
     }
 
 private:
+    typedef Word Words __attribute__((__vector_size__(32)));
+    static constexpr size_t Block = sizeof(Words) / sizeof(Word);
+
+    static Words load(const Word* p)
+    {
+        Words result;
+        std::memcpy(&result, p, sizeof(result));
+        return result;
+    }
+
+    static void store(Word* p, const Words& value)
+    {
+        std::memcpy(p, &value, sizeof(value));
+    }
+
     ML::compact_vector<Word, 8> bitfield;
     Word defaultValue;
 };
@@ -427,7 +503,7 @@ struct FilterState
 private:
     void updateConfigs()
     {
-        CreativeMatrix mask;
+        CreativeMatrix mask(ConfigSet(false, configs_.size()));
         for (const CreativeMatrix& matrix : creatives_) mask |= matrix;
         configs_ &= mask.aggregate();
     }
@@ -497,6 +573,21 @@ struct FilterBase
     virtual void
     removeConfig(unsigned configIndex, const std::shared_ptr<AgentConfig>& config) = 0;
 
+    /** Indicates whether replacing oldConfig with newConfig at the same index
+        requires going through removeConfig and addConfig. Returning false
+        keeps whatever was built for oldConfig, which saves recompiling it
+        when an agent only changes fields that this filter doesn't look at.
+
+        The default is to always update the filter. Filters should only
+        override this if none of the fields they use can differ when it
+        returns false.
+     */
+    virtual bool
+    isAffected(const AgentConfig& oldConfig, const AgentConfig& newConfig) const
+    {
+        return true;
+    }
+
 };
 
 
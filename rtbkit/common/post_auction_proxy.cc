@@ -7,6 +7,7 @@
 */
 
 #include "post_auction_proxy.h"
+#include <boost/lexical_cast.hpp>
 
 using namespace std;
 using namespace Datacratic;
@@ -20,17 +21,71 @@ namespace RTBKIT {
 PostAuctionProxy::
 PostAuctionProxy(shared_ptr<ServiceProxies> proxies) :
     shards(proxies->params.get("postAuctionShards", 1).asInt()),
-    proxies(proxies)
+    proxies(proxies),
+    batching(false), started(false),
+    maxBatchEvents(1), maxBatchDelay(0.0), ackTimeout(0.0),
+    nextBatchId(0)
 {}
 
+PostAuctionProxy::
+~PostAuctionProxy()
+{
+    shutdown();
+}
+
 void
 PostAuctionProxy::
 init()
 {
     toPostAuction.init(proxies->config);
+
+    // Only acknowledgements of batches come back
+    toPostAuction.messageHandler = [=] (const string & source,
+                                        const vector<string> & message)
+        {
+            this->handleMessage(source, message);
+        };
+
     toPostAuction.connectAllServiceProviders("rtbPostAuctionService", "events");
 }
 
+void
+PostAuctionProxy::
+enableBatching(size_t maxEvents, double maxDelay, double ackTimeout)
+{
+    ExcAssert(!started);
+
+    batching = true;
+    maxBatchEvents = std::max<size_t>(maxEvents, 1);
+    maxBatchDelay = maxDelay;
+    this->ackTimeout = ackTimeout;
+    batches.resize(shards);
+}
+
+void
+PostAuctionProxy::
+start()
+{
+    if (!batching || started) return;
+
+    toPostAuction.addPeriodic("PostAuctionProxy::checkBatches", maxBatchDelay,
+                              [=] (uint64_t) { this->checkBatches(); });
+    toPostAuction.start();
+    started = true;
+}
+
+void
+PostAuctionProxy::
+shutdown()
+{
+    if (batching) flush();
+
+    if (started) {
+        toPostAuction.shutdown();
+        started = false;
+    }
+}
+
 bool
 PostAuctionProxy::
 isConnected() const
@@ -60,8 +115,97 @@ sendEvent(PostAuctionEvent event)
     size_t shard = event.auctionId.hash() % shards;
     string str = ML::DB::serializeToString(event);
 
-    // we intentionally drop the message if the shard isn't up.
-    (void) toPostAuction.sendMessageToShard(shard, print(event.type), str);
+    if (!batching) {
+        // we intentionally drop the message if the shard isn't up.
+        (void) toPostAuction.sendMessageToShard(shard, print(event.type), str);
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(batchLock);
+
+    Batch & batch = batches[shard];
+    if (!batch.events) batch.started = Date::now();
+    batch.data += str;
+
+    if (++batch.events >= maxBatchEvents)
+        sendBatch(shard, batch);
+}
+
+void
+PostAuctionProxy::
+flush()
+{
+    std::lock_guard<std::mutex> guard(batchLock);
+
+    for (size_t shard = 0; shard < batches.size(); ++shard) {
+        if (batches[shard].events)
+            sendBatch(shard, batches[shard]);
+    }
+}
+
+void
+PostAuctionProxy::
+sendBatch(size_t shard, Batch & batch)
+{
+    uint64_t id = nextBatchId++;
+
+    // Like single events, batches are dropped if the shard isn't up.
+    bool sent = toPostAuction.sendMessageToShard(
+            shard, "EVENTS", to_string(id), to_string(batch.events), batch.data);
+
+    if (sent) {
+        unacked[id] = { batch.events, Date::now() };
+        doEvent("batch.sent");
+        doEvent("batch.events", ET_OUTCOME, batch.events);
+    }
+    else {
+        doEvent("batch.dropped");
+        doEvent("batch.droppedEvents", ET_COUNT, batch.events);
+    }
+
+    batch.data.clear();
+    batch.events = 0;
+}
+
+void
+PostAuctionProxy::
+checkBatches()
+{
+    Date now = Date::now();
+
+    std::lock_guard<std::mutex> guard(batchLock);
+
+    for (size_t shard = 0; shard < batches.size(); ++shard) {
+        Batch & batch = batches[shard];
+        if (batch.events && now.secondsSince(batch.started) >= maxBatchDelay)
+            sendBatch(shard, batch);
+    }
+
+    // Batch ids go up with time so the oldest batches come first.
+    for (auto it = unacked.begin(); it != unacked.end();) {
+        if (now.secondsSince(it->second.sent) < ackTimeout) break;
+
+        doEvent("batch.lost");
+        doEvent("batch.lostEvents", ET_COUNT, it->second.events);
+        it = unacked.erase(it);
+    }
+}
+
+void
+PostAuctionProxy::
+handleMessage(const string & source, const vector<string> & message)
+{
+    if (message.at(0) != "EVENTSACK") return;
+
+    uint64_t id = boost::lexical_cast<uint64_t>(message.at(1));
+
+    std::lock_guard<std::mutex> guard(batchLock);
+
+    // Acknowledgements that come in after the timeout were already counted
+    // as lost.
+    if (unacked.erase(id))
+        doEvent("batch.acked");
+    else doEvent("batch.lateAck");
 }
 
 
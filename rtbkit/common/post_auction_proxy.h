@@ -11,6 +11,8 @@
 #include "rtbkit/common/auction_events.h"
 #include "soa/service/service_base.h"
 #include "soa/service/zmq_endpoint.h"
+#include <map>
+#include <mutex>
 
 namespace RTBKIT {
 
@@ -29,9 +31,33 @@ namespace RTBKIT {
 struct PostAuctionProxy
 {
     PostAuctionProxy(std::shared_ptr<Datacratic::ServiceProxies> proxies);
+    ~PostAuctionProxy();
 
     void init();
 
+    /** Send the events of each shard in EVENTS messages of up to maxEvents
+        events instead of one message per event.  A batch goes out once it's
+        full or maxDelay seconds after its first event, and the post auction
+        service acknowledges each batch that it processed.  Batches that
+        aren't acknowledged within ackTimeout seconds are reported as lost;
+        they are not sent again as that could count a win twice.
+
+        Must be called before init() and requires start() to be called.  Only
+        post auction services that know about the EVENTS message can be sent
+        batches.
+    */
+    void enableBatching(size_t maxEvents = 64,
+                        double maxDelay = 0.005,
+                        double ackTimeout = 1.0);
+
+    /** Start the thread that sends out the batches that are due and receives
+        their acknowledgements.  Does nothing unless batching is enabled.
+    */
+    void start();
+
+    /** Send what's left in the batches and stop. */
+    void shutdown();
+
     // Returns true only the proxy is connected to all shards.
     bool isConnected() const;
 
@@ -41,11 +67,55 @@ struct PostAuctionProxy
     // Sends an event to the post auction loop.
     void sendEvent(PostAuctionEvent event);
 
+    /** Send the events waiting in batches right away. */
+    void flush();
+
+    /* stats on the batches */
+    typedef std::function<void (const char * eventName,
+                                Datacratic::EventType,
+                                float)> OnEvent;
+    OnEvent onEvent;
+
 private:
+    struct Batch {
+        Batch() : events(0) {}
+
+        std::string data;       ///< Serialized events, back to back
+        size_t events;
+        Datacratic::Date started;
+    };
+
+    struct SentBatch {
+        size_t events;
+        Datacratic::Date sent;
+    };
+
+    void sendBatch(size_t shard, Batch & batch);
+    void checkBatches();
+    void handleMessage(const std::string & source,
+                       const std::vector<std::string> & message);
+
+    void doEvent(const char * eventName,
+                 Datacratic::EventType type = Datacratic::ET_COUNT,
+                 float value = 1.0) const
+    {
+        if (onEvent) onEvent(eventName, type, value);
+    }
+
     size_t shards;
     std::shared_ptr<Datacratic::ServiceProxies> proxies;
     Datacratic::ZmqMultipleNamedClientBusProxy toPostAuction;
 
+    bool batching;
+    bool started;
+    size_t maxBatchEvents;
+    double maxBatchDelay;
+    double ackTimeout;
+
+    std::mutex batchLock;
+    std::vector<Batch> batches;             ///< One per shard
+    uint64_t nextBatchId;
+    std::map<uint64_t, SentBatch> unacked;
 };
 
 } // namespace RTBKIT
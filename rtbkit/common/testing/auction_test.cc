@@ -0,0 +1,191 @@
+/* auction_test.cc
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Test that responses set on an auction end up ordered with the winner
+   first, including when they are set from several threads at once.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include "rtbkit/common/auction.h"
+#include "jml/arch/format.h"
+#include <boost/test/unit_test.hpp>
+#include <thread>
+
+using namespace std;
+using namespace ML;
+using namespace RTBKIT;
+using namespace Datacratic;
+
+
+namespace {
+
+std::shared_ptr<Auction>
+makeAuction(int numSpots, std::shared_ptr<Auction> * finished)
+{
+    auto request = std::make_shared<BidRequest>();
+    request->auctionId = Id("auction");
+    request->imp.resize(numSpots);
+
+    auto onFinish = [=] (std::shared_ptr<Auction> auction)
+        {
+            *finished = auction;
+        };
+
+    return std::make_shared<Auction>(nullptr, onFinish, request, "", "",
+                                     Date::now(), Date::now().plusSeconds(1));
+}
+
+Auction::Response
+makeResponse(const std::string & agent, int price, float priority = 0.0)
+{
+    Auction::Response response;
+    response.agent = agent;
+    response.account = { "campaign", "strategy" };
+    response.price = Auction::Price(MicroUSD_CPM(price), priority);
+    response.creativeId = 1;
+    return response;
+}
+
+} // file scope
+
+BOOST_AUTO_TEST_CASE( test_auction_responses )
+{
+    std::shared_ptr<Auction> finished;
+    auto auction = makeAuction(2, &finished);
+
+    BOOST_CHECK_EQUAL(auction->setResponse(0, makeResponse("a", 100)).val,
+                      Auction::WinLoss::PENDING);
+    auction->setResponse(0, makeResponse("b", 200));
+    auction->setResponse(0, makeResponse("c", 50, 1.0));
+    auction->setResponse(0, makeResponse("d", 500));
+    auction->setResponse(0, makeResponse("e", 50, 1.0));
+
+    BOOST_CHECK_EQUAL(auction->setResponse(1, makeResponse("", 100)).val,
+                      Auction::WinLoss::INVALID);
+    BOOST_CHECK_THROW(auction->setResponse(2, makeResponse("a", 100)),
+                      ML::Exception);
+
+    // Before it's finished, we get a snapshot with the winner pending
+    const Auction::Data * snapshot = auction->getCurrentData();
+    BOOST_CHECK(!snapshot->tooLate);
+    BOOST_CHECK_EQUAL(snapshot->responses.size(), 2);
+    BOOST_CHECK_EQUAL(snapshot->winningResponse(0).agent, "c");
+    BOOST_CHECK_EQUAL(snapshot->winningResponse(0).localStatus.val,
+                      Auction::WinLoss::PENDING);
+    BOOST_CHECK(!snapshot->hasValidResponse(1));
+
+    auction->addDataSources({ "ds1" });
+    auction->addDataSources({ "ds1", "ds2" });
+
+    BOOST_CHECK(auction->finish());
+    BOOST_CHECK(finished == auction);
+    BOOST_CHECK(auction->tooLate());
+    BOOST_CHECK(!auction->finish());
+    BOOST_CHECK(!auction->setError("error"));
+    BOOST_CHECK_EQUAL(auction->setResponse(1, makeResponse("f", 100)).val,
+                      Auction::WinLoss::TOOLATE);
+
+    // The winner comes first, then the rest in the order they came in
+    const Auction::Data * data = auction->getCurrentData();
+    BOOST_CHECK_EQUAL(data, auction->getCurrentData());
+    BOOST_CHECK(data->tooLate);
+    BOOST_CHECK(!data->hasError());
+
+    const auto & responses = data->responses[0];
+    BOOST_REQUIRE_EQUAL(responses.size(), 5);
+    const char * agents[] = { "c", "a", "b", "d", "e" };
+    for (unsigned i = 0;  i < responses.size();  ++i) {
+        BOOST_CHECK_EQUAL(responses[i].agent, agents[i]);
+        BOOST_CHECK_EQUAL(responses[i].localStatus.val,
+                          i == 0 ? Auction::WinLoss::WIN
+                                 : Auction::WinLoss::LOSS);
+    }
+    BOOST_CHECK(!data->hasValidResponse(1));
+    BOOST_CHECK_EQUAL(auction->getDataSources().size(), 2);
+
+    // The snapshot is still there
+    BOOST_CHECK_EQUAL(snapshot->responses[0].size(), 5);
+}
+
+BOOST_AUTO_TEST_CASE( test_auction_error )
+{
+    std::shared_ptr<Auction> finished;
+    auto auction = makeAuction(1, &finished);
+
+    auction->setResponse(0, makeResponse("a", 100));
+    BOOST_CHECK(auction->setError("error", "details"));
+    BOOST_CHECK(finished == auction);
+    BOOST_CHECK(!auction->finish());
+
+    const Auction::Data * data = auction->getCurrentData();
+    BOOST_CHECK(data->hasError());
+    BOOST_CHECK_EQUAL(data->error, "error");
+    BOOST_CHECK_EQUAL(data->details, "details");
+    BOOST_CHECK_EQUAL(data->winningResponse(0).localStatus.val,
+                      Auction::WinLoss::LOSS);
+}
+
+BOOST_AUTO_TEST_CASE( test_auction_concurrent_responses )
+{
+    enum { numThreads = 8, numBids = 1000, numSpots = 3 };
+
+    for (unsigned iter = 0;  iter < 20;  ++iter) {
+        std::shared_ptr<Auction> finished;
+        auto auction = makeAuction(numSpots, &finished);
+
+        // Boost.Test isn't thread safe, so count the results and check
+        // them afterwards
+        int accepted[numThreads] = { 0 };
+        int tooLate[numThreads] = { 0 };
+
+        auto doThread = [&] (int thread)
+            {
+                for (unsigned i = 0;  i < numBids;  ++i) {
+                    string agent = ML::format("%d-%d", thread, i);
+                    int price = 1 + (thread * numBids + i) * 7919 % 100003;
+                    auto status = auction->setResponse(i % numSpots,
+                            makeResponse(agent, price));
+                    if (status.val == Auction::WinLoss::PENDING)
+                        ++accepted[thread];
+                    else if (status.val == Auction::WinLoss::TOOLATE)
+                        ++tooLate[thread];
+                }
+            };
+
+        std::vector<std::thread> threads;
+        for (unsigned i = 0;  i < numThreads;  ++i)
+            threads.emplace_back(doThread, i);
+
+        // Finish it while the bids are coming in on every other iteration
+        if (iter % 2)
+            BOOST_CHECK(auction->finish());
+
+        for (auto & t: threads)
+            t.join();
+
+        if (iter % 2 == 0)
+            BOOST_CHECK(auction->finish());
+
+        const Auction::Data * data = auction->getCurrentData();
+
+        size_t total = 0;
+        for (auto & responses: data->responses) {
+            total += responses.size();
+            for (auto & response: responses)
+                BOOST_CHECK(response.price.maxPrice
+                            <= responses[0].price.maxPrice);
+        }
+
+        size_t numAccepted = 0;
+        for (unsigned i = 0;  i < numThreads;  ++i) {
+            BOOST_CHECK_EQUAL(accepted[i] + tooLate[i], numBids);
+            numAccepted += accepted[i];
+        }
+
+        BOOST_CHECK_EQUAL(total, numAccepted);
+        if (iter % 2 == 0)
+            BOOST_CHECK_EQUAL(total, numThreads * numBids);
+    }
+}
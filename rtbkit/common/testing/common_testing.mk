@@ -4,5 +4,7 @@ $(eval $(call library,bid_request_synth,bid_request_synth.cc,arch utils jsoncpp)
 $(eval $(call test,bid_request_synth_test,bid_request_synth,boost))
 $(eval $(call test,currency_test,bid_request,boost))
 $(eval $(call test,filter_test,filter_registry,boost))
+$(eval $(call program,config_set_bench,filter_registry arch boost_program_options))
 $(eval $(call test,bids_test,rtb,boost))
+$(eval $(call test,auction_test,rtb,boost))
 
@@ -0,0 +1,166 @@
+/** config_set_bench.cc                                 -*- C++ -*-
+    Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+    Compares the dynamically expanded ConfigSet with one created at a fixed
+    width, doing what a FilterState does for a request, over a range of agent
+    counts.
+
+*/
+
+#include "rtbkit/common/filter.h"
+#include "jml/arch/timers.h"
+#include "jml/arch/format.h"
+
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/parsers.hpp>
+#include <boost/program_options/variables_map.hpp>
+#include <iostream>
+#include <vector>
+#include <stdlib.h>
+
+using namespace std;
+using namespace ML;
+using namespace RTBKIT;
+
+
+namespace {
+
+// Somewhere for the results to go, so that they can't be optimized away
+volatile size_t sink;
+
+/** Returns the number of requests per second that run() gets through. */
+template<typename Fn>
+double measure(const Fn& run, double seconds)
+{
+    run();
+
+    size_t total = 0;
+    Timer timer;
+    while (timer.elapsed_wall() < seconds) {
+        for (size_t i = 0; i < 100; ++i) run();
+        total += 100;
+    }
+
+    return total / timer.elapsed_wall();
+}
+
+/** The sets returned by the filters for a request. Each filter only knows
+    about some of the configs so most of the sets stop short of the highest
+    config, like the ones built by the filters do, and half of them include
+    the configs that they don't know about.
+ */
+vector<ConfigSet> makeFilterResults(size_t numConfigs, size_t numFilters)
+{
+    vector<ConfigSet> result;
+
+    for (size_t f = 0; f < numFilters; ++f) {
+        ConfigSet set(f % 2);
+        size_t width = numConfigs - rand() % (numConfigs / 4 + 1);
+        for (size_t cfg = 0; cfg < width; ++cfg)
+            set.set(cfg, rand() % 100 < 97);
+        result.push_back(set);
+    }
+
+    return result;
+}
+
+} // file scope
+
+
+int main(int argc, char ** argv)
+{
+    using namespace boost::program_options;
+
+    vector<size_t> agentCounts = { 16, 64, 256, 1024, 4096 };
+    size_t numFilters = 30;
+    double seconds = 0.5;
+
+    options_description options;
+    options.add_options()
+        ("agents,a", value(&agentCounts)->multitoken(),
+         "number of agent configs")
+        ("filters,f", value(&numFilters), "number of filters per request")
+        ("seconds,s", value(&seconds), "time to run each test for")
+        ("help,h", "print this message");
+
+    variables_map vm;
+    store(command_line_parser(argc, argv).options(options).run(), vm);
+    notify(vm);
+
+    if (vm.count("help")) {
+        cerr << options << endl;
+        return 1;
+    }
+
+    cout << "thousands of requests per second, " << numFilters
+         << " filters each" << endl << endl;
+    cout << format("%10s%12s%12s%10s%12s%12s%10s",
+            "agents", "dynamic", "fixed", "speedup",
+            "next()", "forEach()", "speedup")
+         << endl;
+
+    for (size_t numConfigs : agentCounts) {
+        vector<ConfigSet> results = makeFilterResults(numConfigs, numFilters);
+
+        vector<ConfigSet> creativeRows = makeFilterResults(numConfigs, 4);
+
+        /* What FilterState does: start from the active configs, narrow them
+           down with each of the filters, checking after each one whether
+           there's anything left, and then narrow them down to the configs
+           that still have a creative.
+         */
+        auto filterWith = [&] (const ConfigSet& start, const ConfigSet& none) {
+            ConfigSet configs = start;
+            for (const ConfigSet& result : results) {
+                configs &= result;
+                if (configs.empty()) break;
+            }
+
+            ConfigSet withCreatives = none;
+            for (const ConfigSet& row : creativeRows)
+                withCreatives |= row;
+            configs &= withCreatives;
+
+            sink = configs.count();
+        };
+
+        ConfigSet start(true), none;
+        ConfigSet fixedStart(true, numConfigs), fixedNone(false, numConfigs);
+
+        auto dynamic = [&] { filterWith(start, none); };
+        auto fixed = [&] { filterWith(fixedStart, fixedNone); };
+
+        ConfigSet survivors = fixedStart;
+        for (size_t f = 0; f < 3; ++f) survivors &= results[f];
+
+        auto viaNext = [&] {
+            size_t total = 0;
+            for (size_t cfg = survivors.next();
+                 cfg < survivors.size();
+                 cfg = survivors.next(cfg + 1))
+            {
+                total += cfg;
+            }
+            sink = total;
+        };
+
+        auto viaForEach = [&] {
+            size_t total = 0;
+            survivors.forEach([&] (size_t cfg) { total += cfg; });
+            sink = total;
+        };
+
+        double dynamicRate = measure(dynamic, seconds);
+        double fixedRate = measure(fixed, seconds);
+        double nextRate = measure(viaNext, seconds);
+        double forEachRate = measure(viaForEach, seconds);
+
+        cout << format("%10zd%12.1f%12.1f%9.2fx%12.1f%12.1f%9.2fx",
+                numConfigs,
+                dynamicRate / 1000.0, fixedRate / 1000.0,
+                fixedRate / dynamicRate,
+                nextRate / 1000.0, forEachRate / 1000.0,
+                forEachRate / nextRate)
+             << endl;
+    }
+}
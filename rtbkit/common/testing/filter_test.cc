@@ -114,6 +114,80 @@ BOOST_AUTO_TEST_CASE(configSetTest)
     }
 }
 
+BOOST_AUTO_TEST_CASE(fixedConfigSetTest)
+{
+    enum { capacity = 1024 };
+
+    // Reference result for a config in a set with the given bits and default.
+    auto ref = [] (const vector<bool>& bits, bool def, size_t i) {
+        return i < bits.size() ? bits[i] : def;
+    };
+
+    srand(1);
+
+    for (size_t sizeA : { 0, 1, 63, 64, 65, 255, 256, 300, 1024 }) {
+        for (size_t sizeB : { 0, 7, 64, 200, 257, 1024, 1500 }) {
+            for (int defaults = 0; defaults < 4; ++defaults) {
+                bool defA = defaults & 1, defB = defaults & 2;
+
+                vector<bool> bitsA(sizeA), bitsB(sizeB);
+                ConfigSet fixedA(defA, capacity), dynA(defA);
+                ConfigSet setB(defB);
+
+                for (size_t i = 0; i < sizeA; ++i) {
+                    bitsA[i] = rand() % 3 == 0;
+                    fixedA.set(i, bitsA[i]);
+                    dynA.set(i, bitsA[i]);
+                }
+                for (size_t i = 0; i < sizeB; ++i) {
+                    bitsB[i] = rand() % 2;
+                    setB.set(i, bitsB[i]);
+                }
+
+                BOOST_CHECK_EQUAL(fixedA.size(),
+                        std::max<size_t>(capacity, dynA.size()));
+
+                ConfigSet andF = fixedA & setB, andD = dynA & setB;
+                ConfigSet orF = fixedA | setB, orD = dynA | setB;
+                ConfigSet xorF = fixedA ^ setB, xorD = dynA ^ setB;
+                ConfigSet negF = fixedA.negate();
+
+                /* Operations don't combine the default values, so past the
+                   end of both sets the result depends on how wide they are;
+                   only compare where at least one of them has its bits.
+                 */
+                size_t width = std::max(sizeA, sizeB);
+
+                for (size_t i = 0; i < width; ++i) {
+                    bool a = ref(bitsA, defA, i), b = ref(bitsB, defB, i);
+
+                    BOOST_CHECK_EQUAL(andF.test(i), andD.test(i));
+                    BOOST_CHECK_EQUAL(orF.test(i), orD.test(i));
+                    BOOST_CHECK_EQUAL(xorF.test(i), xorD.test(i));
+
+                    BOOST_CHECK_EQUAL(andF.test(i), a && b);
+                    BOOST_CHECK_EQUAL(orF.test(i), a || b);
+                    BOOST_CHECK_EQUAL(xorF.test(i), a != b);
+                }
+
+                for (size_t i = 0; i < 1600; ++i)
+                    BOOST_CHECK_EQUAL(negF.test(i), !ref(bitsA, defA, i));
+
+                BOOST_CHECK_EQUAL(andF.empty(), andF.count() == 0);
+
+                // forEach visits exactly what next() does, in order.
+                vector<size_t> viaNext, viaForEach;
+                for (size_t i = orF.next(); i < orF.size(); i = orF.next(i + 1))
+                    viaNext.push_back(i);
+                orF.forEach([&] (size_t i) { viaForEach.push_back(i); });
+
+                BOOST_CHECK(viaNext == viaForEach);
+                BOOST_CHECK_EQUAL(viaForEach.size(), orF.count());
+            }
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE(creativeMatrixTest)
 {
     enum { n = 10, m = 100 };
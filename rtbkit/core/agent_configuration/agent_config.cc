@@ -324,6 +324,47 @@ createFromJson(const Json::Value& json, const std::string& name)
 }
 
 
+/*****************************************************************************/
+/* FREQUENCY CAP                                                             */
+/*****************************************************************************/
+
+FrequencyCap
+FrequencyCap::
+createFromJson(const Json::Value & val)
+{
+    FrequencyCap result;
+    int count = 0;  // signed so that negative counts are caught below
+
+    for (auto it = val.begin(), end = val.end();  it != end;  ++it) {
+        if (it.memberName() == "count")
+            count = it->asInt();
+        else if (it.memberName() == "window")
+            result.window = it->asDouble();
+        else throw Exception("frequency cap has invalid key: %s",
+                             it.memberName().c_str());
+    }
+
+    if (count <= 0)
+        throw Exception("frequency cap needs a positive count");
+    result.count = count;
+
+    if (result.window <= 0.0)
+        throw Exception("frequency cap needs a positive window");
+
+    return result;
+}
+
+Json::Value
+FrequencyCap::
+toJson() const
+{
+    Json::Value result;
+    result["count"] = count;
+    result["window"] = window;
+    return result;
+}
+
+
 
 /*****************************************************************************/
 /* AGENT CONFIG                                                             */
@@ -625,6 +666,12 @@ createFromJson(const Json::Value & json)
                                      jt.memberName().c_str());
             }
         }
+        else if (it.memberName() == "frequencyCaps") {
+            ExcCheck(it->isArray(), "frequencyCaps must be an array");
+            for (auto jt = it->begin(), jend = it->end();  jt != jend;  ++jt)
+                newConfig.frequencyCaps.push_back(
+                        FrequencyCap::createFromJson(*jt));
+        }
         else if (it.memberName() == "visits") {
             for (auto jt = it->begin(), jend = it->end();
                  jt != jend;  ++jt) {
@@ -791,6 +838,12 @@ toJson(bool includeCreatives) const
         }
     }
 
+    if (hasFrequencyCap()) {
+        Json::Value & caps = result["frequencyCaps"];
+        for (unsigned i = 0;  i < frequencyCaps.size();  ++i)
+            caps[i] = frequencyCaps[i].toJson();
+    }
+
     if (!visitChannels.empty()) {
         Json::Value & v = result["visits"];
         v["channels"] = visitChannels.toJson();
@@ -218,6 +218,27 @@ enum BlacklistScope {
 };
 
 
+/*****************************************************************************/
+/* FREQUENCY CAP                                                             */
+/*****************************************************************************/
+
+/** Maximum number of wins on a given user for a campaign (the first element
+    of the account) over a sliding window of time.
+*/
+struct FrequencyCap {
+    FrequencyCap(unsigned count = 0, double window = 0.0)
+        : count(count), window(window)
+    {
+    }
+
+    unsigned count;   ///< Maximum number of wins within the window
+    double window;    ///< Length of the window in seconds
+
+    static FrequencyCap createFromJson(const Json::Value & val);
+    Json::Value toJson() const;
+};
+
+
 /*****************************************************************************/
 /* BID CONTROL TYPE                                                          */
 /*****************************************************************************/
@@ -342,6 +363,16 @@ struct AgentConfig {
         return blacklistType != BL_OFF && blacklistTime > 0.0;
     }
 
+    /** Caps on the number of wins per user for our campaign.  They are all
+        checked; the user is filtered out as soon as one of them is reached.
+    */
+    std::vector<FrequencyCap> frequencyCaps;
+
+    bool hasFrequencyCap() const
+    {
+        return !frequencyCaps.empty();
+    }
+
     BidControlType bidControlType;
     uint32_t fixedBidCpmInMicros;
 
@@ -663,15 +663,24 @@ struct ShadowAccount {
 
     void syncFromMaster(const Account & masterAccount)
     {
-        checkInvariants();
         masterAccount.checkInvariants();
+        syncFromMaster(masterAccount.getNetBudget(), masterAccount.status);
+    }
+
+    /** Same as above, with only the parts of the master account that we
+        need (as sent in a binary sync).
+    */
+    void syncFromMaster(const CurrencyPool & masterNetBudget,
+                        Account::Status masterStatus)
+    {
+        checkInvariants();
 
         // net budget: balance assuming spent, commitments are zero
-        netBudget = masterAccount.getNetBudget();
+        netBudget = masterNetBudget;
         balance = netBudget + commitmentsRetired
             - commitmentsMade - spent;
 
-        status = masterAccount.status;
+        status = masterStatus;
         checkInvariants();
     }
 
@@ -1141,6 +1150,7 @@ struct Accounts {
 
 private:
     friend class ShadowAccounts;
+    friend struct ShardedAccounts;
 
     typedef ML::Spinlock Lock;
     typedef std::unique_lock<Lock> Guard;
@@ -1388,6 +1398,17 @@ struct ShadowAccounts {
         return a;
     }
 
+    const ShadowAccount syncFromMaster(const AccountKey & account,
+                                       const CurrencyPool & netBudget,
+                                       Account::Status status)
+    {
+        Guard guard(lock);
+        auto & a = getAccountImpl(account);
+        ExcAssert(!a.uninitialized);
+        a.syncFromMaster(netBudget, status);
+        return a;
+    }
+
     /** Initialize an account by merging with the initial state as
         received from the master banker.
     */
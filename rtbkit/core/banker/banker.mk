@@ -5,11 +5,13 @@ LIBBANKER_SOURCES := \
 	banker.cc \
 	null_banker.cc \
 	slave_banker.cc \
+	banker_sync.cc \
+	sharded_accounts.cc \
 	master_banker.cc \
 	application_layer.cc
 
 LIBBANKER_LINK := \
-	types services redis monitor boost_program_options
+	types services redis monitor boost_program_options worker_task
 
 $(eval $(call library,banker,$(LIBBANKER_SOURCES),$(LIBBANKER_LINK)))
 
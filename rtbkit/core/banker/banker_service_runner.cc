@@ -45,6 +45,7 @@ int main(int argc, char ** argv)
 
     int redisTimeout = 0;
     int saveInterval = 0;
+    int numShards = 1;
 
     bool debug = false;
 
@@ -61,6 +62,8 @@ int main(int argc, char ** argv)
          "Delay at which redis calls will timeout")
         ("save-interval", value<int>(&saveInterval)->default_value(10),
          "Periodic delay at which state will be saved")
+        ("shards", value<int>(&numShards)->default_value(1),
+         "Number of shards (and threads) over which to split the accounts")
         ("fixed-http-bind-address,a", value(&fixedHttpBindAddresses),
          "Fixed address (host:port or *:port) at which we will always listen")
         ("debug", bool_switch(&debug),
@@ -89,7 +92,7 @@ int main(int argc, char ** argv)
     auto proxies = serviceArgs.makeServiceProxies();
     auto serviceName = serviceArgs.serviceName("masterBanker");
 
-    MasterBanker banker(proxies, serviceName);
+    MasterBanker banker(proxies, serviceName, numShards);
     std::shared_ptr<Redis::AsyncConnection> redis;
 
     if (debug)
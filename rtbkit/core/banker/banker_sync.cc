@@ -0,0 +1,138 @@
+/* banker_sync.cc
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Binary messages used to synchronize slave bankers with the master.
+*/
+
+#include "banker_sync.h"
+#include "jml/db/persistent.h"
+#include "jml/db/compact_size_types.h"
+#include "jml/arch/exception.h"
+#include <sstream>
+
+
+using namespace std;
+using namespace ML;
+
+
+namespace RTBKIT {
+
+namespace {
+
+// Leading bytes of each message, to catch an endpoint that's talking
+// to the wrong route or running an incompatible version.
+const unsigned char RequestMagic = 'S';
+const unsigned char ResponseMagic = 'M';
+const unsigned char SyncVersion = 1;
+
+void checkHeader(DB::Store_Reader & store, unsigned char expectedMagic,
+                 const char * what)
+{
+    unsigned char magic, version;
+    store >> magic >> version;
+    if (magic != expectedMagic)
+        throw ML::Exception("%s: not a %s message", what, what);
+    if (version != SyncVersion)
+        throw ML::Exception("%s: unknown version %d", what, (int)version);
+}
+
+} // file scope
+
+
+/*****************************************************************************/
+/* SHADOW SYNC REQUEST                                                       */
+/*****************************************************************************/
+
+std::string
+ShadowSyncRequest::
+serialize() const
+{
+    ostringstream stream;
+    DB::Store_Writer store(stream);
+
+    store << RequestMagic << SyncVersion
+          << session << fullSync << targetBalance
+          << DB::compact_size_t(entries.size());
+
+    for (auto & entry: entries) {
+        store << entry.account << DB::compact_size_t(entry.version)
+              << entry.commitmentsMade << entry.commitmentsRetired
+              << entry.spent << entry.lineItems;
+    }
+
+    return stream.str();
+}
+
+ShadowSyncRequest
+ShadowSyncRequest::
+reconstitute(const std::string & str)
+{
+    DB::Store_Reader store(str.c_str(), str.size());
+    checkHeader(store, RequestMagic, "ShadowSyncRequest");
+
+    ShadowSyncRequest result;
+    store >> result.session >> result.fullSync >> result.targetBalance;
+
+    DB::compact_size_t numEntries(store);
+    result.entries.resize(numEntries);
+
+    for (auto & entry: result.entries) {
+        store >> entry.account;
+        entry.version = DB::compact_size_t(store);
+        store >> entry.commitmentsMade >> entry.commitmentsRetired
+              >> entry.spent >> entry.lineItems;
+    }
+
+    return result;
+}
+
+
+/*****************************************************************************/
+/* SHADOW SYNC RESPONSE                                                      */
+/*****************************************************************************/
+
+std::string
+ShadowSyncResponse::
+serialize() const
+{
+    ostringstream stream;
+    DB::Store_Writer store(stream);
+
+    store << ResponseMagic << SyncVersion
+          << resyncRequired << DB::compact_size_t(entries.size());
+
+    for (auto & entry: entries) {
+        store << entry.account << DB::compact_size_t(entry.version)
+              << entry.netBudget << (unsigned char)entry.status;
+    }
+
+    return stream.str();
+}
+
+ShadowSyncResponse
+ShadowSyncResponse::
+reconstitute(const std::string & str)
+{
+    DB::Store_Reader store(str.c_str(), str.size());
+    checkHeader(store, ResponseMagic, "ShadowSyncResponse");
+
+    ShadowSyncResponse result;
+    store >> result.resyncRequired;
+
+    DB::compact_size_t numEntries(store);
+    result.entries.resize(numEntries);
+
+    for (auto & entry: result.entries) {
+        store >> entry.account;
+        entry.version = DB::compact_size_t(store);
+        store >> entry.netBudget;
+
+        unsigned char status;
+        store >> status;
+        entry.status = (Account::Status)status;
+    }
+
+    return result;
+}
+
+} // namespace RTBKIT
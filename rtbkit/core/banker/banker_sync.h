@@ -0,0 +1,98 @@
+/* banker_sync.h                                                   -*- C++ -*-
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Binary messages used to synchronize slave bankers with the master.
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "rtbkit/common/account_key.h"
+#include "rtbkit/core/banker/account.h"
+
+
+namespace RTBKIT {
+
+
+/*****************************************************************************/
+/* SHADOW SYNC REQUEST                                                       */
+/*****************************************************************************/
+
+/** Message sent periodically by a slave banker to the master banker.  It
+    replaces both the per-account JSON spend reports and the budget
+    reauthorization requests: for each account it carries the slave's
+    spend counters and asks for the account's balance to be topped back up
+    to the given target.
+
+    Only the accounts that have changed since the last acknowledged sync,
+    or that need topping up, are included.  Each account carries a version
+    number that is incremented every time it is sent, which allows the
+    master to detect lost or duplicated messages; when it does, it asks
+    the slave for a full sync in which every account is included.
+*/
+struct ShadowSyncRequest {
+    ShadowSyncRequest()
+        : session(0), fullSync(false)
+    {
+    }
+
+    struct Entry {
+        Entry()
+            : version(0)
+        {
+        }
+
+        AccountKey account;               ///< Full key of the spend account
+        uint64_t version;                 ///< Incremented every time it's sent
+        CurrencyPool commitmentsMade;
+        CurrencyPool commitmentsRetired;
+        CurrencyPool spent;
+        LineItems lineItems;
+    };
+
+    uint64_t session;              ///< Random, chosen once per slave
+    bool fullSync;                 ///< Every account is included
+    CurrencyPool targetBalance;    ///< Balance to top each account up to
+    std::vector<Entry> entries;
+
+    std::string serialize() const;
+    static ShadowSyncRequest reconstitute(const std::string & str);
+};
+
+
+/*****************************************************************************/
+/* SHADOW SYNC RESPONSE                                                      */
+/*****************************************************************************/
+
+/** Reply of the master banker to a ShadowSyncRequest, with the new state
+    of each account that was synchronized.
+*/
+struct ShadowSyncResponse {
+    ShadowSyncResponse()
+        : resyncRequired(false)
+    {
+    }
+
+    struct Entry {
+        Entry()
+            : version(0), status(Account::ACTIVE)
+        {
+        }
+
+        AccountKey account;
+        uint64_t version;           ///< Version of the request entry
+        CurrencyPool netBudget;
+        Account::Status status;
+    };
+
+    /// The master lost track of one of the accounts; the next request needs
+    /// to be a full sync.
+    bool resyncRequired;
+    std::vector<Entry> entries;
+
+    std::string serialize() const;
+    static ShadowSyncResponse reconstitute(const std::string & str);
+};
+
+} // namespace RTBKIT
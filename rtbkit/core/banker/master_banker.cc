@@ -155,6 +155,15 @@ saveAll(const Accounts & toSave, OnSavedCallback onSaved)
         };
     toSave.forEachAccount(onAccount);
 
+    /* MGET needs at least one key */
+    if (keys.empty()) {
+        BankerPersistence::Result saveResult(SUCCESS);
+        saveResult.recordLatency(
+                "totalTimeMs", latencyBetween(begin, Date::now()));
+        onSaved(saveResult, "");
+        return;
+    }
+
     const Date beforePhase1Time = Date::now();
     auto onPhase1Result = [=] (const Redis::Result & result)
         {
@@ -582,24 +591,32 @@ restoreFromArchive(const AccountKey & key, OnRestoredCallback onRestored)
 
 MasterBanker::
 MasterBanker(std::shared_ptr<ServiceProxies> proxies,
-             const string & serviceName)
+             const string & serviceName,
+             int numShards)
     : ServiceBase(serviceName, proxies),
       RestServiceEndpoint(proxies->zmqContext),
-      saving(false)
+      accounts(numShards),
+      lastSaveStatus(BankerPersistence::SUCCESS),
+      saving(0),
+      saveStatus(BankerPersistence::SUCCESS)
 {
     /* Set the Access-Control-Allow-Origins: * header to allow browser-based
        REST calls directly to the endpoint.
     */
     httpEndpoint.allowAllOrigins();
+
+    // The calling thread does its share of the work
+    if (numShards > 1)
+        shardWorkers.reset(new ML::Worker_Task(numShards - 1));
 }
 
 MasterBanker::
 ~MasterBanker()
 {
     saveState();
-    while (saving) {
+    for (int outstanding = saving;  outstanding;  outstanding = saving) {
         cerr << "awaiting end of save operation..." << endl;
-        ML::futex_wait(saving, true);
+        ML::futex_wait(saving, outstanding);
     }
     shutdown();
 }
@@ -682,7 +699,7 @@ init(const shared_ptr<BankerPersistence> & storage, double saveInterval)
                        "List accounts that are in the banker",
                        "List of account names matching the given prefix",
                        [] (const vector<AccountKey> & v) { return jsonEncode(v); },
-                       &Accounts::getAccountKeys,
+                       &ShardedAccounts::getAccountKeys,
                        &accounts,
                        RestParamDefault<AccountKey>
                        ("accountPrefix",
@@ -711,6 +728,27 @@ init(const shared_ptr<BankerPersistence> & storage, double saveInterval)
                        this,
                        JsonParam<Json::Value>("", "list of accounts to update"));
     
+    // Must come before "/shadow", which would match it as a prefix
+    RestRequestRouter::OnProcessRequest shadowSyncRoute
+        = [=] (const RestServiceEndpoint::ConnectionId & connection,
+               const RestRequest & request,
+               const RestRequestParsingContext & context) {
+        try {
+            auto syncRequest = ShadowSyncRequest::reconstitute(request.payload);
+            auto response = syncFromShadowBinary(syncRequest);
+            connection.sendResponse(200, response.serialize(),
+                                    "application/octet-stream");
+        } catch (const std::exception & exc) {
+            connection.sendErrorResponse(400, exc.what());
+            return RestRequestRouter::MR_ERROR;
+        }
+        return RestRequestRouter::MR_YES;
+    };
+    accountsNode.addRoute("/shadowSync", {"PUT", "POST"},
+                          "Binary sync of a slave banker's spend accounts and "
+                          "reauthorization of their budget",
+                          shadowSyncRoute, Json::Value());
+
     addRouteSyncReturn(accountsNode,
                        "/shadow",
                        {"PUT", "POST"},
@@ -733,7 +771,7 @@ init(const shared_ptr<BankerPersistence> & storage, double saveInterval)
                        "Return a representation of the given account",
                        "Representation of the named account",
                        [] (const Account & account) { return account.toJson(); },
-                       &Accounts::getAccount,
+                       &ShardedAccounts::getAccount,
                        &accounts,
                        accountKeyParam);
 
@@ -744,7 +782,7 @@ init(const shared_ptr<BankerPersistence> & storage, double saveInterval)
                        "children",
                        "Representation of the given subtree",
                        [] (const Accounts & subtree) { return subtree.toJson(); },
-                       &Accounts::getAccounts,
+                       &ShardedAccounts::getAccounts,
                        &accounts,
                        accountKeyParam,
                        RestParamDefault<int>("depth", "depth of children (default = 0)", 0));
@@ -755,7 +793,7 @@ init(const shared_ptr<BankerPersistence> & storage, double saveInterval)
                        "Return a list of the children of a given account",
                        "Array of names of child accounts",
                        [] (const vector<AccountKey> & keys) { return jsonEncode(keys); },
-                       &Accounts::getAccountKeys,
+                       &ShardedAccounts::getAccountKeys,
                        &accounts,
                        accountKeyParam,
                        RestParamDefault<int>("depth", "depth of children (default = 0)", 0));
@@ -802,7 +840,7 @@ init(const shared_ptr<BankerPersistence> & storage, double saveInterval)
                        "Return the aggregated summary of the given account",
                        "AccountSummary: aggregation of the given account and its children",
                        [] (const AccountSummary & s) { return s.toJson(); },
-                       &Accounts::getAccountSummary,
+                       &ShardedAccounts::getAccountSummary,
                        &accounts,
                        accountKeyParam,
                        RestParamDefault<int>("maxDepth", "maximum depth to traverse", 3));
@@ -941,14 +979,21 @@ onStateSaved(const BankerPersistence::Result& result,
     }
 
     lastSaveInfo = std::move(info);
-    lastSaveStatus = result.status;
+    if (result.status != BankerPersistence::SUCCESS)
+        saveStatus = result.status;
 
     reportLatencies("save state", result.latencies);
     lastSaveLatency = std::move(result.latencies);
 
     reportLatencies("save state", result.latencies);
-    saving = false;
-    ML::futex_wake(saving);
+
+    // Once the last shard is saved, any failure fails the whole save
+    if (__sync_sub_and_fetch(&saving, 1) <= 0) {
+        lastSaveStatus = saveStatus;
+        saveStatus = BankerPersistence::SUCCESS;
+        saving = 0;
+        ML::futex_wake(saving);
+    }
 }
 
 void
@@ -962,10 +1007,21 @@ saveState()
     if (!storage_ || saving)
         return;
 
-    saving = true;
-    storage_->saveAll(accounts, bind(&MasterBanker::onStateSaved, this,
-                                          placeholders::_1,
-                                          placeholders::_2));
+    // Each shard is saved independently; the saves are all outstanding at
+    // once.  Shards without any accounts have nothing to save, and the
+    // persistence may not accept an empty save.
+    vector<size_t> toSave;
+    for (size_t i = 0;  i < accounts.numShards();  ++i)
+        if (!accounts.shard(i).empty())
+            toSave.push_back(i);
+
+    saving = toSave.size();
+    for (size_t i: toSave) {
+        storage_->saveAll(accounts.shard(i),
+                          bind(&MasterBanker::onStateSaved, this,
+                               placeholders::_1,
+                               placeholders::_2));
+    }
 }
 
 void
@@ -1081,6 +1137,29 @@ private:
     Date start;
 };
 
+/** Split the given account keys by the shard that owns them. */
+std::vector<std::vector<std::string> >
+partitionByShard(const ShardedAccounts & accounts,
+                 const std::vector<std::string> & keys)
+{
+    std::vector<std::vector<std::string> > result(accounts.numShards());
+    for (auto & key: keys)
+        result[accounts.shardIndex(AccountKey(key))].push_back(key);
+    return result;
+}
+
+std::map<std::string, Account>
+mergeShardResults(std::vector<std::map<std::string, Account> > & results)
+{
+    std::map<std::string, Account> result;
+    for (auto & r: results) {
+        if (result.empty())
+            result.swap(r);
+        else result.insert(r.begin(), r.end());
+    }
+    return result;
+}
+
 } // namespace anonymous
 
 void
@@ -1211,23 +1290,27 @@ setBalanceBatched(const Json::Value &transfers)
     Record record(this, "setBalanceBatched");
     checkPersistence();
 
-    std::map<std::string, Account> result;
-    for (const auto& key : transfers.getMemberNames()) {
-        AccountKey account(key);
-        const auto& body = transfers[key];
+    auto keys = partitionByShard(accounts, transfers.getMemberNames());
+    std::vector<std::map<std::string, Account> > results(keys.size());
 
-        ExcCheck(body.isMember("amount"), "missing ammount for account " + key);
-        auto amount = CurrencyPool::fromJson(body["amount"]);
+    forEachShard([&] (size_t shard) {
+            for (const auto& key : keys[shard]) {
+                AccountKey account(key);
+                const auto& body = transfers[key];
 
-        auto type = AT_NONE;
-        if (body.isMember("accountType"))
-            type = AccountTypeFromString(body["accountType"].asString());
+                ExcCheck(body.isMember("amount"), "missing ammount for account " + key);
+                auto amount = CurrencyPool::fromJson(body["amount"]);
 
-        reactivatePresentAccounts(key);
-        result[key] = accounts.setBalance(account, amount, type);
-    }
+                auto type = AT_NONE;
+                if (body.isMember("accountType"))
+                    type = AccountTypeFromString(body["accountType"].asString());
+
+                reactivatePresentAccounts(key);
+                results[shard][key] = accounts.setBalance(account, amount, type);
+            }
+        });
 
-    return std::move(result);
+    return mergeShardResults(results);
 }
 
 const Account
@@ -1264,25 +1347,122 @@ syncFromShadowBatched(const Json::Value &transfers)
     Record record(this, "syncFromShadow");
     checkPersistence();
 
-    std::map<std::string, Account> result;
-    for (const auto& key : transfers.getMemberNames()) {
-        AccountKey account(key);
-        const auto& body = transfers[key];
+    auto keys = partitionByShard(accounts, transfers.getMemberNames());
+    std::vector<std::map<std::string, Account> > results(keys.size());
 
-        ExcCheck(body.isMember("shadow"), "missing shadow for account " + key);
-        auto shadow = ShadowAccount::fromJson(body["shadow"]);
+    forEachShard([&] (size_t shard) {
+            for (const auto& key : keys[shard]) {
+                AccountKey account(key);
+                const auto& body = transfers[key];
 
-        pair<bool, bool> presentActive = accounts.accountPresentAndActive(key);
+                ExcCheck(body.isMember("shadow"), "missing shadow for account " + key);
+                auto shadow = ShadowAccount::fromJson(body["shadow"]);
 
-        if (presentActive.first && !presentActive.second) {
-            result[key] = accounts.getAccount(account);
-        }
-        else {
-            result[key] = accounts.syncFromShadow(account, shadow);
+                pair<bool, bool> presentActive = accounts.accountPresentAndActive(key);
+
+                if (presentActive.first && !presentActive.second) {
+                    results[shard][key] = accounts.getAccount(account);
+                }
+                else {
+                    results[shard][key] = accounts.syncFromShadow(account, shadow);
+                }
+            }
+        });
+
+    return mergeShardResults(results);
+}
+
+ShadowSyncResponse
+MasterBanker::
+syncFromShadowBinary(const ShadowSyncRequest & request)
+{
+    Record record(this, "syncFromShadowBinary");
+    checkPersistence();
+
+    ShadowSyncResponse response;
+    response.entries.resize(request.entries.size());
+
+    std::vector<std::vector<size_t> > entriesByShard(accounts.numShards());
+    for (size_t i = 0;  i < request.entries.size();  ++i) {
+        size_t shard = accounts.shardIndex(request.entries[i].account);
+        entriesByShard[shard].push_back(i);
+    }
+
+    // Decide which entries to apply.  Spend counters are cumulative, so
+    // applying an entry is idempotent as long as it is newer than the last
+    // one applied.
+    std::vector<bool> apply(request.entries.size(), true);
+    {
+        std::unique_lock<std::mutex> guard(shadowSyncLock);
+
+        for (size_t i = 0;  i < request.entries.size();  ++i) {
+            auto & entry = request.entries[i];
+            ShadowSyncState & state = shadowSyncStates[entry.account];
+
+            if (state.session != request.session) {
+                // Either the slave or we restarted; unless the slave is
+                // sending everything, accounts it didn't include may be out
+                // of date.
+                if (!request.fullSync)
+                    response.resyncRequired = true;
+                state.session = request.session;
+            }
+            else if (entry.version <= state.version)
+                apply[i] = false;
+
+            if (apply[i])
+                state.version = entry.version;
         }
     }
 
-    return result;
+    forEachShard([&] (size_t shard) {
+            for (size_t i: entriesByShard[shard]) {
+                auto & entry = request.entries[i];
+
+                Account account;
+                pair<bool, bool> presentActive
+                    = accounts.accountPresentAndActive(entry.account);
+                if (presentActive.first && !presentActive.second) {
+                    // closed; leave it alone
+                    account = accounts.getAccount(entry.account);
+                }
+                else if (apply[i]) {
+                    ShadowAccount shadow;
+                    shadow.commitmentsMade = entry.commitmentsMade;
+                    shadow.commitmentsRetired = entry.commitmentsRetired;
+                    shadow.spent = entry.spent;
+                    shadow.lineItems = entry.lineItems;
+                    accounts.syncFromShadow(entry.account, shadow);
+
+                    account = accounts.setBalance(entry.account,
+                                                  request.targetBalance,
+                                                  AT_SPEND);
+                }
+                else account = accounts.getAccount(entry.account);
+
+                auto & result = response.entries[i];
+                result.account = entry.account;
+                result.version = entry.version;
+                result.netBudget = account.getNetBudget();
+                result.status = account.status;
+            }
+        });
+
+    return response;
+}
+
+void
+MasterBanker::
+forEachShard(const std::function<void (size_t)> & onShard)
+{
+    if (!shardWorkers) {
+        for (size_t i = 0;  i < accounts.numShards();  ++i)
+            onShard(i);
+        return;
+    }
+
+    ML::run_in_parallel(size_t(0), accounts.numShards(), onShard,
+                        -1, "accountShards", "shard", *shardWorkers);
 }
 
 void
@@ -9,6 +9,8 @@
 #define __banker__master_banker_h__
 
 #include "banker.h"
+#include "banker_sync.h"
+#include "sharded_accounts.h"
 #include "soa/service/named_endpoint.h"
 #include "soa/service/message_loop.h"
 #include "soa/service/redis.h"
@@ -16,7 +18,9 @@
 #include "soa/service/rest_request_router.h"
 #include "jml/utils/vector_utils.h"
 #include "jml/utils/positioned_types.h"
+#include "jml/utils/worker_task.h"
 #include <type_traits>
+#include <mutex>
 #include "rtbkit/core/monitor/monitor_provider.h"
 
 #include "null_banker.h"  // debug
@@ -286,8 +290,13 @@ struct MasterBanker
       public RestServiceEndpoint
 {
 
+    /** The accounts are split into numShards independent shards by top
+        level account.  Batched requests are processed on all of the shards
+        in parallel, using numShards threads.
+    */
     MasterBanker(std::shared_ptr<ServiceProxies> proxies,
-                 const std::string & serviceName = "masterBanker");
+                 const std::string & serviceName = "masterBanker",
+                 int numShards = 1);
     ~MasterBanker();
 
     std::shared_ptr<BankerPersistence> storage_;
@@ -309,7 +318,7 @@ struct MasterBanker
     void bindFixedHttpAddress(const std::string & uri);
 
     RestRequestRouter router;
-    Accounts accounts;
+    ShardedAccounts accounts;
 
     Date lastSavedState;
     BankerPersistence::LatencyMap lastSaveLatency;
@@ -319,7 +328,8 @@ struct MasterBanker
     typedef ML::Spinlock Lock;
     typedef std::unique_lock<Lock> Guard;
     mutable Lock saveLock;
-    int saving;
+    int saving;     ///< Number of shards being saved
+    BankerPersistence::PersistenceCallbackStatus saveStatus;
 
     Json::Value createAccount(const AccountKey & key, AccountType type);
     Json::Value getAccountsSimpleSummaries(int depth);
@@ -341,6 +351,17 @@ struct MasterBanker
                            const BankerPersistence::Result& result,
                            const std::string & info);
 
+    /** Apply a binary sync from a slave banker: record the spend of each
+        account in the request, top its balance back up to the target and
+        return its new state.
+
+        Entries that are older than one already applied for the same account
+        are ignored.  If we have no record of an account for the slave's
+        session (because either one of us restarted), a full sync is
+        requested.
+    */
+    ShadowSyncResponse syncFromShadowBinary(const ShadowSyncRequest & request);
+
     Date lastWin;
     Date lastImpression;
 
@@ -367,6 +388,26 @@ private:
     void reactivatePresentAccounts(const AccountKey & key);
 
     void checkPersistence();
+
+    /** Call onShard for the index of every shard, in parallel, and return
+        once they're all done.
+    */
+    void forEachShard(const std::function<void (size_t)> & onShard);
+    std::unique_ptr<ML::Worker_Task> shardWorkers;
+
+    /// Last binary sync applied to each spend account
+    struct ShadowSyncState {
+        ShadowSyncState()
+            : session(0), version(0)
+        {
+        }
+
+        uint64_t session;
+        uint64_t version;
+    };
+
+    std::mutex shadowSyncLock;
+    std::map<AccountKey, ShadowSyncState> shadowSyncStates;
 };
 
 } // namespace RTBKIT
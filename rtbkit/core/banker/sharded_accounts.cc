@@ -0,0 +1,149 @@
+/* sharded_accounts.cc
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Accounts partitioned by top level account.
+*/
+
+#include "sharded_accounts.h"
+#include "jml/utils/exc_check.h"
+#include <algorithm>
+#include <functional>
+
+
+using namespace std;
+
+
+namespace RTBKIT {
+
+
+/*****************************************************************************/
+/* SHARDED ACCOUNTS                                                          */
+/*****************************************************************************/
+
+ShardedAccounts::
+ShardedAccounts(int numShards)
+{
+    ExcCheckGreater(numShards, 0, "need at least one account shard");
+    for (int i = 0;  i < numShards;  ++i)
+        shards.emplace_back(new Accounts());
+}
+
+ShardedAccounts &
+ShardedAccounts::
+operator = (const Accounts & accounts)
+{
+    std::vector<Accounts> newShards(shards.size());
+
+    {
+        Accounts::Guard guard(accounts.lock);
+
+        for (auto & a: accounts.accounts)
+            newShards[shardIndex(a.first)].accounts.insert(a);
+        for (auto & key: accounts.outOfSyncAccounts)
+            newShards[shardIndex(key)].outOfSyncAccounts.insert(key);
+        for (auto & key: accounts.inconsistentAccounts)
+            newShards[shardIndex(key)].inconsistentAccounts.insert(key);
+    }
+
+    for (unsigned i = 0;  i < shards.size();  ++i) {
+        newShards[i].sessionStart = accounts.sessionStart;
+        *shards[i] = std::move(newShards[i]);
+    }
+
+    return *this;
+}
+
+size_t
+ShardedAccounts::
+shardIndex(const AccountKey & account) const
+{
+    if (shards.size() == 1 || account.empty())
+        return 0;
+    return std::hash<std::string>()(account.front()) % shards.size();
+}
+
+Accounts
+ShardedAccounts::
+snapshot() const
+{
+    Accounts result;
+
+    // Always locked in the same order, so this can't deadlock
+    std::vector<Accounts::Guard> guards;
+    for (auto & s: shards)
+        guards.emplace_back(s->lock);
+
+    result.sessionStart = shards[0]->sessionStart;
+    for (auto & s: shards) {
+        result.accounts.insert(s->accounts.begin(), s->accounts.end());
+        result.outOfSyncAccounts.insert(s->outOfSyncAccounts.begin(),
+                                        s->outOfSyncAccounts.end());
+        result.inconsistentAccounts.insert(s->inconsistentAccounts.begin(),
+                                           s->inconsistentAccounts.end());
+    }
+
+    return result;
+}
+
+std::vector<AccountKey>
+ShardedAccounts::
+getAccountKeys(const AccountKey & prefix, int maxDepth) const
+{
+    if (!prefix.empty())
+        return shardFor(prefix).getAccountKeys(prefix, maxDepth);
+
+    std::vector<AccountKey> result;
+    for (auto & s: shards) {
+        auto keys = s->getAccountKeys(prefix, maxDepth);
+        result.insert(result.end(), keys.begin(), keys.end());
+    }
+
+    // Keep them in the same order as a single Accounts would
+    if (shards.size() > 1)
+        std::sort(result.begin(), result.end());
+
+    return result;
+}
+
+void
+ShardedAccounts::
+forEachAccount(const std::function<void (const AccountKey &,
+                                         const Account &)> & onAccount) const
+{
+    for (auto & s: shards)
+        s->forEachAccount(onAccount);
+}
+
+Json::Value
+ShardedAccounts::
+getAccountSummariesJson(bool simplified, int maxDepth) const
+{
+    // Summaries only aggregate within a tree, which is always in one shard
+    Json::Value result;
+    for (auto & s: shards) {
+        Json::Value summaries = s->getAccountSummariesJson(simplified, maxDepth);
+        for (auto it = summaries.begin(), end = summaries.end();
+             it != end;  ++it)
+            result[it.memberName()] = *it;
+    }
+    return result;
+}
+
+Json::Value
+ShardedAccounts::
+toJson() const
+{
+    return snapshot().toJson();
+}
+
+size_t
+ShardedAccounts::
+size() const
+{
+    size_t result = 0;
+    for (auto & s: shards)
+        result += s->size();
+    return result;
+}
+
+} // namespace RTBKIT
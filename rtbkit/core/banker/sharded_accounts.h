@@ -0,0 +1,209 @@
+/* sharded_accounts.h                                              -*- C++ -*-
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Accounts partitioned by top level account.
+*/
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "account.h"
+
+
+namespace RTBKIT {
+
+
+/*****************************************************************************/
+/* SHARDED ACCOUNTS                                                          */
+/*****************************************************************************/
+
+/** Set of accounts split into a number of independent Accounts objects, each
+    with its own lock, by hash of the top level account.
+
+    Every operation that Accounts supports only involves one account and its
+    parents or children, which are all in the same tree, so they are
+    forwarded to the shard that owns the tree.  Operations on different
+    shards can therefore run in parallel on different threads.
+
+    Operations over all of the accounts visit the shards one after the
+    other; those which need a consistent view of the whole set use
+    snapshot(), which holds all of the locks while it copies.
+*/
+struct ShardedAccounts {
+
+    ShardedAccounts(int numShards = 1);
+
+    /** Replace the contents with those of the given accounts, distributed
+        over the shards.  Not thread safe.
+    */
+    ShardedAccounts & operator = (const Accounts & accounts);
+
+    size_t numShards() const
+    {
+        return shards.size();
+    }
+
+    /** Return the index of the shard that owns the given account. */
+    size_t shardIndex(const AccountKey & account) const;
+
+    Accounts & shard(size_t index)
+    {
+        return *shards.at(index);
+    }
+
+    const Accounts & shard(size_t index) const
+    {
+        return *shards.at(index);
+    }
+
+    Accounts & shardFor(const AccountKey & account)
+    {
+        return *shards[shardIndex(account)];
+    }
+
+    const Accounts & shardFor(const AccountKey & account) const
+    {
+        return *shards[shardIndex(account)];
+    }
+
+    /** Return a copy of all of the accounts, taken while all of the shards
+        are locked.
+    */
+    Accounts snapshot() const;
+
+    /*************************************************************************/
+    /* SINGLE TREE OPERATIONS                                                */
+    /*************************************************************************/
+
+    const Account createAccount(const AccountKey & account, AccountType type)
+    {
+        return shardFor(account).createAccount(account, type);
+    }
+
+    const Account createBudgetAccount(const AccountKey & account)
+    {
+        return shardFor(account).createBudgetAccount(account);
+    }
+
+    const Account createSpendAccount(const AccountKey & account)
+    {
+        return shardFor(account).createSpendAccount(account);
+    }
+
+    void restoreAccount(const AccountKey & account,
+                        const Json::Value & jsonValue,
+                        bool overwrite = false)
+    {
+        shardFor(account).restoreAccount(account, jsonValue, overwrite);
+    }
+
+    void reactivateAccount(const AccountKey & account)
+    {
+        shardFor(account).reactivateAccount(account);
+    }
+
+    const Accounts::AccountInfo getAccount(const AccountKey & account) const
+    {
+        return shardFor(account).getAccount(account);
+    }
+
+    std::pair<bool, bool>
+    accountPresentAndActive(const AccountKey & account) const
+    {
+        return shardFor(account).accountPresentAndActive(account);
+    }
+
+    const Account closeAccount(const AccountKey & account)
+    {
+        return shardFor(account).closeAccount(account);
+    }
+
+    const Account setBudget(const AccountKey & topLevelAccount,
+                            const CurrencyPool & newBudget)
+    {
+        return shardFor(topLevelAccount).setBudget(topLevelAccount, newBudget);
+    }
+
+    const Account setBalance(const AccountKey & account,
+                             CurrencyPool amount,
+                             AccountType typeToCreate)
+    {
+        return shardFor(account).setBalance(account, amount, typeToCreate);
+    }
+
+    const CurrencyPool getBalance(const AccountKey & account) const
+    {
+        return shardFor(account).getBalance(account);
+    }
+
+    const Account addAdjustment(const AccountKey & account,
+                                CurrencyPool amount)
+    {
+        return shardFor(account).addAdjustment(account, amount);
+    }
+
+    AccountSummary getAccountSummary(const AccountKey & account,
+                                     int maxDepth = -1) const
+    {
+        return shardFor(account).getAccountSummary(account, maxDepth);
+    }
+
+    const Account syncFromShadow(const AccountKey & account,
+                                 const ShadowAccount & shadow)
+    {
+        return shardFor(account).syncFromShadow(account, shadow);
+    }
+
+    void markAccountOutOfSync(const AccountKey & account)
+    {
+        shardFor(account).markAccountOutOfSync(account);
+    }
+
+    bool isAccountOutOfSync(const AccountKey & account) const
+    {
+        return shardFor(account).isAccountOutOfSync(account);
+    }
+
+    const Account importSpend(const AccountKey & account,
+                              const CurrencyPool & amount)
+    {
+        return shardFor(account).importSpend(account, amount);
+    }
+
+    /** Return a subtree of the accounts. */
+    Accounts getAccounts(const AccountKey & root, int maxDepth = 0)
+    {
+        return shardFor(root).getAccounts(root, maxDepth);
+    }
+
+    /*************************************************************************/
+    /* OPERATIONS OVER ALL ACCOUNTS                                          */
+    /*************************************************************************/
+
+    std::vector<AccountKey>
+    getAccountKeys(const AccountKey & prefix = AccountKey(),
+                   int maxDepth = -1) const;
+
+    void
+    forEachAccount(const std::function<void (const AccountKey &,
+                                             const Account &)>
+                   & onAccount) const;
+
+    Json::Value
+    getAccountSummariesJson(bool simplified = false, int maxDepth = -1) const;
+
+    Json::Value toJson() const;
+
+    size_t size() const;
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+private:
+    std::vector<std::unique_ptr<Accounts> > shards;
+};
+
+} // namespace RTBKIT
@@ -7,6 +7,8 @@
 
 #include "slave_banker.h"
 #include "jml/utils/vector_utils.h"
+#include "jml/utils/exc_check.h"
+#include <random>
 
 using namespace std;
 using namespace Datacratic;
@@ -28,6 +30,17 @@ namespace  {
         }
     }
 
+    /** Identifies this instance of the slave banker to the master, so that
+        it can tell when we restart.  Never zero.
+    */
+    uint64_t newSyncSession()
+    {
+        std::random_device device;
+        uint64_t result = device();
+        result = (result << 32) ^ device();
+        return result ? result : 1;
+    }
+
 } // namespace
 namespace RTBKIT {
 
@@ -119,7 +132,9 @@ Logging::Category SlaveBanker::error("SlaveBanker Error", SlaveBanker::print);
 Logging::Category SlaveBanker::trace("SlaveBanker Trace", SlaveBanker::print);
 
 SlaveBanker::SlaveBanker()
-    : createdAccounts(128), reauthorizing(false), numReauthorized(0)
+    : createdAccounts(128),
+      binarySync(false), session(newSyncSession()), needFullSync(true),
+      reauthorizing(false), numReauthorized(0)
 {
 }
 
@@ -129,7 +144,9 @@ SlaveBanker(
         CurrencyPool spendRate,
         double syncRate,
         bool batchedUpdates)
-    : createdAccounts(128), reauthorizing(false), numReauthorized(0)
+    : createdAccounts(128),
+      binarySync(false), session(newSyncSession()), needFullSync(true),
+      reauthorizing(false), numReauthorized(0)
 {
     init(accountSuffix, spendRate, syncRate, batchedUpdates);
 }
@@ -448,6 +465,11 @@ reportSpend(uint64_t numTimeoutsExpired)
              << " timeouts" << endl;
     }
 
+    if (binarySync) {
+        reportSpendBinary();
+        return;
+    }
+
     if (reportSpendSent != Date())
         cerr << "warning: report spend still in progress" << endl;
 
@@ -468,6 +490,9 @@ void
 SlaveBanker::
 reauthorizeBudgetBatched(uint64_t numTimeoutsExpired)
 {
+    if (binarySync)
+        return;  // done by reportSpendBinary
+
     Json::Value body;
     body["amount"] = spendRate.toJson();
     body["accountType"] = "spend";
@@ -522,6 +547,9 @@ reauthorizeBudget(uint64_t numTimeoutsExpired)
              << " timeouts" << endl;
     }
 
+    if (binarySync)
+        return;  // done by reportSpendBinary
+
     //std::unique_lock<Lock> guard(lock);
     if (reauthorizing) {
         cerr << "warning: reauthorize budget still in progress" << endl;
@@ -595,6 +623,144 @@ onReauthorizeBudgetMessage(const AccountKey & accountKey,
     }
 }
 
+void
+SlaveBanker::
+reportSpendBinary()
+{
+    if (reauthorizing) {
+        cerr << "warning: shadow sync still in progress" << endl;
+        return;
+    }
+
+    // Accounts whose initialization got lost are retried, as in syncAll
+    for (auto & key: accounts.getAccountKeys()) {
+        if (!accounts.isInitialized(key) && accounts.isStalled(key)) {
+            LOG(bankerDebug) << "CRITICAL:" << key << std::endl;
+            accounts.reinitializeStalledAccount(key);
+            createdAccounts.push(key);
+        }
+    }
+
+    auto request = std::make_shared<ShadowSyncRequest>();
+    request->session = session;
+    request->targetBalance = spendRate;
+
+    {
+        std::lock_guard<Lock> guard(shadowSyncLock);
+        request->fullSync = needFullSync;
+
+        // Send the accounts that have spent since the master last heard
+        // from us, or that it couldn't top up last time.
+        auto onAccount = [&] (const AccountKey & key,
+                              const ShadowAccount & account)
+            {
+                SyncState & state = syncStates[key];
+                bool changed = account.commitmentsMade != state.commitmentsMade
+                    || account.commitmentsRetired != state.commitmentsRetired
+                    || account.spent != state.spent;
+                if (!changed && state.toppedUp && !request->fullSync)
+                    return;
+
+                ShadowSyncRequest::Entry entry;
+                entry.account = key.childKey(accountSuffix);
+                entry.version = ++state.version;
+                entry.commitmentsMade = account.commitmentsMade;
+                entry.commitmentsRetired = account.commitmentsRetired;
+                entry.spent = account.spent;
+                entry.lineItems = account.lineItems;
+                request->entries.push_back(std::move(entry));
+            };
+        accounts.forEachInitializedAndActiveAccount(onAccount);
+
+        if (request->entries.empty()) {
+            needFullSync = false;
+
+            std::lock_guard<Lock> guard(syncLock);
+            lastSync = lastReauthorize = Date::now();
+            return;
+        }
+    }
+
+    reauthorizing = true;
+    reauthorizeDate = Date::now();
+
+    using std::placeholders::_1;
+    using std::placeholders::_2;
+    using std::placeholders::_3;
+    applicationLayer->request("POST", "/v1/accounts/shadowSync", {},
+                              request->serialize(),
+                              std::bind(&SlaveBanker::onShadowSyncResponse,
+                                        this, request, _1, _2, _3));
+}
+
+void
+SlaveBanker::
+onShadowSyncResponse(std::shared_ptr<ShadowSyncRequest> request,
+                     std::exception_ptr exc, int code,
+                     const std::string & payload)
+{
+    // Accounts that weren't acknowledged still differ from their last
+    // acknowledged state, so they will be sent again next time.
+    try {
+        if (exc)
+            std::rethrow_exception(exc);
+
+        if (code != Default::ExpectedMasterHttpCode)
+            throw ML::Exception("expected HTTP %d, got %d: %s",
+                                Default::ExpectedMasterHttpCode, code,
+                                payload.c_str());
+
+        auto response = ShadowSyncResponse::reconstitute(payload);
+        ExcCheckEqual(response.entries.size(), request->entries.size(),
+                      "wrong number of accounts in shadow sync response");
+
+        std::lock_guard<Lock> guard(shadowSyncLock);
+
+        if (response.resyncRequired)
+            needFullSync = true;
+        else if (request->fullSync)
+            needFullSync = false;
+
+        for (unsigned i = 0;  i < response.entries.size();  ++i) {
+            const auto & sent = request->entries[i];
+            const auto & result = response.entries[i];
+            ExcCheckEqual(sent.account, result.account,
+                          "shadow sync response out of order");
+
+            AccountKey key = result.account.parent();
+            SyncState & state = syncStates[key];
+            if (state.version != result.version)
+                continue;  // sent again since
+
+            state.commitmentsMade = sent.commitmentsMade;
+            state.commitmentsRetired = sent.commitmentsRetired;
+            state.spent = sent.spent;
+
+            CurrencyPool masterBalance
+                = result.netBudget + sent.commitmentsRetired
+                - sent.commitmentsMade - sent.spent;
+            state.toppedUp = masterBalance == request->targetBalance;
+
+            accounts.syncFromMaster(key, result.netBudget, result.status);
+        }
+
+        Date now = Date::now();
+        lastReauthorizeDelay = now - reauthorizeDate;
+        numReauthorized++;
+
+        std::lock_guard<Lock> syncGuard(syncLock);
+        lastSync = lastReauthorize = now;
+    } catch (const std::exception & e) {
+        LOG(error) << "Error when syncing with the master banker: "
+                   << e.what() << std::endl;
+    } catch (...) {
+        LOG(error) << "Unknown error when syncing with the master banker"
+                   << std::endl;
+    }
+
+    reauthorizing = false;
+}
+
 void
 SlaveBanker::
 waitReauthorized()
@@ -630,6 +796,7 @@ getProviderIndicators() const
 
 constexpr bool SlaveBankerArguments::Defaults::UseHttp;
 constexpr bool SlaveBankerArguments::Defaults::Batched;
+constexpr bool SlaveBankerArguments::Defaults::BinarySync;
 constexpr int SlaveBankerArguments::Defaults::HttpConnections;
 constexpr bool SlaveBankerArguments::Defaults::TcpNoDelay;
 const std::string SlaveBankerArguments::Defaults::SpendRate{"100000USD/1M"};
@@ -638,6 +805,7 @@ SlaveBankerArguments::SlaveBankerArguments()
     : spendRate(Defaults::SpendRate)
     , syncRate(Defaults::SyncRate)
     , batched(Defaults::Batched)
+    , binarySync(Defaults::BinarySync)
     , useHttp(Defaults::UseHttp)
     , httpTimeout(Defaults::HttpTimeout)
     , httpConnections(0)
@@ -664,6 +832,9 @@ SlaveBankerArguments::makeProgramOptions(std::string title)
          "frequency at which the slave banker syncs itself with the master banker.")
         ("banker-batched", po::bool_switch(&batched),
          "slave banker now uses batched communication to sync with the master banker.")
+        ("banker-binary-sync", po::bool_switch(&binarySync),
+         "slave banker syncs with the master banker using a single binary message "
+         "that only contains the accounts that changed.")
         ("use-http-banker", po::bool_switch(&useHttp),
          "Communicate with the MasterBanker over http")
         ("banker-http-timeouts", po::value<double>(&httpTimeout),
@@ -688,6 +859,7 @@ makeBanker(std::shared_ptr<ServiceProxies> proxies, const std::string& accountSu
 {
     auto spendRate = CurrencyPool(Amount::parse(this->spendRate));
     auto banker = std::make_shared<SlaveBanker>(accountSuffix, spendRate, syncRate, batched);
+    banker->setBinarySync(binarySync);
 
     banker->setApplicationLayer(makeApplicationLayer(std::move(proxies)));
     return banker;
@@ -11,6 +11,7 @@
 #include <atomic>
 #include "banker.h"
 #include "application_layer.h"
+#include "banker_sync.h"
 #include "soa/service/zmq_endpoint.h"
 #include "soa/service/typed_message_channel.h"
 #include "soa/service/logs.h"
@@ -213,6 +214,16 @@ struct SlaveBanker : public Banker, public MessageLoop {
         addSource("SlaveBanker::ApplicationLayer", *layer);
     }
 
+    /** Report spend and reauthorize budget with a single binary message
+        per period that only includes the accounts that need it, rather
+        than one JSON message per account for each.  The master banker
+        must support the /v1/accounts/shadowSync route.
+    */
+    void setBinarySync(bool enabled)
+    {
+        binarySync = enabled;
+    }
+
     bool isReauthorizing() const
     {
         return reauthorizing;
@@ -303,6 +314,34 @@ private:
     void onReauthorizeBudgetBatchedResponse(
             std::exception_ptr exc, int code, const std::string& payload);
 
+    /** Binary sync, which replaces both reportSpend and reauthorizeBudget
+        when enabled.
+    */
+    void reportSpendBinary();
+    void onShadowSyncResponse(std::shared_ptr<ShadowSyncRequest> request,
+                              std::exception_ptr exc, int code,
+                              const std::string & payload);
+
+    /// State of an account as last acknowledged by the master banker
+    struct SyncState {
+        SyncState()
+            : version(0), toppedUp(false)
+        {
+        }
+
+        uint64_t version;
+        CurrencyPool commitmentsMade;
+        CurrencyPool commitmentsRetired;
+        CurrencyPool spent;
+        bool toppedUp;   ///< Master's balance was at the spend rate
+    };
+
+    std::atomic<bool> binarySync;
+    uint64_t session;
+    mutable Lock shadowSyncLock;
+    std::map<AccountKey, SyncState> syncStates;
+    bool needFullSync;
+
     std::atomic<bool> shutdown_;
     std::atomic<bool> reauthorizing;
     Date reauthorizeDate;
@@ -325,6 +364,7 @@ public:
         static const std::string SpendRate;
         static constexpr double SyncRate = 1.0;
         static constexpr bool Batched = false;
+        static constexpr bool BinarySync = false;
 
         static constexpr bool UseHttp = false;
         static constexpr int HttpConnections = 1 << 3;
@@ -358,6 +398,7 @@ private:
     std::string spendRate;
     double syncRate;
     bool batched;
+    bool binarySync;
 
     bool useHttp;
     double httpTimeout;
@@ -0,0 +1,149 @@
+/* banker_sync_test.cc
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Tests for the binary sync between slave and master bankers.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <memory>
+#include <boost/test/unit_test.hpp>
+
+#include "soa/service/service_base.h"
+#include "rtbkit/core/banker/banker_sync.h"
+#include "rtbkit/core/banker/master_banker.h"
+
+using namespace std;
+using namespace Datacratic;
+using namespace RTBKIT;
+
+namespace {
+
+ShadowSyncRequest::Entry
+makeEntry(const AccountKey & account, uint64_t version,
+          Amount made, Amount retired, Amount spent)
+{
+    ShadowSyncRequest::Entry entry;
+    entry.account = account;
+    entry.version = version;
+    entry.commitmentsMade = made;
+    entry.commitmentsRetired = retired;
+    entry.spent = spent;
+    return entry;
+}
+
+} // file scope
+
+BOOST_AUTO_TEST_CASE( test_shadow_sync_serialization )
+{
+    ShadowSyncRequest request;
+    request.session = 0x123456789abcdefULL;
+    request.fullSync = true;
+    request.targetBalance = USD(0.10);
+    request.entries.push_back(makeEntry(AccountKey("campaign:strategy:slave"),
+                                        1000000, USD(2), USD(1.5), USD(0.5)));
+    request.entries.back().lineItems.entries["item"] = USD(0.5);
+    request.entries.push_back(makeEntry(AccountKey("other:slave"), 1,
+                                        USD(0), USD(0), USD(0)));
+
+    auto request2 = ShadowSyncRequest::reconstitute(request.serialize());
+    BOOST_CHECK_EQUAL(request2.session, request.session);
+    BOOST_CHECK_EQUAL(request2.fullSync, true);
+    BOOST_CHECK_EQUAL(request2.targetBalance, USD(0.10));
+    BOOST_REQUIRE_EQUAL(request2.entries.size(), 2);
+    for (unsigned i = 0;  i < 2;  ++i) {
+        auto & e1 = request.entries[i];
+        auto & e2 = request2.entries[i];
+        BOOST_CHECK_EQUAL(e2.account, e1.account);
+        BOOST_CHECK_EQUAL(e2.version, e1.version);
+        BOOST_CHECK_EQUAL(e2.commitmentsMade, e1.commitmentsMade);
+        BOOST_CHECK_EQUAL(e2.commitmentsRetired, e1.commitmentsRetired);
+        BOOST_CHECK_EQUAL(e2.spent, e1.spent);
+        BOOST_CHECK_EQUAL(e2.lineItems, e1.lineItems);
+    }
+
+    ShadowSyncResponse response;
+    response.resyncRequired = true;
+    ShadowSyncResponse::Entry entry;
+    entry.account = AccountKey("campaign:strategy:slave");
+    entry.version = 12;
+    entry.netBudget = USD(3);
+    entry.status = Account::CLOSED;
+    response.entries.push_back(entry);
+
+    auto response2 = ShadowSyncResponse::reconstitute(response.serialize());
+    BOOST_CHECK_EQUAL(response2.resyncRequired, true);
+    BOOST_REQUIRE_EQUAL(response2.entries.size(), 1);
+    BOOST_CHECK_EQUAL(response2.entries[0].account, entry.account);
+    BOOST_CHECK_EQUAL(response2.entries[0].version, 12);
+    BOOST_CHECK_EQUAL(response2.entries[0].netBudget, USD(3));
+    BOOST_CHECK_EQUAL(response2.entries[0].status, Account::CLOSED);
+
+    // One can't be mistaken for the other
+    BOOST_CHECK_THROW(ShadowSyncResponse::reconstitute(request.serialize()),
+                      ML::Exception);
+    BOOST_CHECK_THROW(ShadowSyncRequest::reconstitute(response.serialize()),
+                      ML::Exception);
+}
+
+BOOST_AUTO_TEST_CASE( test_master_banker_shadow_sync )
+{
+    auto serviceProxies = std::make_shared<ServiceProxies>();
+
+    MasterBanker banker(serviceProxies);
+    banker.accounts.createBudgetAccount(AccountKey("campaign"));
+    banker.accounts.setBudget(AccountKey("campaign"), USD(10));
+
+    AccountKey spendKey("campaign:slave");
+
+    ShadowSyncRequest request;
+    request.session = 42;
+    request.fullSync = true;
+    request.targetBalance = USD(1);
+    request.entries.push_back(makeEntry(spendKey, 1, USD(0), USD(0), USD(0)));
+
+    // First sync: the account is created and topped up
+    auto response = banker.syncFromShadowBinary(request);
+    BOOST_CHECK_EQUAL(response.resyncRequired, false);
+    BOOST_REQUIRE_EQUAL(response.entries.size(), 1);
+    BOOST_CHECK_EQUAL(response.entries[0].account, spendKey);
+    BOOST_CHECK_EQUAL(response.entries[0].version, 1);
+    BOOST_CHECK_EQUAL(response.entries[0].netBudget, USD(1));
+    BOOST_CHECK_EQUAL(banker.accounts.getBalance(spendKey), USD(1));
+
+    // Spend some of it and sync; the balance is topped back up
+    request.fullSync = false;
+    request.entries[0] = makeEntry(spendKey, 2, USD(0.5), USD(0.5), USD(0.3));
+    response = banker.syncFromShadowBinary(request);
+    BOOST_CHECK_EQUAL(response.resyncRequired, false);
+    BOOST_CHECK_EQUAL(response.entries[0].version, 2);
+    BOOST_CHECK_EQUAL(response.entries[0].netBudget, USD(1.3));
+    BOOST_CHECK_EQUAL(banker.accounts.getAccount(spendKey).spent, USD(0.3));
+    BOOST_CHECK_EQUAL(banker.accounts.getBalance(spendKey), USD(1));
+
+    // A stale duplicate is ignored
+    request.entries[0] = makeEntry(spendKey, 2, USD(0.7), USD(0.7), USD(0.6));
+    response = banker.syncFromShadowBinary(request);
+    BOOST_CHECK_EQUAL(response.resyncRequired, false);
+    BOOST_CHECK_EQUAL(banker.accounts.getAccount(spendKey).spent, USD(0.3));
+
+    // A gap in the versions is fine, as the counters are cumulative
+    request.entries[0].version = 5;
+    response = banker.syncFromShadowBinary(request);
+    BOOST_CHECK_EQUAL(response.resyncRequired, false);
+    BOOST_CHECK_EQUAL(banker.accounts.getAccount(spendKey).spent, USD(0.6));
+    BOOST_CHECK_EQUAL(response.entries[0].netBudget, USD(1.6));
+
+    // A new session that isn't a full sync means the slave restarted and
+    // we may be missing accounts
+    request.session = 43;
+    request.entries[0].version = 1;
+    response = banker.syncFromShadowBinary(request);
+    BOOST_CHECK_EQUAL(response.resyncRequired, true);
+
+    request.fullSync = true;
+    request.entries[0].version = 2;
+    response = banker.syncFromShadowBinary(request);
+    BOOST_CHECK_EQUAL(response.resyncRequired, false);
+}
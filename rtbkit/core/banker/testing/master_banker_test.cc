@@ -79,7 +79,7 @@ BOOST_AUTO_TEST_CASE( test_master_banker_onstatesaved )
     /* BankerPersistence::DATA_INCONSISTENCY: accounts corresponding to the
      * keys passed in a json array must have been marked as out of sync */
 
-    Accounts newAccounts = testBanker.accounts;
+    Accounts newAccounts = testBanker.accounts.snapshot();
     Json::Value badKeys = Json::parse("[ 'account2:spend' ]");
     testBanker.onStateSaved(BankerPersistence::DATA_INCONSISTENCY,
                             badKeys.toString());
@@ -108,3 +108,49 @@ BOOST_AUTO_TEST_CASE( test_master_banker_http_headers )
 
     BOOST_CHECK_EQUAL(response.getHeader("Access-Control-Allow-Origin"), "*");
 }
+
+/* Fails empty saves like redis fails an MGET without any keys. */
+struct EmptySaveFailsPersistence : public NoBankerPersistence {
+    EmptySaveFailsPersistence()
+        : saves(0)
+    {
+    }
+
+    void saveAll(const Accounts & toSave, OnSavedCallback onSaved)
+    {
+        ++saves;
+        if (toSave.empty())
+            onSaved(Result { PERSISTENCE_ERROR },
+                    "wrong number of arguments for 'mget'");
+        else onSaved(Result { SUCCESS }, "");
+    }
+
+    int saves;
+};
+
+BOOST_AUTO_TEST_CASE( test_master_banker_save_empty_shards )
+{
+    auto serviceProxies = std::make_shared<ServiceProxies>();
+
+    /* more shards than accounts */
+    MasterBanker testBanker(serviceProxies, "masterBanker", 8);
+    auto storage = std::make_shared<EmptySaveFailsPersistence>();
+    testBanker.storage_ = storage;
+
+    testBanker.saveState();
+    BOOST_CHECK_EQUAL(storage->saves, 0);
+    BOOST_CHECK_EQUAL(testBanker.lastSaveStatus, BankerPersistence::SUCCESS);
+
+    testBanker.accounts.createAccount(AccountKey("account1"), AT_BUDGET);
+    testBanker.accounts.createAccount(AccountKey("account2:spend"), AT_SPEND);
+
+    int nonEmpty = 0;
+    for (size_t i = 0;  i < testBanker.accounts.numShards();  ++i)
+        nonEmpty += !testBanker.accounts.shard(i).empty();
+    BOOST_REQUIRE_LT(nonEmpty, testBanker.accounts.numShards());
+
+    testBanker.saveState();
+    BOOST_CHECK_EQUAL(storage->saves, nonEmpty);
+    BOOST_CHECK_EQUAL(testBanker.lastSaveStatus, BankerPersistence::SUCCESS);
+    BOOST_CHECK_EQUAL(testBanker.saving, 0);
+}
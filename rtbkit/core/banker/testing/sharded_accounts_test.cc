@@ -0,0 +1,101 @@
+/* sharded_accounts_test.cc
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Tests for the accounts sharded by top level account.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <memory>
+#include <boost/test/unit_test.hpp>
+
+#include "soa/service/service_base.h"
+#include "rtbkit/core/banker/sharded_accounts.h"
+#include "rtbkit/core/banker/master_banker.h"
+#include "jml/arch/format.h"
+
+using namespace std;
+using namespace Datacratic;
+using namespace RTBKIT;
+
+BOOST_AUTO_TEST_CASE( test_sharded_accounts )
+{
+    Accounts reference;
+    ShardedAccounts accounts(4);
+
+    for (unsigned i = 0;  i < 20;  ++i) {
+        AccountKey campaign(ML::format("campaign%d", i));
+        AccountKey strategy = campaign.childKey("strategy");
+        AccountKey spend = strategy.childKey("slave");
+
+        reference.setBudget(campaign, USD(100));
+        reference.setBalance(strategy, USD(i + 1), AT_BUDGET);
+        reference.setBalance(spend, USD(0.5), AT_SPEND);
+
+        accounts.setBudget(campaign, USD(100));
+        accounts.setBalance(strategy, USD(i + 1), AT_BUDGET);
+        accounts.setBalance(spend, USD(0.5), AT_SPEND);
+
+        // A tree always lives in one shard
+        BOOST_CHECK_EQUAL(accounts.shardIndex(spend),
+                          accounts.shardIndex(campaign));
+        BOOST_CHECK(accounts.shardFor(campaign)
+                    .accountPresentAndActive(spend).first);
+    }
+
+    // The accounts are spread over the shards
+    for (unsigned i = 0;  i < accounts.numShards();  ++i)
+        BOOST_CHECK_GT(accounts.shard(i).size(), 0);
+
+    BOOST_CHECK_EQUAL(accounts.size(), reference.size());
+    BOOST_CHECK_EQUAL(accounts.toJson(), reference.toJson());
+    BOOST_CHECK_EQUAL(accounts.snapshot().toJson(), reference.toJson());
+    BOOST_CHECK(accounts.getAccountKeys() == reference.getAccountKeys());
+    BOOST_CHECK(accounts.getAccountKeys(AccountKey("campaign3"), 2)
+                == reference.getAccountKeys(AccountKey("campaign3"), 2));
+    BOOST_CHECK_EQUAL(accounts.getAccountSummariesJson(true, 2),
+                      reference.getAccountSummariesJson(true, 2));
+
+    // Loading distributes the accounts again
+    ShardedAccounts loaded(3);
+    loaded = reference;
+    BOOST_CHECK_EQUAL(loaded.toJson(), reference.toJson());
+    BOOST_CHECK_EQUAL(loaded.getBalance(AccountKey("campaign7:strategy")),
+                      USD(7.5));
+}
+
+BOOST_AUTO_TEST_CASE( test_master_banker_sharded_sync )
+{
+    auto serviceProxies = std::make_shared<ServiceProxies>();
+
+    MasterBanker banker(serviceProxies, "masterBanker", 4);
+
+    ShadowSyncRequest request;
+    request.session = 1;
+    request.fullSync = true;
+    request.targetBalance = USD(1);
+
+    for (unsigned i = 0;  i < 50;  ++i) {
+        AccountKey campaign(ML::format("campaign%d", i));
+        banker.accounts.setBudget(campaign, USD(100));
+
+        ShadowSyncRequest::Entry entry;
+        entry.account = campaign.childKey("slave");
+        entry.version = 1;
+        request.entries.push_back(entry);
+    }
+
+    auto response = banker.syncFromShadowBinary(request);
+    BOOST_CHECK_EQUAL(response.resyncRequired, false);
+    BOOST_REQUIRE_EQUAL(response.entries.size(), 50);
+
+    // The replies are in the same order as the requests
+    for (unsigned i = 0;  i < 50;  ++i) {
+        BOOST_CHECK_EQUAL(response.entries[i].account,
+                          request.entries[i].account);
+        BOOST_CHECK_EQUAL(response.entries[i].netBudget, USD(1));
+        BOOST_CHECK_EQUAL(banker.accounts.getBalance(request.entries[i].account),
+                          USD(1));
+    }
+}
@@ -13,6 +13,8 @@
 #include "rtbkit/common/messages.h"
 #include "soa/service/rest_request_params.h"
 #include "soa/service/rest_request_binding.h"
+#include <boost/lexical_cast.hpp>
+#include <sstream>
 
 using namespace std;
 using namespace Datacratic;
@@ -188,6 +190,14 @@ initConnections(size_t shard)
     router.bind("WIN", std::bind(&PostAuctionService::doWinMessage, this, _1));
     router.bind("LOSS", std::bind(&PostAuctionService::doLossMessage, this,_1));
     router.bind("EVENT", std::bind(&PostAuctionService::doCampaignEventMessage, this, _1));
+    router.bind("EVENTS", std::bind(&PostAuctionService::doEventsMessage, this, _1));
+
+    // Proxies that batch their events run their message loop to get the
+    // acknowledgements, which also sends us their keepalives.
+    auto ignore = [] (const std::vector<std::string> &) {};
+    router.bind("HELLO", ignore);
+    router.bind("HEARTBEAT", ignore);
+
     router.defaultHandler = [=](const std::vector<std::string> & message) {
         LOG(error) << "unroutable message: " << message[0] << std::endl;
     };
@@ -356,6 +366,31 @@ doCampaignEventMessage(const std::vector<std::string> & message)
     doEvent(event);
 }
 
+void
+PostAuctionService::
+doEventsMessage(const std::vector<std::string> & message)
+{
+    recordHit("messages.EVENTS");
+
+    size_t count = boost::lexical_cast<size_t>(message.at(3));
+    std::istringstream stream(message.at(4));
+    ML::DB::Store_Reader store(stream);
+
+    for (size_t i = 0; i < count; ++i) {
+        auto event = std::make_shared<PostAuctionEvent>();
+        event->reconstitute(store);
+
+        if (event->type == PAE_CAMPAIGN_EVENT)
+            recordHit("messages.EVENT." + event->label);
+        else recordHit(std::string("messages.") + RTBKIT::print(event->type));
+
+        doEvent(event);
+    }
+
+    // Only acknowledge once all the events of the batch were handled
+    endpoint.sendMessage(message.at(0), "EVENTSACK", message.at(2));
+}
+
 
 void
 PostAuctionService::
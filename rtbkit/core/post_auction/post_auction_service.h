@@ -274,6 +274,10 @@ private:
      * in. */
     void doCampaignEventMessage(const std::vector<std::string> & message);
 
+    /** Decode from zeromq and handle a batch of events sent by a
+        PostAuctionProxy, then acknowledge it. */
+    void doEventsMessage(const std::vector<std::string> & message);
+
     void doConfigChange(
             const std::string & agent,
             std::shared_ptr<const AgentConfig> config);
@@ -0,0 +1,174 @@
+/** post_auction_batch_test.cc                                 -*- C++ -*-
+    Copyright (c) 2015 Datacratic.  All rights reserved.
+
+    Sends batches of events through the PostAuctionProxy to a running post
+    auction service and checks that every event gets there once and that
+    every batch is acknowledged.
+
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include "rtbkit/core/post_auction/post_auction_service.h"
+#include "rtbkit/core/post_auction/simple_event_matcher.h"
+#include "rtbkit/core/banker/null_banker.h"
+#include "rtbkit/common/post_auction_proxy.h"
+#include "jml/utils/testing/watchdog.h"
+#include "jml/arch/timers.h"
+#include "jml/arch/format.h"
+
+#include <boost/test/unit_test.hpp>
+#include <mutex>
+#include <map>
+
+using namespace std;
+using namespace ML;
+using namespace Datacratic;
+using namespace RTBKIT;
+
+
+namespace {
+
+/** Keeps a count of every event that the service records. */
+struct RecordingEventService : public EventService
+{
+    virtual void onEvent(const std::string & name,
+                         const char * event,
+                         EventType type,
+                         float value)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        counts[event] += 1;
+    }
+
+    int count(const std::string & event) const
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = counts.find(event);
+        return it == counts.end() ? 0 : it->second;
+    }
+
+    mutable std::mutex lock;
+    std::map<std::string, int> counts;
+};
+
+/** What the proxy reports about its batches. */
+struct BatchStats
+{
+    BatchStats() : sent(0), acked(0), lost(0), lateAcks(0), dropped(0) {}
+
+    void onEvent(const char * eventName, EventType, float value)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+
+        string event = eventName;
+        if (event == "batch.sent") ++sent;
+        else if (event == "batch.acked") ++acked;
+        else if (event == "batch.lost") ++lost;
+        else if (event == "batch.lateAck") ++lateAcks;
+        else if (event == "batch.dropped") ++dropped;
+        else if (event == "batch.events") sizes.push_back(value);
+    }
+
+    int getAcked() const
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        return acked;
+    }
+
+    mutable std::mutex lock;
+    int sent, acked, lost, lateAcks, dropped;
+    std::vector<int> sizes;
+};
+
+PostAuctionEvent makeEvent(unsigned i)
+{
+    PostAuctionEvent event;
+    event.type = PAE_CAMPAIGN_EVENT;
+    event.label = ML::format("event%d", i);
+    event.auctionId = Id(ML::format("auction%d", i));
+    event.adSpotId = Id(1);
+    event.timestamp = Date::now();
+    return event;
+}
+
+} // file scope
+
+
+BOOST_AUTO_TEST_CASE( test_post_auction_event_batches )
+{
+    ML::Watchdog watchdog(30.0);
+
+    ZmqLogs::print.deactivate();
+    PostAuctionService::print.deactivate();
+    SimpleEventMatcher::print.deactivate();
+
+    auto proxies = std::make_shared<ServiceProxies>();
+    auto events = std::make_shared<RecordingEventService>();
+    proxies->events = events;
+
+    PostAuctionService service(proxies, "post-auction-batch-test");
+    service.init(0);
+    service.setBanker(std::make_shared<NullBanker>());
+    service.bindTcp();
+    service.start();
+
+    // Long enough that sending the full batches below doesn't race with
+    // the partial one going out.
+    const size_t batchSize = 4;
+    const double batchDelay = 0.2;
+
+    BatchStats stats;
+    PostAuctionProxy proxy(proxies);
+    proxy.onEvent = [&] (const char * event, EventType type, float value)
+        {
+            stats.onEvent(event, type, value);
+        };
+    proxy.enableBatching(batchSize, batchDelay, 10.0 /* ackTimeout */);
+    proxy.init();
+    proxy.start();
+
+    while (!proxy.isConnected())
+        ML::sleep(0.01);
+
+    // Two full batches, which go out straight away, and a partial one that
+    // has to wait for the delay.
+    const unsigned numEvents = 2 * batchSize + 2;
+    for (unsigned i = 0;  i < numEvents;  ++i)
+        proxy.sendEvent(makeEvent(i));
+
+    {
+        std::lock_guard<std::mutex> guard(stats.lock);
+        BOOST_CHECK_EQUAL(stats.sent, 2);
+    }
+
+    while (stats.getAcked() < 3)
+        ML::sleep(0.01);
+
+    // Anything sent twice would have shown up by now
+    ML::sleep(2 * batchDelay);
+
+    {
+        std::lock_guard<std::mutex> guard(stats.lock);
+        BOOST_CHECK_EQUAL(stats.sent, 3);
+        BOOST_CHECK_EQUAL(stats.acked, 3);
+        BOOST_CHECK_EQUAL(stats.lost, 0);
+        BOOST_CHECK_EQUAL(stats.lateAcks, 0);
+        BOOST_CHECK_EQUAL(stats.dropped, 0);
+
+        std::vector<int> expected = { int(batchSize), int(batchSize), 2 };
+        BOOST_CHECK_EQUAL_COLLECTIONS(stats.sizes.begin(), stats.sizes.end(),
+                                      expected.begin(), expected.end());
+    }
+
+    BOOST_CHECK_EQUAL(events->count("messages.EVENTS"), 3);
+    BOOST_CHECK_EQUAL(service.stats.events, numEvents);
+    for (unsigned i = 0;  i < numEvents;  ++i) {
+        BOOST_CHECK_EQUAL(
+                events->count(ML::format("messages.EVENT.event%d", i)), 1);
+    }
+
+    proxy.shutdown();
+    service.shutdown();
+}
@@ -12,6 +12,10 @@
     access pattern because that would mix multiple transaction which confuses
     redis. Instead we need to have one connection per live transaction.
 
+    Passing a window in seconds as the first argument coalesces the commands
+    of each connection into pipelined writes (see AsyncConnection::coalesce),
+    which mostly saves the write of each of the MULTI, SET and EXEC.
+
  */
 
 #include "soa/types/date.h"
@@ -43,9 +47,11 @@ enum {
 
 struct Connection
 {
-    Connection(const Redis::Address& addr) :
+    Connection(const Redis::Address& addr, double window) :
         processed(0), retries(0), errors(0), inFlights(0), conn(addr)
-    {}
+    {
+        if (window > 0.0) conn.coalesce(window);
+    }
 
     bool send()
     {
@@ -160,7 +166,7 @@ void report(std::vector<Connection*>& connections, double duration)
 /* RUN                                                                        */
 /******************************************************************************/
 
-void run(std::vector<Connection*>& connections)
+void run(std::vector<Connection*>& connections, double window)
 {
     Date now = Date::now();
     Date start = now;
@@ -169,7 +175,8 @@ void run(std::vector<Connection*>& connections)
 
     std::cerr << "\n"
         << printElapsed(Duration) << " duration\n"
-        << printValue(Connections) << " connections\n";
+        << printValue(Connections) << " connections\n"
+        << printElapsed(window) << " coalescing window\n";
 
 
     while ((now = Date::now()) < end) {
@@ -198,12 +205,13 @@ void run(std::vector<Connection*>& connections)
 int main(int argc, char* argv[])
 {
     Redis::Address addr("localhost:6379");
+    double window = argc > 1 ? std::stod(argv[1]) : 0.0;
 
     std::vector<Connection*> connections;
     connections.reserve(Connections);
 
     while(connections.size() < Connections)
-        connections.push_back(new Connection(addr));
+        connections.push_back(new Connection(addr, window));
 
-    run(connections);
+    run(connections, window);
 }
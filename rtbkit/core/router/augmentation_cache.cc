@@ -0,0 +1,130 @@
+/* augmentation_cache.cc
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Router-side cache of augmentor responses.
+*/
+
+#include "augmentation_cache.h"
+#include "jml/utils/exc_check.h"
+#include <algorithm>
+
+
+using namespace std;
+using namespace ML;
+
+
+namespace RTBKIT {
+
+
+/*****************************************************************************/
+/* AUGMENTATION CACHE CONFIG                                                 */
+/*****************************************************************************/
+
+AugmentationCacheConfig
+AugmentationCacheConfig::
+fromJson(const Json::Value & json)
+{
+    AugmentationCacheConfig result;
+
+    for (auto it = json.begin(), end = json.end(); it != end; ++it) {
+        if (it.memberName() == "userIdDomain")
+            result.userIdDomain = it->asString();
+        else if (it.memberName() == "ttlSeconds")
+            result.ttl = it->asDouble();
+        else if (it.memberName() == "maxEntries")
+            result.maxEntries = it->asUInt();
+        else throw ML::Exception("unknown augmentation cache field "
+                                 + it.memberName());
+    }
+
+    ExcCheck(!result.userIdDomain.empty(), "no user id domain for cache");
+    ExcCheckGreater(result.ttl, 0.0, "invalid cache time to live");
+    ExcCheckGreater(result.maxEntries, 0, "invalid cache size");
+
+    return result;
+}
+
+
+/*****************************************************************************/
+/* AUGMENTATION CACHE                                                        */
+/*****************************************************************************/
+
+AugmentationCache::
+AugmentationCache(const AugmentationCacheConfig & config)
+    : hits(0), misses(0), evictions(0), config_(config)
+{
+}
+
+Id
+AugmentationCache::
+getUserId(const BidRequest & request) const
+{
+    auto it = request.userIds.find(config_.userIdDomain);
+    if (it == request.userIds.end() || !it->second.notNull())
+        return Id();
+    return it->second;
+}
+
+bool
+AugmentationCache::
+get(const Id & userId,
+    const std::set<std::string> & agents,
+    AugmentationList & result,
+    Date now)
+{
+    auto it = entries.find(userId);
+    if (it == entries.end()
+        || it->second.timeout <= now
+        || !std::includes(it->second.agents.begin(), it->second.agents.end(),
+                          agents.begin(), agents.end()))
+    {
+        ++misses;
+        return false;
+    }
+
+    ++hits;
+    result = it->second.augmentations;
+    return true;
+}
+
+void
+AugmentationCache::
+put(const Id & userId,
+    const std::set<std::string> & agents,
+    const AugmentationList & augmentations,
+    Date now)
+{
+    if (!userId.notNull()) return;
+
+    Date timeout = now.plusSeconds(config_.ttl);
+
+    auto it = entries.find(userId);
+    if (it != entries.end()) {
+        it->second.agents = agents;
+        it->second.augmentations = augmentations;
+        entries.updateTimeout(it, timeout);
+        return;
+    }
+
+    expire(now);
+
+    while (entries.size() >= config_.maxEntries) {
+        entries.erase(entries.timeouts.begin()->second);
+        ++evictions;
+    }
+
+    Entry entry;
+    entry.agents = agents;
+    entry.augmentations = augmentations;
+    entries.insert(userId, std::move(entry), timeout);
+}
+
+void
+AugmentationCache::
+expire(Date now)
+{
+    if (entries.earliest <= now)
+        entries.expire(now);
+}
+
+} // namespace RTBKIT
@@ -0,0 +1,101 @@
+/* augmentation_cache.h                                            -*- C++ -*-
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Router-side cache of augmentor responses keyed on a user id.
+*/
+
+#pragma once
+
+#include "rtbkit/common/augmentation.h"
+#include "rtbkit/common/bid_request.h"
+#include "soa/service/timeout_map.h"
+#include "soa/types/id.h"
+#include <set>
+#include <string>
+
+
+namespace RTBKIT {
+
+
+/*****************************************************************************/
+/* AUGMENTATION CACHE CONFIG                                                 */
+/*****************************************************************************/
+
+/** How the responses of a given augmentor are cached by the router. */
+struct AugmentationCacheConfig {
+    AugmentationCacheConfig()
+        : userIdDomain("prov"), ttl(60.0), maxEntries(100000)
+    {
+    }
+
+    std::string userIdDomain;  ///< User id domain the responses are keyed on
+    double ttl;                ///< Seconds a cached response stays valid
+    size_t maxEntries;         ///< Maximum number of users to remember
+
+    static AugmentationCacheConfig fromJson(const Json::Value & json);
+};
+
+
+/*****************************************************************************/
+/* AUGMENTATION CACHE                                                        */
+/*****************************************************************************/
+
+/** Remembers what a single augmentor answered for a given user so that
+    further auctions for the same user can be augmented without a round trip
+    to the augmentor.
+
+    A cached response is only used if it was computed for a superset of the
+    agents that are asking, since augmentors only augment for the agents they
+    are told about.
+
+    Not thread safe; it's owned by the augmentation loop thread.
+*/
+struct AugmentationCache {
+
+    AugmentationCache(const AugmentationCacheConfig & config
+                      = AugmentationCacheConfig());
+
+    /** Return the id the cache is keyed on for the given request, or a null
+        id if the request can't be cached.
+    */
+    Id getUserId(const BidRequest & request) const;
+
+    /** Look up the cached response for the given user that covers all of
+        the given agents.  Returns true and fills in result on a hit.
+    */
+    bool get(const Id & userId,
+             const std::set<std::string> & agents,
+             AugmentationList & result,
+             Date now = Date::now());
+
+    /** Record the response that an augmentor gave for the given user and
+        agents.  If the cache is full the entry closest to expiry is evicted.
+    */
+    void put(const Id & userId,
+             const std::set<std::string> & agents,
+             const AugmentationList & augmentations,
+             Date now = Date::now());
+
+    /** Drop all entries whose time to live has passed. */
+    void expire(Date now = Date::now());
+
+    size_t size() const { return entries.size(); }
+
+    const AugmentationCacheConfig & config() const { return config_; }
+
+    uint64_t hits;       ///< Lookups answered from the cache
+    uint64_t misses;     ///< Lookups that had to go to the augmentor
+    uint64_t evictions;  ///< Entries dropped before expiry to bound memory
+
+private:
+    AugmentationCacheConfig config_;
+
+    struct Entry {
+        std::set<std::string> agents;
+        AugmentationList augmentations;
+    };
+
+    TimeoutMap<Id, Entry> entries;
+};
+
+} // namespace RTBKIT
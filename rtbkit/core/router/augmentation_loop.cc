@@ -154,6 +154,31 @@ bindAugmentors(const std::string & uri)
     }
 }
 
+void
+AugmentationLoop::
+bindShm()
+{
+    toAugmentors.bindShm();
+}
+
+void
+AugmentationLoop::
+addAugmentorCache(const std::string & augmentor,
+                  const AugmentationCacheConfig & config)
+{
+    ExcCheck(!augmentor.empty(), "no augmentor name for cache");
+    caches[augmentor] = std::make_shared<AugmentationCache>(config);
+}
+
+void
+AugmentationLoop::
+initAugmentorCaches(const Json::Value & config)
+{
+    for (auto it = config.begin(), end = config.end(); it != end; ++it)
+        addAugmentorCache(it.memberName(),
+                          AugmentationCacheConfig::fromJson(*it));
+}
+
 void
 AugmentationLoop::
 handleAugmentorMessage(const std::vector<std::string> & message)
@@ -185,6 +210,15 @@ recordStats()
 
         recordLevel(inFlights, "augmentor.%s.numInFlight", it->first);
     }
+
+    for (auto & cache: caches) {
+        AugmentationCache & c = *cache.second;
+        recordLevel(c.size(), "augmentor.%s.cache.size", cache.first);
+        recordCount(c.hits, "augmentor.%s.cache.hits", cache.first);
+        recordCount(c.misses, "augmentor.%s.cache.misses", cache.first);
+        recordCount(c.evictions, "augmentor.%s.cache.evictions", cache.first);
+        c.hits = c.misses = c.evictions = 0;
+    }
 }
 
 
@@ -211,6 +245,9 @@ checkExpiries()
     if (augmenting.earliest <= now)
         augmenting.expire(onExpired, now);
 
+    for (auto & cache: caches)
+        cache.second->expire(now);
+
     if (augmenting.empty() && !idle_) {
         idle_ = 1;
         futex_wake(idle_);
@@ -383,10 +420,28 @@ doAugmentation(const std::shared_ptr<Entry> & entry)
     }
 
     bool sentToAugmentor = false;
+    std::vector<std::string> cached;
 
     for (auto it = entry->outstanding.begin(), end = entry->outstanding.end();
          it != end;  ++it)
     {
+        auto cacheIt = caches.find(*it);
+        if (cacheIt != caches.end()) {
+            AugmentationCache & cache = *cacheIt->second;
+            const Auction & auction = *entry->info->auction;
+            AugmentationList augmentationList;
+            if (cache.get(cache.getUserId(*auction.request),
+                          entry->augmentorAgents[*it],
+                          augmentationList, now))
+            {
+                recordHit("augmentor.%s.cacheHit", *it);
+                entry->info->auction->augmentations[*it]
+                    .mergeWith(augmentationList);
+                cached.push_back(*it);
+                continue;
+            }
+        }
+
         auto & aug = *augmentors[*it];
 
         const AugmentorInstanceInfo* instance = pickInstance(aug);
@@ -415,6 +470,9 @@ doAugmentation(const std::shared_ptr<Entry> & entry)
         sentToAugmentor = true;
     }
 
+    for (const auto & name: cached)
+        entry->outstanding.erase(name);
+
     if (sentToAugmentor)
         augmenting.insert(entry->info->auction->id, entry, entry->timeout);
     else entry->onFinished(entry->info);
@@ -528,6 +586,7 @@ doResponse(const std::vector<std::string> & message)
     ML::Timer timer;
 
     AugmentationList augmentationList;
+    bool parsed = true;
     if (augmentation != "" && augmentation != "null") {
         try {
             Json::Value augmentationJson;
@@ -539,6 +598,7 @@ doResponse(const std::vector<std::string> & message)
             string eventName = "augmentor." + augmentor
                 + ".responseParsingExceptions";
             recordEvent(eventName.c_str(), ET_COUNT);
+            parsed = false;
         }
     }
 
@@ -578,6 +638,16 @@ doResponse(const std::vector<std::string> & message)
     recordHit("augmentor.%s.%s", augmentor, eventType);
     recordHit("augmentor.%s.instances.%s.%s", augmentor, addr, eventType);
 
+    // Null responses are worth remembering too: the augmentor has nothing
+    // for this user.
+    auto cacheIt = caches.find(augmentor);
+    if (parsed && cacheIt != caches.end()) {
+        AugmentationCache & cache = *cacheIt->second;
+        cache.put(cache.getUserId(*entry.second->info->auction->request),
+                  entry.second->augmentorAgents[augmentor],
+                  augmentationList);
+    }
+
     auto& auctionAugs = entry.second->info->auction->augmentations;
     auctionAugs[augmentor].mergeWith(augmentationList);
 
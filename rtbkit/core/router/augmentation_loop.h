@@ -9,6 +9,7 @@
 #define __rtb_router__augmentation_loop_h__
 
 #include "rtbkit/common/augmentation.h"
+#include "augmentation_cache.h"
 #include "soa/service/timeout_map.h"
 #include "soa/service/zmq_endpoint.h"
 #include "soa/service/typed_message_channel.h"
@@ -103,6 +104,20 @@ struct AugmentationLoop : public ServiceBase, public MessageLoop {
 
     void bindAugmentors(const std::string & uri);
 
+    /** Let augmentors on this host connect over shared memory. */
+    void bindShm();
+
+    /** Cache the responses of the given augmentor in the router, keyed on
+        a user id.  Must be called before the loop is started.
+    */
+    void addAugmentorCache(const std::string & augmentor,
+                           const AugmentationCacheConfig & config);
+
+    /** Set up augmentor caches from a JSON object mapping augmentor names
+        to their cache configuration.
+    */
+    void initAugmentorCaches(const Json::Value & config);
+
     /** Push an auction into the augmentor.  Can be called from any thread. */
     void augment(const std::shared_ptr<AugmentationInfo> & info,
                  Date timeout,
@@ -127,6 +142,11 @@ private:
     /** Currently configured augmentors.  Indexed by the augmentor name. */
     std::map<std::string, std::shared_ptr<AugmentorInfo> > augmentors;
 
+    /** Response caches for the augmentors that have one.  Indexed by the
+        augmentor name.
+    */
+    std::map<std::string, std::shared_ptr<AugmentationCache> > caches;
+
     /** A single entry in the augmentor info structure. */
     struct AugmentorInfoEntry {
         std::string name;
@@ -7,6 +7,7 @@
 */
 
 #include "filter_pool.h"
+#include "frequency_cap_store.h"
 #include "rtbkit/common/bid_request.h"
 #include "rtbkit/common/exchange_connector.h"
 #include "rtbkit/core/agent_configuration/agent_config.h"
@@ -27,7 +28,11 @@ namespace RTBKIT {
 /******************************************************************************/
 
 FilterPool::
-FilterPool() : data(new Data()), events(nullptr) {}
+FilterPool(size_t configCapacity) :
+    data(new Data(configCapacity)),
+    events(nullptr),
+    configCapacity(configCapacity)
+{}
 
 
 void
@@ -37,6 +42,13 @@ init(EventRecorder* events)
     this->events = events;
 }
 
+void
+FilterPool::
+initFrequencyCaps(std::shared_ptr<const FrequencyCapStore> store)
+{
+    frequencyCaps = std::move(store);
+}
+
 
 bool
 FilterPool::
@@ -71,12 +83,12 @@ void
 FilterPool::
 recordDiff(const Data* data, const FilterBase* filter, const ConfigSet& diff)
 {
-    for (size_t cfg = diff.next(); cfg < diff.size(); cfg = diff.next(cfg+1)) {
-        const AgentConfig& config = *data->configs[cfg].config;
+    diff.forEach([&] (size_t cfg) {
+                const AgentConfig& config = *data->configs[cfg].config;
 
-        events->recordHit("accounts.%s.filter.static.%s",
-                config.account.toString('.'), filter->name());
-    }
+                events->recordHit("accounts.%s.filter.static.%s",
+                        config.account.toString('.'), filter->name());
+            });
 }
 
 uint64_t
@@ -91,6 +103,34 @@ recordTime(uint64_t start, const FilterBase* filter)
     return now;
 }
 
+void
+FilterPool::
+filterFrequencyCaps(
+        const Data* data, const BidRequest& br, FilterState& state,
+        bool sampleStats)
+{
+    ConfigSet capped = state.configs() & data->cappedConfigs;
+    if (capped.empty()) return;
+
+    ConfigSet reached(false, configCapacity);
+
+    capped.forEach([&] (size_t cfg) {
+                const AgentConfig& config = *data->configs[cfg].config;
+
+                if (!frequencyCaps->isCapped(
+                                br.userIds, config.account, config.frequencyCaps))
+                    return;
+
+                reached.set(cfg);
+                if (sampleStats) {
+                    events->recordHit("accounts.%s.filter.frequencyCap",
+                            config.account.toString('.'));
+                }
+            });
+
+    state.narrowConfigs(reached.negate());
+}
+
 
 FilterPool::ConfigList
 FilterPool::
@@ -109,7 +149,8 @@ filter(const BidRequest& br, const ExchangeConnector* conn, const ConfigSet& mas
     bool sampleStats = events && (random() % 10 == 0);
     uint64_t ticksStart = sampleStats ? ticks() : 0;
 
-    for (FilterBase* filter : current->filters) {
+    for (const auto& entry : current->filters) {
+        const FilterBase* filter = entry.get();
         filter->filter(state);
 
         const ConfigSet& filtered = state.configs();
@@ -127,15 +168,20 @@ filter(const BidRequest& br, const ExchangeConnector* conn, const ConfigSet& mas
         }
     }
 
+    // The caps are checked last so that we only look up the user for the
+    // configs that would otherwise bid.
+    if (frequencyCaps && !state.configs().empty())
+        filterFrequencyCaps(current, br, state, sampleStats);
+
     auto biddableSpots = state.biddableSpots();
     configs = state.configs();
 
     ConfigList result;
-    for (size_t i = configs.next(); i < configs.size(); i = configs.next(i + 1)) {
-        ConfigEntry entry = current->configs[i];
-        entry.biddableSpots = std::move(biddableSpots[i]);
-        result.emplace_back(std::move(entry));
-    }
+    configs.forEach([&] (size_t i) {
+                ConfigEntry entry = current->configs[i];
+                entry.biddableSpots = std::move(biddableSpots[i]);
+                result.emplace_back(std::move(entry));
+            });
 
     return result;
 }
@@ -186,7 +232,7 @@ initWithDefaultFilters()
     unique_ptr<Data> newData;
 
     do {
-        newData.reset(new Data);
+        newData.reset(new Data(configCapacity));
 
         for (const auto& name: FilterRegistry::listFilters()) {
             newData->addFilter(FilterRegistry::makeFilter(name));
@@ -244,20 +290,11 @@ removeConfig(const string& name)
 
 FilterPool::Data::
 Data(const Data& other) :
+    filters(other.filters),
     configs(other.configs),
-    activeConfigs(other.activeConfigs)
-{
-    filters.reserve(other.filters.size());
-    for (FilterBase* filter : other.filters)
-        filters.push_back(filter->clone());
-}
-
-
-FilterPool::Data::
-~Data()
-{
-    for (FilterBase* filter : filters) delete filter;
-}
+    activeConfigs(other.activeConfigs),
+    cappedConfigs(other.cappedConfigs)
+{}
 
 ssize_t
 FilterPool::Data::
@@ -273,11 +310,15 @@ unsigned
 FilterPool::Data::
 addConfig(const string& name, const AgentInfo& info)
 {
-    // If our config already exists, we have to deregister it with the filters
-    // before we can add the new config.
-    removeConfig(name);
+    // If our config already exists, only the filters that care about what
+    // changed have to be updated.
+    ssize_t index = findConfig(name);
+    if (index >= 0) {
+        updateConfig(index, info);
+        return index;
+    }
 
-    ssize_t index = findConfig("");
+    index = findConfig("");
     if (index >= 0)
         configs[index] = ConfigEntry(name, info);
     else {
@@ -286,13 +327,38 @@ addConfig(const string& name, const AgentInfo& info)
     }
 
     activeConfigs.setConfig(index, info.config->creatives.size());
+    cappedConfigs.set(index, info.config->hasFrequencyCap());
 
-    for (FilterBase* filter : filters)
+    for (auto& filter : filters) {
+        filter.reset(filter->clone());
         filter->addConfig(index, info.config);
+    }
 
     return index;
 }
 
+void
+FilterPool::Data::
+updateConfig(unsigned index, const AgentInfo& info)
+{
+    std::shared_ptr<AgentConfig> oldConfig = configs[index].config;
+    const std::shared_ptr<AgentConfig>& newConfig = info.config;
+
+    activeConfigs.resetConfig(index);
+    activeConfigs.setConfig(index, newConfig->creatives.size());
+    cappedConfigs.set(index, newConfig->hasFrequencyCap());
+
+    for (auto& filter : filters) {
+        if (!filter->isAffected(*oldConfig, *newConfig)) continue;
+
+        filter.reset(filter->clone());
+        filter->removeConfig(index, oldConfig);
+        filter->addConfig(index, newConfig);
+    }
+
+    configs[index] = ConfigEntry(configs[index].name, info);
+}
+
 void
 FilterPool::Data::
 removeConfig(const string& name)
@@ -301,9 +367,12 @@ removeConfig(const string& name)
     if (index < 0) return;
 
     activeConfigs.resetConfig(index);
+    cappedConfigs.reset(index);
 
-    for (FilterBase* filter : filters)
+    for (auto& filter : filters) {
+        filter.reset(filter->clone());
         filter->removeConfig(index, configs[index].config);
+    }
 
     configs[index].reset();
 }
@@ -323,16 +392,15 @@ void
 FilterPool::Data::
 addFilter(FilterBase* filter)
 {
-    ConfigSet active = activeConfigs.aggregate();
-    for (size_t cfgId = active.next();
-         cfgId < active.size();
-         cfgId += active.next(cfgId + 1))
-    {
-        filter->addConfig(cfgId, configs[cfgId].config);
-    }
+    activeConfigs.aggregate().forEach([&] (size_t cfgId) {
+                filter->addConfig(cfgId, configs[cfgId].config);
+            });
 
-    filters.push_back(filter);
-    sort(filters.begin(), filters.end(), [] (FilterBase* lhs, FilterBase* rhs) {
+    filters.emplace_back(filter);
+    sort(filters.begin(), filters.end(),
+            [] (const std::shared_ptr<FilterBase>& lhs,
+                const std::shared_ptr<FilterBase>& rhs)
+            {
                 return lhs->priority() < rhs->priority();
             });
 }
@@ -344,12 +412,7 @@ removeFilter(const string& name)
     ssize_t index = findFilter(name);
     if (index < 0) return;
 
-    delete filters[index];
-
-    for (size_t i = index; i < filters.size() - 1; ++i)
-        filters[i] = filters[i+1];
-
-    filters.pop_back();
+    filters.erase(filters.begin() + index);
 }
 
 } // namepsace RTBKit
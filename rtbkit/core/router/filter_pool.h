@@ -31,6 +31,7 @@ struct AgentInfo;
 struct AgentStatus;
 struct AgentStats;
 struct AgentConfig;
+struct FrequencyCapStore;
 
 
 /******************************************************************************/
@@ -39,11 +40,24 @@ struct AgentConfig;
 
 struct FilterPool
 {
-    FilterPool();
+    /** If configCapacity isn't 0, all of the config sets used to filter a
+        request are created with room for that many configs. Operations
+        between them then never have to expand a set, which saves a lot of
+        checks and allocations per request once there are more than a few
+        hundred configs. Configs beyond the capacity still work but go back
+        to expanding the sets as needed.
+     */
+    explicit FilterPool(size_t configCapacity = 0);
     ~FilterPool();
 
     void init(EventRecorder* events = nullptr);
 
+    /** Filter out the configs with frequency caps that were reached for the
+        user of the request, using the wins recorded in the given store.
+        Must be set before we start filtering.
+     */
+    void initFrequencyCaps(std::shared_ptr<const FrequencyCapStore> store);
+
     struct ConfigEntry
     {
         ConfigEntry(std::string name, const AgentInfo& info) :
@@ -90,34 +104,48 @@ private:
 
     struct Data
     {
-        Data() {}
+        Data(size_t configCapacity = 0) :
+            activeConfigs(ConfigSet(false, configCapacity)),
+            cappedConfigs(false, configCapacity)
+        {}
         Data(const Data& other);
-        ~Data();
 
         ssize_t findConfig(const std::string& name) const;
         unsigned addConfig(const std::string& name, const AgentInfo& info);
+        void updateConfig(unsigned index, const AgentInfo& info);
         void removeConfig(const std::string& name);
 
         ssize_t findFilter(const std::string& name) const;
         void addFilter(FilterBase* filter);
         void removeFilter(const std::string& name);
 
-        // \todo Use unique_ptr when moving to gcc 4.7
-        std::vector<FilterBase*> filters;
+        /* Filters are shared with the Data they were copied from and are
+           only cloned when they have to be modified. A config update that
+           doesn't affect a filter therefore doesn't copy it.
+        */
+        std::vector< std::shared_ptr<FilterBase> > filters;
 
         std::vector<ConfigEntry> configs;
         CreativeMatrix activeConfigs;
+
+        // Configs that have frequency caps to check.
+        ConfigSet cappedConfigs;
     };
 
     bool setData(Data*&, std::unique_ptr<Data>&);
     void recordDiff(const Data* data, const FilterBase* f, const ConfigSet& diff);
     uint64_t recordTime(uint64_t ticks, const FilterBase* filter);
+    void filterFrequencyCaps(
+            const Data* data, const BidRequest& br, FilterState& state,
+            bool sampleStats);
 
     std::atomic<Data*> data;
     std::vector< std::shared_ptr<AgentConfig> > configs;
     Datacratic::GcLock gc;
 
     EventRecorder* events;
+    size_t configCapacity;
+    std::shared_ptr<const FrequencyCapStore> frequencyCaps;
 };
 
 } // namespace RTBKIT
@@ -46,8 +46,8 @@ void CreativeSegmentsFilter::setCreative(unsigned configIndex,
     for (const auto& entry : creative.segments) {
         auto& segment = data[entry.first];
 
-        segment.ie.addInclude(configIndex, crIndex, entry.second.include);
-        segment.ie.addExclude(configIndex, crIndex, entry.second.exclude);
+        segment.ie.setInclude(configIndex, crIndex, value, entry.second.include);
+        segment.ie.setExclude(configIndex, crIndex, value, entry.second.exclude);
 
         if (entry.second.excludeIfNotPresent) {
             if (value && segment.excludeIfNotPresent.empty())
@@ -28,6 +28,11 @@ struct CreativeFormatFilter : public CreativeFilter<CreativeFormatFilter>
     static constexpr const char* name = "CreativeFormat";
     unsigned priority() const { return Priority::CreativeFormat; }
 
+    bool isAffected(const AgentConfig& oldConfig, const AgentConfig& newConfig) const
+    {
+        return !isSameCreatives(oldConfig, newConfig, &Creative::format);
+    }
+
     void addCreative(
             unsigned cfgIndex, unsigned crIndex, const Creative& creative)
     {
@@ -85,6 +90,11 @@ struct CreativeLanguageFilter : public CreativeFilter<CreativeLanguageFilter>
     static constexpr const char* name = "CreativeLanguage";
     unsigned priority() const { return Priority::CreativeLanguage; }
 
+    bool isAffected(const AgentConfig& oldConfig, const AgentConfig& newConfig) const
+    {
+        return !isSameCreatives(oldConfig, newConfig, &Creative::languageFilter);
+    }
+
     void addCreative(
             unsigned cfgIndex, unsigned crIndex, const Creative& creative)
     {
@@ -117,6 +127,11 @@ struct CreativeLocationFilter : public CreativeFilter<CreativeLocationFilter>
     static constexpr const char* name = "CreativeLocation";
     unsigned priority() const { return Priority::CreativeLocation; }
 
+    bool isAffected(const AgentConfig& oldConfig, const AgentConfig& newConfig) const
+    {
+        return !isSameCreatives(oldConfig, newConfig, &Creative::locationFilter);
+    }
+
     void addCreative(
             unsigned cfgIndex, unsigned crIndex, const Creative& creative)
     {
@@ -151,6 +166,11 @@ struct CreativeExchangeNameFilter :
     static constexpr const char* name = "CreativeExchangeName";
     unsigned priority() const { return Priority::CreativeExchangeName; }
 
+    bool isAffected(const AgentConfig& oldConfig, const AgentConfig& newConfig) const
+    {
+        return !isSameCreatives(oldConfig, newConfig, &Creative::exchangeFilter);
+    }
+
 
     void addCreative(
             unsigned cfgIndex, unsigned crIndex, const Creative& creative)
@@ -241,6 +261,11 @@ struct CreativeSegmentsFilter : public CreativeFilter<CreativeSegmentsFilter>
 
     unsigned priority() const { return Priority::CreativeSegments; }
 
+    bool isAffected(const AgentConfig& oldConfig, const AgentConfig& newConfig) const
+    {
+        return !isSameCreatives(oldConfig, newConfig, &Creative::segments);
+    }
+
     void addCreative(unsigned cfgIndex, unsigned crIndex,
                        const Creative& creative)
     {
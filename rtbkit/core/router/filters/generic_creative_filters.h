@@ -48,6 +48,20 @@ struct CreativeFilter : public FilterBaseT<Filter>
             removeCreative(cfgIndex, i, config->creatives[i]);
     }
 
+    // Convenience for isAffected: compares the given field of every creative.
+    template<typename Field>
+    static bool isSameCreatives(
+            const AgentConfig& lhs, const AgentConfig& rhs, Field Creative::* field)
+    {
+        if (lhs.creatives.size() != rhs.creatives.size()) return false;
+
+        for (size_t i = 0; i < lhs.creatives.size(); ++i) {
+            if (!isSame(lhs.creatives[i].*field, rhs.creatives[i].*field))
+                return false;
+        }
+        return true;
+    }
+
     // Same semantics as filter but called for every impressions.
     virtual void filterImpression(
             FilterState& state, unsigned impId, const AdSpot& imp) const
@@ -12,6 +12,8 @@
 #include "rtbkit/core/agent_configuration/include_exclude.h"
 #include "rtbkit/common/filter.h"
 
+#include <algorithm>
+
 
 namespace RTBKIT {
 
@@ -52,6 +54,97 @@ struct FilterBaseT : public FilterBase
 };
 
 
+/******************************************************************************/
+/* CONFIG COMPARISON                                                          */
+/******************************************************************************/
+
+/** Compares the parts of two configs that a filter looks at. Meant to be used
+    to implement FilterBase::isAffected so it has to be a lot cheaper than
+    updating the filter; going through the JSON form of the configs isn't.
+ */
+template<typename T>
+bool isSame(const T& lhs, const T& rhs)
+{
+    return lhs == rhs;
+}
+
+template<typename Base, typename Str>
+bool isSame(const CachedRegex<Base, Str>& lhs, const CachedRegex<Base, Str>& rhs)
+{
+    return lhs.base.str() == rhs.base.str();
+}
+
+inline bool isSame(const DomainMatcher& lhs, const DomainMatcher& rhs)
+{
+    return lhs.str == rhs.str;
+}
+
+template<typename T>
+bool isSame(const std::vector<T>& lhs, const std::vector<T>& rhs)
+{
+    if (lhs.size() != rhs.size()) return false;
+
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        if (!isSame(lhs[i], rhs[i])) return false;
+    }
+    return true;
+}
+
+template<typename K, typename T>
+bool isSame(const std::map<K, T>& lhs, const std::map<K, T>& rhs)
+{
+    if (lhs.size() != rhs.size()) return false;
+
+    for (auto it = lhs.begin(), jt = rhs.begin(); it != lhs.end(); ++it, ++jt) {
+        if (it->first != jt->first || !isSame(it->second, jt->second))
+            return false;
+    }
+    return true;
+}
+
+template<typename T, typename IE>
+bool isSame(const IncludeExclude<T, IE>& lhs, const IncludeExclude<T, IE>& rhs)
+{
+    return isSame(lhs.include, rhs.include) && isSame(lhs.exclude, rhs.exclude);
+}
+
+inline bool isSame(const SegmentList& lhs, const SegmentList& rhs)
+{
+    return lhs.ints == rhs.ints
+        && lhs.strings == rhs.strings
+        && lhs.weights == rhs.weights;
+}
+
+inline bool
+isSame(const AgentConfig::SegmentInfo& lhs, const AgentConfig::SegmentInfo& rhs)
+{
+    return lhs.excludeIfNotPresent == rhs.excludeIfNotPresent
+        && isSame(lhs.include, rhs.include)
+        && isSame(lhs.exclude, rhs.exclude)
+        && isSame(lhs.applyToExchanges, rhs.applyToExchanges);
+}
+
+inline bool
+isSame(const Creative::SegmentInfo& lhs, const Creative::SegmentInfo& rhs)
+{
+    return lhs.excludeIfNotPresent == rhs.excludeIfNotPresent
+        && isSame(lhs.include, rhs.include)
+        && isSame(lhs.exclude, rhs.exclude);
+}
+
+inline bool isSame(const UserPartition& lhs, const UserPartition& rhs)
+{
+    if (lhs.hashOn != rhs.hashOn || lhs.modulus != rhs.modulus) return false;
+    if (lhs.includeRanges.size() != rhs.includeRanges.size()) return false;
+
+    for (size_t i = 0; i < lhs.includeRanges.size(); ++i) {
+        if (lhs.includeRanges[i].first != rhs.includeRanges[i].first) return false;
+        if (lhs.includeRanges[i].last != rhs.includeRanges[i].last) return false;
+    }
+    return true;
+}
+
+
 /******************************************************************************/
 /* ITERATIVE FILTER                                                           */
 /******************************************************************************/
@@ -465,12 +558,103 @@ private:
 };
 
 
+/******************************************************************************/
+/* SORTED KEY INDEX                                                           */
+/******************************************************************************/
+
+/** Maps keys to config sets through two parallel sorted arrays, so that the
+    position of a key doubles as a dense id for it.
+
+    Looking up a list of keys walks the list and the index together, galloping
+    over the keys in between, which for a sorted list is a merge that never
+    hashes anything. Lists that aren't sorted still work: the search starts
+    over whenever a key goes backwards.
+ */
+template<typename Key>
+struct SortedKeyIndex
+{
+    bool empty() const { return keys.empty(); }
+    size_t size() const { return keys.size(); }
+
+    void set(const Key& key, unsigned cfgIndex, bool value)
+    {
+        auto it = std::lower_bound(keys.begin(), keys.end(), key);
+        size_t i = it - keys.begin();
+
+        if (it == keys.end() || *it != key) {
+            if (!value) return;
+            keys.insert(it, key);
+            sets.insert(sets.begin() + i, ConfigSet());
+        }
+
+        sets[i].set(cfgIndex, value);
+
+        if (!value && sets[i].empty()) {
+            keys.erase(keys.begin() + i);
+            sets.erase(sets.begin() + i);
+        }
+    }
+
+    const ConfigSet* find(const Key& key) const
+    {
+        size_t i = seek(0, key);
+        return i < keys.size() && keys[i] == key ? &sets[i] : nullptr;
+    }
+
+    /** Calls onMatch with the config set of every key in the list that is in
+        the index.
+     */
+    template<typename List, typename Fn>
+    void forEachMatch(const List& list, Fn&& onMatch) const
+    {
+        if (keys.empty()) return;
+
+        size_t pos = 0;
+        for (auto it = list.begin(), end = list.end(); it != end; ++it) {
+            if (it != list.begin() && *it < *(it - 1)) pos = 0;
+
+            pos = seek(pos, *it);
+            if (pos < keys.size() && keys[pos] == *it)
+                onMatch(sets[pos]);
+        }
+    }
+
+private:
+
+    /** Index of the first key from pos onwards that isn't smaller than key.
+        Gallops forward from pos before doing a binary search so that short
+        hops stay cheap.
+     */
+    template<typename K>
+    size_t seek(size_t pos, const K& key) const
+    {
+        size_t lo = pos, hi = pos, step = 1;
+        while (hi < keys.size() && keys[hi] < key) {
+            lo = hi + 1;
+            hi += step;
+            step *= 2;
+        }
+        hi = std::min(hi, keys.size());
+
+        return std::lower_bound(keys.begin() + lo, keys.begin() + hi, key)
+            - keys.begin();
+    }
+
+    std::vector<Key> keys;
+    std::vector<ConfigSet> sets;
+};
+
+
 /******************************************************************************/
 /* SEGMENT LIST FILTER                                                        */
 /******************************************************************************/
 
 /** Segments have quirks and are best handled seperatly from the list filter.
 
+    Integer segments and string segments are kept in their own sorted index
+    which lines up with the sorted ints and strings of a SegmentList. Negative
+    integers are keyed on their string form, like SegmentList::forEach() would
+    give them to us.
  */
 struct SegmentListFilter
 {
@@ -491,16 +675,25 @@ struct SegmentListFilter
 
     ConfigSet filter(int i, const std::string& str) const
     {
-        return i >= 0 ? get(intSet, i) : get(strSet, str);
+        const ConfigSet* configs = i >= 0 ? intSet.find(i) : strSet.find(str);
+        return configs ? *configs : ConfigSet();
     }
 
     ConfigSet filter(const SegmentList& segments) const
     {
         ConfigSet configs;
+        auto onMatch = [&] (const ConfigSet& matches) { configs |= matches; };
 
-        segments.forEach([&](int i, std::string str, float) {
-                    configs |= filter(i, str);
-                });
+        intSet.forEachMatch(segments.ints, onMatch);
+        strSet.forEachMatch(segments.strings, onMatch);
+
+        if (!strSet.empty()) {
+            for (int i : segments.ints) {
+                if (i >= 0) continue;
+                const ConfigSet* matches = strSet.find(std::to_string(i));
+                if (matches) configs |= *matches;
+            }
+        }
 
         return configs;
     }
@@ -509,21 +702,17 @@ private:
 
     void setConfig(unsigned cfgIndex, const SegmentList& segments, bool value)
     {
-        segments.forEach([&](int i, std::string str, float) {
-                    if (i >= 0) intSet[i].set(cfgIndex, value);
-                    else strSet[str].set(cfgIndex, value);
-                });
-    }
+        for (int i : segments.ints) {
+            if (i >= 0) intSet.set(i, cfgIndex, value);
+            else strSet.set(std::to_string(i), cfgIndex, value);
+        }
 
-    template<typename K>
-    ConfigSet get(const std::unordered_map<K, ConfigSet>& m, K k) const
-    {
-        auto it = m.find(k);
-        return it != m.end() ? it->second : ConfigSet();
+        for (const auto& str : segments.strings)
+            strSet.set(str, cfgIndex, value);
     }
 
-    std::unordered_map<int, ConfigSet> intSet;
-    std::unordered_map<std::string, ConfigSet> strSet;
+    SortedKeyIndex<int> intSet;
+    SortedKeyIndex<std::string> strSet;
 };
 
 
@@ -35,15 +35,8 @@ setConfig(unsigned cfgIndex, const AgentConfig& config, bool value)
         segment.exchange.setIncludeExclude(
                 cfgIndex, value, entry.second.applyToExchanges);
 
-        if (entry.second.excludeIfNotPresent) {
-            if (value && segment.excludeIfNotPresent.empty())
-                excludeIfNotPresent.insert(entry.first);
-
+        if (entry.second.excludeIfNotPresent)
             segment.excludeIfNotPresent.set(cfgIndex, value);
-
-            if (!value && segment.excludeIfNotPresent.empty())
-                excludeIfNotPresent.erase(entry.first);
-        }
     }
 }
 
@@ -84,25 +77,36 @@ void
 SegmentsFilter::
 filter(FilterState& state) const
 {
-    unordered_set<string> toCheck = excludeIfNotPresent;
+    /* Both the segments of the request and our data are sorted by source so
+       we walk them together. Any source we skip over is missing from the
+       request.
+    */
+    auto onMissing = [&] (const SegmentData& segment) {
+        if (segment.excludeIfNotPresent.empty()) return;
+
+        ConfigSet result = segment.excludeIfNotPresent.negate();
+        state.narrowConfigs(segment.applyExchangeFilter(state, result));
+    };
+
+    auto it = data.begin(), end = data.end();
 
     for (const auto& segment : state.request.segments) {
-        toCheck.erase(segment.first);
+        for (; it != end && it->first < segment.first; ++it) {
+            onMissing(it->second);
+            if (state.configs().empty()) return;
+        }
 
-        auto it = data.find(segment.first);
-        if (it == data.end()) continue;
+        if (it == end || it->first != segment.first) continue;
 
         ConfigSet result = it->second.ie.filter(*segment.second);
         state.narrowConfigs(it->second.applyExchangeFilter(state, result));
         if (state.configs().empty()) return;
-    }
 
-    for (const auto& segment : toCheck) {
-        auto it = data.find(segment);
-        if (it == data.end()) continue;
+        ++it;
+    }
 
-        ConfigSet result = it->second.excludeIfNotPresent.negate();
-        state.narrowConfigs(it->second.applyExchangeFilter(state, result));
+    for (; it != end; ++it) {
+        onMissing(it->second);
         if (state.configs().empty()) return;
     }
 }
@@ -131,7 +135,7 @@ setConfig(unsigned cfgIndex, const AgentConfig& config, bool value)
     ExcAssertEqual(entry.modulus, part.modulus);
     ExcAssertEqual(entry.hashOn, part.hashOn);
 
-    entry.excludeIfEmpty.set(cfgIndex);
+    entry.excludeIfEmpty.set(cfgIndex, value);
 
     if (value) entry.filter.addConfig(cfgIndex, part.includeRanges);
     else entry.filter.removeConfig(cfgIndex, part.includeRanges);
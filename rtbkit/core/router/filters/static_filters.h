@@ -14,6 +14,7 @@
 #include "jml/utils/compact_vector.h"
 
 #include <array>
+#include <map>
 #include <unordered_map>
 #include <unordered_set>
 #include <mutex>
@@ -31,6 +32,11 @@ struct SegmentsFilter : public FilterBaseT<SegmentsFilter>
     static constexpr const char* name = "Segments";
     unsigned priority() const { return Priority::Segments; }
 
+    bool isAffected(const AgentConfig& oldConfig, const AgentConfig& newConfig) const
+    {
+        return !isSame(oldConfig.segments, newConfig.segments);
+    }
+
     void setConfig(unsigned configIndex, const AgentConfig& config, bool value);
     void filter(FilterState& state) const;
 
@@ -48,8 +54,10 @@ private:
                 FilterState& state, const ConfigSet& result) const;
     };
 
-    std::unordered_map<std::string, SegmentData> data;
-    std::unordered_set<std::string> excludeIfNotPresent;
+    /* Kept sorted by source so that it can be walked alongside the sorted
+       segments of a request.
+    */
+    std::map<std::string, SegmentData> data;
 };
 
 
@@ -62,6 +70,11 @@ struct UserPartitionFilter : public FilterBaseT<UserPartitionFilter>
     static constexpr const char* name = "UserPartition";
     unsigned priority() const { return Priority::UserPartition; }
 
+    bool isAffected(const AgentConfig& oldConfig, const AgentConfig& newConfig) const
+    {
+        return !isSame(oldConfig.userPartition, newConfig.userPartition);
+    }
+
     void setConfig(unsigned cfgIndex, const AgentConfig& config, bool value);
     void filter(FilterState& state) const;
 
@@ -102,6 +115,12 @@ struct HourOfWeekFilter : public FilterBaseT<HourOfWeekFilter>
     static constexpr const char* name = "HourOfWeek";
     unsigned priority() const { return Priority::HourOfWeek; }
 
+    bool isAffected(const AgentConfig& oldConfig, const AgentConfig& newConfig) const
+    {
+        return oldConfig.hourOfWeekFilter.hourBitmap
+            != newConfig.hourOfWeekFilter.hourBitmap;
+    }
+
     void setConfig(unsigned configIndex, const AgentConfig& config, bool value)
     {
         const auto& bitmap = config.hourOfWeekFilter.hourBitmap;
@@ -132,6 +151,11 @@ struct UrlFilter : public FilterBaseT<UrlFilter>
     static constexpr const char* name = "Url";
     unsigned priority() const { return Priority::Url; }
 
+    bool isAffected(const AgentConfig& oldConfig, const AgentConfig& newConfig) const
+    {
+        return !isSame(oldConfig.urlFilter, newConfig.urlFilter);
+    }
+
     void setConfig(unsigned configIndex, const AgentConfig& config, bool value)
     {
         impl.setIncludeExclude(configIndex, value, config.urlFilter);
@@ -157,6 +181,11 @@ struct HostFilter : public FilterBaseT<HostFilter>
     static constexpr const char* name = "Host";
     unsigned priority() const { return Priority::Host; }
 
+    bool isAffected(const AgentConfig& oldConfig, const AgentConfig& newConfig) const
+    {
+        return !isSame(oldConfig.hostFilter, newConfig.hostFilter);
+    }
+
     void setConfig(unsigned configIndex, const AgentConfig& config, bool value)
     {
         impl.setIncludeExclude(configIndex, value, config.hostFilter);
@@ -181,6 +210,11 @@ struct LanguageFilter : public FilterBaseT<LanguageFilter>
     static constexpr const char* name = "Language";
     unsigned priority() const { return Priority::Language; }
 
+    bool isAffected(const AgentConfig& oldConfig, const AgentConfig& newConfig) const
+    {
+        return !isSame(oldConfig.languageFilter, newConfig.languageFilter);
+    }
+
     void setConfig(unsigned configIndex, const AgentConfig& config, bool value)
     {
         impl.setIncludeExclude(configIndex, value, config.languageFilter);
@@ -206,6 +240,11 @@ struct LocationFilter : public FilterBaseT<LocationFilter>
     static constexpr const char* name = "Location";
     unsigned priority() const { return Priority::Location; }
 
+    bool isAffected(const AgentConfig& oldConfig, const AgentConfig& newConfig) const
+    {
+        return !isSame(oldConfig.locationFilter, newConfig.locationFilter);
+    }
+
     void setConfig(unsigned configIndex, const AgentConfig& config, bool value)
     {
         impl.setIncludeExclude(configIndex, value, config.locationFilter);
@@ -272,6 +311,11 @@ struct ExchangeNameFilter : public FilterBaseT<ExchangeNameFilter>
     static constexpr const char* name = "ExchangeName";
     unsigned priority() const { return Priority::ExchangeName; }
 
+    bool isAffected(const AgentConfig& oldConfig, const AgentConfig& newConfig) const
+    {
+        return !isSame(oldConfig.exchangeFilter, newConfig.exchangeFilter);
+    }
+
 
     void setConfig(unsigned configIndex, const AgentConfig& config, bool value)
     {
@@ -297,6 +341,11 @@ struct FoldPositionFilter : public FilterBaseT<FoldPositionFilter>
     static constexpr const char* name = "FoldPosition";
     unsigned priority() const { return Priority::FoldPosition; }
 
+    bool isAffected(const AgentConfig& oldConfig, const AgentConfig& newConfig) const
+    {
+        return !isSame(oldConfig.foldPositionFilter, newConfig.foldPositionFilter);
+    }
+
     void setConfig(unsigned cfgIndex, const AgentConfig& config, bool value)
     {
         impl.setIncludeExclude(cfgIndex, value, config.foldPositionFilter);
@@ -324,6 +373,11 @@ struct RequiredIdsFilter : public FilterBaseT<RequiredIdsFilter>
     static constexpr const char* name = "RequireIds";
     unsigned priority() const { return Priority::RequiredIds; }
 
+    bool isAffected(const AgentConfig& oldConfig, const AgentConfig& newConfig) const
+    {
+        return oldConfig.requiredIds != newConfig.requiredIds;
+    }
+
     void setConfig(unsigned cfgIndex, const AgentConfig& config, bool value)
     {
         for (const auto& domain : config.requiredIds) {
@@ -257,6 +257,37 @@ BOOST_AUTO_TEST_CASE(segmentListTest)
     check(filter.filter(seg2),     { 0, 1 });
 }
 
+BOOST_AUTO_TEST_CASE(segmentListUnsortedTest)
+{
+    SegmentListFilter filter;
+
+    filter.addConfig(0, segment(5, 100, "x"));
+    filter.addConfig(1, segment(7, -3, "y"));
+    filter.addConfig(2, segment(1000, "z"));
+
+    // Lists built with add() and never sorted still have to match.
+    SegmentList unsorted;
+    unsorted.add(1000);
+    unsorted.add(7);
+    unsorted.add(2);
+    unsorted.add("z");
+    unsorted.add("x");
+
+    title("segment-unsorted-1");
+    check(filter.filter(unsorted), { 0, 1, 2 });
+
+    SegmentList negative;
+    negative.add(-3);
+    check(filter.filter(negative), { 1 });
+    check(filter.filter(-1, "-3"), { 1 });
+
+    title("segment-unsorted-2");
+    filter.removeConfig(2, segment(1000, "z"));
+    filter.removeConfig(0, segment(5, 100, "x"));
+    check(filter.filter(unsorted), { 1 });
+    check(filter.filter(segment(5, 100, 1000, "x", "z")), { });
+}
+
 BOOST_AUTO_TEST_CASE(includeExcludeFilterTest)
 {
     typedef ListFilter<size_t> BaseFilterT;
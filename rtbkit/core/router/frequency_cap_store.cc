@@ -0,0 +1,213 @@
+/* frequency_cap_store.cc
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Implementation of the frequency cap store.
+*/
+
+#include "frequency_cap_store.h"
+#include "rtbkit/common/bid_request.h"
+#include "jml/arch/exception.h"
+#include <mutex>
+#include <cmath>
+
+
+using namespace std;
+using namespace ML;
+using namespace Datacratic;
+
+
+namespace RTBKIT {
+
+namespace {
+
+inline uint64_t mix(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+bool hasUser(const Id & id)
+{
+    return id.type > Id::NULLID;
+}
+
+} // file scope
+
+
+/*****************************************************************************/
+/* FREQUENCY CAP STORE                                                       */
+/*****************************************************************************/
+
+FrequencyCapStore::
+FrequencyCapStore(double bucketWidth, unsigned numBuckets,
+                  size_t bucketCapacity)
+    : bucketWidth(bucketWidth), bucketCapacity(1), dropped_(0)
+{
+    if (bucketWidth <= 0.0)
+        throw Exception("frequency cap buckets need a positive width");
+    if (numBuckets < 2)
+        throw Exception("frequency cap store needs at least two buckets");
+
+    // Round up to a power of two so that we can mask instead of divide
+    while (this->bucketCapacity < bucketCapacity)
+        this->bucketCapacity *= 2;
+
+    buckets.resize(numBuckets);
+    for (auto & bucket: buckets) {
+        bucket.period = -1;
+        bucket.used = 0;
+    }
+}
+
+FrequencyCapStore *
+FrequencyCapStore::
+createFromJson(const Json::Value & json)
+{
+    double bucketWidth = 600.0;
+    unsigned numBuckets = 145;
+    size_t bucketCapacity = 1 << 15;
+
+    for (auto it = json.begin(), end = json.end();  it != end;  ++it) {
+        if (it.memberName() == "bucketWidth")
+            bucketWidth = it->asDouble();
+        else if (it.memberName() == "numBuckets")
+            numBuckets = it->asUInt();
+        else if (it.memberName() == "bucketCapacity")
+            bucketCapacity = it->asUInt();
+        else throw Exception("frequency cap store has invalid key: %s",
+                             it.memberName().c_str());
+    }
+
+    return new FrequencyCapStore(bucketWidth, numBuckets, bucketCapacity);
+}
+
+uint64_t
+FrequencyCapStore::
+getKey(const UserIds & uids, const AccountKey & account)
+{
+    const Id & user = hasUser(uids.providerId)
+        ? uids.providerId : uids.exchangeId;
+    if (!hasUser(user)) return 0;
+
+    uint64_t key = mix(user.hash() ^ mix(std::hash<string>()(account.at(0, ""))));
+    return key ? key : 1;
+}
+
+int64_t
+FrequencyCapStore::
+getPeriod(Date date) const
+{
+    return floor(date.secondsSinceEpoch() / bucketWidth);
+}
+
+void
+FrequencyCapStore::
+recordWin(const UserIds & uids, const AccountKey & account, Date timestamp)
+{
+    uint64_t key = getKey(uids, account);
+    if (!key) return;
+
+    int64_t period = getPeriod(timestamp);
+
+    std::lock_guard<ML::Spinlock> guard(lock);
+
+    Bucket & bucket = buckets[period % buckets.size()];
+
+    // Too old to be in any window that we can count over
+    if (bucket.period > period) return;
+
+    if (bucket.period < period) {
+        bucket.entries.resize(bucketCapacity);
+        std::fill(bucket.entries.begin(), bucket.entries.end(), Entry{0, 0});
+        bucket.used = 0;
+        bucket.period = period;
+    }
+
+    size_t mask = bucketCapacity - 1;
+    for (size_t i = mix(key) & mask;;  i = (i + 1) & mask) {
+        Entry & entry = bucket.entries[i];
+        if (entry.key == key) {
+            ++entry.count;
+            return;
+        }
+        if (entry.key == 0) {
+            // Keep a quarter of the table free so that probes stay short
+            if (bucket.used >= bucketCapacity - bucketCapacity / 4) {
+                ++dropped_;
+                return;
+            }
+            entry.key = key;
+            entry.count = 1;
+            ++bucket.used;
+            return;
+        }
+    }
+}
+
+unsigned
+FrequencyCapStore::
+countPeriods(uint64_t key, int64_t first, int64_t last) const
+{
+    first = std::max<int64_t>(first, last - buckets.size() + 1);
+
+    size_t mask = bucketCapacity - 1;
+    unsigned result = 0;
+
+    for (int64_t period = first;  period <= last;  ++period) {
+        const Bucket & bucket = buckets[period % buckets.size()];
+        if (bucket.period != period) continue;
+
+        for (size_t i = mix(key) & mask;;  i = (i + 1) & mask) {
+            const Entry & entry = bucket.entries[i];
+            if (entry.key == key) {
+                result += entry.count;
+                break;
+            }
+            if (entry.key == 0) break;
+        }
+    }
+
+    return result;
+}
+
+unsigned
+FrequencyCapStore::
+count(const UserIds & uids, const AccountKey & account,
+      double window, Date now) const
+{
+    uint64_t key = getKey(uids, account);
+    if (!key) return 0;
+
+    int64_t first = getPeriod(now.plusSeconds(-window));
+    int64_t last = getPeriod(now);
+
+    std::lock_guard<ML::Spinlock> guard(lock);
+    return countPeriods(key, first, last);
+}
+
+bool
+FrequencyCapStore::
+isCapped(const UserIds & uids, const AccountKey & account,
+         const vector<FrequencyCap> & caps, Date now) const
+{
+    uint64_t key = getKey(uids, account);
+    if (!key) return false;
+
+    int64_t last = getPeriod(now);
+
+    std::lock_guard<ML::Spinlock> guard(lock);
+
+    for (const FrequencyCap & cap: caps) {
+        int64_t first = getPeriod(now.plusSeconds(-cap.window));
+        if (countPeriods(key, first, last) >= cap.count)
+            return true;
+    }
+
+    return false;
+}
+
+} // namespace RTBKIT
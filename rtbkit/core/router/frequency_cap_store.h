@@ -0,0 +1,114 @@
+/* frequency_cap_store.h                                           -*- C++ -*-
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Bounded store of recent wins per user and campaign, used by the router
+   to enforce the frequency caps of its agents.
+*/
+
+#pragma once
+
+#include "rtbkit/common/account_key.h"
+#include "rtbkit/core/agent_configuration/agent_config.h"
+#include "soa/types/date.h"
+#include "jml/arch/spinlock.h"
+#include <vector>
+#include <cstdint>
+
+
+namespace RTBKIT {
+
+struct UserIds;
+
+
+/*****************************************************************************/
+/* FREQUENCY CAP STORE                                                       */
+/*****************************************************************************/
+
+/** Counts the wins for each (user, campaign) pair in a ring of time buckets.
+
+    Each bucket covers bucketWidth seconds and is a fixed size open
+    addressing hash table (allocated the first time it's written to), so
+    the memory used is bounded no matter how many users we see.  When time
+    moves on, the oldest bucket is recycled for the new period.  If a bucket
+    fills up, further wins for new pairs in that period are dropped (and
+    counted in dropped()).
+
+    Users without a provider or exchange id can't be told apart, so their
+    wins aren't recorded and they are never capped.
+
+    The number of wins in a window is the sum over the buckets that overlap
+    it, so it can include up to one bucket's worth of wins older than the
+    window.  That errs on the side of capping.  Windows longer than the
+    buckets retained are clamped to what's retained.
+
+    Lookups and updates are a few memory accesses under a spinlock, so it's
+    fine to call it for every bid request.
+*/
+struct FrequencyCapStore {
+
+    FrequencyCapStore(double bucketWidth = 600.0,
+                      unsigned numBuckets = 145,
+                      size_t bucketCapacity = 1 << 15);
+
+    /** Configure from JSON, with any of bucketWidth, numBuckets and
+        bucketCapacity.
+    */
+    static FrequencyCapStore * createFromJson(const Json::Value & json);
+
+    /** Record a win on the given user for the campaign of the account. */
+    void recordWin(const UserIds & uids, const AccountKey & account,
+                   Date timestamp = Date::now());
+
+    /** Number of wins on the user for the campaign of the account in the
+        window seconds before now.
+    */
+    unsigned count(const UserIds & uids, const AccountKey & account,
+                   double window, Date now = Date::now()) const;
+
+    /** Have any of the caps been reached for the user and the campaign of
+        the account?
+    */
+    bool isCapped(const UserIds & uids, const AccountKey & account,
+                  const std::vector<FrequencyCap> & caps,
+                  Date now = Date::now()) const;
+
+    /** Longest window that we can count over, in seconds. */
+    double maxWindow() const { return bucketWidth * (buckets.size() - 1); }
+
+    /** Number of wins we had no room for. */
+    uint64_t dropped() const { return dropped_; }
+
+    /** Key used for a user and campaign.  The provider id is used if there
+        is one as it's stable across exchanges; otherwise the exchange id.
+        Returns 0 if there is neither.
+    */
+    static uint64_t getKey(const UserIds & uids, const AccountKey & account);
+
+private:
+    struct Entry {
+        uint64_t key;     ///< 0 means that the entry is empty
+        uint32_t count;
+    };
+
+    struct Bucket {
+        int64_t period;   ///< Which period of time this bucket is for
+        size_t used;
+        std::vector<Entry> entries;
+    };
+
+    int64_t getPeriod(Date date) const;
+
+    /** Number of wins for the key in the periods between first and last
+        inclusive.  Must be called with the lock held.
+    */
+    unsigned countPeriods(uint64_t key, int64_t first, int64_t last) const;
+
+    double bucketWidth;
+    size_t bucketCapacity;
+    std::vector<Bucket> buckets;
+    uint64_t dropped_;
+
+    mutable ML::Spinlock lock;
+};
+
+} // namespace RTBKIT
@@ -34,6 +34,7 @@
 #include "rtbkit/common/messages.h"
 #include "rtbkit/common/win_cost_model.h"
 #include "rtbkit/common/bidder_interface.h"
+#include "soa/utils/object_pool.h"
 
 using namespace std;
 using namespace ML;
@@ -127,6 +128,7 @@ Router(ServiceBase & parent,
       auctionGraveyard(65536),
       doBidBuffer(65536),
       augmentationLoop(*this),
+      winEvents(getZmqContext()),
       loopMonitor(*this),
       loadStabilizer(loopMonitor),
       secondsUntilLossAssumed_(secondsUntilLossAssumed),
@@ -143,6 +145,7 @@ Router(ServiceBase & parent,
       logger(getZmqContext()),
       doDebug(false),
       disableAuctionProb(false),
+      exchangeThreadSelection(false),
       numAuctions(0), numBids(0), numNonEmptyBids(0),
       numAuctionsWithBid(0), numNoPotentialBidders(0),
       numNoBidders(0),
@@ -177,6 +180,7 @@ Router(std::shared_ptr<ServiceProxies> services,
       auctionGraveyard(65536),
       doBidBuffer(65536),
       augmentationLoop(*this),
+      winEvents(getZmqContext()),
       loopMonitor(*this),
       loadStabilizer(loopMonitor),
       secondsUntilLossAssumed_(secondsUntilLossAssumed),
@@ -193,6 +197,7 @@ Router(std::shared_ptr<ServiceProxies> services,
       logger(getZmqContext()),
       doDebug(false),
       disableAuctionProb(false),
+      exchangeThreadSelection(false),
       numAuctions(0), numBids(0), numNonEmptyBids(0),
       numAuctionsWithBid(0), numNoPotentialBidders(0),
       numNoBidders(0),
@@ -216,6 +221,21 @@ initBidderInterface(Json::Value const & json)
     bidder->registerLoopMonitor(&loopMonitor);
 }
 
+void
+Router::
+initAugmentorCaches(Json::Value const & json)
+{
+    augmentationLoop.initAugmentorCaches(json);
+}
+
+void
+Router::
+initFrequencyCaps(Json::Value const & json)
+{
+    ExcAssert(!initialized);
+    frequencyCaps.reset(FrequencyCapStore::createFromJson(json));
+}
+
 void
 Router::
 initAnalytics(const string & baseUrl, const int numConnections)
@@ -244,6 +264,20 @@ init()
 
     augmentationLoop.init();
 
+    if (frequencyCaps) {
+        filters.initFrequencyCaps(frequencyCaps);
+
+        winEvents.init(getServices()->config);
+        winEvents.messageHandler = [=] (const vector<zmq::message_t> & msg)
+            {
+                AccountKey account(msg.at(19).toString());
+                UserIds uids = UserIds::createFromString(msg.at(15).toString());
+                frequencyCaps->recordWin(uids, account);
+            };
+        winEvents.connectAllServiceProviders(
+                "rtbPostAuctionService", "logger", { "MATCHEDWIN" });
+    }
+
     logger.init(getServices()->config, serviceName() + "/logger");
 
     bridge.agents.init(getServices()->config, serviceName() + "/agents");
@@ -278,6 +312,7 @@ init()
     loopMonitor.init();
     loopMonitor.addMessageLoop("augmentationLoop", &augmentationLoop);
     loopMonitor.addMessageLoop("logger", &logger);
+    if (frequencyCaps) loopMonitor.addMessageLoop("winEvents", &winEvents);
     loopMonitor.addMessageLoop("configListener", &configListener);
     loopMonitor.addMessageLoop("monitorClient", &monitorClient);
     loopMonitor.addMessageLoop("monitorProviderClient", &monitorProviderClient);
@@ -327,6 +362,14 @@ bindTcp()
     bridge.agents.bindTcp(getServices()->ports->getRange("router"));
 }
 
+void
+Router::
+bindShm()
+{
+    bridge.agents.bindShm();
+    augmentationLoop.bindShm();
+}
+
 void
 Router::
 bindAgents(std::string agentUri)
@@ -368,6 +411,13 @@ unsafeDisableAuctionProbability()
     disableAuctionProb = true;
 }
 
+void
+Router::
+enableExchangeThreadSelection()
+{
+    exchangeThreadSelection = true;
+}
+
 void
 Router::
 start(boost::function<void ()> onStop)
@@ -390,6 +440,7 @@ start(boost::function<void ()> onStop)
     logger.start();
     analytics.start();
     augmentationLoop.start();
+    if (frequencyCaps) winEvents.start();
     runThread.reset(new boost::thread(runfn));
 
     if (connectPostAuctionLoop) {
@@ -772,6 +823,7 @@ shutdown()
     wakeupMainLoop.signal();
 
     augmentationLoop.shutdown();
+    winEvents.shutdown();
 
     if (runThread)
         runThread->join();
@@ -826,7 +878,7 @@ injectAuction(Auction::HandleAuction onAuctionFinished,
               double expiryTime,
               double lossTime)
 {
-    auto auction = std::make_shared<Auction>(
+    auto auction = makePooled<Auction>(
         nullptr,
         onAuctionFinished,
         request,
@@ -1174,7 +1226,7 @@ checkExpiredAuctions()
 #endif
 
                 // end the auction when it expires in case we're waiting on dead agents
-        if(!auctionInfo.auction->getResponses().empty()) {
+        if(auctionInfo.auction->numSpots() != 0) {
                     if(!auctionInfo.auction->finish()) {
                 this->recordHit("tooLateToFinish");
             }
@@ -1333,6 +1385,24 @@ augmentAuction(const std::shared_ptr<AugmentationInfo> & info)
                              onDoneAugmenting);
 }
 
+namespace {
+
+/** Cheap per-thread random number.  preprocessAuction runs on the exchange
+    connector threads and random() takes a lock that they would all share.
+*/
+uint64_t threadRandom()
+{
+    static __thread uint64_t state = 0;
+    if (JML_UNLIKELY(!state))
+        state = (uint64_t)&state ^ 0x9e3779b97f4a7c15ULL;
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+} // file scope
+
 std::shared_ptr<AugmentationInfo>
 Router::
 preprocessAuction(const std::shared_ptr<Auction> & auction)
@@ -1435,6 +1505,10 @@ preprocessAuction(const std::shared_ptr<Auction> & auction)
         bidder.config = entry.config;
         bidder.stats = entry.stats;
         bidder.imp = std::move(entry.biddableSpots);
+        if (exchangeThreadSelection) {
+            bidder.inFlightProp = float(entry.status->numBidsInFlight)
+                / max(entry.config->maxInFlight, 1);
+        }
 
         groupAgents[rrGroup].push_back(bidder);
         groupAgents[rrGroup].totalBidProbability += entry.config->bidProbability;
@@ -1452,7 +1526,7 @@ preprocessAuction(const std::shared_ptr<Auction> & auction)
             * globalBidProbability;
 
         if (bidProbability < 1.0) {
-            float val = (random() % 1000000) / 1000000.0;
+            float val = (threadRandom() % 1000000) / 1000000.0;
             if (val > bidProbability) {
                 for (unsigned i = 0;  i < it->second.size();  ++i)
                     ML::atomic_inc(it->second[i].stats->skippedBidProbability);
@@ -1460,6 +1534,9 @@ preprocessAuction(const std::shared_ptr<Auction> & auction)
             }
         }
 
+        if (exchangeThreadSelection)
+            it->second.selectBidder(threadRandom());
+
         // Group is valid for bidding; next step is to augment the bid
         // request
         validGroups.push_back(it->second);
@@ -1478,7 +1555,7 @@ preprocessAuction(const std::shared_ptr<Auction> & auction)
         return std::shared_ptr<AugmentationInfo>();
     }
 
-    auto info = std::make_shared<AugmentationInfo>(auction, lossTimeout);
+    auto info = makePooled<AugmentationInfo>(auction, lossTimeout);
     info->potentialGroups.swap(validGroups);
 
     auction->outOfPrepro = Date::now();
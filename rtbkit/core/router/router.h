@@ -21,6 +21,7 @@
 #include "soa/service/pending_list.h"
 #include "soa/service/loop_monitor.h"
 #include "augmentation_loop.h"
+#include "frequency_cap_store.h"
 #include "router_types.h"
 #include "soa/gc/gc_lock.h"
 #include "jml/utils/ring_buffer.h"
@@ -140,6 +141,17 @@ struct Router : public ServiceBase,
     /** Initialize the bidder interface. */
     void initBidderInterface(Json::Value const & json);
 
+    /** Initialize the router-side caches of augmentor responses.  The
+        configuration maps augmentor names to an AugmentationCacheConfig.
+    */
+    void initAugmentorCaches(Json::Value const & json);
+
+    /** Initialize the store of recent wins used to enforce the frequency
+        caps of the agents, configured as in FrequencyCapStore::createFromJson.
+        The store is fed with the matched wins from the post auction loop.
+    */
+    void initFrequencyCaps(Json::Value const & json);
+
     /** Initialize analytics if it is used. */
     void initAnalytics(const std::string & baseUrl, const int numConnections);
 
@@ -149,6 +161,11 @@ struct Router : public ServiceBase,
     /** Bind to TCP/IP ports and publish where to connect to. */
     void bindTcp();
 
+    /** Also accept agents and augmentors running on this host over shared
+        memory rather than zeroMQ.  Must be called after init().
+    */
+    void bindShm();
+
     /** Bind a zeroMQ URI for the agent to listen on. */
     void bindAgents(std::string agentUri);
 
@@ -165,6 +182,19 @@ struct Router : public ServiceBase,
     */
     void unsafeDisableAuctionProbability();
 
+    /** Pick the agent that gets the auction in each round robin group on the
+        exchange connector thread that preprocessed it, rather than in the
+        router loop, so that only one agent per group is left for the router
+        loop to check.  Only groups whose agents need no augmentation, have
+        no blacklist and need the same time to bid are picked early, so that
+        the router loop can't filter out the picked agent but not the
+        others.  The pick uses the in-flight counts seen by the exchange
+        thread, which lag behind the router loop's, so agents that are
+        getting close to their maxInFlight aren't picked (see
+        GroupPotentialBidders::selectBidder()).
+    */
+    void enableExchangeThreadSelection();
+
     /** Start the router running in a separate thread.  The given function
         will be called when the thread is stopped. */
     virtual void
@@ -416,6 +446,12 @@ public:
     AugmentationLoop augmentationLoop;
     Blacklist blacklist;
 
+    /** Wins per user and campaign, for the frequency caps.  Null if they
+        aren't enforced.
+    */
+    std::shared_ptr<FrequencyCapStore> frequencyCaps;
+    ZmqNamedMultipleSubscriber winEvents;
+
     LoopMonitor loopMonitor;
     LoadStabilizer loadStabilizer;
 
@@ -754,6 +790,9 @@ public:
     /* Disable auction probability for testing only : don't drop any BR*/ 
     bool disableAuctionProb;
 
+    /* Round robin groups get their agent picked in preprocessAuction */
+    bool exchangeThreadSelection;
+
     mutable ML::Spinlock debugLock;
     TimeoutMap<Id, AuctionDebugInfo> debugInfo;
 
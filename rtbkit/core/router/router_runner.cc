@@ -50,6 +50,8 @@ RouterRunner() :
     noPostAuctionLoop(false),
     logAuctions(false),
     logBids(false),
+    shmTransport(false),
+    exchangeThreadSelection(false),
     maxBidPrice(40),
     slowModeTimeout(MonitorClient::DefaultCheckTimeout),
     slowModeTolerance(MonitorClient::DefaultTolerance),
@@ -82,10 +84,18 @@ doOptions(int argc, char ** argv,
          "configuration file with exchange data")
         ("bidder,b", value<string>(&bidderConfigurationFile),
          "configuration file with bidder interface data")
+        ("augmentor-cache-configuration", value<string>(&augmentorCacheConfigurationFile),
+         "configuration file with augmentor response caches")
+        ("frequency-cap-configuration", value<string>(&frequencyCapConfigurationFile),
+         "configuration file for the store of wins used to enforce agents' frequency caps")
         ("log-auctions", value<bool>(&logAuctions)->zero_tokens(),
          "log auction requests")
         ("log-bids", value<bool>(&logBids)->zero_tokens(),
          "log bid responses")
+        ("shm-transport", value<bool>(&shmTransport)->zero_tokens(),
+         "let agents and augmentors on this host connect over shared memory")
+        ("exchange-thread-selection", value<bool>(&exchangeThreadSelection)->zero_tokens(),
+         "pick the agent of each round robin group on the exchange threads")
         ("max-bid-price", value(&maxBidPrice),
          "maximum bid price accepted by router")
         ("slow-mode-money-limit,s", value<string>(&slowModeMoneyLimit)->default_value("100000USD/1M"),
@@ -146,7 +156,13 @@ init()
                                       USD_CPM(maxBidPrice),
                                       slowModeTimeout, amountSlowModeMoneyLimit);
     router->slowModeTolerance = slowModeTolerance;
+    if (exchangeThreadSelection)
+        router->enableExchangeThreadSelection();
     router->initBidderInterface(bidderConfig);
+    if (!augmentorCacheConfigurationFile.empty())
+        router->initAugmentorCaches(loadJsonFromFile(augmentorCacheConfigurationFile));
+    if (!frequencyCapConfigurationFile.empty())
+        router->initFrequencyCaps(loadJsonFromFile(frequencyCapConfigurationFile));
     if (analyticsOn) {
         const auto & analyticsUri = proxies->params["analytics-uri"].asString();
         if (!analyticsUri.empty()) {
@@ -161,6 +177,8 @@ init()
 
     router->setBanker(banker);
     router->bindTcp();
+    if (shmTransport)
+        router->bindShm();
 }
 
 void
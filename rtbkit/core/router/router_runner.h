@@ -31,6 +31,8 @@ struct RouterRunner {
 
     std::string exchangeConfigurationFile;
     std::string bidderConfigurationFile;
+    std::string augmentorCacheConfigurationFile;
+    std::string frequencyCapConfigurationFile;
 
     float lossSeconds;
     bool noPostAuctionLoop;
@@ -38,6 +40,9 @@ struct RouterRunner {
     bool logAuctions;
     bool logBids;
 
+    bool shmTransport;
+    bool exchangeThreadSelection;
+
     float maxBidPrice;
     std::string bankerUri;
 
@@ -230,6 +230,47 @@ toJson() const
 }
 
 
+/*****************************************************************************/
+/* GROUP POTENTIAL BIDDERS                                                   */
+/*****************************************************************************/
+
+constexpr float GroupPotentialBidders::MaxSelectedInFlightProp;
+
+void
+GroupPotentialBidders::
+selectBidder(uint64_t random)
+{
+    if (size() < 2) return;
+
+    // The router loop checks the augmentations and blacklist against what
+    // only it knows.  It also checks the time that's left, which only
+    // filters out all the agents alike if they all need the same.
+    float minTimeAvailableMs = front().config->minTimeAvailableMs;
+    for (const auto & bidder : *this) {
+        const AgentConfig & config = *bidder.config;
+        if (!config.augmentations.empty() || config.hasBlacklist()) return;
+        if (config.minTimeAvailableMs != minTimeAvailableMs) return;
+    }
+
+    size_t numCandidates = 0;
+    for (const auto & bidder : *this)
+        if (bidder.inFlightProp < MaxSelectedInFlightProp)
+            ++numCandidates;
+    if (numCandidates == 0) return;
+
+    size_t pick = random % numCandidates;
+    for (auto & bidder : *this) {
+        if (bidder.inFlightProp >= MaxSelectedInFlightProp) continue;
+        if (pick-- != 0) continue;
+
+        PotentialBidder selected = std::move(bidder);
+        clear();
+        push_back(std::move(selected));
+        return;
+    }
+}
+
+
 /*****************************************************************************/
 /* BIDDABLE SPOTS                                                            */
 /*****************************************************************************/
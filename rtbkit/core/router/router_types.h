@@ -261,6 +261,19 @@ struct GroupPotentialBidders : public std::vector<PotentialBidder> {
         : totalBidProbability(0.0)
     {
     }
+
+    /** Only keep the agent that the router loop would send the auction to,
+        picked at random (from the given random number) among the ones that
+        have room for more bids in flight.  The group is left whole when the
+        router loop could still filter out that agent but not the others.
+    */
+    void selectBidder(uint64_t random);
+
+    /** Agents that already have this proportion of their maxInFlight bids in
+        flight aren't picked by selectBidder(): the auctions ahead of this
+        one can add more before the router loop gets to it.
+    */
+    static constexpr float MaxSelectedInFlightProp = 0.5;
     
     double totalBidProbability;
 };
@@ -15,10 +15,12 @@ $(eval $(call library,static_filters,$(LIB_FILTERS_SOURCES),$(LIB_FILTERS_LINK))
 
 LIBRTB_ROUTER_SOURCES := \
 	augmentation_loop.cc \
+	augmentation_cache.cc \
 	router.cc \
 	router_types.cc \
 	router_stack.cc \
-	filter_pool.cc
+	filter_pool.cc \
+	frequency_cap_store.cc
 
 LIBRTB_ROUTER_LINK := \
 	rtb zeromq boost_thread logger opstats crypto++ leveldb gc services redis banker agent_configuration monitor monitor_service post_auction static_filters openrtb
@@ -0,0 +1,220 @@
+/* auction_pool_bench.cc
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Stress test of the creation and destruction of auctions, counting the
+   allocator calls made per auction with and without the object pools.
+
+   Each auction is created the way the exchange connector and router do it
+   (a bid request, an Auction and an AugmentationInfo) and then released on
+   a separate thread via a graveyard, as the router's auction deleter does.
+*/
+
+#include "rtbkit/core/router/augmentation_loop.h"
+#include "rtbkit/common/auction.h"
+#include "soa/utils/object_pool.h"
+#include "jml/utils/ring_buffer.h"
+#include "jml/arch/timers.h"
+
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/parsers.hpp>
+#include <boost/program_options/variables_map.hpp>
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <stdlib.h>
+
+using namespace std;
+using namespace ML;
+using namespace Datacratic;
+using namespace RTBKIT;
+
+
+/*****************************************************************************/
+/* ALLOCATION COUNTING                                                       */
+/*****************************************************************************/
+
+namespace {
+
+std::atomic<uint64_t> numNew(0);
+std::atomic<uint64_t> numDelete(0);
+
+} // file scope
+
+void * operator new(size_t size)
+{
+    ++numNew;
+    void * result = malloc(size ? size : 1);
+    if (!result)
+        throw std::bad_alloc();
+    return result;
+}
+
+void operator delete(void * mem) noexcept
+{
+    if (!mem)
+        return;
+    ++numDelete;
+    free(mem);
+}
+
+void * operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete[](void * mem) noexcept
+{
+    operator delete(mem);
+}
+
+
+/*****************************************************************************/
+/* BENCH                                                                     */
+/*****************************************************************************/
+
+namespace {
+
+BidRequest makeBidRequest()
+{
+    BidRequest bidRequest;
+
+    FormatSet formats;
+    formats.push_back(Format(160,600));
+    AdSpot spot;
+    spot.id = Id(1);
+    spot.formats = formats;
+    bidRequest.imp.push_back(spot);
+
+    formats[0] = Format(300,250);
+    spot.id = Id(2);
+    bidRequest.imp.push_back(spot);
+
+    bidRequest.location.countryCode = "CA";
+    bidRequest.location.regionCode = "QC";
+    bidRequest.location.cityName = "Montreal";
+    bidRequest.auctionId = Id("6f9d0a1c-7c0b-4a8e-9a37-2f3d8c1e5b42");
+    bidRequest.exchange = "mock";
+    bidRequest.language = "en";
+    bidRequest.url = Url("http://datacratic.com/some/page/with/a/long/path");
+    bidRequest.userAgent = "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36";
+    bidRequest.userIds.add(Id("user1234567890abcdef"), ID_EXCHANGE);
+    bidRequest.timestamp = Date::now();
+
+    return bidRequest;
+}
+
+/** Release a bid request allocated with the global operator new. */
+void deleteUnpooled(BidRequest * request)
+{
+    request->~BidRequest();
+    ::operator delete(request);
+}
+
+struct Result {
+    double newPerAuction;
+    double deletePerAuction;
+    double auctionsPerSecond;
+};
+
+Result run(bool pooled, size_t numAuctions)
+{
+    const BidRequest proto = makeBidRequest();
+    const std::string protoStr(1024, 'x');  // Stands in for the raw request
+    Auction::HandleAuction handleAuction = [] (std::shared_ptr<Auction>) {};
+
+    typedef std::shared_ptr<AugmentationInfo> Ptr;
+    ML::RingBufferSWMR<Ptr> graveyard(65536);
+    std::atomic<bool> finished(false);
+
+    auto deleter = [&] ()
+        {
+            Ptr toDelete;
+            while (!finished || graveyard.tryPop(toDelete))
+                graveyard.tryPop(toDelete, 0.001);
+        };
+
+    // Warm up the pools and the allocator, then measure
+    for (unsigned pass = 0;  pass < 2;  ++pass) {
+        finished = false;
+        std::thread deleterThread(deleter);
+
+        uint64_t newBefore = numNew, deleteBefore = numDelete;
+        Date start = Date::now();
+
+        size_t n = pass == 0 ? numAuctions / 10 : numAuctions;
+        for (size_t i = 0;  i < n;  ++i) {
+            std::shared_ptr<BidRequest> request;
+            std::shared_ptr<Auction> auction;
+            Ptr info;
+
+            Date now = Date::now();
+
+            if (pooled) {
+                request.reset(new BidRequest(proto));
+                auction = makePooled<Auction>(nullptr, handleAuction,
+                                              request, protoStr,
+                                              "datacratic", now,
+                                              now.plusSeconds(0.1));
+                info = makePooled<AugmentationInfo>(auction, now);
+            }
+            else {
+                request.reset(::new BidRequest(proto), deleteUnpooled);
+                auction = std::make_shared<Auction>(nullptr, handleAuction,
+                                                    request, protoStr,
+                                                    "datacratic", now,
+                                                    now.plusSeconds(0.1));
+                info = std::make_shared<AugmentationInfo>(auction, now);
+            }
+
+            request.reset();
+            auction.reset();
+            graveyard.push(std::move(info));
+        }
+
+        finished = true;
+        deleterThread.join();
+
+        if (pass == 1) {
+            double elapsed = Date::now().secondsSince(start);
+            Result result;
+            result.newPerAuction = 1.0 * (numNew - newBefore) / n;
+            result.deletePerAuction = 1.0 * (numDelete - deleteBefore) / n;
+            result.auctionsPerSecond = n / elapsed;
+            return result;
+        }
+    }
+
+    throw ML::Exception("not reached");
+}
+
+} // file scope
+
+int main(int argc, char ** argv)
+{
+    using namespace boost::program_options;
+
+    size_t numAuctions = 1000000;
+
+    options_description opt("Bench options");
+    opt.add_options()
+        ("auctions,n", value<size_t>(&numAuctions),
+         "number of auctions to create")
+        ("help,h", "print this message");
+
+    variables_map vm;
+    store(command_line_parser(argc, argv).options(opt).run(), vm);
+    notify(vm);
+
+    if (vm.count("help")) {
+        cerr << opt << endl;
+        return 1;
+    }
+
+    for (bool pooled: { false, true }) {
+        Result result = run(pooled, numAuctions);
+        cerr << (pooled ? "pooled:   " : "unpooled: ")
+             << result.newPerAuction << " new and "
+             << result.deletePerAuction << " delete per auction, "
+             << result.auctionsPerSecond << " auctions/s" << endl;
+    }
+}
@@ -0,0 +1,115 @@
+/* augmentation_cache_test.cc
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Test for the router-side augmentation cache.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include "rtbkit/core/router/augmentation_cache.h"
+
+
+using namespace std;
+using namespace ML;
+using namespace Datacratic;
+using namespace RTBKIT;
+
+namespace {
+
+AugmentationList makeAugmentations(const std::string & tag)
+{
+    AugmentationList result;
+    result.insertGlobal(Augmentation(std::set<std::string>{ tag }));
+    return result;
+}
+
+} // file scope
+
+BOOST_AUTO_TEST_CASE( test_cache_hit_and_expiry )
+{
+    AugmentationCacheConfig config;
+    config.ttl = 10.0;
+    AugmentationCache cache(config);
+
+    Date now = Date::now();
+    Id user("user1");
+    set<string> agents = { "a1", "a2" };
+
+    AugmentationList result;
+    BOOST_CHECK(!cache.get(user, agents, result, now));
+    BOOST_CHECK_EQUAL(cache.misses, 1);
+
+    cache.put(user, agents, makeAugmentations("tag1"), now);
+    BOOST_CHECK_EQUAL(cache.size(), 1);
+
+    BOOST_CHECK(cache.get(user, agents, result, now.plusSeconds(5)));
+    BOOST_CHECK_EQUAL(cache.hits, 1);
+    BOOST_CHECK_EQUAL(result.filterForAccount(AccountKey()).tags.count("tag1"), 1);
+
+    // A subset of the agents can use the cached response...
+    BOOST_CHECK(cache.get(user, { "a2" }, result, now));
+
+    // ... but not an agent that the augmentor wasn't asked about
+    BOOST_CHECK(!cache.get(user, { "a1", "a3" }, result, now));
+
+    // Entries are invalid once their time to live has passed
+    BOOST_CHECK(!cache.get(user, agents, result, now.plusSeconds(11)));
+    cache.expire(now.plusSeconds(11));
+    BOOST_CHECK_EQUAL(cache.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE( test_cache_bounded )
+{
+    AugmentationCacheConfig config;
+    config.maxEntries = 10;
+    AugmentationCache cache(config);
+
+    Date now = Date::now();
+    set<string> agents = { "a1" };
+
+    for (unsigned i = 0;  i < 100;  ++i) {
+        cache.put(Id(i + 1), agents, makeAugmentations("tag"),
+                  now.plusSeconds(i));
+        BOOST_CHECK_LE(cache.size(), 10);
+    }
+
+    BOOST_CHECK_EQUAL(cache.evictions, 90);
+
+    // The most recent entries are the ones kept
+    AugmentationList result;
+    BOOST_CHECK(cache.get(Id(100), agents, result, now.plusSeconds(99)));
+    BOOST_CHECK(!cache.get(Id(1), agents, result, now.plusSeconds(99)));
+
+    // Null user ids are never cached
+    cache.put(Id(), agents, makeAugmentations("tag"), now);
+    BOOST_CHECK(!cache.get(Id(), agents, result, now));
+}
+
+BOOST_AUTO_TEST_CASE( test_cache_config )
+{
+    Json::Value json;
+    json["userIdDomain"] = "xchg";
+    json["ttlSeconds"] = 30;
+    json["maxEntries"] = 1000;
+
+    auto config = AugmentationCacheConfig::fromJson(json);
+    BOOST_CHECK_EQUAL(config.userIdDomain, "xchg");
+    BOOST_CHECK_EQUAL(config.ttl, 30.0);
+    BOOST_CHECK_EQUAL(config.maxEntries, 1000);
+
+    json["unknownField"] = 1;
+    BOOST_CHECK_THROW(AugmentationCacheConfig::fromJson(json), std::exception);
+
+    BidRequest request;
+    request.userIds.add(Id("exchangeUser"), ID_EXCHANGE);
+    request.userIds.add(Id("providerUser"), ID_PROVIDER);
+
+    AugmentationCache cache(config);
+    BOOST_CHECK_EQUAL(cache.getUserId(request), Id("exchangeUser"));
+
+    config.userIdDomain = "other";
+    AugmentationCache cache2(config);
+    BOOST_CHECK(!cache2.getUserId(request).notNull());
+}
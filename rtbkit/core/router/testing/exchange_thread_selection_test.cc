@@ -0,0 +1,99 @@
+/* exchange_thread_selection_test.cc
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Test of the round robin agent picked on the exchange threads.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include "rtbkit/core/router/router_types.h"
+#include "rtbkit/core/agent_configuration/agent_config.h"
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+using namespace ML;
+using namespace RTBKIT;
+
+
+namespace {
+
+/** An agent with the given number of bids in flight, as preprocessAuction
+    sees it. */
+PotentialBidder makeBidder(const std::string & agent,
+                           int numBidsInFlight,
+                           int maxInFlight = 100,
+                           float minTimeAvailableMs = 5.0)
+{
+    auto config = std::make_shared<AgentConfig>();
+    config->augmentations.clear();  // not the default "random" one
+    config->maxInFlight = maxInFlight;
+    config->minTimeAvailableMs = minTimeAvailableMs;
+
+    PotentialBidder bidder;
+    bidder.agent = agent;
+    bidder.config = config;
+    bidder.inFlightProp = float(numBidsInFlight) / maxInFlight;
+    return bidder;
+}
+
+} // file scope
+
+BOOST_AUTO_TEST_CASE( test_select_bidder_skips_busy_agents )
+{
+    // Whatever the random number, the agent that's at its limit isn't the
+    // one left to bid
+    for (uint64_t random = 0;  random < 10;  ++random) {
+        GroupPotentialBidders group;
+        group.push_back(makeBidder("busy", 100));
+        group.push_back(makeBidder("idle", 10));
+        group.push_back(makeBidder("close", 60));
+
+        group.selectBidder(random);
+        BOOST_REQUIRE_EQUAL(group.size(), 1);
+        BOOST_CHECK_EQUAL(group[0].agent, "idle");
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_select_bidder_spreads_load )
+{
+    set<string> picked;
+    for (uint64_t random = 0;  random < 10;  ++random) {
+        GroupPotentialBidders group;
+        group.push_back(makeBidder("agent1", 0));
+        group.push_back(makeBidder("agent2", 20));
+
+        group.selectBidder(random);
+        BOOST_REQUIRE_EQUAL(group.size(), 1);
+        picked.insert(group[0].agent);
+    }
+
+    BOOST_CHECK_EQUAL(picked.size(), 2);
+}
+
+BOOST_AUTO_TEST_CASE( test_select_bidder_keeps_group )
+{
+    // Every agent is over or close to its limit; the router loop picks
+    GroupPotentialBidders busy;
+    busy.push_back(makeBidder("agent1", 100));
+    busy.push_back(makeBidder("agent2", 70));
+    busy.selectBidder(0);
+    BOOST_CHECK_EQUAL(busy.size(), 2);
+
+    // The router loop could run out of time for one but not the other
+    GroupPotentialBidders slow;
+    slow.push_back(makeBidder("agent1", 0, 100, 5.0));
+    slow.push_back(makeBidder("agent2", 0, 100, 20.0));
+    slow.selectBidder(0);
+    BOOST_CHECK_EQUAL(slow.size(), 2);
+
+    // Augmentations are only checked in the router loop
+    GroupPotentialBidders augmented;
+    augmented.push_back(makeBidder("agent1", 0));
+    augmented.push_back(makeBidder("agent2", 0));
+    auto config = std::make_shared<AgentConfig>(*augmented[1].config);
+    config->augmentations.resize(1);
+    augmented[1].config = config;
+    augmented.selectBidder(0);
+    BOOST_CHECK_EQUAL(augmented.size(), 2);
+}
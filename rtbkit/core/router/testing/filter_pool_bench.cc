@@ -0,0 +1,181 @@
+/* filter_pool_bench.cc
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Measures how many agent config updates per second the filter pool takes.
+   Each update is either a change that none of the filters look at (the bid
+   probability, as pushed by optimizers) or a change to the url filter.  It
+   compares replacing the config in place with removing it and adding it back,
+   which goes through every filter.
+*/
+
+#include "rtbkit/core/router/filter_pool.h"
+#include "rtbkit/core/router/router_types.h"
+#include "rtbkit/core/agent_configuration/agent_config.h"
+#include "rtbkit/common/bid_request.h"
+#include "jml/utils/exc_assert.h"
+#include "jml/arch/format.h"
+
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/parsers.hpp>
+#include <boost/program_options/variables_map.hpp>
+#include <iostream>
+
+using namespace std;
+using namespace ML;
+using namespace Datacratic;
+using namespace RTBKIT;
+
+
+namespace {
+
+Json::Value makeConfig(unsigned agent, unsigned version, bool changeUrl)
+{
+    Json::Value config;
+    config["account"][0] = ML::format("campaign%d", agent % 37);
+    config["account"][1] = ML::format("strategy%d", agent);
+    config["bidProbability"] = 0.1 + (version % 9) / 10.0;
+
+    unsigned urlVersion = changeUrl ? version : 0;
+    config["urlFilter"]["include"][0] = ML::format("^http://site%d\\.com/", agent % 50);
+    config["urlFilter"]["exclude"][0]
+        = ML::format("/private%d/%d", agent % 20, urlVersion);
+    config["hostFilter"]["include"][0] = ML::format("site%d.com", agent % 50);
+    config["hostFilter"]["include"][1] = "datacratic.com";
+    config["languageFilter"]["include"][0] = agent % 2 ? "en" : "fr";
+    config["locationFilter"]["include"][0] = ML::format("CA:QC:.*%d", agent % 10);
+    config["exchangeFilter"]["include"][0] = "mock";
+
+    Json::Value & segments = config["segmentFilter"]["segs"];
+    for (unsigned i = 0;  i < 10;  ++i)
+        segments["include"][i] = ML::format("seg%d", (agent * 7 + i) % 200);
+
+    for (unsigned i = 0;  i < 3;  ++i) {
+        Json::Value creative;
+        creative["format"] = i == 0 ? "300x250" : (i == 1 ? "160x600" : "728x90");
+        creative["id"] = i;
+        creative["name"] = ML::format("creative%d", i);
+        config["creatives"][i] = creative;
+    }
+
+    return config;
+}
+
+AgentInfo makeInfo(unsigned agent, unsigned version, bool changeUrl)
+{
+    AgentInfo info;
+    info.config = std::make_shared<AgentConfig>(
+            AgentConfig::createFromJson(makeConfig(agent, version, changeUrl)));
+    return info;
+}
+
+BidRequest makeBidRequest(unsigned i)
+{
+    BidRequest br;
+
+    AdSpot spot;
+    spot.id = Id(1);
+    spot.formats.push_back(Format(300, 250));
+    br.imp.push_back(spot);
+
+    br.exchange = "mock";
+    br.language = "en";
+    br.url = Url(ML::format("http://site%d.com/news/section0/page", i % 50));
+    br.location.countryCode = "CA";
+    br.location.regionCode = "QC";
+    br.location.cityName = ML::format("Montreal%d", i % 10);
+    br.timestamp = Date::now();
+    br.segments.addStrings("segs", {
+                ML::format("seg%d", i % 200),
+                ML::format("seg%d", (i * 3) % 200) });
+    return br;
+}
+
+std::vector<std::string> getNames(const FilterPool::ConfigList & list)
+{
+    std::vector<std::string> result;
+    for (const auto & entry : list)
+        result.push_back(entry.name);
+    return result;
+}
+
+double bench(unsigned numAgents, unsigned numUpdates, bool inPlace,
+             bool changeUrl, std::vector<std::vector<std::string> > & results)
+{
+    FilterPool pool;
+    pool.initWithDefaultFilters();
+
+    // These need an exchange connector to let anything through
+    pool.removeFilter("ExchangePre");
+    pool.removeFilter("ExchangePost");
+    pool.removeFilter("CreativeExchange");
+
+    for (unsigned agent = 0;  agent < numAgents;  ++agent)
+        pool.addConfig(ML::format("agent%d", agent), makeInfo(agent, 0, changeUrl));
+
+    // Parse ahead of time to only measure the filter pool
+    std::vector<AgentInfo> updates;
+    for (unsigned i = 0;  i < numUpdates;  ++i)
+        updates.push_back(makeInfo(i % numAgents, i + 1, changeUrl));
+
+    Date start = Date::now();
+
+    for (unsigned i = 0;  i < numUpdates;  ++i) {
+        string name = ML::format("agent%d", i % numAgents);
+        if (!inPlace) pool.removeConfig(name);
+        pool.addConfig(name, updates[i]);
+    }
+
+    double elapsed = Date::now().secondsSince(start);
+
+    results.clear();
+    for (unsigned i = 0;  i < 100;  ++i)
+        results.push_back(getNames(pool.filter(makeBidRequest(i), nullptr)));
+
+    return numUpdates / elapsed;
+}
+
+} // file scope
+
+int main(int argc, char ** argv)
+{
+    using namespace boost::program_options;
+
+    unsigned numAgents = 500;
+    unsigned numUpdates = 2000;
+
+    options_description opt("Bench options");
+    opt.add_options()
+        ("agents,a", value<unsigned>(&numAgents),
+         "number of agent configs in the pool")
+        ("updates,n", value<unsigned>(&numUpdates),
+         "number of config updates to measure")
+        ("help,h", "print this message");
+
+    variables_map vm;
+    store(command_line_parser(argc, argv).options(opt).run(), vm);
+    notify(vm);
+
+    if (vm.count("help")) {
+        cerr << opt << endl;
+        return 1;
+    }
+
+    for (bool changeUrl : { false, true }) {
+        std::vector<std::vector<std::string> > expected, results;
+        double full = bench(numAgents, numUpdates, false, changeUrl, expected);
+        double inPlace = bench(numAgents, numUpdates, true, changeUrl, results);
+
+        // Both ways of updating must end up filtering the same way
+        ExcAssert(expected == results);
+
+        size_t matches = 0;
+        for (const auto & names : results)
+            matches += names.size();
+        ExcAssert(matches > 0);
+
+        cout << (changeUrl ? "url filter changed:   " : "bid probability only: ")
+             << "remove/add " << ML::format("%8.0f", full) << " updates/s, "
+             << "in place " << ML::format("%8.0f", inPlace) << " updates/s"
+             << endl;
+    }
+}
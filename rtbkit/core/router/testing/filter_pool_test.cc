@@ -0,0 +1,310 @@
+/* filter_pool_test.cc
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Checks that replacing an agent config in place, which only updates the
+   filters that say they're affected by the change, filters exactly like
+   removing the config and adding it back.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include "rtbkit/core/router/filter_pool.h"
+#include "rtbkit/core/router/router_types.h"
+#include "rtbkit/core/agent_configuration/agent_config.h"
+#include "rtbkit/common/bid_request.h"
+#include "jml/arch/format.h"
+
+#include <boost/test/unit_test.hpp>
+#include <functional>
+#include <algorithm>
+
+using namespace std;
+using namespace ML;
+using namespace Datacratic;
+using namespace RTBKIT;
+
+
+namespace {
+
+enum { NumAgents = 8 };
+
+typedef std::function<void (Json::Value &, unsigned agent)> Mutation;
+
+/** Base config of an agent, which lets a fair share of the requests through
+    so that a change to any of the filters shows in the results.
+*/
+Json::Value makeConfig(unsigned agent)
+{
+    Json::Value config;
+    config["account"][0] = ML::format("campaign%d", agent);
+    config["account"][1] = "strategy";
+    config["bidProbability"] = 0.5;
+
+    config["urlFilter"]["exclude"][0] = ML::format("/private%d/", agent % 3);
+    config["hostFilter"]["exclude"][0] = ML::format("site%d.com", agent % 5);
+    config["languageFilter"]["include"][0] = "en";
+    config["languageFilter"]["include"][1] = "fr";
+    if (agent % 2)
+        config["exchangeFilter"]["exclude"][0] = "other";
+
+    config["segmentFilter"]["segs"]["exclude"][0] = ML::format("seg%d", agent);
+
+    for (unsigned i = 0;  i < 2;  ++i) {
+        Json::Value creative;
+        creative["format"] = i == 0 ? "300x250" : "728x90";
+        creative["id"] = i;
+        creative["name"] = ML::format("creative%d", i);
+        config["creatives"][i] = creative;
+    }
+
+    return config;
+}
+
+AgentInfo makeInfo(const Json::Value & config)
+{
+    AgentInfo info;
+    info.config = std::make_shared<AgentConfig>(
+            AgentConfig::createFromJson(config));
+    return info;
+}
+
+std::string hourBitmap(unsigned hoursOn)
+{
+    std::string result(168, '0');
+    for (unsigned i = 0;  i < 168;  ++i)
+        if (i % hoursOn == 0) result[i] = '1';
+    return result;
+}
+
+std::vector<BidRequest> makeBidRequests()
+{
+    std::vector<BidRequest> result;
+
+    // Covers Sunday midnight and the next 50 hours
+    Date start = Date::fromSecondsSinceEpoch(1420329600);  // 2015-Jan-04 00:00
+
+    for (unsigned i = 0;  i < 200;  ++i) {
+        BidRequest br;
+
+        AdSpot spot;
+        spot.id = Id(1);
+        spot.formats.push_back(i % 3 ? Format(300, 250) : Format(728, 90));
+        spot.position.val = i % 4
+            ? OpenRTB::AdPosition::ABOVE : OpenRTB::AdPosition::BELOW;
+        br.imp.push_back(spot);
+
+        br.exchange = i % 5 ? "mock" : "other";
+        br.language = i % 2 ? "en" : (i % 3 ? "fr" : "de");
+        br.url = Url(ML::format("http://site%d.com/private%d/page",
+                                i % 7, i % 4));
+        br.location.countryCode = "CA";
+        br.location.regionCode = i % 2 ? "QC" : "ON";
+        br.location.cityName = "Montreal";
+        br.timestamp = start.plusSeconds(3600 * (i % 50));
+        br.segments.addStrings("segs", {
+                    ML::format("seg%d", i % NumAgents),
+                    ML::format("seg%d", (i * 3) % 11) });
+
+        if (i % 7 != 3) br.userIds.add(Id(ML::format("user%d", i)), ID_EXCHANGE);
+
+        result.push_back(br);
+    }
+
+    return result;
+}
+
+FilterPool * makePool()
+{
+    FilterPool * pool = new FilterPool();
+    pool->initWithDefaultFilters();
+
+    // These need an exchange connector to let anything through
+    pool->removeFilter("ExchangePre");
+    pool->removeFilter("ExchangePost");
+    pool->removeFilter("CreativeExchange");
+
+    for (unsigned agent = 0;  agent < NumAgents;  ++agent)
+        pool->addConfig(ML::format("agent%d", agent), makeInfo(makeConfig(agent)));
+
+    return pool;
+}
+
+/** Which agents and creatives get through for each of the requests. */
+std::vector<std::vector<std::string> >
+filterAll(FilterPool & pool, const std::vector<BidRequest> & requests)
+{
+    std::vector<std::vector<std::string> > result;
+
+    for (const auto & br : requests) {
+        std::vector<std::string> matches;
+        for (const auto & entry : pool.filter(br, nullptr)) {
+            std::string match = entry.name;
+            for (const auto & creatives : entry.biddableSpots) {
+                match += ML::format(" %d:", creatives.first);
+                for (int creative : creatives.second)
+                    match += ML::format("%d,", creative);
+            }
+            matches.push_back(match);
+        }
+        std::sort(matches.begin(), matches.end());
+        result.push_back(matches);
+    }
+
+    return result;
+}
+
+size_t numMatches(const std::vector<std::vector<std::string> > & results)
+{
+    size_t result = 0;
+    for (const auto & matches : results)
+        result += matches.size();
+    return result;
+}
+
+/** Applies the mutation to some of the agents, both in place and through a
+    remove and add, and then reverts it in place.  Returns whether the
+    mutation changed which requests get through.
+*/
+bool checkMutation(const std::string & name, const Mutation & mutate,
+                   const std::vector<BidRequest> & requests)
+{
+    BOOST_TEST_CHECKPOINT(name);
+
+    std::unique_ptr<FilterPool> inPlace(makePool());
+    std::unique_ptr<FilterPool> readded(makePool());
+
+    auto original = filterAll(*inPlace, requests);
+    BOOST_REQUIRE_GT(numMatches(original), 0);
+
+    for (unsigned agent = 0;  agent < NumAgents;  agent += 2) {
+        std::string agentName = ML::format("agent%d", agent);
+        Json::Value config = makeConfig(agent);
+        mutate(config, agent);
+
+        inPlace->addConfig(agentName, makeInfo(config));
+        readded->removeConfig(agentName);
+        readded->addConfig(agentName, makeInfo(config));
+    }
+
+    auto mutated = filterAll(*readded, requests);
+    BOOST_CHECK_MESSAGE(filterAll(*inPlace, requests) == mutated,
+                        name + ": updated in place filters differently");
+
+    // Going back has to undo everything that the update did
+    for (unsigned agent = 0;  agent < NumAgents;  agent += 2) {
+        std::string agentName = ML::format("agent%d", agent);
+        inPlace->addConfig(agentName, makeInfo(makeConfig(agent)));
+    }
+
+    BOOST_CHECK_MESSAGE(filterAll(*inPlace, requests) == original,
+                        name + ": reverting in place filters differently");
+
+    return mutated != original;
+}
+
+} // file scope
+
+
+/** Changes to fields that none of the filters look at. */
+BOOST_AUTO_TEST_CASE( test_filter_pool_update_unaffected )
+{
+    auto requests = makeBidRequests();
+
+    std::vector<std::pair<std::string, Mutation> > mutations = {
+        { "same", [] (Json::Value &, unsigned) {} },
+        { "bidProbability", [] (Json::Value & config, unsigned) {
+                config["bidProbability"] = 0.1;
+            } },
+        { "creativeName", [] (Json::Value & config, unsigned) {
+                config["creatives"][0]["name"] = "renamed";
+            } },
+        { "maxInFlight", [] (Json::Value & config, unsigned) {
+                config["maxInFlight"] = 10;
+            } },
+    };
+
+    for (const auto & mutation : mutations)
+        BOOST_CHECK(!checkMutation(mutation.first, mutation.second, requests));
+}
+
+/** Changes to each of the fields that a filter looks at. */
+BOOST_AUTO_TEST_CASE( test_filter_pool_update_affected )
+{
+    auto requests = makeBidRequests();
+
+    std::vector<std::pair<std::string, Mutation> > mutations = {
+        { "urlFilter", [] (Json::Value & config, unsigned agent) {
+                config["urlFilter"]["exclude"][0]
+                    = ML::format("site%d\\.com", agent % 7);
+            } },
+        { "hostFilter", [] (Json::Value & config, unsigned agent) {
+                config["hostFilter"]["include"][0]
+                    = ML::format("site%d.com", agent % 7);
+            } },
+        { "languageFilter", [] (Json::Value & config, unsigned) {
+                config["languageFilter"]["include"].resize(1);
+            } },
+        { "locationFilter", [] (Json::Value & config, unsigned) {
+                config["locationFilter"]["include"][0] = "CA:QC:.*";
+            } },
+        { "exchangeFilter", [] (Json::Value & config, unsigned) {
+                config["exchangeFilter"]["include"][0] = "other";
+            } },
+        { "segmentFilter", [] (Json::Value & config, unsigned agent) {
+                config["segmentFilter"]["segs"]["include"][0]
+                    = ML::format("seg%d", (agent + 1) % NumAgents);
+            } },
+        { "segmentFilter.excludeIfNotPresent", [] (Json::Value & config, unsigned) {
+                config["segmentFilter"]["other"]["include"][0] = "seg1";
+                config["segmentFilter"]["other"]["excludeIfNotPresent"] = true;
+            } },
+        { "segmentFilter.applyToExchanges", [] (Json::Value & config, unsigned) {
+                config["segmentFilter"]["segs"]["applyToExchanges"]["include"][0]
+                    = "other";
+            } },
+        { "userPartition", [] (Json::Value & config, unsigned) {
+                config["userPartition"]["hashOn"] = "exchangeId";
+                config["userPartition"]["modulus"] = 2;
+                config["userPartition"]["includeRanges"][0][0] = 0;
+                config["userPartition"]["includeRanges"][0][1] = 1;
+            } },
+        { "hourOfWeekFilter", [] (Json::Value & config, unsigned agent) {
+                config["hourOfWeekFilter"]["hourlyBitmapSundayMidnightUtc"]
+                    = hourBitmap(agent + 2);
+            } },
+        { "foldPositionFilter", [] (Json::Value & config, unsigned) {
+                config["foldPositionFilter"]["include"][0]
+                    = (int)OpenRTB::AdPosition::ABOVE;
+            } },
+        { "requiredIds", [] (Json::Value & config, unsigned) {
+                config["requiredIds"][0] = "xchg";
+            } },
+        { "creatives.format", [] (Json::Value & config, unsigned) {
+                config["creatives"][1]["format"] = "300x250";
+            } },
+        { "creatives.count", [] (Json::Value & config, unsigned) {
+                config["creatives"].resize(1);
+            } },
+        { "creatives.languageFilter", [] (Json::Value & config, unsigned) {
+                config["creatives"][0]["languageFilter"]["include"][0] = "fr";
+            } },
+        { "creatives.locationFilter", [] (Json::Value & config, unsigned) {
+                config["creatives"][0]["locationFilter"]["include"][0] = "CA:ON:.*";
+            } },
+        { "creatives.exchangeFilter", [] (Json::Value & config, unsigned) {
+                config["creatives"][0]["exchangeFilter"]["include"][0] = "other";
+            } },
+        { "creatives.segmentFilter", [] (Json::Value & config, unsigned agent) {
+                config["creatives"][0]["segmentFilter"]["segs"]["include"][0]
+                    = ML::format("seg%d", (agent + 3) % NumAgents);
+            } },
+    };
+
+    for (const auto & mutation : mutations) {
+        // Otherwise the request set doesn't exercise the filter
+        BOOST_CHECK_MESSAGE(
+                checkMutation(mutation.first, mutation.second, requests),
+                mutation.first + ": change didn't affect the results");
+    }
+}
@@ -0,0 +1,169 @@
+/* frequency_cap_store_test.cc
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Test of the store of wins used for the frequency caps.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include "rtbkit/core/router/frequency_cap_store.h"
+#include "rtbkit/common/bid_request.h"
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+using namespace ML;
+using namespace RTBKIT;
+using namespace Datacratic;
+
+
+namespace {
+
+UserIds makeUser(const std::string & exchangeId,
+                 const std::string & providerId = "")
+{
+    UserIds uids;
+    uids.exchangeId = Id(exchangeId);
+    if (!providerId.empty())
+        uids.providerId = Id(providerId);
+    return uids;
+}
+
+} // file scope
+
+BOOST_AUTO_TEST_CASE( test_frequency_cap_store_counts )
+{
+    FrequencyCapStore store(60.0, 10, 128);
+
+    Date start = Date::fromSecondsSinceEpoch(60 * 100000);
+    UserIds user = makeUser("user1");
+    UserIds other = makeUser("user2");
+    AccountKey campaign("campaign:strategy1");
+
+    store.recordWin(user, campaign, start);
+    store.recordWin(user, AccountKey("campaign:strategy2"), start.plusSeconds(30));
+    store.recordWin(user, campaign, start.plusSeconds(90));
+    store.recordWin(other, campaign, start.plusSeconds(90));
+    store.recordWin(user, AccountKey("other:strategy1"), start.plusSeconds(90));
+
+    // Wins are counted per campaign, whatever the rest of the account
+    Date now = start.plusSeconds(100);
+    BOOST_CHECK_EQUAL(store.count(user, campaign, 30.0, now), 1);
+    BOOST_CHECK_EQUAL(store.count(user, campaign, 100.0, now), 3);
+    BOOST_CHECK_EQUAL(store.count(other, campaign, 100.0, now), 1);
+    BOOST_CHECK_EQUAL(store.count(makeUser("user3"), campaign, 100.0, now), 0);
+    BOOST_CHECK_EQUAL(store.count(user, AccountKey("other"), 100.0, now), 1);
+
+    BOOST_CHECK(store.isCapped(user, campaign, { { 5, 3600 }, { 3, 100 } }, now));
+    BOOST_CHECK(!store.isCapped(user, campaign, { { 5, 3600 }, { 2, 30 } }, now));
+    BOOST_CHECK(!store.isCapped(other, campaign, { { 2, 3600 } }, now));
+
+    // Once the buckets are recycled the old wins are forgotten
+    Date later = start.plusSeconds(60 * 10);
+    BOOST_CHECK_EQUAL(store.count(user, campaign, 3600.0, later), 1);
+    store.recordWin(other, campaign, later);
+    BOOST_CHECK_EQUAL(store.count(user, campaign, 3600.0, later), 1);
+    BOOST_CHECK_EQUAL(store.count(other, campaign, 3600.0, later), 2);
+
+    Date muchLater = start.plusSeconds(60 * 11);
+    store.recordWin(other, campaign, muchLater);
+    BOOST_CHECK_EQUAL(store.count(user, campaign, 3600.0, muchLater), 0);
+    BOOST_CHECK_EQUAL(store.count(other, campaign, 3600.0, muchLater), 2);
+
+    // Wins that are too old for any window are ignored
+    store.recordWin(user, campaign, start);
+    BOOST_CHECK_EQUAL(store.count(user, campaign, 3600.0, muchLater), 0);
+}
+
+BOOST_AUTO_TEST_CASE( test_frequency_cap_store_user_ids )
+{
+    FrequencyCapStore store(60.0, 10, 128);
+    AccountKey campaign("campaign");
+    Date now = Date::fromSecondsSinceEpoch(60 * 100000);
+
+    // The provider id is used when there is one
+    store.recordWin(makeUser("exchange1", "provider"), campaign, now);
+    BOOST_CHECK_EQUAL(store.count(makeUser("exchange2", "provider"),
+                                  campaign, 60.0, now), 1);
+    BOOST_CHECK_EQUAL(store.count(makeUser("exchange1"),
+                                  campaign, 60.0, now), 0);
+}
+
+BOOST_AUTO_TEST_CASE( test_frequency_cap_store_no_user_id )
+{
+    FrequencyCapStore store(60.0, 10, 128);
+    AccountKey campaign("campaign");
+    Date now = Date::fromSecondsSinceEpoch(60 * 100000);
+
+    UserIds anonymous;
+    UserIds nullIds;
+    nullIds.exchangeId = Id("null");
+    nullIds.providerId = Id("null");
+    BOOST_CHECK_EQUAL(FrequencyCapStore::getKey(anonymous, campaign), 0);
+    BOOST_CHECK_EQUAL(FrequencyCapStore::getKey(nullIds, campaign), 0);
+
+    // Users we can't tell apart don't share a count that would cap them all
+    for (unsigned i = 0;  i < 10;  ++i) {
+        store.recordWin(anonymous, campaign, now);
+        store.recordWin(nullIds, campaign, now);
+    }
+
+    BOOST_CHECK_EQUAL(store.count(anonymous, campaign, 60.0, now), 0);
+    BOOST_CHECK(!store.isCapped(anonymous, campaign, { { 1, 3600 } }, now));
+    BOOST_CHECK(!store.isCapped(nullIds, campaign, { { 1, 3600 } }, now));
+    BOOST_CHECK(!store.isCapped(makeUser("user1"), campaign, { { 1, 3600 } }, now));
+
+    // A null provider id falls back to the exchange id
+    UserIds exchangeOnly = makeUser("user1");
+    exchangeOnly.providerId = Id("null");
+    store.recordWin(exchangeOnly, campaign, now);
+    BOOST_CHECK_EQUAL(store.count(makeUser("user1"), campaign, 60.0, now), 1);
+}
+
+BOOST_AUTO_TEST_CASE( test_frequency_cap_store_bounded )
+{
+    FrequencyCapStore store(60.0, 10, 100);
+    AccountKey campaign("campaign");
+    Date now = Date::fromSecondsSinceEpoch(60 * 100000);
+
+    // The capacity is rounded up to 128, of which 96 can be used
+    for (unsigned i = 0;  i < 200;  ++i)
+        store.recordWin(makeUser("user" + to_string(i)), campaign, now);
+    BOOST_CHECK_EQUAL(store.dropped(), 200 - 96);
+
+    // Users that are already there can still be counted
+    store.recordWin(makeUser("user0"), campaign, now);
+    BOOST_CHECK_EQUAL(store.dropped(), 200 - 96);
+
+    // A new period starts from an empty bucket
+    store.recordWin(makeUser("user199"), campaign, now.plusSeconds(60));
+    BOOST_CHECK_EQUAL(store.dropped(), 200 - 96);
+}
+
+BOOST_AUTO_TEST_CASE( test_frequency_cap_config )
+{
+    Json::Value json;
+    json["count"] = 3;
+    json["window"] = 3600;
+
+    FrequencyCap cap = FrequencyCap::createFromJson(json);
+    BOOST_CHECK_EQUAL(cap.count, 3);
+    BOOST_CHECK_EQUAL(cap.window, 3600.0);
+    BOOST_CHECK_EQUAL(FrequencyCap::createFromJson(cap.toJson()).count, 3);
+
+    json["window"] = 0;
+    BOOST_CHECK_THROW(FrequencyCap::createFromJson(json), ML::Exception);
+    json["window"] = 3600;
+
+    // A cap that lets nothing through is a mistake, not a way to pause
+    json["count"] = 0;
+    BOOST_CHECK_THROW(FrequencyCap::createFromJson(json), ML::Exception);
+    json["count"] = -1;
+    BOOST_CHECK_THROW(FrequencyCap::createFromJson(json), ML::Exception);
+    json.removeMember("count");
+    BOOST_CHECK_THROW(FrequencyCap::createFromJson(json), ML::Exception);
+
+    json["window"] = 60;
+    json["size"] = 1;
+    BOOST_CHECK_THROW(FrequencyCap::createFromJson(json), ML::Exception);
+}
@@ -9,3 +9,9 @@ $(eval $(call nodejs_test,rtb_new_format_test,bid_request sync_utils))
 $(eval $(call test,pending_list_test,types,boost))
 #$(eval $(call test,router_banker_test,rtb_router dataflow bidding_agent,boost))
 #$(eval $(call test,augmentation_test,rtb_router bid_request augmentor_base,boost))
+$(eval $(call test,augmentation_cache_test,rtb_router,boost))
+$(eval $(call test,frequency_cap_store_test,rtb_router,boost))
+$(eval $(call test,exchange_thread_selection_test,rtb_router,boost))
+$(eval $(call test,filter_pool_test,rtb_router,boost))
+$(eval $(call program,auction_pool_bench,rtb_router boost_program_options))
+$(eval $(call program,filter_pool_bench,rtb_router boost_program_options))
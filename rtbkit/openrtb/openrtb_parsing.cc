@@ -70,6 +70,16 @@ DefaultDescription()
     addField("iframebuster", &Impression::iframebuster, "Supported iframe busters");
     addField("pmp", &Impression::pmp, "Contains any deals eligible for the impression");
     addField("ext", &Impression::ext, "Extended impression attributes");
+
+    compile<JSON_CODEC_FIELD(Impression, id),
+            JSON_CODEC_FIELD(Impression, displaymanager),
+            JSON_CODEC_FIELD(Impression, displaymanagerver),
+            JSON_CODEC_FIELD(Impression, instl),
+            JSON_CODEC_FIELD(Impression, tagid),
+            JSON_CODEC_FIELD(Impression, bidfloor),
+            JSON_CODEC_FIELD(Impression, bidfloorcur),
+            JSON_CODEC_FIELD(Impression, secure),
+            JSON_CODEC_FIELD(Impression, ext)>();
 }
 
 DefaultDescription<OpenRTB::Content>::
@@ -252,6 +262,12 @@ DefaultDescription()
     addField("ext", &Segment::ext, "Extensions to the protocol go here");
     /// Datacratic extension
     addField("segmentusecost", &Segment::segmentusecost, "Segment use cost in CPM");
+
+    compile<JSON_CODEC_FIELD(Segment, id),
+            JSON_CODEC_FIELD(Segment, name),
+            JSON_CODEC_FIELD(Segment, value),
+            JSON_CODEC_FIELD(Segment, ext),
+            JSON_CODEC_FIELD(Segment, segmentusecost)>();
 }
 
 DefaultDescription<OpenRTB::Data>::
@@ -264,6 +280,12 @@ DefaultDescription()
     /// Datacratic extension
     addField("datausecost", &Data::datausecost, "Cost of using data in CPM");
     addField("usecostcurrency", &Data::usecostcurrency, "Currency for use cost");
+
+    compile<JSON_CODEC_FIELD(Data, id),
+            JSON_CODEC_FIELD(Data, name),
+            JSON_CODEC_FIELD(Data, ext),
+            JSON_CODEC_FIELD(Data, datausecost),
+            JSON_CODEC_FIELD(Data, usecostcurrency)>();
 }
 
 DefaultDescription<OpenRTB::User>::
@@ -304,6 +326,17 @@ DefaultDescription()
              new StringIdDescription());
     addField("attr", &Bid::attr, "Creative attributes");
     addField("ext", &Bid::ext, "Extensions");
+
+    compile<JSON_CODEC_FIELD(Bid, id),
+            JSON_CODEC_FIELD(Bid, impid),
+            JSON_CODEC_FIELD(Bid, price),
+            JSON_CODEC_FIELD(Bid, adid),
+            JSON_CODEC_FIELD(Bid, nurl),
+            JSON_CODEC_FIELD(Bid, adm),
+            JSON_CODEC_FIELD(Bid, iurl),
+            JSON_CODEC_FIELD(Bid, cid),
+            JSON_CODEC_FIELD(Bid, crid),
+            JSON_CODEC_FIELD(Bid, ext)>();
 }
 
 DefaultDescription<OpenRTB::SeatBid>::
@@ -314,6 +347,10 @@ DefaultDescription()
              new StringIdDescription());
     addField("group", &SeatBid::group, "Do we require all bids to be won in a group?");
     addField("ext", &SeatBid::ext, "Extensions");
+
+    compile<JSON_CODEC_FIELD(SeatBid, seat),
+            JSON_CODEC_FIELD(SeatBid, group),
+            JSON_CODEC_FIELD(SeatBid, ext)>();
 }
 
 DefaultDescription<OpenRTB::BidResponse>::
@@ -327,6 +364,12 @@ DefaultDescription()
     addField("cur", &BidResponse::cur, "Currency in which we're bidding");
     addField("customData", &BidResponse::customData, "Custom data to be stored for user");
     addField("ext", &BidResponse::ext, "Extensions");
+
+    compile<JSON_CODEC_FIELD(BidResponse, id),
+            JSON_CODEC_FIELD(BidResponse, bidid),
+            JSON_CODEC_FIELD(BidResponse, cur),
+            JSON_CODEC_FIELD(BidResponse, customData),
+            JSON_CODEC_FIELD(BidResponse, ext)>();
 }
 
 DefaultDescription<OpenRTB::Deal>::
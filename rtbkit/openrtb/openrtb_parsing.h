@@ -9,6 +9,7 @@
 
 #include "soa/types/value_description.h"
 #include "soa/types/basic_value_descriptions.h"
+#include "soa/types/json_codec.h"
 #include "soa/types/json_parsing.h"
 #include "openrtb.h"
 #include <boost/lexical_cast.hpp>
@@ -261,7 +262,7 @@ struct DefaultDescription<OpenRTB::BidRequest>
 
 template<>
 struct DefaultDescription<OpenRTB::Impression>
-    : public StructureDescription<OpenRTB::Impression> {
+    : public CompiledStructureDescription<OpenRTB::Impression> {
     DefaultDescription();
 };
 
@@ -327,31 +328,31 @@ struct DefaultDescription<OpenRTB::Geo>
 
 template<>
 struct DefaultDescription<OpenRTB::Data>
-    : public StructureDescription<OpenRTB::Data> {
+    : public CompiledStructureDescription<OpenRTB::Data> {
     DefaultDescription();
 };
 
 template<>
 struct DefaultDescription<OpenRTB::Segment>
-    : public StructureDescription<OpenRTB::Segment> {
+    : public CompiledStructureDescription<OpenRTB::Segment> {
     DefaultDescription();
 };
 
 template<>
 struct DefaultDescription<OpenRTB::Bid>
-    : public StructureDescription<OpenRTB::Bid> {
+    : public CompiledStructureDescription<OpenRTB::Bid> {
     DefaultDescription();
 };
 
 template<>
 struct DefaultDescription<OpenRTB::SeatBid>
-    : public StructureDescription<OpenRTB::SeatBid> {
+    : public CompiledStructureDescription<OpenRTB::SeatBid> {
     DefaultDescription();
 };
 
 template<>
 struct DefaultDescription<OpenRTB::BidResponse>
-    : public StructureDescription<OpenRTB::BidResponse> {
+    : public CompiledStructureDescription<OpenRTB::BidResponse> {
     DefaultDescription();
 };
 
@@ -43,21 +43,36 @@ init(shared_ptr<ConfigurationService> config)
     registerServiceProvider(serviceName_, { "adServer" });
     services->config->removePath(serviceName());
 
+    toPostAuctionService_.onEvent = [=] (const char * eventName,
+                                         EventType type, float value)
+        {
+            this->recordEvent(("postAuction." + string(eventName)).c_str(),
+                              type, value);
+        };
     toPostAuctionService_.init();
 }
 
+void
+AdServerConnector::
+enableEventBatching(size_t maxEvents, double maxDelay)
+{
+    toPostAuctionService_.enableBatching(maxEvents, maxDelay);
+}
+
 void
 AdServerConnector::
 start()
 {
     startTime_ = Date::now();
     recordHit("up");
+    toPostAuctionService_.start();
 }
 
 void
 AdServerConnector::
 shutdown()
 {
+    toPostAuctionService_.shutdown();
 }
 
 void
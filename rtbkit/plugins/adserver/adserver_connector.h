@@ -37,6 +37,13 @@ struct AdServerConnector : public Datacratic::ServiceBase {
 
     void recordUptime() const;
 
+    /** Send the events to the post auction loop in batches of up to
+        maxEvents events, each sent at the latest maxDelay seconds after its
+        first event (see PostAuctionProxy::enableBatching).  Must be called
+        before init.
+    */
+    void enableEventBatching(size_t maxEvents, double maxDelay);
+
     /*************************************************************************/
     /* METHODS TO SEND MESSAGES ON                                           */
     /*************************************************************************/
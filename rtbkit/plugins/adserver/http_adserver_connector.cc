@@ -19,15 +19,48 @@ using namespace RTBKIT;
 
 HttpAdServerConnectionHandler::
 HttpAdServerConnectionHandler(HttpAdServerHttpEndpoint & endpoint,
-                              const HttpAdServerRequestCb & requestCb)
-    : endpoint_(endpoint), requestCb_(requestCb)
+                              const HttpAdServerRequestCb & requestCb,
+                              const HttpAdServerPayloadCb & payloadCb)
+    : endpoint_(endpoint), requestCb_(requestCb), payloadCb_(payloadCb)
 {
 }
 
+void
+HttpAdServerConnectionHandler::
+handleHttpPayload(const HttpHeader & header, const string & payload)
+{
+    if (!payloadCb_) {
+        JsonConnectionHandler::handleHttpPayload(header, payload);
+        return;
+    }
+
+    // Only requests that end up in an error get parsed into a Json::Value,
+    // to be sent back in the response.
+    auto message = [&] ()
+        {
+            Json::Value json;
+            Json::Reader reader;
+            if (!reader.parse(payload, json, false))
+                json = payload;
+            return json;
+        };
+
+    sendResponse([&] () { return payloadCb_(header, payload); }, message);
+}
+
 void
 HttpAdServerConnectionHandler::
 handleJson(const HttpHeader & header, const Json::Value & json,
            const string & jsonStr)
+{
+    sendResponse([&] () { return requestCb_(header, json, jsonStr); },
+                 [&] () { return json; });
+}
+
+void
+HttpAdServerConnectionHandler::
+sendResponse(const function<HttpAdServerResponse ()> & handle,
+             const function<Json::Value ()> & message)
 {
     string resultMsg;
 
@@ -43,7 +76,7 @@ handleJson(const HttpHeader & header, const Json::Value & json,
     };
 
     try {
-        HttpAdServerResponse returnValue = requestCb_(header, json, jsonStr);
+        HttpAdServerResponse returnValue = handle();
         if(returnValue.valid) {
             resultMsg = ("HTTP/1.1 200 OK\r\n"
                      "Content-Type: none\r\n"
@@ -52,10 +85,11 @@ handleJson(const HttpHeader & header, const Json::Value & json,
         }
         else {
             endpoint_.doEvent("error.rqParsingError");
-            resultMsg = sendErrorResponse(returnValue.error, returnValue.details, json);
+            resultMsg = sendErrorResponse(returnValue.error, returnValue.details, message());
         }
     }
     catch (const exception & exc) {
+        Json::Value json = message();
         cerr << "error parsing adserver request " << json << ": "
              << exc.what() << endl;
         endpoint_.doEvent("error.rqParsingError");
@@ -93,9 +127,10 @@ sendErrorResponse(const std::string & error, const std::string & details, const
 /****************************************************************************/
 
 HttpAdServerHttpEndpoint::
-HttpAdServerHttpEndpoint(int port, const HttpAdServerRequestCb & requestCb)
+HttpAdServerHttpEndpoint(int port, const HttpAdServerRequestCb & requestCb,
+                         const HttpAdServerPayloadCb & payloadCb)
     : HttpEndpoint("adserver-ep-" + to_string(port)),
-      port_(port), requestCb_(requestCb)
+      port_(port), requestCb_(requestCb), payloadCb_(payloadCb)
 {
 }
 
@@ -105,6 +140,7 @@ HttpAdServerHttpEndpoint(HttpAdServerHttpEndpoint && otherEndpoint)
 {
     port_ = otherEndpoint.port_;
     requestCb_ = otherEndpoint.requestCb_;
+    payloadCb_ = otherEndpoint.payloadCb_;
 }
 
 HttpAdServerHttpEndpoint::
@@ -120,6 +156,7 @@ operator = (const HttpAdServerHttpEndpoint& other)
     if (this != &other) {
         port_ = other.port_;
         requestCb_ = other.requestCb_;
+        payloadCb_ = other.payloadCb_;
     }
 
     return *this;
@@ -137,7 +174,8 @@ shared_ptr<ConnectionHandler>
 HttpAdServerHttpEndpoint::
 makeNewHandler()
 {
-    return std::make_shared<HttpAdServerConnectionHandler>(*this, requestCb_);
+    return std::make_shared<HttpAdServerConnectionHandler>(*this, requestCb_,
+                                                           payloadCb_);
 }
 
 
@@ -159,6 +197,13 @@ registerEndpoint(int port, const HttpAdServerRequestCb & requestCb)
     endpoints_.emplace_back(port, requestCb);
 }
 
+void
+HttpAdServerConnector::
+registerPayloadEndpoint(int port, const HttpAdServerPayloadCb & payloadCb)
+{
+    endpoints_.emplace_back(port, HttpAdServerRequestCb(), payloadCb);
+}
+
 void
 HttpAdServerConnector::
 init(const shared_ptr<ConfigurationService> & config)
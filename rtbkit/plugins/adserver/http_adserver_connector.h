@@ -39,20 +39,36 @@ typedef std::function<HttpAdServerResponse (const HttpHeader & header,
                             const std::string & jsonStr)>
     HttpAdServerRequestCb;
 
+/** Callback that gets the raw payload of the request, for ad servers that
+    parse it themselves instead of going through a Json::Value. */
+typedef std::function<HttpAdServerResponse (const HttpHeader & header,
+                                            const std::string & payload)>
+    HttpAdServerPayloadCb;
+
 struct HttpAdServerConnectionHandler
     : public Datacratic::JsonConnectionHandler {
     HttpAdServerConnectionHandler(HttpAdServerHttpEndpoint & endpoint,
-                                  const HttpAdServerRequestCb & requestCb);
+                                  const HttpAdServerRequestCb & requestCb,
+                                  const HttpAdServerPayloadCb & payloadCb);
+
+    /** Hands the payload straight to the payload callback if there is one
+        and parses it as JSON for the request callback otherwise. */
+    virtual void handleHttpPayload(const HttpHeader & header,
+                                   const std::string & payload);
 
     virtual void handleJson(const HttpHeader & header,
                             const Json::Value & json,
                             const std::string & jsonStr);
 
 private:
+    void sendResponse(const std::function<HttpAdServerResponse ()> & handle,
+                      const std::function<Json::Value ()> & message);
+
     std::string sendErrorResponse(const std::string & error, const std::string & details, const Json::Value & json);
     
     HttpAdServerHttpEndpoint & endpoint_;
     const HttpAdServerRequestCb & requestCb_;
+    const HttpAdServerPayloadCb & payloadCb_;
 };
 
 
@@ -62,7 +78,9 @@ private:
 
 struct HttpAdServerHttpEndpoint : public Datacratic::HttpEndpoint {
     HttpAdServerHttpEndpoint(int port,
-                             const HttpAdServerRequestCb & requestCb);
+                             const HttpAdServerRequestCb & requestCb,
+                             const HttpAdServerPayloadCb & payloadCb
+                                 = HttpAdServerPayloadCb());
     HttpAdServerHttpEndpoint(HttpAdServerHttpEndpoint && otherEndpoint);
 
     ~HttpAdServerHttpEndpoint();
@@ -93,6 +111,7 @@ struct HttpAdServerHttpEndpoint : public Datacratic::HttpEndpoint {
 private:
     int port_;
     HttpAdServerRequestCb requestCb_;
+    HttpAdServerPayloadCb payloadCb_;
 };
         
 /****************************************************************************/
@@ -109,6 +128,11 @@ struct HttpAdServerConnector : public AdServerConnector {
 
     void registerEndpoint(int port, const HttpAdServerRequestCb & requestCb);
 
+    /** Register an endpoint whose requests are handed over without being
+        parsed. */
+    void registerPayloadEndpoint(int port,
+                                 const HttpAdServerPayloadCb & payloadCb);
+
     void init(const std::shared_ptr<ConfigurationService> & config);
     void shutdown();
 
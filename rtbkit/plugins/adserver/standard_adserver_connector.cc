@@ -8,6 +8,8 @@
 #include "rtbkit/common/json_holder.h"
 
 #include "soa/service/logs.h"
+#include "soa/types/json_parsing.h"
+#include <cstring>
 
 #include "standard_adserver_connector.h"
 
@@ -35,6 +37,10 @@ makeProgramOptions()
     options.add_options()
         ("win-port,w", value(&winPort), "listening port for wins")
         ("events-port,e", value(&eventsPort), "listening port for events")
+        ("event-batch-size", value(&eventBatchSize),
+         "send events to the post auction loop in batches of this size (0 to send them one by one)")
+        ("event-batch-delay", value(&eventBatchDelay),
+         "longest time in seconds that an event waits in a batch")
         ("verbose,v", value(&verbose), "verbose mode");
     stdOptions.add(options);
 
@@ -69,6 +75,12 @@ StandardAdServerConnector(std::string const & serviceName, std::shared_ptr<Servi
     int eventsPort = json.get("eventsPort", 18144).asInt();
     verbose = json.get("verbose", false).asBool();
     initEventType(json);
+
+    int eventBatchSize = json.get("eventBatchSize", 0).asInt();
+    if (eventBatchSize > 0)
+        enableEventBatching(eventBatchSize,
+                            json.get("eventBatchDelay", 0.005).asDouble());
+
     init(winPort, eventsPort, verbose);
 }
 
@@ -96,6 +108,8 @@ StandardAdServerConnector::
 init(StandardAdServerArguments & ssConfig)
 {
     ssConfig.validate();
+    if (ssConfig.eventBatchSize > 0)
+        enableEventBatching(ssConfig.eventBatchSize, ssConfig.eventBatchDelay);
     init(ssConfig.winPort, ssConfig.eventsPort, ssConfig.verbose);
 }
 
@@ -109,11 +123,13 @@ init(int winsPort, int eventsPort, bool verbose)
 
     shared_ptr<ServiceProxies> services = getServices();
 
-    auto win = &StandardAdServerConnector::handleWinRq;
-    registerEndpoint(winsPort, bind(win, this, _1, _2, _3));
+    auto win = &StandardAdServerConnector::handleWinPayload;
+    registerPayloadEndpoint(winsPort,
+                            bind(win, this, placeholders::_1, placeholders::_2));
 
-    auto delivery = &StandardAdServerConnector::handleDeliveryRq;
-    registerEndpoint(eventsPort, bind(delivery, this, _1, _2, _3));
+    auto delivery = &StandardAdServerConnector::handleDeliveryPayload;
+    registerPayloadEndpoint(eventsPort,
+                            bind(delivery, this, placeholders::_1, placeholders::_2));
 
     HttpAdServerConnector::init(services->config);
     publisher_.init(services->config, serviceName_ + "/logger");
@@ -155,32 +171,190 @@ errorResponseHelper(HttpAdServerResponse & resp,
     resp.details = details;
 }
 
+/* STANDARDADSERVERNOTICE */
+
+namespace {
+
+/* Same conversions as Json::Value::asString() and asDouble() */
+
+string expectString(StreamingJsonParsingContext & context)
+{
+    if (context.isNull()) {
+        context.expectNull();
+        return "";
+    }
+    return context.expectStringUtf8().rawString();
+}
+
+double expectNumber(StreamingJsonParsingContext & context)
+{
+    if (context.isNull()) {
+        context.expectNull();
+        return 0.0;
+    }
+    return context.expectDouble();
+}
+
+} // file scope
+
+StandardAdServerNotice::
+StandardAdServerNotice()
+    : hasTimestamp(false), timestamp(0.0),
+      hasBidRequestId(false), hasImpId(false),
+      hasPrice(false), price(0.0),
+      hasType(false)
+{
+}
+
+void
+StandardAdServerNotice::
+fromJson(const Json::Value & json)
+{
+    if (json.isMember("timestamp")) {
+        hasTimestamp = true;
+        timestamp = json["timestamp"].asDouble();
+    }
+    if (json.isMember("bidRequestId")) {
+        hasBidRequestId = true;
+        bidRequestId = json["bidRequestId"].asString();
+    }
+    if (json.isMember("impid")) {
+        hasImpId = true;
+        impId = json["impid"].asString();
+    }
+    if (json.isMember("price")) {
+        hasPrice = true;
+        price = json["price"].asDouble();
+    }
+    if (json.isMember("type")) {
+        hasType = true;
+        type = json["type"].asString();
+    }
+    if (json.isMember("userIds")) {
+        auto item =  json["userIds"];
+        if(!item.empty())
+            userId = item[0].asString();
+    }
+    if (json.isMember("passback")) {
+        passback =  json["passback"].asString();
+    }
+}
+
+void
+StandardAdServerNotice::
+parse(const std::string & payload)
+{
+    const char * start = payload.c_str();
+    StreamingJsonParsingContext context(payload, start, start + payload.size());
+
+    auto onMember = [&] ()
+        {
+            const char * name = context.fieldNamePtr();
+
+            if (!strcmp(name, "timestamp")) {
+                hasTimestamp = true;
+                timestamp = expectNumber(context);
+            }
+            else if (!strcmp(name, "bidRequestId")) {
+                hasBidRequestId = true;
+                bidRequestId = expectString(context);
+            }
+            else if (!strcmp(name, "impid")) {
+                hasImpId = true;
+                impId = expectString(context);
+            }
+            else if (!strcmp(name, "price")) {
+                hasPrice = true;
+                price = expectNumber(context);
+            }
+            else if (!strcmp(name, "type")) {
+                hasType = true;
+                type = expectString(context);
+            }
+            else if (!strcmp(name, "userIds")) {
+                if (context.isNull()) {
+                    context.expectNull();
+                    return;
+                }
+                bool first = true;
+                context.forEachElement([&] ()
+                    {
+                        if (first) userId = expectString(context);
+                        else context.skip();
+                        first = false;
+                    });
+            }
+            else if (!strcmp(name, "passback")) {
+                passback = expectString(context);
+            }
+            else context.skip();
+        };
+
+    context.forEachMember(onMember);
+
+    ML::skipJsonWhitespace(*context.context);
+    context.context->expect_eof();
+}
+
+
+/* STANDARDADSERVERCONNECTOR */
+
 HttpAdServerResponse
 StandardAdServerConnector::
 handleWinRq(const HttpHeader & header,
             const Json::Value & json, const std::string & jsonStr)
+{
+    StandardAdServerNotice notice;
+    notice.fromJson(json);
+    return handleWin(notice);
+}
+
+HttpAdServerResponse
+StandardAdServerConnector::
+handleWinPayload(const HttpHeader & header, const std::string & payload)
+{
+    StandardAdServerNotice notice;
+    notice.parse(payload);
+    return handleWin(notice);
+}
+
+HttpAdServerResponse
+StandardAdServerConnector::
+handleDeliveryRq(const HttpHeader & header,
+                 const Json::Value & json, const std::string & jsonStr)
+{
+    StandardAdServerNotice notice;
+    notice.fromJson(json);
+    return handleDelivery(notice);
+}
+
+HttpAdServerResponse
+StandardAdServerConnector::
+handleDeliveryPayload(const HttpHeader & header, const std::string & payload)
+{
+    StandardAdServerNotice notice;
+    notice.parse(payload);
+    return handleDelivery(notice);
+}
+
+HttpAdServerResponse
+StandardAdServerConnector::
+handleWin(const StandardAdServerNotice & notice)
 {
     HttpAdServerResponse response;
 
     Date timestamp;
-    string bidRequestIdStr;
-    string impIdStr;
-    double winPriceDbl;
-
     Id bidRequestId;
     Id impId;
     USD_CPM winPrice;
-
     UserIds userIds;
-    string userIdStr;
-    string passback;
 
     /*
      *  Timestamp is an required field.
      *  If null, we return an error response.
      */
-    if (json.isMember("timestamp")) {
-        timestamp = Date::fromSecondsSinceEpoch(json["timestamp"].asDouble());
+    if (notice.hasTimestamp) {
+        timestamp = Date::fromSecondsSinceEpoch(notice.timestamp);
 
         // Check if timestamp is finite when treated as seconds
         if(!timestamp.isADate()) {
@@ -200,9 +374,8 @@ handleWinRq(const HttpHeader & header,
      *  bidRequestId is an required field.
      *  If null, we return an error response.
      */
-    if (json.isMember("bidRequestId")) {
-        bidRequestIdStr = json["bidRequestId"].asString();
-        bidRequestId = Id(bidRequestIdStr); 
+    if (notice.hasBidRequestId) {
+        bidRequestId = Id(notice.bidRequestId);
     } else {
         errorResponseHelper(response,
                             "MISSING_BIDREQUESTID",
@@ -214,9 +387,8 @@ handleWinRq(const HttpHeader & header,
      *  impid is an required field.
      *  If null, we return an error response.
      */
-    if (json.isMember("impid")) {
-        impIdStr = json["impid"].asString();
-        impId = Id(impIdStr);
+    if (notice.hasImpId) {
+        impId = Id(notice.impId);
     } else {
         errorResponseHelper(response,
                             "MISSING_IMPID",
@@ -228,9 +400,8 @@ handleWinRq(const HttpHeader & header,
      *  price is an required field.
      *  If null, we return an error response.
      */
-    if (json.isMember("price")) {
-        winPriceDbl = json["price"].asDouble();
-        winPrice = USD_CPM(winPriceDbl);
+    if (notice.hasPrice) {
+        winPrice = USD_CPM(notice.price);
     } else {
         errorResponseHelper(response,
                             "MISSING_WINPRICE",
@@ -242,25 +413,8 @@ handleWinRq(const HttpHeader & header,
      *  UserIds is an optional field.
      *  If null, we just put an empty array.
      */
-    if (json.isMember("userIds")) {
-        auto item =  json["userIds"];
-        if(!item.empty())
-            userIds.add(Id(item[0].asString()), ID_PROVIDER);
-    }
-    else {
-        // UserIds is optional
-    }
-
-    /*
-     *  Passback is an optional field.
-     *  If null, we just put an empty string.
-     */
-    if (json.isMember("passback")) {
-        passback =  json["passback"].asString();
-    }
-    else {
-        // Passback is optional
-    }
+    if (!notice.userId.empty())
+        userIds.add(Id(notice.userId), ID_PROVIDER);
 
     LOG(adserverTrace) << "{\"timestamp\":\"" << timestamp.print(3) << "\"," <<
         "\"bidRequestId\":\"" << bidRequestId << "\"," <<
@@ -270,8 +424,8 @@ handleWinRq(const HttpHeader & header,
     if(response.valid) {
         publishWin(bidRequestId, impId, winPrice, timestamp, Json::Value(), userIds,
                    AccountKey(), Date());
-        publisher_.publish("WIN", timestamp.print(3), bidRequestIdStr,
-                           impIdStr, winPrice.toString());
+        publisher_.publish("WIN", timestamp.print(3), notice.bidRequestId,
+                           notice.impId, winPrice.toString());
     }
 
     return response;
@@ -279,12 +433,10 @@ handleWinRq(const HttpHeader & header,
 
 HttpAdServerResponse
 StandardAdServerConnector::
-handleDeliveryRq(const HttpHeader & header,
-                 const Json::Value & json, const std::string & jsonStr)
+handleDelivery(const StandardAdServerNotice & notice)
 {    
     HttpAdServerResponse response;
-    string bidRequestIdStr, impIdStr, userIdStr, event;
-    Id bidRequestId, impId, userId;
+    Id bidRequestId, impId;
     UserIds userIds;
     Date timestamp;
     
@@ -292,8 +444,8 @@ handleDeliveryRq(const HttpHeader & header,
      *  Timestamp is an required field.
      *  If null, we return an error response.
      */
-    if (json.isMember("timestamp")) {
-        timestamp = Date::fromSecondsSinceEpoch(json["timestamp"].asDouble());
+    if (notice.hasTimestamp) {
+        timestamp = Date::fromSecondsSinceEpoch(notice.timestamp);
         
         // Check if timestamp is finite when treated as seconds
         if(!timestamp.isADate()) {
@@ -313,11 +465,12 @@ handleDeliveryRq(const HttpHeader & header,
      *  type is an required field.
      *  If null, we return an error response.
      */
-    if (json.isMember("type")) {
+    auto event = eventType.end();
+    if (notice.hasType) {
 
-        event = (json["type"].asString());
+        event = eventType.find(notice.type);
         
-        if(eventType.find(event) == eventType.end()) {
+        if(event == eventType.end()) {
             errorResponseHelper(response,
                                 "UNSUPPORTED_TYPE",
                                 "A campaign event requires the type field.");
@@ -336,9 +489,7 @@ handleDeliveryRq(const HttpHeader & header,
      *  impid is an required field.
      *  If null, we return an error response.
      */
-    if (json.isMember("impid")) {
-
-    } else {
+    if (!notice.hasImpId) {
         errorResponseHelper(response,
                             "MISSING_IMPID",
                             "A campaign event requires the impId field.");
@@ -350,9 +501,7 @@ handleDeliveryRq(const HttpHeader & header,
      *  bidRequestId is an required field.
      *  If null, we return an error response.
      */
-    if (json.isMember("bidRequestId")) {
-
-    } else {
+    if (!notice.hasBidRequestId) {
         errorResponseHelper(response,
                             "MISSING_BIDREQUESTID",
                             "A campaign event requires the bidRequestId field.");
@@ -363,32 +512,23 @@ handleDeliveryRq(const HttpHeader & header,
      *  UserIds is an optional field.
      *  If null, we just put an empty array.
      */
-    if (json.isMember("userIds")) {
-        auto item =  json["userIds"];
-
-        if(!item.empty())
-            userIds.add(Id(item[0].asString()), ID_PROVIDER);
-    }
-    else {
-        // UserIds is optional
-    }
+    if (!notice.userId.empty())
+        userIds.add(Id(notice.userId), ID_PROVIDER);
 
-    bidRequestIdStr = json["bidRequestId"].asString();
-    impIdStr = json["impid"].asString();
-    bidRequestId = Id(bidRequestIdStr);
-    impId = Id(impIdStr);
+    bidRequestId = Id(notice.bidRequestId);
+    impId = Id(notice.impId);
     
     LOG(adserverTrace) << "{\"timestamp\":\"" << timestamp.print(3) << "\"," <<
-        "\"bidRequestId\":\"" << bidRequestIdStr << "\"," <<
-        "\"impId\":\"" << impIdStr << "\"," <<
-        "\"event\":\"" << event << 
+        "\"bidRequestId\":\"" << notice.bidRequestId << "\"," <<
+        "\"impId\":\"" << notice.impId << "\"," <<
+        "\"event\":\"" << notice.type << 
         "\"userIds\":" << userIds.toString() << "\"}";
 
     if(response.valid) {
-        publishCampaignEvent(eventType[event], bidRequestId, impId, timestamp,
+        publishCampaignEvent(event->second, bidRequestId, impId, timestamp,
                                  Json::Value(), userIds);
-        publisher_.publish(eventType[event], timestamp.print(3), bidRequestIdStr,
-                                impIdStr, userIds.toString());
+        publisher_.publish(event->second, timestamp.print(3), notice.bidRequestId,
+                                notice.impId, userIds.toString());
     }
     return response;
 }
@@ -26,6 +26,11 @@ using namespace std;
 
 struct StandardAdServerArguments : ServiceProxyArguments
 {
+    StandardAdServerArguments()
+        : eventBatchSize(0), eventBatchDelay(0.005)
+    {
+    }
+
     boost::program_options::options_description makeProgramOptions();
     void validate();
 
@@ -33,6 +38,37 @@ struct StandardAdServerArguments : ServiceProxyArguments
     int eventsPort;
 
     bool verbose;
+
+    int eventBatchSize;
+    double eventBatchDelay;
+};
+
+/** Fields of a win notice or campaign event sent to the standard ad server
+    connector.  The has* members tell whether the required fields were
+    there. */
+struct StandardAdServerNotice
+{
+    StandardAdServerNotice();
+
+    /** Take the fields from an already parsed request. */
+    void fromJson(const Json::Value & json);
+
+    /** Parse the fields straight out of the request payload, without
+        building a Json::Value. */
+    void parse(const std::string & payload);
+
+    bool hasTimestamp;
+    double timestamp;
+    bool hasBidRequestId;
+    std::string bidRequestId;
+    bool hasImpId;
+    std::string impId;
+    bool hasPrice;
+    double price;
+    bool hasType;
+    std::string type;
+    std::string userId;         ///< First of the userIds, if any
+    std::string passback;
 };
 
 struct StandardAdServerConnector : public HttpAdServerConnector
@@ -55,6 +91,16 @@ struct StandardAdServerConnector : public HttpAdServerConnector
     HttpAdServerResponse handleDeliveryRq(const HttpHeader & header,
                           const Json::Value & json, const string & jsonStr);
 
+    /** Same as handleWinRq and handleDeliveryRq, parsing the payload
+        directly.  These are the ones that the ports are bound to. */
+    HttpAdServerResponse handleWinPayload(const HttpHeader & header,
+                                          const string & payload);
+    HttpAdServerResponse handleDeliveryPayload(const HttpHeader & header,
+                                               const string & payload);
+
+    HttpAdServerResponse handleWin(const StandardAdServerNotice & notice);
+    HttpAdServerResponse handleDelivery(const StandardAdServerNotice & notice);
+
     /** */
     Datacratic::ZmqNamedPublisher publisher_;
 
@@ -83,6 +83,41 @@ struct TestStandardAdServer {
     std::shared_ptr<EventSource> eventSource;
 };
 
+BOOST_AUTO_TEST_CASE( test_standard_adserver_notice_parse )
+{
+    auto check = [] (const std::string & payload)
+        {
+            StandardAdServerNotice parsed, expected;
+            parsed.parse(payload);
+            expected.fromJson(Json::parse(payload));
+
+            BOOST_CHECK_EQUAL(parsed.hasTimestamp, expected.hasTimestamp);
+            BOOST_CHECK_EQUAL(parsed.timestamp, expected.timestamp);
+            BOOST_CHECK_EQUAL(parsed.hasBidRequestId, expected.hasBidRequestId);
+            BOOST_CHECK_EQUAL(parsed.bidRequestId, expected.bidRequestId);
+            BOOST_CHECK_EQUAL(parsed.hasImpId, expected.hasImpId);
+            BOOST_CHECK_EQUAL(parsed.impId, expected.impId);
+            BOOST_CHECK_EQUAL(parsed.hasPrice, expected.hasPrice);
+            BOOST_CHECK_EQUAL(parsed.price, expected.price);
+            BOOST_CHECK_EQUAL(parsed.hasType, expected.hasType);
+            BOOST_CHECK_EQUAL(parsed.type, expected.type);
+            BOOST_CHECK_EQUAL(parsed.userId, expected.userId);
+            BOOST_CHECK_EQUAL(parsed.passback, expected.passback);
+        };
+
+    check(loadFile(win_sample_filename));
+    check(loadFile(click_sample_filename));
+    check(loadFile(conversion_sample_filename));
+    check("{\"timestamp\":null,\"userIds\":[\"u1\",\"u2\"],"
+          "\"passback\":\"caf\\u00e9\",\"extra\":{\"a\":[1,2]},\"price\":2}");
+
+    StandardAdServerNotice notice;
+    BOOST_CHECK_THROW(notice.parse("{\"timestamp\":1} trailing"),
+                      std::exception);
+    BOOST_CHECK_THROW(notice.parse("{\"timestamp\":\"1\"}"),
+                      std::exception);
+}
+
 BOOST_FIXTURE_TEST_SUITE( standard_adserver_tests, TestStandardAdServer )
 
 BOOST_AUTO_TEST_CASE( test_standard_adserver_win )
@@ -163,4 +198,26 @@ BOOST_AUTO_TEST_CASE( test_standard_adserver_conversion )
 
 }
 
+BOOST_AUTO_TEST_CASE( test_standard_adserver_missing_price )
+{
+    std::string strJson = "{\"timestamp\":1396461865,\"bidRequestId\":\"a\","
+                          "\"impid\":\"b\"}";
+
+    std::string httpRequest = ML::format(
+                                  "POST / HTTP/1.1\r\n"
+                                  "Content-Length: %zd\r\n"
+                                  "Content-Type: application/json\r\n"
+                                  "\r\n"
+                                  "%s",
+                                  strJson.size(),
+                                  strJson.c_str());
+
+    winSource->write(httpRequest);
+    std::string result = winSource->read();
+
+    BOOST_CHECK_EQUAL(result.compare(0, 24, "HTTP/1.1 400 Bad Request"), 0);
+    BOOST_CHECK_NE(result.find("MISSING_WINPRICE"), std::string::npos);
+    BOOST_CHECK_NE(result.find("\"bidRequestId\":\"a\""), std::string::npos);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -11,6 +11,7 @@
 #include "jml/arch/timers.h"
 #include "jml/utils/vector_utils.h"
 #include "jml/arch/futex.h"
+#include "jml/utils/guard.h"
 #include <memory>
 
 
@@ -30,12 +31,140 @@ namespace RTBKIT {
 // of requests.
 enum { QueueSize = 65536 };
 
+// Each worker with its own sockets only queues up the responses of its own
+// requests that weren't given from within the request handler.
+enum { WorkerQueueSize = 4096 };
+
+namespace {
+
+/** Worker loop whose request handler is running on this thread, if any. */
+__thread const MessageLoop * currentWorker = nullptr;
+
+} // file scope
+
+
+/*****************************************************************************/
+/* AUGMENTOR WORKER                                                          */
+/*****************************************************************************/
+
+/** Message loop of a worker with its own connections to the routers, which
+    handles the requests as they come in on its own thread.
+*/
+struct Augmentor::Worker : public MessageLoop
+{
+    Worker(Augmentor & owner, int index)
+        : owner(owner),
+          index(index),
+          toRouters(owner.getZmqContext()),
+          responseQueue(WorkerQueueSize)
+    {
+    }
+
+    ~Worker()
+    {
+        shutdown();
+    }
+
+    void init()
+    {
+        responseQueue.onEvent = [=] (const Response& resp)
+            {
+                owner.sendResponse(toRouters, resp.first, resp.second);
+            };
+
+        addSource("Augmentor::Worker::responseQueue", responseQueue);
+
+        // Every worker is its own instance of the augmentor for the routers
+        toRouters.init(owner.getServices()->config,
+                       owner.serviceName() + "-" + to_string(index));
+
+        toRouters.connectHandler = [=] (const std::string & newRouter)
+            {
+                toRouters.sendMessage(newRouter, "CONFIG", "1.0",
+                                      owner.augmentorName);
+                owner.recordHit("messages.CONFIG");
+            };
+
+        toRouters.disconnectHandler = [=] (const std::string & oldRouter)
+            {
+                cerr << "worker " << index << " disconnected from router "
+                     << oldRouter << endl;
+            };
+
+        toRouters.messageHandler = [=] (const std::string & router,
+                                        std::vector<std::string> message)
+            {
+                handleRouterMessage(router, message);
+            };
+
+        toRouters.connectAllServiceProviders(
+                "rtbRouterAugmentation", "augmentors");
+
+        addSource("Augmentor::Worker::toRouters", toRouters);
+    }
+
+    void shutdown()
+    {
+        MessageLoop::shutdown();
+        toRouters.shutdown();
+    }
+
+    void handleRouterMessage(const std::string & router,
+                             std::vector<std::string> & message)
+    {
+        const std::string & type = message.at(0);
+        owner.recordHit("messages." + type);
+
+        if (type == "CONFIGOK") return;
+
+        if (type != "AUGMENT") {
+            cerr << "unknown router message type: " << type << endl;
+            return;
+        }
+
+        if (owner.loadStabilizer.shedMessage()) {
+            owner.sendShed(toRouters, router, message);
+            return;
+        }
+
+        Message value = make_pair(router, std::move(message));
+
+        try { owner.parseMessage(request, value); }
+        catch (const std::exception& ex) {
+            cerr << "error while parsing message: "
+                << value << " -> " << ex.what()
+                << endl;
+            return;
+        }
+
+        request.worker = index;
+
+        currentWorker = this;
+        Call_Guard guard([] { currentWorker = nullptr; });
+        owner.handleRequest(request);
+    }
+
+    Augmentor & owner;
+    int index;
+
+    ZmqMultipleNamedClientBusProxy toRouters;
+    TypedMessageSink<Response> responseQueue;
+
+    AugmentationRequest request;
+};
+
+
+/*****************************************************************************/
+/* AUGMENTOR                                                                 */
+/*****************************************************************************/
+
 Augmentor::
 Augmentor(const std::string & augmentorName,
           const std::string & serviceName,
           std::shared_ptr<ServiceProxies> proxies)
     : ServiceBase(serviceName, proxies),
       augmentorName(augmentorName),
+      fields(AUG_ALL),
       toRouters(getZmqContext()),
       responseQueue(QueueSize),
       requestQueue(QueueSize),
@@ -50,6 +179,7 @@ Augmentor(const std::string & augmentorName,
           ServiceBase& parent)
     : ServiceBase(serviceName, parent),
       augmentorName(augmentorName),
+      fields(AUG_ALL),
       toRouters(getZmqContext()),
       responseQueue(QueueSize),
       requestQueue(QueueSize),
@@ -66,58 +196,57 @@ Augmentor::
 
 void
 Augmentor::
-init(int numThreads)
+init(int numThreads, bool socketPerWorker)
 {
-    responseQueue.onEvent = [=] (const Response& resp)
-        {
-            const AugmentationRequest& request = resp.first;
-            const AugmentationList& response = resp.second;
-
-            toRouters.sendMessage(
-                    request.router,
-                    "RESPONSE",
-                    "1.0",
-                    request.startTime,
-                    request.id.toString(),
-                    request.augmentor,
-                    chomp(response.toJson().toString()));
-
-            recordHit("messages.RESPONSE");
-        };
+    if (socketPerWorker) {
+        for (int i = 0; i < numThreads; ++i) {
+            workerLoops.emplace_back(new Worker(*this, i));
+            workerLoops.back()->init();
+        }
+    }
+    else {
+        responseQueue.onEvent = [=] (const Response& resp)
+            {
+                sendResponse(toRouters, resp.first, resp.second);
+            };
 
-    addSource("Augmentor::responseQueue", responseQueue);
+        addSource("Augmentor::responseQueue", responseQueue);
 
-    toRouters.init(getServices()->config, serviceName());
+        toRouters.init(getServices()->config, serviceName());
 
-    toRouters.connectHandler = [=] (const std::string & newRouter)
-        {
-            toRouters.sendMessage(newRouter, "CONFIG", "1.0", augmentorName);
-            recordHit("messages.CONFIG");
-        };
+        toRouters.connectHandler = [=] (const std::string & newRouter)
+            {
+                toRouters.sendMessage(newRouter, "CONFIG", "1.0", augmentorName);
+                recordHit("messages.CONFIG");
+            };
 
-    toRouters.disconnectHandler = [=] (const std::string & oldRouter)
-        {
-            cerr << "disconnected from router " << oldRouter << endl;
-        };
+        toRouters.disconnectHandler = [=] (const std::string & oldRouter)
+            {
+                cerr << "disconnected from router " << oldRouter << endl;
+            };
 
-    toRouters.messageHandler = [=] (const std::string & router,
-                                    std::vector<std::string> message)
-        {
-            handleRouterMessage(router, message);
-        };
+        toRouters.messageHandler = [=] (const std::string & router,
+                                        std::vector<std::string> message)
+            {
+                handleRouterMessage(router, message);
+            };
 
 
-    toRouters.connectAllServiceProviders("rtbRouterAugmentation", "augmentors");
+        toRouters.connectAllServiceProviders("rtbRouterAugmentation", "augmentors");
 
-    addSource("Augmentor::toRouters", toRouters);
+        addSource("Augmentor::toRouters", toRouters);
 
 
-    stopWorkers = false;
-    for (size_t i = 0; i < numThreads; ++i)
-        workers.create_thread([=] { this->runWorker(); });
+        stopWorkers = false;
+        for (int i = 0; i < numThreads; ++i)
+            workers.create_thread([=] { this->runWorker(i); });
+    }
 
     loopMonitor.init();
     loopMonitor.addMessageLoop("augmentor", this);
+    for (auto & worker : workerLoops)
+        loopMonitor.addMessageLoop("worker" + to_string(worker->index),
+                                   worker.get());
     loopMonitor.onLoadChange = [=] (double) {
         recordLevel(this->loadStabilizer.shedProbability(), "shedProbability");
     };
@@ -129,6 +258,8 @@ Augmentor::
 start()
 {
     MessageLoop::start();
+    for (auto & worker : workerLoops)
+        worker->start();
 }
 
 void
@@ -137,6 +268,8 @@ shutdown()
 {
     stopWorkers = true;
     workers.join_all();
+    for (auto & worker : workerLoops)
+        worker->shutdown();
     MessageLoop::shutdown();
     toRouters.shutdown();
 }
@@ -145,12 +278,65 @@ void
 Augmentor::
 respond(const AugmentationRequest & request, const AugmentationList & response)
 {
-    if (responseQueue.tryPush(make_pair(request, response)))
+    if (!workerLoops.empty()) {
+        Worker & worker = *workerLoops.at(request.worker);
+
+        // Responses given from within the request handler go out right away
+        if (currentWorker == &worker) {
+            sendResponse(worker.toRouters, request, response);
+            return;
+        }
+
+        if (worker.responseQueue.tryPush(make_pair(request, response)))
+            return;
+    }
+
+    else if (responseQueue.tryPush(make_pair(request, response)))
         return;
 
     cerr << "Dropping augmentation response: response queue is full" << endl;
 }
 
+void
+Augmentor::
+sendResponse(ZmqMultipleNamedClientBusProxy & proxy,
+             const AugmentationRequest & request,
+             const AugmentationList & response)
+{
+    proxy.sendMessage(
+            request.router,
+            "RESPONSE",
+            "1.0",
+            request.startTime,
+            request.id.toString(),
+            request.augmentor,
+            chomp(response.toJson().toString()));
+
+    recordHit("messages.RESPONSE");
+
+    if (request.worker >= 0) {
+        double latencyMs = Date::now().secondsSince(request.receiveTime) * 1000;
+        recordOutcome(latencyMs, "workers.%d.latencyMs", request.worker);
+    }
+}
+
+void
+Augmentor::
+sendShed(ZmqMultipleNamedClientBusProxy & proxy,
+         const std::string & router,
+         const std::vector<std::string> & message)
+{
+    proxy.sendMessage(
+            router,
+            "RESPONSE",
+            message.at(1), // version
+            message.at(7), // startTime
+            message.at(3), // auctionId
+            message.at(2), // augmentor
+            "null");       // response
+    recordHit("shedMessages");
+}
+
 void
 Augmentor::
 parseMessage(AugmentationRequest& request, Message& message)
@@ -158,18 +344,31 @@ parseMessage(AugmentationRequest& request, Message& message)
     const string & version = message.second.at(1);
     ExcCheckEqual(version, "1.0", "unexpected version in augment");
 
+    request.receiveTime = Date::now();
     request.router = message.first;
     request.timeAvailableMs = 0.05;
     request.augmentor = std::move(message.second.at(2));
     request.id = Id(std::move(message.second.at(3)));
 
-    const string & brSource = std::move(message.second.at(4));
-    const string & brStr = std::move(message.second.at(5));
-    request.bidRequest.reset(BidRequest::parse(brSource, brStr));
+    if (fields & AUG_BID_REQUEST) {
+        const string & brSource = message.second.at(4);
+        const string & brStr = message.second.at(5);
+        request.bidRequest.reset(BidRequest::parse(brSource, brStr));
+        request.bidRequestSource.clear();
+        request.bidRequestStr.clear();
+    }
+    else {
+        request.bidRequest.reset();
+        request.bidRequestSource = std::move(message.second.at(4));
+        request.bidRequestStr = std::move(message.second.at(5));
+    }
 
-    istringstream agentsStr(message.second.at(6));
-    ML::DB::Store_Reader reader(agentsStr);
-    reader.load(request.agents);
+    request.agents.clear();
+    if (fields & AUG_AGENTS) {
+        istringstream agentsStr(message.second.at(6));
+        ML::DB::Store_Reader reader(agentsStr);
+        reader.load(request.agents);
+    }
 
     const string & startTimeStr = message.second.at(7);
     request.startTime = Date::fromSecondsSinceEpoch(strtod(startTimeStr.c_str(), 0));
@@ -188,24 +387,14 @@ handleRouterMessage(const std::string & router, std::vector<std::string> & messa
 
     else if (type == "AUGMENT") {
 
-        bool shedMessage = loadStabilizer.shedMessage();
-
-        if (!shedMessage) {
-            Message value = make_pair(router, std::move(message));
-            shedMessage = !requestQueue.tryPush(std::move(value));
+        if (loadStabilizer.shedMessage()) {
+            sendShed(toRouters, router, message);
+            return;
         }
 
-        if (shedMessage) {
-            toRouters.sendMessage(
-                    router,
-                    "RESPONSE",
-                    message.at(1), // version
-                    message.at(7), // startTime
-                    message.at(3), // auctionId
-                    message.at(2), // augmentor
-                    "null");       // response
-            recordHit("shedMessages");
-        }
+        Message value = make_pair(router, std::move(message));
+        if (!requestQueue.tryPush(value))
+            sendShed(toRouters, router, value.second);
     }
 
     else cerr << "unknown router message type: " << type << endl;
@@ -213,7 +402,7 @@ handleRouterMessage(const std::string & router, std::vector<std::string> & messa
 
 void
 Augmentor::
-runWorker()
+runWorker(int index)
 {
     AugmentationRequest request;
     Message message;
@@ -229,9 +418,9 @@ runWorker()
             continue;
         }
 
+        request.worker = index;
         handleRequest(request);
     }
 }
 
 } // namespace RTBKIT
-
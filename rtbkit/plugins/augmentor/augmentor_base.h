@@ -39,16 +39,34 @@ namespace RTBKIT {
     Note that this object must be relatively copy friendly because it must be
     transfered to worker threads in the MultiThreadedAugmentor and the
     AsyncAugmentor.
+
+    Only the parts given to Augmentor::requestFields() are filled in.  When
+    the bid request isn't parsed, its source and unparsed string are kept
+    instead so that an augmentor can pick out the few values it needs.
  */
 struct AugmentationRequest
 {
+    AugmentationRequest() : timeAvailableMs(0.0), worker(-1) {}
+
     std::string augmentor;                    // Name of the augmentor
     std::string router;                       // Router to respond to
     Id id;                                    // Auction id
     std::shared_ptr<BidRequest> bidRequest;   // Bid request to augment
+    std::string bidRequestSource;             // Format of the unparsed request
+    std::string bidRequestStr;                // Unparsed bid request
     std::vector<std::string> agents;          // Agents availble to bid
     double timeAvailableMs;                   // Time to respond
     Date startTime;                           // Start of the latency timer
+    Date receiveTime;                         // When the augmentor got it
+    int worker;                               // Worker that handled it
+};
+
+/** Parts of an AUGMENT message that an augmentor needs parsed. */
+enum AugmentationFields {
+    AUG_BID_REQUEST = 1 << 0,   // Parse the bid request into bidRequest
+    AUG_AGENTS = 1 << 1,        // Decode the list of agents
+
+    AUG_ALL = AUG_BID_REQUEST | AUG_AGENTS
 };
 
 
@@ -58,6 +76,17 @@ struct AugmentationRequest
 
 /** Class that implements a bid request augmentor.  Real augmentors should
     build on top of this class.
+
+    By default, requests are received and responses sent by the message loop
+    of the augmentor while the workers pick the requests off a shared queue.
+    When initialized with a socket per worker, each worker instead runs its
+    own message loop with its own connections to the routers.  Every worker
+    then shows up as an instance of the augmentor to the routers, which
+    balance the requests between them, so nothing is funneled through a
+    single thread.
+
+    The time each worker takes to respond is recorded as the
+    workers.<n>.latencyMs outcome.
 */
 
 struct Augmentor : public ServiceBase, public MessageLoop {
@@ -72,7 +101,7 @@ struct Augmentor : public ServiceBase, public MessageLoop {
 
     ~Augmentor();
 
-    void init(int numThreads = 1);
+    void init(int numThreads = 1, bool socketPerWorker = false);
     void start();
     void shutdown();
 
@@ -80,6 +109,11 @@ struct Augmentor : public ServiceBase, public MessageLoop {
     void respond(const AugmentationRequest & request,
                  const AugmentationList & response);
 
+    /** Only parse the given AugmentationFields of the requests.  Defaults to
+        AUG_ALL.  Must be called before start().
+    */
+    void requestFields(int fields) { this->fields = fields; }
+
     double sampleLoad() { return loopMonitor.sampleLoad().load; }
     double shedProbability() { return loadStabilizer.shedProbability(); }
 
@@ -90,7 +124,10 @@ protected:
     RequestHandle handleRequest;
 
 private:
+    struct Worker;
+
     std::string augmentorName; // This can differ from the servicenName!
+    int fields;
 
     ZmqMultipleNamedClientBusProxy toRouters;
 
@@ -103,14 +140,22 @@ private:
     boost::thread_group workers;
     std::atomic<bool> stopWorkers;
 
+    std::vector<std::unique_ptr<Worker> > workerLoops;
+
     LoopMonitor loopMonitor;
     LoadStabilizer loadStabilizer;
 
-    void runWorker();
+    void runWorker(int index);
     void handleRouterMessage(const std::string & router,
                              std::vector<std::string> & message);
 
     void parseMessage(AugmentationRequest& req, Message& msg);
+    void sendResponse(ZmqMultipleNamedClientBusProxy & proxy,
+                      const AugmentationRequest & request,
+                      const AugmentationList & response);
+    void sendShed(ZmqMultipleNamedClientBusProxy & proxy,
+                  const std::string & router,
+                  const std::vector<std::string> & message);
 };
 
 
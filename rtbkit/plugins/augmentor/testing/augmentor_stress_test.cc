@@ -16,6 +16,7 @@
 #include <thread>
 #include <atomic>
 #include <set>
+#include <mutex>
 
 using namespace std;
 using namespace ML;
@@ -53,6 +54,8 @@ struct MockAugmentationLoop : public ServiceBase, public MessageLoop
 
         toAug.onConnection = [=] (const std::string & client) {
             cerr << "augmentor " << client << " has connected" << endl;
+            std::lock_guard<std::mutex> guard(lock);
+            clients.push_back(client);
         };
         toAug.onDisconnection = [=] (const std::string & client) {
             cerr << "augmentor " << client << " has disconnected" << endl;
@@ -70,8 +73,16 @@ struct MockAugmentationLoop : public ServiceBase, public MessageLoop
         }
 
         addPeriodic("MockAugLoop::send", 0.0001, [=] (uint64_t) {
+                    // With a socket per worker, every worker is a client
+                    std::string client;
+                    {
+                        std::lock_guard<std::mutex> guard(lock);
+                        if (clients.empty()) return;
+                        client = clients[sent % clients.size()];
+                    }
+
                     toAug.sendMessage(
-                            "test-aug", "AUGMENT", "1.0", "test-aug",
+                            client, "AUGMENT", "1.0", "test-aug",
                             to_string(random()), "datacratic", sampleBr,
                             agents, Date::now());
 
@@ -84,9 +95,12 @@ struct MockAugmentationLoop : public ServiceBase, public MessageLoop
     ZmqNamedClientBus toAug;
     string agents;
     size_t sent, recv;
+
+    std::mutex lock;
+    vector<string> clients;
 };
 
-BOOST_AUTO_TEST_CASE( stressTest )
+void stressTest(int numThreads, bool socketPerWorker, int fields)
 {
     enum {
         FeederThreads = 6,
@@ -108,8 +122,11 @@ BOOST_AUTO_TEST_CASE( stressTest )
     cerr << "init aug\n";
 
     SyncAugmentor aug("test-aug", "test-aug", proxies);
-    aug.init();
+    aug.requestFields(fields);
+    aug.init(numThreads, socketPerWorker);
     aug.doRequest = [&] (const AugmentationRequest& req) {
+        ExcAssertEqual(!!req.bidRequest, !!(fields & AUG_BID_REQUEST));
+        ExcAssertEqual(req.agents.empty(), !(fields & AUG_AGENTS));
         processed++;
         return AugmentationList();
     };
@@ -143,3 +160,13 @@ BOOST_AUTO_TEST_CASE( stressTest )
 
     proxies->events->dump(cerr);
 }
+
+BOOST_AUTO_TEST_CASE( stressTestSharedQueue )
+{
+    stressTest(1, false, AUG_ALL);
+}
+
+BOOST_AUTO_TEST_CASE( stressTestSocketPerWorker )
+{
+    stressTest(4, true, AUG_AGENTS);
+}
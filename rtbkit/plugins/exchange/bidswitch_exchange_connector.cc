@@ -39,6 +39,7 @@ BidSwitchExchangeConnector(ServiceBase & owner, const std::string & name)
     configuration_("bidswitch") {
     this->auctionResource = "/auctions";
     this->auctionVerb = "POST";
+    this->writeResponseDirectly = true;
     init();
 }
 
@@ -49,6 +50,7 @@ BidSwitchExchangeConnector(const std::string & name,
       configuration_("bidswitch") {
     this->auctionResource = "/auctions";
     this->auctionVerb = "POST";
+    this->writeResponseDirectly = true;
     init();
 }
 
@@ -29,6 +29,7 @@ CasaleExchangeConnector::CasaleExchangeConnector(
 {
     this->auctionResource = "/bidder";
     this->auctionVerb = "POST";
+    this->writeResponseDirectly = true;
     initCreativeConfiguration();
 }
 
@@ -39,6 +40,7 @@ CasaleExchangeConnector::CasaleExchangeConnector(
 {
     this->auctionResource = "/bidder";
     this->auctionVerb = "POST";
+    this->writeResponseDirectly = true;
     initCreativeConfiguration();
 }
 
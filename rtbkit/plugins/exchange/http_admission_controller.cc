@@ -0,0 +1,195 @@
+/* http_admission_controller.cc
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Pre-parse admission control for HTTP exchange connectors.
+*/
+
+#include "http_admission_controller.h"
+#include "jml/utils/exc_check.h"
+#include "jml/arch/exception.h"
+#include "jml/compiler/compiler.h"
+#include <algorithm>
+
+
+using namespace std;
+using namespace ML;
+
+
+namespace RTBKIT {
+
+namespace {
+
+/** Cheap per-thread random number in [0, 1).  random() takes a lock, which
+    we don't want on the path of every bid request.
+*/
+double randomUniform()
+{
+    static __thread uint64_t state = 0;
+    if (JML_UNLIKELY(!state))
+        state = (uint64_t)&state ^ 0x9e3779b97f4a7c15ULL;
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return (state >> 11) * (1.0 / (1ULL << 53));
+}
+
+/** Ramp from 0 at target to 1 at twice target. */
+double ramp(double value, double target)
+{
+    if (target <= 0.0 || value <= target)
+        return 0.0;
+    return std::min(1.0, (value - target) / target);
+}
+
+void updateAverage(std::atomic<double> & average, double sample,
+                   double smoothing)
+{
+    // Lost updates under contention don't matter for an average
+    double current = average.load(std::memory_order_relaxed);
+    average.store(current + smoothing * (sample - current),
+                  std::memory_order_relaxed);
+}
+
+} // file scope
+
+
+/*****************************************************************************/
+/* HTTP ADMISSION CONTROLLER                                                 */
+/*****************************************************************************/
+
+HttpAdmissionController::
+HttpAdmissionController()
+    : enabled(false),
+      maxInFlight(0),
+      targetStartLatencyMs(0.0),
+      maxStartLatencyMs(0.0),
+      targetParseLatencyMs(0.0),
+      maxShedProbability(0.9),
+      smoothing(0.01),
+      startLatencyAvg(0.0),
+      parseLatencyAvg(0.0),
+      numAdmitted(0),
+      numShed(0)
+{
+}
+
+void
+HttpAdmissionController::
+configure(const Json::Value & config)
+{
+    enabled = true;
+
+    for (auto it = config.begin(), end = config.end(); it != end; ++it) {
+        if (it.memberName() == "enabled")
+            enabled = it->asBool();
+        else if (it.memberName() == "maxInFlight")
+            maxInFlight = it->asInt();
+        else if (it.memberName() == "targetStartLatencyMs")
+            targetStartLatencyMs = it->asDouble();
+        else if (it.memberName() == "maxStartLatencyMs")
+            maxStartLatencyMs = it->asDouble();
+        else if (it.memberName() == "targetParseLatencyMs")
+            targetParseLatencyMs = it->asDouble();
+        else if (it.memberName() == "maxShedProbability")
+            maxShedProbability = it->asDouble();
+        else if (it.memberName() == "smoothing")
+            smoothing = it->asDouble();
+        else throw ML::Exception("unknown admission control field "
+                                 + it.memberName());
+    }
+
+    ExcCheckGreaterEqual(maxInFlight, 0, "invalid maxInFlight");
+    ExcCheckGreaterEqual(targetStartLatencyMs, 0.0,
+                         "invalid targetStartLatencyMs");
+    ExcCheckGreaterEqual(maxStartLatencyMs, 0.0, "invalid maxStartLatencyMs");
+    ExcCheckGreaterEqual(targetParseLatencyMs, 0.0,
+                         "invalid targetParseLatencyMs");
+    ExcCheck(maxShedProbability >= 0.0 && maxShedProbability <= 1.0,
+             "maxShedProbability must be between 0 and 1");
+    ExcCheck(smoothing > 0.0 && smoothing <= 1.0,
+             "smoothing must be between 0 and 1");
+}
+
+const char *
+HttpAdmissionController::
+eventName(Decision decision)
+{
+    switch (decision) {
+    case ADMIT:              return "auctionAdmitted";
+    case SHED_LOAD:          return "auctionEarlyDrop.randomEarlyDrop";
+    case SHED_IN_FLIGHT:     return "auctionEarlyDrop.inFlight";
+    case SHED_START_LATENCY: return "auctionEarlyDrop.startLatency";
+    case SHED_PARSE_LATENCY: return "auctionEarlyDrop.parseLatency";
+    case SHED_EXPIRED:       return "auctionEarlyDrop.expired";
+    }
+    throw ML::Exception("unknown admission decision");
+}
+
+std::pair<double, HttpAdmissionController::Decision>
+HttpAdmissionController::
+shedProbability(double acceptProbability, int inFlight) const
+{
+    std::pair<double, Decision> result(1.0 - acceptProbability, SHED_LOAD);
+    if (!enabled)
+        return result;
+
+    auto consider = [&] (double probability, Decision reason)
+        {
+            probability = std::min(probability, maxShedProbability);
+            if (probability > result.first)
+                result = make_pair(probability, reason);
+        };
+
+    if (maxInFlight > 0)
+        consider(ramp(inFlight, 0.5 * maxInFlight), SHED_IN_FLIGHT);
+    consider(ramp(startLatencyAvg, targetStartLatencyMs), SHED_START_LATENCY);
+    consider(ramp(parseLatencyAvg, targetParseLatencyMs), SHED_PARSE_LATENCY);
+
+    return result;
+}
+
+HttpAdmissionController::Decision
+HttpAdmissionController::
+admit(double acceptProbability, int inFlight, double startLatencyMs)
+{
+    Decision result = ADMIT;
+
+    if (enabled) {
+        updateAverage(startLatencyAvg, startLatencyMs, smoothing);
+        if (maxStartLatencyMs > 0.0 && startLatencyMs > maxStartLatencyMs)
+            result = SHED_EXPIRED;
+    }
+
+    if (result == ADMIT) {
+        auto shed = shedProbability(acceptProbability, inFlight);
+        if (shed.first > 0.0 && randomUniform() < shed.first)
+            result = shed.second;
+    }
+
+    if (result == ADMIT)
+        numAdmitted.fetch_add(1, std::memory_order_relaxed);
+    else numShed.fetch_add(1, std::memory_order_relaxed);
+
+    return result;
+}
+
+void
+HttpAdmissionController::
+recordParseLatency(double parseLatencyMs)
+{
+    if (enabled)
+        updateAverage(parseLatencyAvg, parseLatencyMs, smoothing);
+}
+
+double
+HttpAdmissionController::
+sampleShedRate() const
+{
+    uint64_t admitted = numAdmitted.exchange(0, std::memory_order_relaxed);
+    uint64_t shed = numShed.exchange(0, std::memory_order_relaxed);
+    if (admitted + shed == 0)
+        return 0.0;
+    return 1.0 * shed / (admitted + shed);
+}
+
+} // namespace RTBKIT
@@ -0,0 +1,105 @@
+/* http_admission_controller.h                                     -*- C++ -*-
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Decides which incoming bid requests to shed before they are parsed.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <utility>
+#include "soa/jsoncpp/json.h"
+
+
+namespace RTBKIT {
+
+
+/*****************************************************************************/
+/* HTTP ADMISSION CONTROLLER                                                 */
+/*****************************************************************************/
+
+/** Decides, before a bid request is parsed, whether it is worth handling.
+    When we're overloaded parsing requests that will then be dropped only
+    makes things worse, so this sheds a random fraction of the traffic
+    straight away with an immediate no-bid.
+
+    The fraction shed is the largest of:
+    - the router's load shedding, passed in as the accept probability;
+    - a ramp on the number of requests in flight, from half of maxInFlight
+      to maxInFlight;
+    - a ramp on the average time requests wait before we get to them, from
+      targetStartLatencyMs to twice that;
+    - a ramp on the average time spent parsing, from targetParseLatencyMs
+      to twice that.
+
+    The last three are capped at maxShedProbability so that some requests
+    keep getting through to measure with.  A request that has already waited
+    longer than maxStartLatencyMs is always shed, which bounds head of line
+    latency.
+
+    Unless enabled, only the router's load shedding is applied.
+
+    Thread safe; called from all of the exchange connector's threads.
+*/
+struct HttpAdmissionController {
+
+    HttpAdmissionController();
+
+    /** Configure from the "admissionControl" section of the exchange
+        configuration.  Setting it enables the controller.
+    */
+    void configure(const Json::Value & config);
+
+    bool enabled;
+
+    int maxInFlight;              ///< 0 to ignore requests in flight
+    double targetStartLatencyMs;  ///< 0 to ignore the start latency
+    double maxStartLatencyMs;     ///< 0 for no hard limit
+    double targetParseLatencyMs;  ///< 0 to ignore the parse latency
+    double maxShedProbability;    ///< Cap on the adaptive shedding
+    double smoothing;             ///< Weight of a sample in the averages
+
+    enum Decision {
+        ADMIT,
+        SHED_LOAD,           ///< Router load shedding
+        SHED_IN_FLIGHT,      ///< Too many requests in flight
+        SHED_START_LATENCY,  ///< Requests wait too long before handling
+        SHED_PARSE_LATENCY,  ///< Parsing is too slow
+        SHED_EXPIRED         ///< This request waited too long
+    };
+
+    /** Name of the event recorded when a request is shed for the given
+        reason.
+    */
+    static const char * eventName(Decision decision);
+
+    /** Decide what to do with a request that has waited startLatencyMs since
+        its first byte arrived, when inFlight requests are being served.
+    */
+    Decision admit(double acceptProbability, int inFlight,
+                   double startLatencyMs);
+
+    /** Record how long it took to parse a request that was admitted. */
+    void recordParseLatency(double parseLatencyMs);
+
+    /** Probability with which we'd currently shed a request, and the
+        reason.
+    */
+    std::pair<double, Decision>
+    shedProbability(double acceptProbability, int inFlight) const;
+
+    /** Fraction of requests shed since the last call. */
+    double sampleShedRate() const;
+
+    double startLatencyAverage() const { return startLatencyAvg; }
+    double parseLatencyAverage() const { return parseLatencyAvg; }
+
+private:
+    std::atomic<double> startLatencyAvg;
+    std::atomic<double> parseLatencyAvg;
+
+    mutable std::atomic<uint64_t> numAdmitted;
+    mutable std::atomic<uint64_t> numShed;
+};
+
+} // namespace RTBKIT
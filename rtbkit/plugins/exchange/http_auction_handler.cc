@@ -15,6 +15,7 @@
 #include "jml/utils/set_utils.h"
 #include "jml/utils/vector_utils.h"
 #include "jml/arch/timers.h"
+#include "soa/utils/object_pool.h"
 #include <set>
 
 #include <boost/foreach.hpp>
@@ -318,13 +319,17 @@ handleHttpPayload(const HttpHeader & header,
         return;
     }
     
-    double acceptProbability = endpoint->acceptAuctionProbability;
+    // Shed load before we spend any time parsing the request
+    double startLatencyMs = now.secondsSince(firstData) * 1000.0;
 
-    if (acceptProbability < 1.0
-        && random() % 1000000 > 1000000 * acceptProbability) {
-        // early drop...
-        doEvent("auctionEarlyDrop.randomEarlyDrop");
-        dropAuction("random early drop");
+    auto decision = endpoint->admission.admit
+        (endpoint->acceptAuctionProbability,
+         endpoint->numServingRequest,
+         startLatencyMs);
+
+    if (decision != HttpAdmissionController::ADMIT) {
+        doEvent(HttpAdmissionController::eventName(decision));
+        dropAuction("early drop: load shedding");
         return;
     }
 
@@ -333,7 +338,7 @@ handleHttpPayload(const HttpHeader & header,
 
     doEvent("auctionStartLatencyMs",
             ET_OUTCOME,
-            now.secondsSince(firstData) * 1000.0, "ms");
+            startLatencyMs, "ms");
 
     doEvent("auctionTimeAvailableMs",
             ET_OUTCOME,
@@ -387,6 +392,10 @@ handleHttpPayload(const HttpHeader & header,
     try {
         auto bidRequest = parseBidRequest(header, payload);
 
+        if (endpoint->admission.enabled)
+            endpoint->admission.recordParseLatency
+                (Date::now().secondsSince(now) * 1000.0);
+
         if (!bidRequest) {
             endpoint->recordHit("error.noBidRequest");
             //cerr << "got no bid request" << endl;
@@ -394,11 +403,11 @@ handleHttpPayload(const HttpHeader & header,
             return;
         }
 
-        auction.reset(new Auction(endpoint,
-                                  handleAuction, bidRequest,
-                                  bidRequest->toJsonStr(),
-                                  "datacratic",
-                                  firstData, expiry));
+        auction = makePooled<Auction>(endpoint,
+                                      handleAuction, bidRequest,
+                                      bidRequest->toJsonStr(),
+                                      "datacratic",
+                                      firstData, expiry);
 
         endpoint->adjustAuction(auction);
 
@@ -513,9 +522,20 @@ sendResponse()
         return;
     }
     
-    HttpResponse response = getResponse();
-    
     Date startTime = auction->start;
+
+    // Connectors that can write their response straight into the output
+    // buffer do so; the others go through an HttpResponse.
+    HttpResponseWriter writer;
+    writer.addHeader("X-Processing-Time-Ms",
+                     to_string(Date::now().secondsSince(startTime) * 1000));
+    bool written = endpoint->writeResponse(*this, this->header, *auction,
+                                           writer);
+
+    std::unique_ptr<HttpResponse> response;
+    if (!written)
+        response.reset(new HttpResponse(getResponse()));
+
     Date beforeSend = Date::now();
 
     auto onSendFinished = [=] ()
@@ -547,13 +567,18 @@ sendResponse()
         };
 
     addActivityS("beforeSend");
+
+    if (written) {
+        send(writer.finish(), NEXT_CONTINUE, onSendFinished);
+        return;
+    }
     
     double timeTaken = beforeSend.secondsSince(startTime) * 1000;
 
-    response.extraHeaders
+    response->extraHeaders
         .push_back({"X-Processing-Time-Ms", to_string(timeTaken)});
 
-    putResponseOnWire(response, onSendFinished);
+    putResponseOnWire(*response, onSendFinished);
 }
 
 void
@@ -109,6 +109,9 @@ configure(const Json::Value & parameters)
 
     if (parameters.isMember("realTimePolling"))
         realTimePolling(parameters["realTimePolling"].asBool());
+
+    if (parameters.isMember("admissionControl"))
+        admission.configure(parameters["admissionControl"]);
 }
 
 void
@@ -279,6 +282,16 @@ getResponse(const HttpAuctionHandler & connection,
     throw ML::Exception("need to override HttpExchangeConnector::getResponse");
 }
 
+bool
+HttpExchangeConnector::
+writeResponse(const HttpAuctionHandler & connection,
+              const HttpHeader & requestHeader,
+              const Auction & auction,
+              HttpResponseWriter & writer) const
+{
+    return false;
+}
+
 HttpResponse
 HttpExchangeConnector::
 getDroppedAuctionResponse(const HttpAuctionHandler & connection,
@@ -334,6 +347,17 @@ HttpExchangeConnector::
 periodicCallback(uint64_t numWakeups) const
 {
     recordLevel(numConnections(), "httpConnections");
+
+    if (admission.enabled) {
+        auto shed = admission.shedProbability(acceptAuctionProbability,
+                                              numServingRequest);
+        recordLevel(shed.first, "admission.shedProbability");
+        recordLevel(admission.sampleShedRate(), "admission.shedRate");
+        recordLevel(admission.startLatencyAverage(),
+                    "admission.startLatencyMs");
+        recordLevel(admission.parseLatencyAverage(),
+                    "admission.parseLatencyMs");
+    }
 }
 
 } // namespace RTBKIT
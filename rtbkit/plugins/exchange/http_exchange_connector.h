@@ -15,6 +15,8 @@
 #include "rtbkit/common/auction.h"
 #include <limits>
 #include "rtbkit/common/exchange_connector.h"
+#include "http_admission_controller.h"
+#include "http_response_writer.h"
 #include <boost/algorithm/string.hpp>
 
 
@@ -184,6 +186,22 @@ struct HttpExchangeConnector
                 const HttpHeader & requestHeader,
                 const Auction & auction) const;
 
+    /** Write the HTTP response for our auction, header included, straight
+        into the given writer.  This avoids building the response as an
+        HttpResponse and copying it on its way to the wire, and is used in
+        preference to getResponse() when it returns true.
+
+        The default implementation returns false, meaning that it's not
+        supported.  A connector that implements it and also overrides
+        getResponse() in a derived class needs to make sure that the two
+        stay consistent.
+    */
+    virtual bool
+    writeResponse(const HttpAuctionHandler & connection,
+                  const HttpHeader & requestHeader,
+                  const Auction & auction,
+                  HttpResponseWriter & writer) const;
+
     /** Return a stringified JSON of the response for when we drop an
         auction.
     */
@@ -287,6 +305,9 @@ protected:
 
     /// The ping time to assume for unknown hosts
     float pingTimeUnknownHostsMs;
+
+    /// Decides which bid requests to shed before they are parsed
+    HttpAdmissionController admission;
     
 private:
     friend class HttpAuctionHandler;
@@ -0,0 +1,372 @@
+/* http_response_writer.cc
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Writes an HTTP response and its JSON body straight into the output buffer.
+*/
+
+#include "http_response_writer.h"
+#include "soa/service/http_header.h"
+#include "jml/arch/exception.h"
+#include "jml/utils/exc_assert.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+
+using namespace std;
+using namespace Datacratic;
+
+
+namespace RTBKIT {
+
+namespace {
+
+// Width of the Content-Length value, which is enough for any response we
+// could ever send.
+const size_t ContentLengthWidth = 10;
+
+} // file scope
+
+
+/*****************************************************************************/
+/* HTTP RESPONSE WRITER                                                      */
+/*****************************************************************************/
+
+HttpResponseWriter::
+HttpResponseWriter(size_t capacity)
+    : state(NOT_STARTED),
+      capacity(capacity),
+      contentLengthPos(0),
+      bodyStart(0),
+      numPendingHeaders(0),
+      depth(0)
+{
+}
+
+void
+HttpResponseWriter::
+addHeader(const char * name, const std::string & value)
+{
+    if (state == NOT_STARTED) {
+        ExcAssertLess(numPendingHeaders, MaxPendingHeaders);
+        pendingHeaders[numPendingHeaders].name = name;
+        pendingHeaders[numPendingHeaders].value = value;
+        ++numPendingHeaders;
+        return;
+    }
+
+    ExcAssertEqual(state, IN_HEADER);
+    writeHeaderLine(name, value.c_str(), value.length());
+}
+
+void
+HttpResponseWriter::
+startResponse(int responseCode, const char * contentType)
+{
+    ExcAssertEqual(state, NOT_STARTED);
+
+    // Nothing is reserved until we know that the writer is being used
+    buffer.reserve(capacity);
+
+    char code[16];
+    int len = snprintf(code, sizeof(code), "%d ", responseCode);
+
+    buffer.append("HTTP/1.1 ");
+    buffer.append(code, len);
+    buffer.append(getResponseReasonPhrase(responseCode));
+    buffer.append("\r\n");
+
+    if (*contentType)
+        writeHeaderLine("Content-Type", contentType, strlen(contentType));
+
+    buffer.append("Content-Length:");
+    contentLengthPos = buffer.length();
+    buffer.append(ContentLengthWidth + 1, ' ');
+    buffer.append("\r\nConnection: Keep-Alive\r\n");
+
+    state = IN_HEADER;
+
+    for (int i = 0;  i < numPendingHeaders;  ++i) {
+        auto & h = pendingHeaders[i];
+        writeHeaderLine(h.name, h.value.c_str(), h.value.length());
+    }
+}
+
+void
+HttpResponseWriter::
+startBody()
+{
+    ExcAssertEqual(state, IN_HEADER);
+    buffer.append("\r\n");
+    bodyStart = buffer.length();
+    state = IN_BODY;
+}
+
+std::string
+HttpResponseWriter::
+finish()
+{
+    ExcAssertEqual(state, IN_BODY);
+    ExcAssertEqual(depth, 0);
+
+    unsigned long long bodyLength = buffer.length() - bodyStart;
+
+    // Right align the length in the field; the spaces before it are
+    // allowed by the HTTP grammar.
+    char * end = &buffer[contentLengthPos] + ContentLengthWidth + 1;
+    do {
+        *--end = '0' + bodyLength % 10;
+        bodyLength /= 10;
+    } while (bodyLength);
+    ExcAssertGreater(end, &buffer[contentLengthPos]);
+
+    state = NOT_STARTED;
+    numPendingHeaders = 0;
+
+    std::string result;
+    result.swap(buffer);
+    return result;
+}
+
+void
+HttpResponseWriter::
+writeHeaderLine(const char * name, const char * value, size_t len)
+{
+    buffer.append(name);
+    buffer.append(": ");
+    buffer.append(value, len);
+    buffer.append("\r\n");
+}
+
+void
+HttpResponseWriter::
+beforeValue()
+{
+    if (depth == 0)
+        return;
+
+    Level & level = levels[depth - 1];
+    if (level.isObject)
+        return;  // separator was written by startMember()
+
+    if (level.hasElements)
+        buffer += ',';
+    level.hasElements = true;
+}
+
+void
+HttpResponseWriter::
+startObject()
+{
+    beforeValue();
+    ExcAssertLess(depth, MaxDepth);
+    levels[depth++] = { true, false };
+    buffer += '{';
+}
+
+void
+HttpResponseWriter::
+endObject()
+{
+    ExcAssert(depth > 0 && levels[depth - 1].isObject);
+    --depth;
+    buffer += '}';
+}
+
+void
+HttpResponseWriter::
+startArray()
+{
+    beforeValue();
+    ExcAssertLess(depth, MaxDepth);
+    levels[depth++] = { false, false };
+    buffer += '[';
+}
+
+void
+HttpResponseWriter::
+endArray()
+{
+    ExcAssert(depth > 0 && !levels[depth - 1].isObject);
+    --depth;
+    buffer += ']';
+}
+
+void
+HttpResponseWriter::
+startMember(const char * name)
+{
+    ExcAssert(depth > 0 && levels[depth - 1].isObject);
+    Level & level = levels[depth - 1];
+    if (level.hasElements)
+        buffer += ',';
+    level.hasElements = true;
+
+    buffer += '\"';
+    buffer.append(name);
+    buffer.append("\":");
+}
+
+void
+HttpResponseWriter::
+writeEscaped(const char * str, size_t len)
+{
+    for (size_t i = 0;  i < len;  ++i) {
+        char c = str[i];
+        if (c >= ' ' && c < 127 && c != '\"' && c != '\\') {
+            buffer += c;
+            continue;
+        }
+
+        switch (c) {
+        case '\t': buffer.append("\\t");  break;
+        case '\n': buffer.append("\\n");  break;
+        case '\r': buffer.append("\\r");  break;
+        case '\f': buffer.append("\\f");  break;
+        case '\b': buffer.append("\\b");  break;
+        case '\\':
+        case '\"': buffer += '\\';  buffer += c;  break;
+        default:
+            throw ML::Exception("Invalid character in JSON string: "
+                                + string(str, len));
+        }
+    }
+}
+
+void
+HttpResponseWriter::
+writeString(const char * str, size_t len)
+{
+    beforeValue();
+    buffer += '\"';
+    writeEscaped(str, len);
+    buffer += '\"';
+}
+
+void
+HttpResponseWriter::
+writeStringUtf8(const Utf8String & str)
+{
+    beforeValue();
+    buffer += '\"';
+
+    // Multi-byte characters and the control characters without a short
+    // escape are passed through, as StreamJsonPrintingContext does.
+    const char * p = str.rawData();
+    for (size_t i = 0, len = str.rawLength();  i < len;  ++i) {
+        char c = p[i];
+        switch (c) {
+        case '\t': buffer.append("\\t");  break;
+        case '\n': buffer.append("\\n");  break;
+        case '\r': buffer.append("\\r");  break;
+        case '\b': buffer.append("\\b");  break;
+        case '\f': buffer.append("\\f");  break;
+        case '\\':
+        case '\"': buffer += '\\';  buffer += c;  break;
+        default:   buffer += c;
+        }
+    }
+
+    buffer += '\"';
+}
+
+void
+HttpResponseWriter::
+writeUnsigned(unsigned long long value)
+{
+    char buf[24];
+    char * end = buf + sizeof(buf), * p = end;
+    do {
+        *--p = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    buffer.append(p, end);
+}
+
+void
+HttpResponseWriter::
+writeIdChars(const Id & id)
+{
+    switch (id.type) {
+    case Id::NONE:
+        return;
+    case Id::STR:
+        writeEscaped(id.stringData(), id.stringLength());
+        return;
+    case Id::BIGDEC:
+        if (id.val2 == 0) {
+            writeUnsigned(id.val1);
+            return;
+        }
+        break;
+    case Id::COMPOUND2:
+        writeIdChars(id.compoundId1());
+        buffer += ':';
+        writeIdChars(id.compoundId2());
+        return;
+    default:
+        break;
+    }
+
+    string str = id.toString();
+    writeEscaped(str.c_str(), str.length());
+}
+
+void
+HttpResponseWriter::
+writeId(const Id & id)
+{
+    beforeValue();
+    buffer += '\"';
+    writeIdChars(id);
+    buffer += '\"';
+}
+
+void
+HttpResponseWriter::
+writeInt(long long value)
+{
+    beforeValue();
+    if (value < 0) {
+        buffer += '-';
+        writeUnsigned(-(unsigned long long)value);
+    }
+    else writeUnsigned(value);
+}
+
+void
+HttpResponseWriter::
+writeDouble(double value)
+{
+    beforeValue();
+
+    // %g is what an ostream with the default precision produces
+    char buf[32];
+    int len = snprintf(buf, sizeof(buf), "%g", value);
+
+    if (std::isfinite(value))
+        buffer.append(buf, len);
+    else {
+        buffer += '\"';
+        buffer.append(buf, len);
+        buffer += '\"';
+    }
+}
+
+void
+HttpResponseWriter::
+writeBool(bool value)
+{
+    beforeValue();
+    buffer.append(value ? "true" : "false");
+}
+
+void
+HttpResponseWriter::
+writeJson(const Json::Value & value)
+{
+    beforeValue();
+    buffer.append(value.toStringNoNewLine());
+}
+
+} // namespace RTBKIT
@@ -0,0 +1,159 @@
+/* http_response_writer.h                                          -*- C++ -*-
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Writes an HTTP response and its JSON body straight into the output buffer.
+*/
+
+#pragma once
+
+#include <string>
+#include "soa/types/id.h"
+#include "soa/types/string.h"
+#include "soa/jsoncpp/json.h"
+
+
+namespace RTBKIT {
+
+
+/*****************************************************************************/
+/* HTTP RESPONSE WRITER                                                      */
+/*****************************************************************************/
+
+/** Builds a complete HTTP response, header and body, in a single buffer
+    that is then handed over to the connection to be put on the wire.
+
+    Going through an HttpResponse means building a JSON document, printing
+    it into a stream, copying the stream into the response body and then
+    copying the body again behind the header; this writes every byte once.
+
+    The body length is only known once the body has been written, so the
+    Content-Length header is written with a fixed width field that is padded
+    with spaces and filled in by finish().
+
+    The JSON primitives put in the separators themselves and produce the
+    same output as a StreamJsonPrintingContext would.
+
+    Usage:
+
+        writer.startResponse(200, "application/json");
+        writer.startBody();
+        writer.startObject();
+        writer.startMember("id");
+        writer.writeId(auction.id);
+        writer.endObject();
+        connection.send(writer.finish());
+*/
+struct HttpResponseWriter {
+
+    HttpResponseWriter(size_t capacity = 2048);
+
+    /** Add a header to the response.  Headers added before startResponse()
+        are held and written along with the standard ones.
+    */
+    void addHeader(const char * name, const std::string & value);
+
+    /** Write the status line and the standard headers. */
+    void startResponse(int responseCode, const char * contentType);
+
+    /** Finish the header; whatever is written after this is the body. */
+    void startBody();
+
+    /** Fill in the Content-Length and return the whole response.  The
+        writer is empty afterwards.
+    */
+    std::string finish();
+
+    /** Whether a response was started. */
+    bool started() const
+    {
+        return state != NOT_STARTED;
+    }
+
+    /// Append raw characters to the body
+    void write(const char * data, size_t len)
+    {
+        buffer.append(data, len);
+    }
+
+    void write(const std::string & data)
+    {
+        buffer.append(data);
+    }
+
+    /*************************************************************************/
+    /* JSON                                                                  */
+    /*************************************************************************/
+
+    void startObject();
+    void endObject();
+    void startArray();
+    void endArray();
+
+    /** Start an object member.  The name is written as is, so must not need
+        escaping.
+    */
+    void startMember(const char * name);
+
+    /** Write a string that must be plain ASCII, with the same escaping and
+        restrictions as ML::jsonEscape().
+    */
+    void writeString(const char * str, size_t len);
+
+    void writeString(const std::string & str)
+    {
+        writeString(str.c_str(), str.length());
+    }
+
+    /** Write a UTF-8 string, passing the non ASCII characters through. */
+    void writeStringUtf8(const Datacratic::Utf8String & str);
+
+    /** Write an Id as a string, without going through Id::toString() for
+        the common string, integer and compound ids.
+    */
+    void writeId(const Datacratic::Id & id);
+
+    void writeInt(long long value);
+    void writeDouble(double value);
+    void writeBool(bool value);
+    void writeJson(const Json::Value & value);
+
+private:
+    enum State {
+        NOT_STARTED,
+        IN_HEADER,
+        IN_BODY
+    };
+
+    State state;
+    size_t capacity;
+    std::string buffer;
+
+    size_t contentLengthPos;      ///< Where to write the Content-Length
+    size_t bodyStart;             ///< Offset of the first byte of the body
+
+    enum { MaxPendingHeaders = 4 };
+    struct PendingHeader {
+        const char * name;
+        std::string value;
+    };
+    PendingHeader pendingHeaders[MaxPendingHeaders];
+    int numPendingHeaders;
+
+    enum { MaxDepth = 32 };
+    struct Level {
+        bool isObject;
+        bool hasElements;
+    };
+    Level levels[MaxDepth];
+    int depth;
+
+    /** Write the separator before a value, if needed. */
+    void beforeValue();
+
+    void writeHeaderLine(const char * name, const char * value, size_t len);
+    void writeIdChars(const Datacratic::Id & id);
+    void writeEscaped(const char * str, size_t len);
+    void writeUnsigned(unsigned long long value);
+};
+
+} // namespace RTBKIT
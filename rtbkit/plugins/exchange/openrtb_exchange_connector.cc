@@ -9,11 +9,13 @@
 #include "rtbkit/plugins/bid_request/openrtb_bid_source.h"
 #include "rtbkit/plugins/bid_request/openrtb_bid_request_parser.h"
 #include "rtbkit/plugins/exchange/http_auction_handler.h"
+#include "rtbkit/plugins/exchange/openrtb_response_writer.h"
 #include "rtbkit/core/agent_configuration/agent_config.h"
 #include "rtbkit/openrtb/openrtb_parsing.h"
 #include "soa/types/json_printing.h"
 #include <boost/any.hpp>
 #include <boost/lexical_cast.hpp>
+#include <typeinfo>
 #include "jml/utils/file_functions.h"
 #include "jml/arch/info.h"
 #include "jml/utils/rng.h"
@@ -83,14 +85,16 @@ BOOST_STATIC_ASSERT(hasFromJson<int>::value == false);
 
 OpenRTBExchangeConnector::
 OpenRTBExchangeConnector(ServiceBase & owner, const std::string & name)
-    : HttpExchangeConnector(name, owner)
+    : HttpExchangeConnector(name, owner),
+      writeResponseDirectly(false)
 {
 }
 
 OpenRTBExchangeConnector::
 OpenRTBExchangeConnector(const std::string & name,
                          std::shared_ptr<ServiceProxies> proxies)
-    : HttpExchangeConnector(name, proxies)
+    : HttpExchangeConnector(name, proxies),
+      writeResponseDirectly(false)
 {
 }
 
@@ -207,6 +211,61 @@ getResponse(const HttpAuctionHandler & connection,
                                 current->error + ": " + current->details);
 
     OpenRTB::BidResponse response;
+    fillResponse(connection, auction, response);
+
+    if (response.seatbid.empty())
+        return HttpResponse(204, "none", "");
+
+    static Datacratic::DefaultDescription<OpenRTB::BidResponse> desc;
+    std::ostringstream stream;
+    StreamJsonPrintingContext context(stream);
+    desc.printJsonTyped(&response, context);
+
+    return HttpResponse(200, "application/json", stream.str());
+}
+
+bool
+OpenRTBExchangeConnector::
+writeResponse(const HttpAuctionHandler & connection,
+              const HttpHeader & requestHeader,
+              const Auction & auction,
+              HttpResponseWriter & writer) const
+{
+    // A derived connector may build its response differently in
+    // getResponse(), so it has to say that it doesn't.
+    if (!writeResponseDirectly
+        && typeid(*this) != typeid(OpenRTBExchangeConnector))
+        return false;
+
+    const Auction::Data * current = auction.getCurrentData();
+
+    // Errors are rare enough to go through getResponse()
+    if (current->hasError())
+        return false;
+
+    OpenRTB::BidResponse response;
+    fillResponse(connection, auction, response);
+
+    if (response.seatbid.empty()) {
+        writer.startResponse(204, "none");
+        writer.startBody();
+        return true;
+    }
+
+    writer.startResponse(200, "application/json");
+    writer.startBody();
+    writeJson(writer, response);
+    return true;
+}
+
+void
+OpenRTBExchangeConnector::
+fillResponse(const HttpAuctionHandler & connection,
+             const Auction & auction,
+             OpenRTB::BidResponse & response) const
+{
+    const Auction::Data * current = auction.getCurrentData();
+
     response.id = auction.id;
 
     response.ext = getResponseExt(connection, auction);
@@ -218,16 +277,6 @@ getResponse(const HttpAuctionHandler & connection,
 
         setSeatBid(auction, spotNum, response);
     }
-
-    if (response.seatbid.empty())
-        return HttpResponse(204, "none", "");
-
-    static Datacratic::DefaultDescription<OpenRTB::BidResponse> desc;
-    std::ostringstream stream;
-    StreamJsonPrintingContext context(stream);
-    desc.printJsonTyped(&response, context);
-
-    return HttpResponse(200, "application/json", stream.str());
 }
 
 Json::Value
@@ -48,6 +48,12 @@ struct OpenRTBExchangeConnector : public HttpExchangeConnector {
                 const HttpHeader & requestHeader,
                 const Auction & auction) const;
 
+    virtual bool
+    writeResponse(const HttpAuctionHandler & connection,
+                  const HttpHeader & requestHeader,
+                  const Auction & auction,
+                  HttpResponseWriter & writer) const;
+
     virtual HttpResponse
     getDroppedAuctionResponse(const HttpAuctionHandler & connection,
                               const std::string & reason) const;
@@ -65,9 +71,24 @@ private:
                    const Auction & auction) const;
 protected:
 
+    /** Fill in the bid response for the auction, with one seat bid per
+        valid response as set up by setSeatBid().  Shared by getResponse()
+        and writeResponse().
+    */
+    void fillResponse(const HttpAuctionHandler & connection,
+                      const Auction & auction,
+                      OpenRTB::BidResponse & response) const;
+
     virtual void setSeatBid(Auction const & auction,
                             int spotNum,
                             OpenRTB::BidResponse & response) const;
+
+    /** Whether writeResponse() may write the response that fillResponse()
+        builds instead of leaving it to getResponse().  Derived connectors
+        that don't change the response in getResponse() set it to opt in;
+        the plain OpenRTB connector always writes it directly.
+    */
+    bool writeResponseDirectly;
 };
 
 } // namespace RTBKIT
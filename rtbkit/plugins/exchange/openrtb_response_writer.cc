@@ -0,0 +1,142 @@
+/* openrtb_response_writer.cc
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Writes OpenRTB bid responses with an HttpResponseWriter.
+*/
+
+#include "openrtb_response_writer.h"
+#include <cmath>
+
+
+using namespace std;
+using namespace Datacratic;
+
+
+namespace RTBKIT {
+
+namespace {
+
+// Each of these skips the member when its description would consider the
+// value to be the default, as StructureDescription does.
+
+void writeMember(HttpResponseWriter & writer, const char * name,
+                 const Id & id)
+{
+    if (!id.notNull())
+        return;
+    writer.startMember(name);
+    writer.writeId(id);
+}
+
+void writeMember(HttpResponseWriter & writer, const char * name,
+                 const std::string & str)
+{
+    if (str.empty())
+        return;
+    writer.startMember(name);
+    writer.writeString(str);
+}
+
+void writeMember(HttpResponseWriter & writer, const char * name,
+                 const Utf8String & str)
+{
+    if (str.empty())
+        return;
+    writer.startMember(name);
+    writer.writeStringUtf8(str);
+}
+
+void writeMember(HttpResponseWriter & writer, const char * name,
+                 const Json::Value & value)
+{
+    if (value.isNull())
+        return;
+    writer.startMember(name);
+    writer.writeJson(value);
+}
+
+} // file scope
+
+
+/*****************************************************************************/
+/* OPENRTB RESPONSE WRITER                                                   */
+/*****************************************************************************/
+
+void writeJson(HttpResponseWriter & writer, const OpenRTB::Bid & bid)
+{
+    writer.startObject();
+
+    writeMember(writer, "id", bid.id);
+    writeMember(writer, "impid", bid.impid);
+    if (!std::isnan(bid.price.val)) {
+        writer.startMember("price");
+        writer.writeDouble(bid.price.val);
+    }
+    writeMember(writer, "adid", bid.adid);
+    writeMember(writer, "nurl", bid.nurl);
+    writeMember(writer, "adm", bid.adm);
+    if (!bid.adomain.empty()) {
+        writer.startMember("adomain");
+        writer.startArray();
+        for (auto & domain: bid.adomain)
+            writer.writeString(domain);
+        writer.endArray();
+    }
+    writeMember(writer, "iurl", bid.iurl);
+    writeMember(writer, "cid", bid.cid);
+    writeMember(writer, "crid", bid.crid);
+    if (!bid.attr.empty()) {
+        writer.startMember("attr");
+        writer.startArray();
+        for (auto & attr: bid.attr)
+            writer.writeInt(attr.val);
+        writer.endArray();
+    }
+    writeMember(writer, "ext", bid.ext);
+
+    writer.endObject();
+}
+
+void writeJson(HttpResponseWriter & writer, const OpenRTB::SeatBid & seatBid)
+{
+    writer.startObject();
+
+    if (!seatBid.bid.empty()) {
+        writer.startMember("bid");
+        writer.startArray();
+        for (auto & bid: seatBid.bid)
+            writeJson(writer, bid);
+        writer.endArray();
+    }
+    writeMember(writer, "seat", seatBid.seat);
+    if (seatBid.group.val != -1) {
+        writer.startMember("group");
+        writer.writeInt(seatBid.group.val);
+    }
+    writeMember(writer, "ext", seatBid.ext);
+
+    writer.endObject();
+}
+
+void writeJson(HttpResponseWriter & writer,
+               const OpenRTB::BidResponse & response)
+{
+    writer.startObject();
+
+    writeMember(writer, "id", response.id);
+    if (!response.seatbid.empty()) {
+        writer.startMember("seatbid");
+        writer.startArray();
+        for (auto & seatBid: response.seatbid)
+            writeJson(writer, seatBid);
+        writer.endArray();
+    }
+    writeMember(writer, "bidid", response.bidid);
+    writeMember(writer, "cur", response.cur);
+    writeMember(writer, "customData", response.customData);
+    writeMember(writer, "ext", response.ext);
+
+    writer.endObject();
+}
+
+} // namespace RTBKIT
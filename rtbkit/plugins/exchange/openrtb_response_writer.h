@@ -0,0 +1,35 @@
+/* openrtb_response_writer.h                                       -*- C++ -*-
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Writes OpenRTB bid responses with an HttpResponseWriter.
+*/
+
+#pragma once
+
+#include "rtbkit/openrtb/openrtb.h"
+#include "rtbkit/plugins/exchange/http_response_writer.h"
+
+
+namespace RTBKIT {
+
+
+/*****************************************************************************/
+/* OPENRTB RESPONSE WRITER                                                   */
+/*****************************************************************************/
+
+/** Write the parts of a bid response as JSON.  The output is exactly what
+    their value descriptions print, fields left at their default value
+    included, but without going through a printing context and a stream.
+
+    These can be used by any connector whose response, or part of it, has
+    the OpenRTB seatbid / bid shape.
+*/
+
+void writeJson(HttpResponseWriter & writer, const OpenRTB::Bid & bid);
+
+void writeJson(HttpResponseWriter & writer, const OpenRTB::SeatBid & seatBid);
+
+void writeJson(HttpResponseWriter & writer,
+               const OpenRTB::BidResponse & response);
+
+} // namespace RTBKIT
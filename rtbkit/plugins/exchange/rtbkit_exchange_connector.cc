@@ -20,6 +20,7 @@ RTBKitExchangeConnector::
 RTBKitExchangeConnector(ServiceBase &owner, const std::string &name)
     : OpenRTBExchangeConnector(owner, name)
 {
+    this->writeResponseDirectly = true;
 }
 
 RTBKitExchangeConnector::
@@ -27,6 +28,7 @@ RTBKitExchangeConnector(const std::string &name,
                         std::shared_ptr<ServiceProxies> proxies)
     : OpenRTBExchangeConnector(name, proxies)
 {
+    this->writeResponseDirectly = true;
 }
 
 std::shared_ptr<BidRequest>
@@ -32,6 +32,7 @@ RubiconExchangeConnector(ServiceBase & owner, const std::string & name)
 {
     this->auctionResource = "/auctions";
     this->auctionVerb = "POST";
+    this->writeResponseDirectly = true;
 
     init();
 }
@@ -44,6 +45,7 @@ RubiconExchangeConnector(const std::string & name,
 {
     this->auctionResource = "/auctions";
     this->auctionVerb = "POST";
+    this->writeResponseDirectly = true;
 
     init();
 }
@@ -37,6 +37,7 @@ SmaatoExchangeConnector(ServiceBase & owner, const std::string & name)
     : OpenRTBExchangeConnector(owner, name) {
     this->auctionResource = "/auctions";
     this->auctionVerb = "POST";
+    this->writeResponseDirectly = true;
 }
 
 SmaatoExchangeConnector::
@@ -45,6 +46,7 @@ SmaatoExchangeConnector(const std::string & name,
     : OpenRTBExchangeConnector(name, proxies) {
     this->auctionResource = "/auctions";
     this->auctionVerb = "POST";
+    this->writeResponseDirectly = true;
 }
  
 std::shared_ptr<BidRequest>
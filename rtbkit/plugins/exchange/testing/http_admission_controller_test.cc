@@ -0,0 +1,109 @@
+/* http_admission_controller_test.cc
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Test for the pre-parse admission control of HTTP exchange connectors.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include "rtbkit/plugins/exchange/http_admission_controller.h"
+
+
+using namespace std;
+using namespace RTBKIT;
+
+namespace {
+
+/** Fraction of n requests that are shed. */
+double shedFraction(HttpAdmissionController & controller,
+                    double acceptProbability, int inFlight,
+                    double startLatencyMs, int n = 100000)
+{
+    int shed = 0;
+    for (int i = 0;  i < n;  ++i)
+        if (controller.admit(acceptProbability, inFlight, startLatencyMs)
+            != HttpAdmissionController::ADMIT)
+            ++shed;
+    return 1.0 * shed / n;
+}
+
+} // file scope
+
+BOOST_AUTO_TEST_CASE( test_disabled_applies_router_shedding_only )
+{
+    HttpAdmissionController controller;
+    BOOST_CHECK(!controller.enabled);
+
+    BOOST_CHECK_EQUAL(shedFraction(controller, 1.0, 1000000, 1000.0), 0.0);
+    BOOST_CHECK_CLOSE(shedFraction(controller, 0.75, 0, 0.0), 0.25, 5.0);
+
+    auto shed = controller.shedProbability(0.5, 0);
+    BOOST_CHECK_EQUAL(shed.first, 0.5);
+    BOOST_CHECK_EQUAL(shed.second, HttpAdmissionController::SHED_LOAD);
+    BOOST_CHECK_EQUAL(controller.sampleShedRate() > 0.0, true);
+    BOOST_CHECK_EQUAL(controller.sampleShedRate(), 0.0);
+}
+
+BOOST_AUTO_TEST_CASE( test_in_flight_and_latency_signals )
+{
+    Json::Value config;
+    config["maxInFlight"] = 100;
+    config["maxStartLatencyMs"] = 20.0;
+    config["targetParseLatencyMs"] = 1.0;
+    config["maxShedProbability"] = 0.8;
+    config["smoothing"] = 1.0;
+
+    HttpAdmissionController controller;
+    controller.configure(config);
+    BOOST_CHECK(controller.enabled);
+
+    // Below half of the in flight limit nothing is shed
+    BOOST_CHECK_EQUAL(shedFraction(controller, 1.0, 50, 1.0), 0.0);
+
+    // Halfway up the ramp
+    auto shed = controller.shedProbability(1.0, 75);
+    BOOST_CHECK_CLOSE(shed.first, 0.5, 1e-6);
+    BOOST_CHECK_EQUAL(shed.second, HttpAdmissionController::SHED_IN_FLIGHT);
+
+    // Capped so that some requests still get through
+    BOOST_CHECK_CLOSE(controller.shedProbability(1.0, 1000).first, 0.8, 1e-6);
+
+    // ... but router shedding isn't capped
+    BOOST_CHECK_EQUAL(controller.shedProbability(0.0, 1000).first, 1.0);
+
+    // Requests that waited too long are always shed
+    BOOST_CHECK_EQUAL(controller.admit(1.0, 0, 21.0),
+                      HttpAdmissionController::SHED_EXPIRED);
+
+    // Slow parsing
+    controller.recordParseLatency(1.5);
+    shed = controller.shedProbability(1.0, 0);
+    BOOST_CHECK_CLOSE(shed.first, 0.5, 1e-6);
+    BOOST_CHECK_EQUAL(shed.second,
+                      HttpAdmissionController::SHED_PARSE_LATENCY);
+
+    controller.recordParseLatency(0.5);
+    BOOST_CHECK_EQUAL(controller.shedProbability(1.0, 0).first, 0.0);
+}
+
+BOOST_AUTO_TEST_CASE( test_config )
+{
+    Json::Value config;
+    config["enabled"] = false;
+    config["targetStartLatencyMs"] = 5.0;
+
+    HttpAdmissionController controller;
+    controller.configure(config);
+    BOOST_CHECK(!controller.enabled);
+    BOOST_CHECK_EQUAL(controller.targetStartLatencyMs, 5.0);
+
+    config["unknownField"] = 1;
+    BOOST_CHECK_THROW(controller.configure(config), std::exception);
+
+    Json::Value bad;
+    bad["maxShedProbability"] = 2.0;
+    BOOST_CHECK_THROW(HttpAdmissionController().configure(bad),
+                      std::exception);
+}
@@ -0,0 +1,148 @@
+/* http_response_writer_test.cc
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Test for writing exchange responses straight into the output buffer.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <sstream>
+#include <boost/test/unit_test.hpp>
+#include "rtbkit/plugins/exchange/http_response_writer.h"
+#include "rtbkit/plugins/exchange/openrtb_response_writer.h"
+#include "rtbkit/openrtb/openrtb_parsing.h"
+#include "soa/types/json_printing.h"
+
+
+using namespace std;
+using namespace Datacratic;
+using namespace RTBKIT;
+
+namespace {
+
+std::string printWithDescription(const OpenRTB::BidResponse & response)
+{
+    static DefaultDescription<OpenRTB::BidResponse> desc;
+    std::ostringstream stream;
+    StreamJsonPrintingContext context(stream);
+    desc.printJsonTyped(&response, context);
+    return stream.str();
+}
+
+std::string printWithWriter(const OpenRTB::BidResponse & response)
+{
+    HttpResponseWriter writer;
+    writer.startResponse(200, "application/json");
+    writer.startBody();
+    writeJson(writer, response);
+    std::string result = writer.finish();
+    return result.substr(result.find("\r\n\r\n") + 4);
+}
+
+} // file scope
+
+BOOST_AUTO_TEST_CASE( test_http_framing )
+{
+    HttpResponseWriter writer;
+    writer.addHeader("X-Processing-Time-Ms", "1.5");
+    writer.startResponse(200, "application/json");
+    writer.addHeader("X-Other", "value");
+    writer.startBody();
+    writer.startObject();
+    writer.startMember("a");
+    writer.startArray();
+    writer.writeInt(-12);
+    writer.writeDouble(0.25);
+    writer.writeBool(true);
+    writer.writeString("x\"y");
+    writer.endArray();
+    writer.startMember("b");
+    writer.startObject();
+    writer.endObject();
+    writer.endObject();
+
+    std::string response = writer.finish();
+    BOOST_CHECK(!writer.started());
+
+    std::string body = "{\"a\":[-12,0.25,true,\"x\\\"y\"],\"b\":{}}";
+    BOOST_CHECK_EQUAL(response,
+                      "HTTP/1.1 200 OK\r\n"
+                      "Content-Type: application/json\r\n"
+                      "Content-Length:         " + to_string(body.length())
+                      + "\r\n"
+                      "Connection: Keep-Alive\r\n"
+                      "X-Processing-Time-Ms: 1.5\r\n"
+                      "X-Other: value\r\n"
+                      "\r\n" + body);
+
+    // A no-bid has an empty body, and the writer can be used again
+    writer.startResponse(204, "none");
+    writer.startBody();
+    response = writer.finish();
+    BOOST_CHECK_EQUAL(response,
+                      "HTTP/1.1 204 No Content\r\n"
+                      "Content-Type: none\r\n"
+                      "Content-Length:          0\r\n"
+                      "Connection: Keep-Alive\r\n"
+                      "\r\n");
+
+    // Only plain ASCII goes in a plain string
+    writer.startResponse(200, "application/json");
+    writer.startBody();
+    BOOST_CHECK_THROW(writer.writeString("\x01"), ML::Exception);
+}
+
+BOOST_AUTO_TEST_CASE( test_openrtb_same_as_description )
+{
+    OpenRTB::BidResponse response;
+    response.id = Id("auction-with-a-long-id-0123456789");
+
+    // Nothing but the id
+    BOOST_CHECK_EQUAL(printWithWriter(response),
+                      printWithDescription(response));
+
+    response.seatbid.emplace_back();
+    response.seatbid[0].bid.emplace_back();
+
+    // The usual shape, as set up by OpenRTBExchangeConnector::setSeatBid
+    auto & b = response.seatbid[0].bid[0];
+    b.cid = Id("campaign");
+    b.crid = Id(12345);
+    b.id = Id(Id("auction"), Id("1"));
+    b.impid = Id("1");
+    b.price.val = 1.23456789;
+
+    BOOST_CHECK_EQUAL(printWithWriter(response),
+                      printWithDescription(response));
+
+    // Everything else filled in as well
+    b.adid = Id("0828398c-5965-11e0-84c8-0026b937c8e1");
+    b.nurl = Utf8String("http://win.example.com/?p=${AUCTION_PRICE}&q=\"\\");
+    b.adm = Utf8String("<a href=\"x\">caf\xc3\xa9</a>\n\t");
+    b.adomain = { "example.com", "example.org" };
+    b.iurl = Utf8String("http://example.com/image.png");
+    OpenRTB::CreativeAttribute attr;
+    attr.val = 1;
+    b.attr.push_back(attr);
+    attr.val = 7;
+    b.attr.push_back(attr);
+    b.ext["priority"] = 1.0;
+    b.ext["list"][0] = "a";
+
+    response.seatbid.emplace_back();
+    response.seatbid[1].bid.push_back(b);
+    response.seatbid[1].bid.push_back(b);
+    response.seatbid[1].bid[1].price.val = 2;
+    response.seatbid[1].seat = Id("seat");
+    response.seatbid[1].group.val = 0;
+    response.seatbid[1].ext["x"] = "y";
+
+    response.bidid = Id(42);
+    response.cur = "USD";
+    response.customData = Utf8String("custom");
+    response.ext["protocol"] = "2.2";
+
+    BOOST_CHECK_EQUAL(printWithWriter(response),
+                      printWithDescription(response));
+}
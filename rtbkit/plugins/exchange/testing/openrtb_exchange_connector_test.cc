@@ -11,6 +11,7 @@
 
 #include "rtbkit/common/testing/exchange_source.h"
 #include "rtbkit/plugins/exchange/openrtb_exchange_connector.h"
+#include "rtbkit/plugins/bid_request/openrtb_bid_source.h"
 #include "rtbkit/core/router/router.h"
 
 
@@ -99,3 +100,62 @@ BOOST_AUTO_TEST_CASE( test_openrtb_error_codes )
     router.shutdown();
 }
 
+
+/** Connector that builds its own response, which the OpenRTB connector
+    mustn't bypass when it writes responses directly.
+*/
+struct OwnResponseExchangeConnector : public OpenRTBExchangeConnector {
+    OwnResponseExchangeConnector(const std::string & name,
+                                 std::shared_ptr<ServiceProxies> proxies)
+        : OpenRTBExchangeConnector(name, proxies)
+    {
+    }
+
+    virtual HttpResponse
+    getResponse(const HttpAuctionHandler & connection,
+                const HttpHeader & requestHeader,
+                const Auction & auction) const
+    {
+        return HttpResponse(200, "application/json", "{\"own\":true}");
+    }
+};
+
+BOOST_AUTO_TEST_CASE( test_openrtb_overridden_get_response )
+{
+    std::shared_ptr<ServiceProxies> proxies(new ServiceProxies());
+
+    Router router(proxies, "router");
+    router.unsafeDisableMonitor();
+    router.init();
+
+    router.bindTcp();
+    router.start();
+
+    auto connector
+        = std::make_shared<OwnResponseExchangeConnector>("connector", proxies);
+    connector->configureHttp(1, -1, "0.0.0.0");
+    connector->start();
+    connector->enableUntil(Date::positiveInfinity());
+
+    router.addExchange(connector);
+
+    ML::sleep(1.0);
+
+    Json::Value config;
+    config["url"] = ML::format("localhost:%d", connector->port());
+    config["verb"] = "POST";
+    config["resource"] = "/auctions";
+    OpenRTBBidSource source(config);
+
+    // Nobody bids, so the auction finishes with the connector's response
+    source.generateRandomBidRequest();
+    auto result = source.read();
+    std::cerr << "http response:" << std::endl << result << std::endl;
+
+    HttpHeader http;
+    http.parse(result);
+    BOOST_CHECK_EQUAL(http.resource, "200");
+    BOOST_CHECK_EQUAL(http.knownData, "{\"own\":true}");
+
+    router.shutdown();
+}
@@ -1,6 +1,7 @@
 #define BOOST_TEST_MAIN
 #define BOOST_TEST_DYN_LINK
 
+#include <algorithm>
 #include <iostream>
 
 #include <boost/test/unit_test.hpp>
@@ -278,3 +279,43 @@ BOOST_AUTO_TEST_CASE(test_error)
     BOOST_CHECK_THROW(conf.handleCreativeCompatibility(example1, true),
                       std::runtime_error);
 }
+
+BOOST_AUTO_TEST_CASE(test_compiled_template)
+{
+    TestCreativeConfiguration conf("test");
+    conf.addExpanderVariable("custom", [](const TestCreativeConfiguration::Context&)
+                             { return std::string("a b"); });
+    conf.addExpanderFilter("reverse", [](std::string& value) -> std::string&
+                           {
+                               std::reverse(value.begin(), value.end());
+                               return value;
+                           });
+
+    RTBKIT::BidRequest bidrequest;
+    bidrequest.auctionId = Datacratic::Id("auction\xc3\xa9");
+    RTBKIT::Auction::Response response;
+    RTBKIT::Creative creative(728, 90, "LB", 1);
+    TestCreativeConfiguration::Context context{creative, response, bidrequest, 0};
+
+    auto compiled = conf.compile(
+            "http://win/?ex=%{exchange}&id=%{bidrequest.id#urlencode}"
+            "&w=%{creative.width}&c=%{custom#upper#reverse}%{custom}");
+
+    // Appends to the buffer, which can be reused
+    std::string out = "prefix:";
+    compiled->expand(context, out);
+    BOOST_CHECK_EQUAL(out, "prefix:http://win/?ex=test&id=auction%C3%A9"
+                      "&w=728&c=B Aa b");
+
+    out.clear();
+    compiled->expand(context, out);
+    BOOST_CHECK_EQUAL(out, "http://win/?ex=test&id=auction%C3%A9"
+                      "&w=728&c=B Aa b");
+
+    // Templates without any variables are copied as is
+    out.clear();
+    conf.compile("no variables")->expand(context, out);
+    BOOST_CHECK_EQUAL(out, "no variables");
+
+    BOOST_CHECK_THROW(conf.compile("%{custom#nofilter}"), std::runtime_error);
+}
@@ -0,0 +1,543 @@
+/* columnar_log.cc
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Block compressed, column oriented storage for log messages.
+*/
+
+#include "columnar_log.h"
+#include "jml/arch/exception.h"
+#include "jml/utils/exc_assert.h"
+#include <zlib.h>
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+
+
+namespace Datacratic {
+
+namespace {
+
+const uint32_t BlockMagic = 0x31424c43;  // "CLB1"
+
+int64_t toMicros(Date date)
+{
+    return llround(date.secondsSinceEpoch() * 1000000.0);
+}
+
+/** Same as toMicros but with the infinities at the ends of the range. */
+int64_t toQueryMicros(Date date)
+{
+    if (date == Date::negativeInfinity())
+        return numeric_limits<int64_t>::min();
+    if (date == Date::positiveInfinity())
+        return numeric_limits<int64_t>::max();
+    return toMicros(date);
+}
+
+template<typename T>
+void append(string & out, T value)
+{
+    out.append((const char *)&value, sizeof(value));
+}
+
+void appendString(string & out, const string & value)
+{
+    append<uint32_t>(out, value.size());
+    out += value;
+}
+
+string compressColumn(const string & raw, int level)
+{
+    uLongf size = compressBound(raw.size());
+    string result(size, '\0');
+
+    int res = compress2((Bytef *)&result[0], &size,
+                        (const Bytef *)raw.data(), raw.size(), level);
+    if (res != Z_OK)
+        throw ML::Exception("columnar log: compression failed: %d", res);
+
+    result.resize(size);
+    return result;
+}
+
+/** Reads the parts of a block out of the mapped file.  Every read returns
+    false instead of going past the end of the file.
+*/
+struct Cursor {
+    Cursor(const char * pos, const char * end)
+        : pos(pos), end(end)
+    {
+    }
+
+    template<typename T>
+    bool read(T & value)
+    {
+        if (end - pos < (ssize_t)sizeof(T)) return false;
+        memcpy(&value, pos, sizeof(T));
+        pos += sizeof(T);
+        return true;
+    }
+
+    bool read(string & value)
+    {
+        uint32_t size;
+        if (!read(size) || end - pos < size) return false;
+        value.assign(pos, size);
+        pos += size;
+        return true;
+    }
+
+    bool skip(size_t size)
+    {
+        if (end - pos < (ssize_t)size) return false;
+        pos += size;
+        return true;
+    }
+
+    const char * pos;
+    const char * end;
+};
+
+struct Column {
+    const char * data;
+    uint32_t compressedSize;
+    uint32_t rawSize;
+
+    string decompress() const
+    {
+        string result(rawSize, '\0');
+        uLongf size = rawSize;
+
+        int res = uncompress((Bytef *)&result[0], &size,
+                             (const Bytef *)data, compressedSize);
+        if (res != Z_OK || size != rawSize)
+            throw ML::Exception("columnar log: corrupt column: %d", res);
+
+        return result;
+    }
+};
+
+/** Where a string column's values are once it's decompressed. */
+struct Strings {
+    Strings(const string & raw, uint32_t rows)
+        : raw(raw), offsets(rows + 1)
+    {
+        ExcAssertGreaterEqual(raw.size(), rows * sizeof(uint32_t));
+        const char * sizes = raw.data();
+
+        offsets[0] = rows * sizeof(uint32_t);
+        for (uint32_t i = 0;  i < rows;  ++i) {
+            uint32_t size;
+            memcpy(&size, sizes + i * sizeof(uint32_t), sizeof(size));
+            offsets[i + 1] = offsets[i] + size;
+        }
+        ExcAssertEqual(offsets[rows], raw.size());
+    }
+
+    const char * data(uint32_t row) const { return raw.data() + offsets[row]; }
+    size_t size(uint32_t row) const { return offsets[row + 1] - offsets[row]; }
+
+    bool equals(uint32_t row, const string & value) const
+    {
+        return size(row) == value.size()
+            && memcmp(data(row), value.data(), value.size()) == 0;
+    }
+
+    const string & raw;
+    vector<size_t> offsets;
+};
+
+struct Block {
+    string channel;
+    uint32_t rows;
+    int32_t keyField;
+    int64_t minTime;
+    int64_t maxTime;
+    vector<string> keys;
+    Column rowColumn;
+    vector<Column> columns;
+
+    /** Read the block at the cursor, returning false if the file ends
+        before it does.
+    */
+    bool read(Cursor & cursor)
+    {
+        uint32_t magic, numColumns, numKeys;
+        if (!cursor.read(magic)) return false;
+        if (magic != BlockMagic)
+            throw ML::Exception("columnar log: bad block magic");
+
+        if (!cursor.read(rows) || !cursor.read(numColumns)) return false;
+        if (!cursor.read(keyField)) return false;
+        if (!cursor.read(minTime) || !cursor.read(maxTime)) return false;
+        if (!cursor.read(channel) || !cursor.read(numKeys)) return false;
+
+        keys.resize(numKeys);
+        for (auto & key : keys)
+            if (!cursor.read(key)) return false;
+
+        columns.resize(numColumns);
+        if (!cursor.read(rowColumn.compressedSize)) return false;
+        if (!cursor.read(rowColumn.rawSize)) return false;
+        for (auto & column : columns) {
+            if (!cursor.read(column.compressedSize)) return false;
+            if (!cursor.read(column.rawSize)) return false;
+        }
+
+        rowColumn.data = cursor.pos;
+        if (!cursor.skip(rowColumn.compressedSize)) return false;
+        for (auto & column : columns) {
+            column.data = cursor.pos;
+            if (!cursor.skip(column.compressedSize)) return false;
+        }
+
+        return true;
+    }
+
+    bool mayMatch(const ColumnarLogQuery & query,
+                  int64_t earliest, int64_t latest) const
+    {
+        if (!query.channel.empty() && query.channel != channel)
+            return false;
+        if (maxTime < earliest || minTime >= latest)
+            return false;
+        if (query.key.empty())
+            return true;
+        if (keyField < 1 || keyField > columns.size())
+            return false;
+        return binary_search(keys.begin(), keys.end(), query.key);
+    }
+
+    vector<string> decode(const ColumnarLogQuery & query,
+                          int64_t earliest, int64_t latest) const
+    {
+        string rowData = rowColumn.decompress();
+        ExcAssertEqual(rowData.size(),
+                       rows * (sizeof(int64_t) + sizeof(uint32_t)));
+        const char * times = rowData.data();
+        const char * numFields = times + rows * sizeof(int64_t);
+
+        vector<uint32_t> matching;
+        for (uint32_t i = 0;  i < rows;  ++i) {
+            int64_t time;
+            memcpy(&time, times + i * sizeof(time), sizeof(time));
+            time += minTime;
+            if (time >= earliest && time < latest)
+                matching.push_back(i);
+        }
+
+        if (!query.key.empty() && !matching.empty()) {
+            string keyData = columns[keyField - 1].decompress();
+            Strings keyValues(keyData, rows);
+
+            auto notKey = [&] (uint32_t row)
+                {
+                    return !keyValues.equals(row, query.key);
+                };
+            matching.erase(remove_if(matching.begin(), matching.end(), notKey),
+                           matching.end());
+        }
+
+        vector<string> result;
+        if (matching.empty()) return result;
+
+        vector<string> raw;
+        raw.reserve(columns.size());
+        for (const auto & column : columns)
+            raw.push_back(column.decompress());
+
+        vector<Strings> values;
+        values.reserve(columns.size());
+        for (const auto & data : raw)
+            values.emplace_back(data, rows);
+
+        result.reserve(matching.size());
+        for (uint32_t row : matching) {
+            uint32_t fields;
+            memcpy(&fields, numFields + row * sizeof(fields), sizeof(fields));
+            ExcAssertLessEqual(fields, values.size());
+
+            string message;
+            for (uint32_t i = 0;  i < fields;  ++i) {
+                if (i) message += '\t';
+                message.append(values[i].data(row), values[i].size(row));
+            }
+            result.push_back(std::move(message));
+        }
+
+        return result;
+    }
+};
+
+} // file scope
+
+
+/*****************************************************************************/
+/* COLUMNAR LOG BLOCK WRITER                                                 */
+/*****************************************************************************/
+
+ColumnarLogBlockWriter::
+ColumnarLogBlockWriter(const std::string & channel, int keyField, int level)
+    : channel(channel),
+      keyField(keyField >= 1 ? keyField : -1),
+      level(level)
+{
+}
+
+void
+ColumnarLogBlockWriter::
+add(Date timestamp, const std::string & message)
+{
+    if (times.empty() || timestamp < minTime) minTime = timestamp;
+    if (times.empty() || timestamp > maxTime) maxTime = timestamp;
+
+    size_t row = times.size();
+    times.push_back(toMicros(timestamp));
+
+    size_t field = 0;
+    for (size_t start = 0;  ;  ++field) {
+        size_t end = message.find('\t', start);
+        if (end == string::npos) end = message.size();
+
+        if (field == columns.size())
+            columns.emplace_back(row);
+        columns[field].emplace_back(message, start, end - start);
+
+        if (end == message.size()) break;
+        start = end + 1;
+    }
+
+    // Rows with fewer fields get empty ones so that all columns line up
+    size_t numFields = field + 1;
+    for (size_t i = numFields;  i < columns.size();  ++i)
+        columns[i].emplace_back();
+
+    fieldCounts.push_back(numFields);
+}
+
+std::string
+ColumnarLogBlockWriter::
+encode()
+{
+    uint32_t rows = times.size();
+    int64_t minMicros = rows ? toMicros(minTime) : 0;
+
+    string rowData;
+    rowData.reserve(rows * (sizeof(int64_t) + sizeof(uint32_t)));
+    for (int64_t time : times)
+        append<int64_t>(rowData, time - minMicros);
+    for (uint32_t count : fieldCounts)
+        append<uint32_t>(rowData, count);
+
+    vector<string> data;
+    data.push_back(compressColumn(rowData, level));
+
+    vector<uint32_t> rawSizes { (uint32_t)rowData.size() };
+
+    for (const auto & column : columns) {
+        string raw;
+        for (const auto & value : column)
+            append<uint32_t>(raw, value.size());
+        for (const auto & value : column)
+            raw += value;
+
+        rawSizes.push_back(raw.size());
+        data.push_back(compressColumn(raw, level));
+    }
+
+    vector<string> keys;
+    if (keyField >= 1 && keyField <= columns.size()) {
+        keys = columns[keyField - 1];
+        sort(keys.begin(), keys.end());
+        keys.erase(unique(keys.begin(), keys.end()), keys.end());
+        if (!keys.empty() && keys.front().empty())
+            keys.erase(keys.begin());
+    }
+
+    string result;
+    append<uint32_t>(result, BlockMagic);
+    append<uint32_t>(result, rows);
+    append<uint32_t>(result, columns.size());
+    append<int32_t>(result, keyField);
+    append<int64_t>(result, minMicros);
+    append<int64_t>(result, rows ? toMicros(maxTime) : 0);
+    appendString(result, channel);
+    append<uint32_t>(result, keys.size());
+    for (const auto & key : keys)
+        appendString(result, key);
+
+    for (size_t i = 0;  i < data.size();  ++i) {
+        append<uint32_t>(result, data[i].size());
+        append<uint32_t>(result, rawSizes[i]);
+    }
+    for (const auto & column : data)
+        result += column;
+
+    times.clear();
+    fieldCounts.clear();
+    columns.clear();
+
+    return result;
+}
+
+
+/*****************************************************************************/
+/* COLUMNAR LOG QUERY                                                        */
+/*****************************************************************************/
+
+ColumnarLogQuery::
+ColumnarLogQuery()
+    : earliest(Date::negativeInfinity()),
+      latest(Date::positiveInfinity())
+{
+}
+
+
+/*****************************************************************************/
+/* COLUMNAR LOG READER                                                       */
+/*****************************************************************************/
+
+ColumnarLogReader::
+ColumnarLogReader(const std::string & filename)
+    : file(filename)
+{
+}
+
+size_t
+ColumnarLogReader::
+scan(const ColumnarLogQuery & query, const OnMessage & onMessage, int threads)
+{
+    stats = Stats();
+
+    int64_t earliest = toQueryMicros(query.earliest);
+    int64_t latest = toQueryMicros(query.latest);
+
+    vector<Block> blocks;
+    Cursor cursor(file.start(), file.end());
+
+    while (cursor.pos != cursor.end) {
+        Block block;
+        if (!block.read(cursor)) {
+            stats.truncated = true;
+            break;
+        }
+
+        ++stats.blocks;
+        if (block.mayMatch(query, earliest, latest))
+            blocks.push_back(std::move(block));
+        else ++stats.blocksSkipped;
+    }
+
+    stats.blocksDecoded = blocks.size();
+
+    if (threads <= 0) threads = std::thread::hardware_concurrency();
+    threads = std::max<int>(1, std::min<size_t>(threads, blocks.size()));
+
+    // Workers only get a bounded window of blocks ahead of the delivery, so
+    // a big scan never has more than that decoded at once.  Block i goes
+    // in slot i % window.
+    size_t window = 2 * threads;
+    vector<vector<string> > results(window);
+    vector<char> decoded(window, false);
+    size_t next = 0, delivered = 0;
+    bool stop = false;
+    std::exception_ptr error;
+    std::mutex lock;
+    std::condition_variable changed;
+
+    auto work = [&] ()
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            for (;;) {
+                changed.wait(guard, [&] ()
+                    {
+                        return stop || next == blocks.size()
+                            || next < delivered + window;
+                    });
+                if (stop || next == blocks.size())
+                    return;
+
+                size_t i = next++;
+                guard.unlock();
+
+                vector<string> messages;
+                std::exception_ptr exc;
+                try {
+                    messages = blocks[i].decode(query, earliest, latest);
+                } catch (...) {
+                    exc = std::current_exception();
+                }
+
+                guard.lock();
+                if (exc) {
+                    if (!error) error = exc;
+                    stop = true;
+                }
+                else {
+                    results[i % window] = std::move(messages);
+                    decoded[i % window] = true;
+                }
+                changed.notify_all();
+            }
+        };
+
+    vector<std::thread> workers;
+    for (int i = 0;  i < threads;  ++i)
+        workers.emplace_back(work);
+
+    auto finish = [&] ()
+        {
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                stop = true;
+            }
+            changed.notify_all();
+            for (auto & worker : workers)
+                worker.join();
+        };
+
+    size_t count = 0;
+    try {
+        for (size_t i = 0;  i < blocks.size();  ++i) {
+            vector<string> messages;
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                changed.wait(guard, [&] ()
+                    {
+                        return error || decoded[i % window];
+                    });
+                if (error) break;
+
+                messages.swap(results[i % window]);
+                decoded[i % window] = false;
+                ++delivered;
+            }
+            changed.notify_all();
+
+            for (const auto & message : messages)
+                onMessage(blocks[i].channel, message);
+            count += messages.size();
+
+            // Done with it; its messages go when they go out of scope
+            blocks[i] = Block();
+        }
+    } catch (...) {
+        finish();
+        throw;
+    }
+
+    finish();
+
+    if (error) std::rethrow_exception(error);
+
+    return count;
+}
+
+} // namespace Datacratic
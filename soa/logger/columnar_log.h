@@ -0,0 +1,137 @@
+/* columnar_log.h                                                  -*- C++ -*-
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Block compressed, column oriented storage for log messages.
+*/
+
+#pragma once
+
+#include "soa/types/date.h"
+#include "jml/utils/file_functions.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+
+namespace Datacratic {
+
+
+/*****************************************************************************/
+/* COLUMNAR LOG BLOCK WRITER                                                 */
+/*****************************************************************************/
+
+/** Accumulates the messages of a single channel and encodes them as a block.
+
+    Messages are the tab separated fields that a LogOutput receives.  Fields
+    are numbered like in MultiOutput: 0 is the channel and 1, which is the
+    timestamp, is the first field of the message.  Each field is stored as its
+    own zlib compressed column so that a reader only decompresses the columns
+    it needs.
+
+    The header of a block holds, uncompressed, the range of timestamps of its
+    messages and the sorted distinct values of the indexed field (if any) so
+    that a reader can skip over blocks that can't match a query.  Integers
+    are written in native byte order.
+*/
+
+struct ColumnarLogBlockWriter {
+
+    /** keyField is the field of the messages that gets indexed or -1 to not
+        index any.  level is the zlib compression level.
+    */
+    ColumnarLogBlockWriter(const std::string & channel,
+                           int keyField = -1,
+                           int level = 6);
+
+    /** Add a message logged at the given time. */
+    void add(Date timestamp, const std::string & message);
+
+    /** Number of messages waiting to be encoded. */
+    size_t rows() const { return times.size(); }
+
+    /** Encode the accumulated messages and start a new block. */
+    std::string encode();
+
+    const std::string channel;
+    const int keyField;
+    const int level;
+
+private:
+    std::vector<int64_t> times;
+    std::vector<uint32_t> fieldCounts;
+    std::vector<std::vector<std::string> > columns;
+    Date minTime, maxTime;
+};
+
+
+/*****************************************************************************/
+/* COLUMNAR LOG QUERY                                                        */
+/*****************************************************************************/
+
+/** Which messages to pull out of a columnar log. */
+
+struct ColumnarLogQuery {
+    ColumnarLogQuery();
+
+    std::string channel;    ///< Only this channel; all if empty
+    Date earliest;          ///< Messages logged at or after this time
+    Date latest;            ///< Messages logged before this time
+
+    /** Only messages whose indexed field has this value; all if empty.  Blocks
+        without an indexed field never match a key.
+    */
+    std::string key;
+};
+
+
+/*****************************************************************************/
+/* COLUMNAR LOG READER                                                       */
+/*****************************************************************************/
+
+/** Reads back a file written with ColumnarLogBlockWriter blocks, as written
+    by ColumnarOutput.
+*/
+
+struct ColumnarLogReader {
+
+    explicit ColumnarLogReader(const std::string & filename);
+
+    typedef std::function<void (const std::string & channel,
+                                const std::string & message)> OnMessage;
+
+    /** Call onMessage, in file order, for each message that matches the
+        query and return how many there were.
+
+        Blocks are ruled out from their headers alone.  The others are
+        decoded on the given number of threads (one per core if 0): the
+        timestamps and indexed field come first and the remaining columns are
+        only decompressed when some of the block's messages match.  Only a
+        couple of blocks per thread are decoded ahead of the ones being
+        delivered, and onMessage is called on the calling thread.  A
+        truncated block at the end of the file, as left by a writer that
+        didn't close properly, ends the scan.
+    */
+    size_t scan(const ColumnarLogQuery & query,
+                const OnMessage & onMessage,
+                int threads = 0);
+
+    /** Counts for the last scan. */
+    struct Stats {
+        Stats()
+            : blocks(0), blocksSkipped(0), blocksDecoded(0), truncated(false)
+        {
+        }
+
+        size_t blocks;          ///< Complete blocks in the file
+        size_t blocksSkipped;   ///< Ruled out from their header
+        size_t blocksDecoded;   ///< Had some of their columns decompressed
+        bool truncated;         ///< File ended in the middle of a block
+    };
+
+    Stats stats;
+
+private:
+    ML::File_Read_Buffer file;
+};
+
+} // namespace Datacratic
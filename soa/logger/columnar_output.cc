@@ -0,0 +1,210 @@
+/* columnar_output.cc
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Output that logs into time partitioned columnar files.
+*/
+
+#include "columnar_output.h"
+#include "jml/arch/exception.h"
+#include "jml/utils/parse_context.h"
+#include <cmath>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define BOOST_SYSTEM_NO_DEPRECATED
+
+#include <boost/filesystem.hpp>
+
+
+using namespace std;
+
+
+namespace Datacratic {
+
+namespace {
+
+/** Time of a message from its first field, if it's a date. */
+bool parseTimestamp(const std::string & message, Date & result)
+{
+    size_t end = message.find('\t');
+    if (end == string::npos) end = message.size();
+
+    ML::Parse_Context context("message", message.c_str(), message.c_str() + end);
+    return Date::match_date_time(context, result, "%y-%M-%d", "%H:%M:%S")
+        && context.eof();
+}
+
+} // file scope
+
+
+/*****************************************************************************/
+/* COLUMNAR OUTPUT                                                           */
+/*****************************************************************************/
+
+ColumnarOutput::
+ColumnarOutput(const std::string & directory,
+               double partitionSeconds,
+               size_t rowsPerBlock,
+               int level)
+    : partitionSeconds(partitionSeconds),
+      rowsPerBlock(rowsPerBlock),
+      level(level),
+      messagesLogged(0), blocksWritten(0), bytesWritten(0)
+{
+    if (!directory.empty())
+        open(directory, partitionSeconds, rowsPerBlock, level);
+}
+
+ColumnarOutput::
+~ColumnarOutput()
+{
+    close();
+}
+
+void
+ColumnarOutput::
+open(const std::string & directory,
+     double partitionSeconds,
+     size_t rowsPerBlock,
+     int level)
+{
+    if (partitionSeconds <= 0.0)
+        throw ML::Exception("ColumnarOutput: partitions must be longer than 0s");
+
+    close();
+
+    std::unique_lock<std::mutex> guard(lock);
+
+    boost::filesystem::create_directories(directory);
+
+    this->directory = directory;
+    this->partitionSeconds = partitionSeconds;
+    this->rowsPerBlock = std::max<size_t>(rowsPerBlock, 1);
+    this->level = level;
+}
+
+void
+ColumnarOutput::
+indexField(const std::string & channel, int field)
+{
+    std::unique_lock<std::mutex> guard(lock);
+    keyFields[channel] = field;
+}
+
+void
+ColumnarOutput::
+logMessage(const std::string & channel, const std::string & message)
+{
+    Date timestamp;
+    if (!parseTimestamp(message, timestamp))
+        timestamp = Date::now();
+
+    double partition = partitionOf(timestamp);
+
+    std::unique_lock<std::mutex> guard(lock);
+
+    if (directory.empty())
+        throw ML::Exception("ColumnarOutput: logging before open()");
+
+    auto & entry = pending[channel];
+    if (!entry) {
+        auto it = keyFields.find(channel);
+        int keyField = it == keyFields.end() ? -1 : it->second;
+        entry.reset(new Pending(channel, keyField, level));
+    }
+    else if (entry->writer.rows() && entry->partition != partition)
+        writeBlock(*entry);
+
+    entry->partition = partition;
+    entry->writer.add(timestamp, message);
+    ++messagesLogged;
+
+    if (entry->writer.rows() >= rowsPerBlock)
+        writeBlock(*entry);
+}
+
+void
+ColumnarOutput::
+close()
+{
+    std::unique_lock<std::mutex> guard(lock);
+
+    for (auto & entry : pending) {
+        if (entry.second->writer.rows())
+            writeBlock(*entry.second);
+    }
+
+    // Blocks started after this pick up the current index fields
+    pending.clear();
+}
+
+Json::Value
+ColumnarOutput::
+stats() const
+{
+    std::unique_lock<std::mutex> guard(lock);
+
+    Json::Value result;
+    result["messages"] = (Json::UInt)messagesLogged;
+    result["blocks"] = (Json::UInt)blocksWritten;
+    result["bytes"] = (Json::UInt)bytesWritten;
+    return result;
+}
+
+void
+ColumnarOutput::
+clearStats()
+{
+    std::unique_lock<std::mutex> guard(lock);
+    messagesLogged = blocksWritten = bytesWritten = 0;
+}
+
+std::string
+ColumnarOutput::
+partitionFile(Date timestamp) const
+{
+    Date start = Date::fromSecondsSinceEpoch(partitionOf(timestamp));
+    return directory + "/" + start.print("%Y-%m-%d-%H%M%S") + ".clog";
+}
+
+double
+ColumnarOutput::
+partitionOf(Date timestamp) const
+{
+    return floor(timestamp.secondsSinceEpoch() / partitionSeconds)
+        * partitionSeconds;
+}
+
+void
+ColumnarOutput::
+writeBlock(Pending & pending)
+{
+    string block = pending.writer.encode();
+    string filename
+        = partitionFile(Date::fromSecondsSinceEpoch(pending.partition));
+
+    // A reader only ever sees part of a block if the disk filled up or the
+    // process died while appending it, and then only at the end of the file.
+    int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_APPEND, 00664);
+    if (fd == -1)
+        throw ML::Exception(errno, "open of " + filename);
+
+    size_t done = 0;
+    while (done < block.size()) {
+        ssize_t res = ::write(fd, block.data() + done, block.size() - done);
+        if (res == -1) {
+            int error = errno;
+            ::close(fd);
+            throw ML::Exception(error, "write to " + filename);
+        }
+        done += res;
+    }
+
+    if (::close(fd) == -1)
+        throw ML::Exception(errno, "close " + filename);
+
+    ++blocksWritten;
+    bytesWritten += block.size();
+}
+
+} // namespace Datacratic
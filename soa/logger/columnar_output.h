@@ -0,0 +1,99 @@
+/* columnar_output.h                                               -*- C++ -*-
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Output that logs into time partitioned columnar files.
+*/
+
+#pragma once
+
+#include "logger.h"
+#include "columnar_log.h"
+#include <map>
+#include <mutex>
+
+
+namespace Datacratic {
+
+
+/*****************************************************************************/
+/* COLUMNAR OUTPUT                                                           */
+/*****************************************************************************/
+
+/** Class that logs messages into files of compressed column blocks (see
+    ColumnarLogBlockWriter) that can be queried by time and by an indexed
+    field with ColumnarLogReader or the columnar_scan tool, without having to
+    decompress and parse everything.
+
+    Messages are grouped in blocks by channel and go to one file per
+    partition of time, named after the start of the partition, in the given
+    directory.  The time of a message is its first field when it parses as a
+    date, as it does for messages published through a ZmqNamedPublisher, and
+    the time it got logged otherwise.
+
+    A block is only written once it's full, when a message for another
+    partition comes in for its channel, or on close().  Messages that haven't
+    been written are lost if the process dies.
+*/
+
+struct ColumnarOutput : public LogOutput {
+
+    ColumnarOutput(const std::string & directory = "",
+                   double partitionSeconds = 3600.0,
+                   size_t rowsPerBlock = 4096,
+                   int level = 6);
+
+    virtual ~ColumnarOutput();
+
+    void open(const std::string & directory,
+              double partitionSeconds = 3600.0,
+              size_t rowsPerBlock = 4096,
+              int level = 6);
+
+    /** Index the given field of the messages of a channel, numbered like in
+        MultiOutput where 0 is the channel and 1 the timestamp.  Typically
+        the account of the MATCHEDWIN messages.  Only applies to blocks that
+        are started afterwards.
+    */
+    void indexField(const std::string & channel, int field);
+
+    virtual void logMessage(const std::string & channel,
+                            const std::string & message);
+
+    virtual void close();
+
+    virtual Json::Value stats() const;
+
+    virtual void clearStats();
+
+    /** Name of the file for the partition that the given time falls in. */
+    std::string partitionFile(Date timestamp) const;
+
+private:
+    struct Pending {
+        Pending(const std::string & channel, int keyField, int level)
+            : writer(channel, keyField, level)
+        {
+        }
+
+        ColumnarLogBlockWriter writer;
+        double partition;
+    };
+
+    double partitionOf(Date timestamp) const;
+    void writeBlock(Pending & pending);
+
+    std::string directory;
+    double partitionSeconds;
+    size_t rowsPerBlock;
+    int level;
+
+    std::map<std::string, int> keyFields;
+    std::map<std::string, std::unique_ptr<Pending> > pending;
+
+    mutable std::mutex lock;
+    size_t messagesLogged;
+    size_t blocksWritten;
+    size_t bytesWritten;
+};
+
+} // namespace Datacratic
@@ -0,0 +1,81 @@
+/* columnar_scan.cc
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Print the messages of columnar log files that match a query.
+*/
+
+#include "soa/logger/columnar_log.h"
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/positional_options.hpp>
+#include <boost/program_options/parsers.hpp>
+#include <boost/program_options/variables_map.hpp>
+#include <iostream>
+
+namespace po = boost::program_options;
+
+using namespace std;
+using namespace Datacratic;
+
+
+int main(int argc, char ** argv)
+{
+    vector<string> files;
+    ColumnarLogQuery query;
+    string from, to;
+    double last = 0.0;
+    int threads = 0;
+    bool countOnly = false;
+
+    po::options_description desc("Main options");
+    desc.add_options()
+        ("file,f", po::value(&files), "columnar log files to scan")
+        ("channel,c", po::value(&query.channel), "only messages of this channel")
+        ("key,k", po::value(&query.key), "only messages whose indexed field has this value")
+        ("from", po::value(&from), "only messages logged at or after this time (2015-Jan-31 23:00:00)")
+        ("to", po::value(&to), "only messages logged before this time")
+        ("last", po::value(&last), "only messages of the last given number of seconds")
+        ("threads,t", po::value(&threads), "threads decoding blocks (default: one per core)")
+        ("count", po::bool_switch(&countOnly), "only print the number of matching messages")
+        ("help,h", "print this message");
+
+    po::positional_options_description positional;
+    positional.add("file", -1);
+
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv)
+              .options(desc)
+              .positional(positional)
+              .run(),
+              vm);
+    po::notify(vm);
+
+    if (vm.count("help") || files.empty()) {
+        cerr << desc << endl;
+        return 1;
+    }
+
+    if (!from.empty()) query.earliest = Date::parseDefaultUtc(from);
+    if (!to.empty()) query.latest = Date::parseDefaultUtc(to);
+    if (last > 0.0) query.earliest = Date::now().plusSeconds(-last);
+
+    size_t count = 0;
+
+    auto onMessage = [&] (const string & channel, const string & message)
+        {
+            if (countOnly) return;
+            cout << channel << '\t' << message << '\n';
+        };
+
+    for (const auto & file : files) {
+        ColumnarLogReader reader(file);
+        count += reader.scan(query, onMessage, threads);
+
+        const auto & stats = reader.stats;
+        cerr << file << ": " << stats.blocks << " blocks, "
+             << stats.blocksSkipped << " skipped, "
+             << stats.blocksDecoded << " decoded"
+             << (stats.truncated ? ", truncated" : "") << endl;
+    }
+
+    if (countOnly) cout << count << endl;
+}
@@ -7,13 +7,15 @@ LIBLOGGER_SOURCES := \
 	file_output.cc publish_output.cc \
 	filter.cc json_filter.cc stats_output.cc callback_output.cc \
 	rotating_output.cc cloud_output.cc compressor.cc compressing_output.cc \
-	multi_output.cc 
+	multi_output.cc columnar_log.cc columnar_output.cc
 
 LIBLOGGER_LINK := \
 	ACE arch utils boost_thread boost_regex zeromq endpoint lzma boost_filesystem opstats cloud gc
 
 $(eval $(call library,logger,$(LIBLOGGER_SOURCES),$(LIBLOGGER_LINK)))
 
+$(eval $(call program,columnar_scan,logger boost_program_options))
+
 $(eval $(call nodejs_addon,logger,logger_js.cc filter_js.cc,logger js sigslot))
 
 LIBLOG_METRICS_SOURCES := \
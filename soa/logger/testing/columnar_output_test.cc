@@ -0,0 +1,187 @@
+/* columnar_output_test.cc
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Tests for the columnar log output and reader.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include "soa/logger/columnar_output.h"
+#include "jml/arch/format.h"
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <iterator>
+
+using namespace std;
+using namespace ML;
+using namespace Datacratic;
+
+
+namespace {
+
+const string dir = "tmp/columnar_output_test";
+
+struct Message {
+    Date timestamp;
+    string channel;
+    string account;
+    string text;
+};
+
+/** Two channels over two hours, with the account as the third field of the
+    MATCHEDWIN messages. */
+vector<Message> makeMessages()
+{
+    Date start = Date::fromSecondsSinceEpoch(1420106400);  // 2015-Jan-01 10:00
+    vector<Message> result;
+
+    for (unsigned i = 0;  i < 7200;  ++i) {
+        Message message;
+        message.timestamp = start.plusSeconds(i);
+        message.channel = i % 3 ? "MATCHEDWIN" : "AUCTION";
+        message.account = ML::format("campaign%d:strategy", i % 10);
+        message.text = message.timestamp.print(5)
+            + ML::format("\tauction%d\t", i) + message.account
+            + ML::format("\t%d", i * 7);
+
+        // Empty fields have to come back as they went in
+        if (i % 7 == 0) message.text += "\t";
+        if (i % 11 == 0) message.text += "\t\textra";
+
+        result.push_back(message);
+    }
+
+    return result;
+}
+
+vector<string> scan(const string & file, const ColumnarLogQuery & query,
+                    int threads = 0,
+                    ColumnarLogReader::Stats * stats = nullptr)
+{
+    vector<string> result;
+    ColumnarLogReader reader(file);
+    size_t count = reader.scan(query, [&] (const string & channel,
+                                           const string & message)
+            {
+                result.push_back(channel + "\t" + message);
+            },
+            threads);
+
+    BOOST_CHECK_EQUAL(count, result.size());
+    if (stats) *stats = reader.stats;
+    return result;
+}
+
+} // file scope
+
+BOOST_AUTO_TEST_CASE( test_columnar_output )
+{
+    boost::filesystem::remove_all(dir);
+
+    auto messages = makeMessages();
+
+    ColumnarOutput output(dir, 3600.0, 256);
+    output.indexField("MATCHEDWIN", 3);
+    for (const auto & message : messages)
+        output.logMessage(message.channel, message.text);
+    output.close();
+
+    BOOST_CHECK_EQUAL(output.stats()["messages"].asInt(), messages.size());
+
+    string first = output.partitionFile(messages.front().timestamp);
+    string second = output.partitionFile(messages.back().timestamp);
+    BOOST_CHECK_NE(first, second);
+    BOOST_CHECK(boost::filesystem::exists(first));
+    BOOST_CHECK(boost::filesystem::exists(second));
+
+    // Everything comes back, with the blocks of each channel in order
+    {
+        ColumnarLogQuery query;
+        query.channel = "MATCHEDWIN";
+
+        vector<string> expected;
+        for (const auto & message : messages) {
+            if (message.channel != query.channel) continue;
+            if (output.partitionFile(message.timestamp) != first) continue;
+            expected.push_back(message.channel + "\t" + message.text);
+        }
+
+        BOOST_CHECK(scan(first, query) == expected);
+
+        // With more blocks than fit in the decoding window
+        BOOST_CHECK(scan(first, query, 2) == expected);
+    }
+
+    // Wins for one account over ten minutes
+    {
+        ColumnarLogQuery query;
+        query.channel = "MATCHEDWIN";
+        query.key = "campaign4:strategy";
+        query.earliest = messages.front().timestamp.plusSeconds(1800);
+        query.latest = query.earliest.plusSeconds(600);
+
+        vector<string> expected;
+        for (const auto & message : messages) {
+            if (message.channel != query.channel) continue;
+            if (message.account != query.key) continue;
+            if (message.timestamp < query.earliest) continue;
+            if (message.timestamp >= query.latest) continue;
+            expected.push_back(message.channel + "\t" + message.text);
+        }
+        BOOST_CHECK_EQUAL(expected.size(), 40);
+
+        ColumnarLogReader::Stats stats;
+        auto found = scan(first, query, 4, &stats);
+        BOOST_CHECK(found == expected);
+        BOOST_CHECK(scan(first, query, 1) == expected);
+
+        // Only the blocks covering the ten minutes need to be looked at
+        BOOST_CHECK_LT(stats.blocksDecoded, 5);
+        BOOST_CHECK_EQUAL(stats.blocksDecoded + stats.blocksSkipped,
+                          stats.blocks);
+        BOOST_CHECK(!stats.truncated);
+
+        // Nothing is indexed for the auctions
+        query.channel = "AUCTION";
+        BOOST_CHECK(scan(first, query).empty());
+    }
+
+    boost::filesystem::remove_all(dir);
+}
+
+BOOST_AUTO_TEST_CASE( test_columnar_truncated )
+{
+    boost::filesystem::remove_all(dir);
+
+    auto messages = makeMessages();
+
+    string file;
+    {
+        ColumnarOutput output(dir, 3600.0, 100);
+        for (const auto & message : messages)
+            output.logMessage(message.channel, message.text);
+        file = output.partitionFile(messages.front().timestamp);
+    }
+
+    ColumnarLogReader::Stats stats;
+    size_t all = scan(file, ColumnarLogQuery(), 0, &stats).size();
+    size_t blocks = stats.blocks;
+
+    // Cut the last block short like a writer that died while appending it
+    {
+        ifstream in(file.c_str());
+        string data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+        ofstream out(file.c_str(), ios::trunc);
+        out.write(data.data(), data.size() - 10);
+    }
+
+    size_t remaining = scan(file, ColumnarLogQuery(), 0, &stats).size();
+    BOOST_CHECK(stats.truncated);
+    BOOST_CHECK_EQUAL(stats.blocks, blocks - 1);
+    BOOST_CHECK_LT(remaining, all);
+    BOOST_CHECK_GT(remaining, 0);
+
+    boost::filesystem::remove_all(dir);
+}
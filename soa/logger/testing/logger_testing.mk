@@ -8,6 +8,7 @@ $(eval $(call vowscoffee_test,logger_fs_test,logger))
 $(eval $(call test,logger_deadlock_test,logger,boost manual))
 
 $(eval $(call test,multi_output_logger_test,logger,boost))
+$(eval $(call test,columnar_output_test,logger boost_filesystem,boost))
 $(eval $(call test,rotating_file_logger_test,logger,manual boost))
 
 $(eval $(call vowscoffee_test,logger_metrics_interface_js_test,iloggermetricscpp))
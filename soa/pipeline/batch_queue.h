@@ -0,0 +1,137 @@
+/* batch_queue.h
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+*/
+
+namespace Datacratic
+{
+    // hands items over to worker threads in batches through a bounded queue
+    // so that the producer blocks when the workers can't keep up
+    template<typename T>
+    struct BatchQueue {
+        BatchQueue(size_t batchSize = 1024, size_t capacity = 16) :
+            batchSize(std::max<size_t>(batchSize, 1)),
+            capacity(std::max<size_t>(capacity, 1)),
+            closed(false) {
+        }
+
+        ~BatchQueue() {
+            close();
+            for(auto & item : workers) {
+                item.join();
+            }
+        }
+
+        // starts the threads that call the handler on each item; when there
+        // is more than one thread, the handler must be thread safe
+        void start(int threads, std::function<void(T const &)> handler) {
+            this->handler = std::move(handler);
+            for(int i = 0; i < std::max(threads, 1); ++i) {
+                workers.emplace_back([=]() { work(); });
+            }
+        }
+
+        // waits for room in the queue when the current batch is full and
+        // throws if a worker failed
+        void push(T const & item) {
+            if(batch.empty()) {
+                batch.reserve(batchSize);
+            }
+
+            batch.push_back(item);
+            if(batch.size() >= batchSize) {
+                flush();
+            }
+        }
+
+        // waits until all items were handled and rethrows the first
+        // exception raised by the handler
+        void finish() {
+            flush();
+            close();
+            for(auto & item : workers) {
+                item.join();
+            }
+
+            workers.clear();
+            if(error) {
+                std::rethrow_exception(error);
+            }
+        }
+
+    private:
+        void flush() {
+            std::unique_lock<std::mutex> guard(lock);
+            while(batches.size() >= capacity && !error) {
+                notFull.wait(guard);
+            }
+
+            if(error) {
+                batch.clear();
+                std::rethrow_exception(error);
+            }
+
+            if(!batch.empty()) {
+                batches.push_back(std::move(batch));
+                batch.clear();
+                notEmpty.notify_one();
+            }
+        }
+
+        void close() {
+            std::lock_guard<std::mutex> guard(lock);
+            closed = true;
+            notEmpty.notify_all();
+        }
+
+        void work() {
+            std::vector<T> items;
+            for(;;) {
+                {
+                    std::unique_lock<std::mutex> guard(lock);
+                    while(batches.empty() && !closed) {
+                        notEmpty.wait(guard);
+                    }
+
+                    if(batches.empty()) {
+                        return;
+                    }
+
+                    items = std::move(batches.front());
+                    batches.pop_front();
+                    notFull.notify_one();
+                }
+
+                try {
+                    for(auto & item : items) {
+                        handler(item);
+                    }
+                }
+                catch(...) {
+                    std::lock_guard<std::mutex> guard(lock);
+                    if(!error) {
+                        error = std::current_exception();
+                    }
+
+                    // nothing else gets handled once an item failed
+                    batches.clear();
+                    closed = true;
+                    notFull.notify_all();
+                    return;
+                }
+            }
+        }
+
+        size_t batchSize;
+        size_t capacity;
+        std::vector<T> batch;
+        std::deque<std::vector<T>> batches;
+        bool closed;
+        std::exception_ptr error;
+        std::mutex lock;
+        std::condition_variable notEmpty;
+        std::condition_variable notFull;
+        std::vector<std::thread> workers;
+        std::function<void(T const &)> handler;
+    };
+}
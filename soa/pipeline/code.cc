@@ -7,6 +7,7 @@
 #include "headers.h"
 
 #include <algorithm>
+#include <cstring>
 
 #include "soa/types/basic_value_descriptions.h"
 
@@ -19,5 +20,6 @@ using namespace Datacratic;
 #include "file_writer_block.cc"
 #include "importer_block.cc"
 #include "pin.cc"
+#include "parallel_pipeline.cc"
 #include "pipeline.cc"
 
@@ -10,7 +10,8 @@ TextLineDescription() {
 
 FileReaderBlock::FileReaderBlock() :
     lines(this, "lines"),
-    folder("%{input-path}") {
+    folder("%{input-path}"),
+    chunkSize(1 << 20) {
 }
 
 void FileReaderBlock::run() {
@@ -24,10 +25,48 @@ void FileReaderBlock::run() {
     }
 
     TextLine line;
-    while(std::getline(stream, line.text)) {
+    auto emit = [&](char const * text, size_t size) {
+        line.text.assign(text, size);
         lines.push(line);
         line.number += 1;
-        line.offset += line.text.size();
+        line.offset += size;
+    };
+
+    // read large chunks and split them in lines in bulk instead of using
+    // std::getline on each line; a partial line at the end of a chunk is
+    // kept for the next one
+    std::vector<char> buffer(std::max<size_t>(chunkSize, 1));
+    size_t used = 0;
+    for(;;) {
+        if(used == buffer.size()) {
+            buffer.resize(buffer.size() * 2);
+        }
+
+        stream.read(buffer.data() + used, buffer.size() - used);
+        size_t size = stream.gcount();
+        if(size == 0) {
+            break;
+        }
+
+        char const * begin = buffer.data();
+        char const * end = begin + used + size;
+        char const * next = begin + used;
+        for(;;) {
+            auto eol = (char const *) memchr(next, '\n', end - next);
+            if(!eol) {
+                break;
+            }
+
+            emit(begin, eol - begin);
+            begin = next = eol + 1;
+        }
+
+        used = end - begin;
+        memmove(buffer.data(), begin, used);
+    }
+
+    if(used) {
+        emit(buffer.data(), used);
     }
 
     LOG(print) << "done reading file '" << folder << "/" << filename << "'" << std::endl;
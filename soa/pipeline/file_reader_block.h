@@ -27,6 +27,9 @@ namespace Datacratic
         PushingPin<TextLine> lines;
         std::string folder;
         std::string filename;
+
+        // size of the chunks read from the file before splitting them in lines
+        size_t chunkSize;
     };
 }
 
@@ -9,6 +9,13 @@
 #include <string>
 #include <vector>
 #include <set>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <exception>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 namespace Datacratic
 {
@@ -22,10 +29,13 @@ namespace Datacratic
 #include "soa/types/basic_value_descriptions.h"
 #include "soa/service/logs.h"
 #include "soa/pipeline/pin.h"
+#include "soa/pipeline/batch_queue.h"
 #include "soa/pipeline/block.h"
 #include "soa/pipeline/pipeline.h"
 #include "soa/pipeline/default_pipeline.h"
+#include "soa/pipeline/parallel_pipeline.h"
 #include "soa/pipeline/file_reader_block.h"
 #include "soa/pipeline/file_writer_block.h"
 #include "soa/pipeline/importer_block.h"
+#include "soa/pipeline/queue_block.h"
 
@@ -6,6 +6,8 @@
 
 ImporterBlock::ImporterBlock() :
     lines(this, "lines"),
+    threads(1),
+    batchSize(1024),
     progress(trace, [&]() {
         LOG(progress) << "imported "
                       << done
@@ -22,13 +24,32 @@ ImporterBlock::ImporterBlock() :
 void ImporterBlock::run() {
     done = 0;
 
+    queue.reset();
+    if(threads > 1) {
+        queue.reset(new BatchQueue<TextLine>(batchSize, threads * 4));
+        queue->start(threads, [&](TextLine const & line) {
+            onRead(line);
+        });
+    }
+
     lines->pushHandler = [&](TextLine const & line) {
-        onRead(line);
+        if(queue) {
+            queue->push(line);
+        }
+        else {
+            onRead(line);
+        }
+
         ++done;
         progress.output();
     };
 
     lines->doneHandler = [&]() {
+        if(queue) {
+            queue->finish();
+            queue.reset();
+        }
+
         onDone();
         progress.stop();
     };
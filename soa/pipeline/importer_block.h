@@ -18,9 +18,17 @@ namespace Datacratic
 
         PullingPin<TextLine> lines;
 
+        // calls onRead on that many threads when more than one, in which
+        // case it must be thread safe
+        int threads;
+
+        // number of lines handed to a thread at once
+        size_t batchSize;
+
     private:
         Logging::Progress progress;
         int done;
+        std::unique_ptr<BatchQueue<TextLine>> queue;
     };
 }
 
@@ -0,0 +1,127 @@
+/* parallel_pipeline.cc
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+*/
+
+ParallelPipeline::ParallelPipeline(int threads) :
+    threads(threads),
+    running(0) {
+}
+
+void ParallelPipeline::run() {
+    states.clear();
+    ready.clear();
+    running = 0;
+    error = nullptr;
+
+    for(auto item : getBlocks()) {
+        State state;
+        state.pipeline = this;
+        state.block = item.get();
+        state.count = 0;
+        for(auto pin : item->getIncomingPins()) {
+            if(pin->isConnected()) {
+                state.count++;
+            }
+        }
+
+        if(state.count == 0) {
+            LOG(debug) << "block ready to run name='" << state.block->getPath() << "'" << std::endl;
+            ready.push_back(state.block);
+        }
+        else {
+            states[state.block] = state;
+        }
+    }
+
+    for(auto & item : connectors) {
+        auto block = item->getIncomingPin()->getBlock();
+        auto state = &states[block];
+        item->state = state;
+    }
+
+    int n = threads > 0 ? threads : std::thread::hardware_concurrency();
+    n = std::max<int>(1, std::min<int>(n, getBlocks().size()));
+
+    std::vector<std::thread> workers;
+    for(int i = 0; i != n; ++i) {
+        workers.emplace_back([=]() { work(); });
+    }
+
+    for(auto & item : workers) {
+        item.join();
+    }
+
+    if(error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void ParallelPipeline::work() {
+    for(;;) {
+        Block * item = nullptr;
+
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            while(ready.empty() && running && !error) {
+                changed.wait(guard);
+            }
+
+            // nothing is left to run once nothing is ready or running
+            if(ready.empty() || error) {
+                changed.notify_all();
+                return;
+            }
+
+            item = ready.front();
+            ready.pop_front();
+            ++running;
+        }
+
+        LOG(debug) << "running block='" << item->getPath() << "'" << std::endl;
+
+        std::exception_ptr failure;
+        try {
+            item->run();
+        }
+        catch(...) {
+            failure = std::current_exception();
+        }
+
+        std::lock_guard<std::mutex> guard(lock);
+        if(failure && !error) {
+            error = failure;
+        }
+
+        --running;
+        changed.notify_all();
+    }
+}
+
+Connector * ParallelPipeline::createConnector(IncomingPin * incoming, OutgoingPin * outgoing) {
+    auto item = std::make_shared<ParallelConnector>(incoming, outgoing);
+    connectors.insert(item);
+    return item.get();
+}
+
+ParallelPipeline::
+ParallelConnector::ParallelConnector(IncomingPin * incoming, OutgoingPin * outgoing) :
+    Connector(incoming, outgoing),
+    state(nullptr) {
+}
+
+void ParallelPipeline::ParallelConnector::push() {
+    auto incoming = getIncomingPin();
+    auto outgoing = getOutgoingPin();
+    auto pipeline = state->pipeline;
+    LOG(pipeline->debug) << "push from '" << outgoing->getPath() << "'" << std::endl;
+
+    std::lock_guard<std::mutex> guard(pipeline->lock);
+    incoming->readFrom(outgoing);
+    --state->count;
+    if(state->count == 0) {
+        LOG(pipeline->debug) << "block ready to run name='" << state->block->getPath() << "'" << std::endl;
+        pipeline->ready.push_back(state->block);
+        pipeline->changed.notify_all();
+    }
+}
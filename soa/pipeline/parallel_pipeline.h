@@ -0,0 +1,49 @@
+/* parallel_pipeline.h
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+*/
+
+namespace Datacratic
+{
+    // runs the blocks that are ready on a pool of threads so that
+    // independent blocks run at the same time
+    struct ParallelPipeline :
+        public Pipeline
+    {
+        ParallelPipeline(int threads = 0);
+
+        void run();
+
+        Connector * createConnector(IncomingPin * incoming, OutgoingPin * outgoing);
+
+    private:
+        struct State {
+            ParallelPipeline * pipeline;
+            int count;
+            Block * block;
+        };
+
+        struct ParallelConnector :
+            public Connector
+        {
+            ParallelConnector(IncomingPin * incoming, OutgoingPin * outgoing);
+
+            void push();
+
+            State * state;
+        };
+
+        void work();
+
+        int threads;
+        std::set<std::shared_ptr<ParallelConnector>> connectors;
+        std::deque<Block *> ready;
+        std::map<Block *, State> states;
+        int running;
+        std::exception_ptr error;
+        std::mutex lock;
+        std::condition_variable changed;
+
+        friend struct ParallelConnector;
+    };
+}
@@ -0,0 +1,48 @@
+/* queue_block.h
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+*/
+
+namespace Datacratic
+{
+    // decouples a stream from its consumers: items are passed in batches
+    // through a bounded queue to a thread that pushes them downstream so that
+    // the producer and the consumers run at the same time
+    template<typename T>
+    struct QueueBlock :
+        public Block
+    {
+        QueueBlock() :
+            input(this, "input"),
+            output(this, "output"),
+            batchSize(1024),
+            capacity(16) {
+        }
+
+        void run() {
+            queue.reset(new BatchQueue<T>(batchSize, capacity));
+            queue->start(1, [&](T const & item) {
+                output.push(item);
+            });
+
+            input->pushHandler = [&](T const & item) {
+                queue->push(item);
+            };
+
+            input->doneHandler = [&]() {
+                queue->finish();
+                output.done();
+            };
+
+            input.push();
+        }
+
+        PullingPin<T> input;
+        PushingPin<T> output;
+        size_t batchSize;
+        size_t capacity;
+
+    private:
+        std::unique_ptr<BatchQueue<T>> queue;
+    };
+}
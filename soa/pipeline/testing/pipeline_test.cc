@@ -12,6 +12,7 @@
 #include <boost/algorithm/string.hpp>
 
 #include "soa/pipeline/headers.h"
+#include "jml/arch/exception.h"
 
 using namespace Datacratic;
 
@@ -164,3 +165,112 @@ BOOST_AUTO_TEST_CASE( test_blocks )
     }
 }
 
+
+struct MyBlockThatCountsLines :
+    public ImporterBlock
+{
+    MyBlockThatCountsLines() :
+        count(0), total(0), finished(false) {
+    }
+
+    void onRead(TextLine const & line) {
+        std::lock_guard<std::mutex> guard(lock);
+        count += 1;
+        total += std::stoul(line.text);
+    }
+
+    void onDone() {
+        finished = true;
+    }
+
+    std::mutex lock;
+    size_t count;
+    size_t total;
+    bool finished;
+};
+
+BOOST_AUTO_TEST_CASE( test_parallel_pipeline )
+{
+    ParallelPipeline pipeline(4);
+
+    std::string path("./build/x86_64/tmp");
+    boost::filesystem::create_directories(path);
+
+    auto environment = std::make_shared<Environment>();
+    environment->set("input-path", path);
+    pipeline.environment.set(environment);
+
+    size_t n = 100000;
+    size_t total = 0;
+    {
+        std::ofstream file(path + "/numbers.txt");
+        for(size_t i = 0; i != n; ++i) {
+            file << i * 7 << std::endl;
+            total += i * 7;
+        }
+    }
+
+    // lines are longer than some of the chunks to check the carry over
+    auto r = pipeline.create<FileReaderBlock>("r");
+    r->filename = "numbers.txt";
+    r->chunkSize = 5;
+
+    auto q = pipeline.create<QueueBlock<TextLine>>("q");
+    q->batchSize = 100;
+    q->capacity = 4;
+    q->input.connectWith(r->lines);
+
+    auto a = pipeline.create<MyBlockThatCountsLines>("a");
+    a->threads = 4;
+    a->batchSize = 64;
+    a->lines.connectWith(q->output);
+
+    // independent of the others
+    auto b = pipeline.create<MyBlock>("b");
+    b->text = "ipsum";
+
+    pipeline.run();
+
+    BOOST_CHECK(a->finished);
+    BOOST_CHECK_EQUAL(a->count, n);
+    BOOST_CHECK_EQUAL(a->total, total);
+    BOOST_CHECK(*(b->writingPin) == "empty ipsum");
+}
+
+struct MyBlockThatFails :
+    public ImporterBlock
+{
+    void onRead(TextLine const & line) {
+        if(line.number == 1000) {
+            throw ML::Exception("failed");
+        }
+    }
+};
+
+BOOST_AUTO_TEST_CASE( test_parallel_pipeline_errors )
+{
+    ParallelPipeline pipeline;
+
+    std::string path("./build/x86_64/tmp");
+    boost::filesystem::create_directories(path);
+
+    auto environment = std::make_shared<Environment>();
+    environment->set("input-path", path);
+    pipeline.environment.set(environment);
+
+    {
+        std::ofstream file(path + "/lines.txt");
+        for(size_t i = 0; i != 100000; ++i) {
+            file << "line" << std::endl;
+        }
+    }
+
+    auto r = pipeline.create<FileReaderBlock>("r");
+    r->filename = "lines.txt";
+
+    auto a = pipeline.create<MyBlockThatFails>("a");
+    a->threads = 2;
+    a->lines.connectWith(r->lines);
+
+    BOOST_CHECK_THROW(pipeline.run(), ML::Exception);
+}
@@ -268,6 +268,14 @@ struct PassiveConnectionHandler: public ConnectionHandler {
     void send(const std::string & str,
               NextAction action = NEXT_CONTINUE,
               OnWriteFinished onWriteFinished = OnWriteFinished());
+
+    /** Send some data, taking ownership of the buffer rather than copying
+        it.  Used to put a fully formed response on the wire without another
+        copy of it being made.
+    */
+    void send(std::string && str,
+              NextAction action = NEXT_CONTINUE,
+              OnWriteFinished onWriteFinished = OnWriteFinished());
     
     /** Function called out to when we got some data */
     virtual void handleData(const std::string & data) = 0;
@@ -55,6 +55,17 @@ publishAddress(const std::string & address,
         }
     }
 }
+
+void
+NamedEndpoint::
+republishAddress(const std::string & address,
+                 const Json::Value & addressConfig)
+{
+    ExcAssert(config);
+
+    // Overwriting keeps the node that publishAddress() created
+    config->set(endpointName + "/" + address, addressConfig);
+}
     
 vector<string>
 NamedEndpoint::
@@ -38,6 +38,12 @@ struct NamedEndpoint {
     /** Publish an address for the endpoint. */
     void publishAddress(const std::string & address,
                         const Json::Value & addressConfig);
+
+    /** Replace the configuration of an address that was already published.
+        The uris of its transports must be the same as the first time.
+    */
+    void republishAddress(const std::string & address,
+                          const Json::Value & addressConfig);
     
     /** Publish that the address is active.  Atomically causes the endpoint
         to be reconfigured.
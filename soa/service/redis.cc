@@ -9,6 +9,7 @@
 #include "jml/utils/guard.h"
 #include <boost/thread.hpp>
 #include <poll.h>
+#include <cmath>
 #include <unistd.h>
 #include <fcntl.h>
 #include "jml/arch/atomic_ops.h"
@@ -180,7 +181,116 @@ Reply
 Reply::
 deepCopy() const
 {
-    return Reply(doDeepCopy(r_.get()), true);
+    if (needDelete_)
+        return *this;
+    return Reply(doFlatCopy(r_.get()), doFree);
+}
+
+namespace {
+
+/** Sizes of the parts of a flat copy of a reply. */
+struct FlatSize {
+    FlatSize()
+        : replies(0), elements(0), chars(0)
+    {
+    }
+
+    void add(const redisReply * r)
+    {
+        ++replies;
+        switch (r->type) {
+        case REDIS_REPLY_STATUS:
+        case REDIS_REPLY_ERROR:
+        case REDIS_REPLY_STRING:
+            chars += r->len + 1;
+            break;
+        case REDIS_REPLY_ARRAY:
+            elements += r->elements;
+            for (unsigned i = 0;  i < r->elements;  ++i)
+                add(r->element[i]);
+            break;
+        }
+    }
+
+    size_t replies;
+    size_t elements;
+    size_t chars;
+};
+
+/** Lays out the copy with the replies first, then the element arrays and
+    then the strings so that everything stays aligned. */
+struct FlatWriter {
+    FlatWriter(redisReply * replies, redisReply ** elements, char * chars)
+        : replies(replies), elements(elements), chars(chars)
+    {
+    }
+
+    redisReply * copy(const redisReply * r)
+    {
+        redisReply * result = replies++;
+        memset(result, 0, sizeof(redisReply));
+        result->type = r->type;
+
+        switch (r->type) {
+
+        case REDIS_REPLY_INTEGER:
+        case REDIS_REPLY_NIL:
+            result->integer = r->integer;
+            break;
+        case REDIS_REPLY_STATUS:
+        case REDIS_REPLY_ERROR:
+        case REDIS_REPLY_STRING:
+            result->str = chars;
+            result->len = r->len;
+            std::copy(r->str, r->str + r->len, chars);
+            chars[r->len] = 0;
+            chars += r->len + 1;
+            break;
+        case REDIS_REPLY_ARRAY:
+            result->element = elements;
+            result->elements = r->elements;
+            elements += r->elements;
+            for (unsigned i = 0;  i < r->elements;  ++i)
+                result->element[i] = copy(r->element[i]);
+            break;
+        default:
+            throw ML::Exception("unknown Redis reply type %d", r->type);
+        };
+
+        return result;
+    }
+
+    redisReply * replies;
+    redisReply ** elements;
+    char * chars;
+};
+
+} // file scope
+
+redisReply *
+Reply::
+doFlatCopy(const redisReply * r)
+{
+    FlatSize size;
+    size.add(r);
+
+    size_t repliesBytes = size.replies * sizeof(redisReply);
+    size_t elementsBytes = size.elements * sizeof(redisReply *);
+
+    char * mem = (char *)malloc(repliesBytes + elementsBytes + size.chars);
+    if (!mem)
+        throw ML::Exception("out of memory copying Redis reply");
+
+    FlatWriter writer((redisReply *)mem,
+                      (redisReply **)(mem + repliesBytes),
+                      mem + repliesBytes + elementsBytes);
+
+    try {
+        return writer.copy(r);
+    } catch (...) {
+        free(mem);
+        throw;
+    }
 }
 
 redisReply *
@@ -423,8 +533,18 @@ struct AsyncConnection::EventLoop {
     pollfd fds[2];
     volatile int disconnected;
 
+    /* Coalescing of the writes.  Protected by the connection's lock. */
+    double window;
+    size_t maxCommands;
+    bool writeRequested;       ///< hiredis has something to write
+    Date writeDeadline;        ///< When it has to be written by
+    size_t commandsWaiting;    ///< Commands queued since the last write
+
     EventLoop(AsyncConnection * connection)
-        : finished(false), connection(connection), disconnected(1)
+        : finished(false), connection(connection), disconnected(1),
+          window(connection->coalesceWindow),
+          maxCommands(connection->coalesceMaxCommands),
+          writeRequested(false), commandsWaiting(0)
     {
         ML::atomic_inc(eventLoopsCreated);
         
@@ -518,6 +638,19 @@ struct AsyncConnection::EventLoop {
             if (connection->earliestTimeout == Date::positiveInfinity())
                 timeout = 1000000;
 
+            // Commands being coalesced are written once their window is
+            // over.  Round up so that we don't spin until then.
+            {
+                boost::unique_lock<Lock> guard(connection->lock);
+                if (writeRequested && !(fds[1].events & POLLOUT)) {
+                    double writeLeft = now.secondsUntil(writeDeadline);
+                    if (writeLeft <= 0)
+                        fds[1].events |= POLLOUT;
+                    else timeout = std::min<int>(timeout,
+                                                 ceil(1000 * writeLeft));
+                }
+            }
+
             //cerr << "looping; fd0 = " << fds[1].fd << " timeout = "
             //     << timeout << endl;
 
@@ -662,7 +795,26 @@ struct AsyncConnection::EventLoop {
     void startWriting()
     {
         //cerr << "start writing" << endl;
-        //if (fds[1].events & POLLOUT) return;  // already reading
+
+        // hiredis asks for this for every command that it buffers, but the
+        // loop only needs to be woken up for the first one since the last
+        // write.
+        if (writeRequested) return;
+        writeRequested = true;
+
+        if (window > 0.0 && maxCommands > 1)
+            writeDeadline = Date::now().plusSeconds(window);
+        else fds[1].events |= POLLOUT;
+
+        wakeup();
+    }
+
+    /** Called with the connection's lock held when a command is queued. */
+    void commandQueued()
+    {
+        if (++commandsWaiting < maxCommands) return;
+        if (fds[1].events & POLLOUT) return;
+
         fds[1].events |= POLLOUT;
         wakeup();
     }
@@ -677,6 +829,8 @@ struct AsyncConnection::EventLoop {
     {
         //cerr << "stop writing" << endl;
         fds[1].events &= ~POLLOUT;
+        writeRequested = false;
+        commandsWaiting = 0;
     }
 
     static void cleanup(void * privData)
@@ -695,13 +849,15 @@ struct AsyncConnection::EventLoop {
 
 AsyncConnection::
 AsyncConnection()
-    : context_(0), idNum(0)
+    : context_(0), idNum(0),
+      coalesceWindow(0.0), coalesceMaxCommands(1)
 {
 }
 
 AsyncConnection::
 AsyncConnection(const Address & address)
-    : context_(0), idNum(0)
+    : context_(0), idNum(0),
+      coalesceWindow(0.0), coalesceMaxCommands(1)
 {
     connect(address);
 }
@@ -970,6 +1126,8 @@ queue(const Command & command,
         resultCallback(context_, 0, data.get());
         return -1;
     }
+
+    eventLoop->commandQueued();
     
     if (needWakeup)
         eventLoop->wakeup();
@@ -1081,6 +1239,22 @@ cancel(int handle)
     throw ML::Exception("AsyncConnection::cancel(): not done");
 }
 
+void
+AsyncConnection::
+coalesce(double window, size_t maxCommands)
+{
+    boost::unique_lock<Lock> guard(lock);
+
+    coalesceWindow = window;
+    coalesceMaxCommands = std::max<size_t>(maxCommands, 1);
+
+    if (eventLoop) {
+        eventLoop->window = coalesceWindow;
+        eventLoop->maxCommands = coalesceMaxCommands;
+        eventLoop->wakeup();
+    }
+}
+
 void
 AsyncConnection::
 expireTimeouts(Date now)
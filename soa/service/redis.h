@@ -10,6 +10,7 @@
 
 #include <hiredis/hiredis.h>
 #include <hiredis/async.h>
+#include <cstdlib>
 #include <string>
 #include "jml/arch/exception.h"
 #include "jml/utils/exc_assert.h"
@@ -56,22 +57,37 @@ struct Reply {
     {
     }
 
+    /** For replies made by doFlatCopy(). */
+    static void doFree(redisReply * reply)
+    {
+        free(reply);
+    }
+
     Reply()
+        : needDelete_(false)
     {
     }
 
     Reply(redisReply * reply, bool needDelete)
-        : r_(reply, needDelete ? doDelete : noDelete)
+        : r_(reply, needDelete ? doDelete : noDelete),
+          needDelete_(needDelete)
     {
     }
 
     bool initialized() const { return !!r_; }
 
-    /** Makes a deep copy that we have ownership of. */
+    /** Makes a deep copy that we have ownership of.  Replies are never
+        modified, so one that we already own is shared instead of copied.
+    */
     Reply deepCopy() const;
 
     static redisReply * doDeepCopy(redisReply * r);
 
+    /** Copy a reply and everything it points to into a single block of
+        memory, to be freed with doFree() instead of freeReplyObject().
+    */
+    static redisReply * doFlatCopy(const redisReply * r);
+
     operator std::string () const
     {
         return asString();
@@ -114,6 +130,11 @@ struct Reply {
     }
 
 private:
+    Reply(redisReply * reply, void (*deleter) (redisReply *))
+        : r_(reply, deleter), needDelete_(true)
+    {
+    }
+
     std::shared_ptr<redisReply> r_;
     bool needDelete_;
 };
@@ -427,6 +448,17 @@ struct AsyncConnection {
     
     /** Cancel the given command. */
     void cancel(int handle);
+
+    /** Hold on to the commands that get queued for up to window seconds
+        after the first one, or until maxCommands of them are waiting, so
+        that they go out to Redis as one pipelined write.  This trades a bit
+        of latency for fewer system calls on both ends when lots of small
+        commands are issued.
+
+        Without it, the commands that are queued while the connection's
+        thread is busy already go out together.
+    */
+    void coalesce(double window, size_t maxCommands = 256);
     
     size_t numRequestsPending() const
     {
@@ -476,6 +508,9 @@ private:
     redisAsyncContext * context_;
     int64_t idNum;
 
+    double coalesceWindow;
+    size_t coalesceMaxCommands;
+
     struct EventLoop;
     std::shared_ptr<EventLoop> eventLoop;
 
@@ -49,6 +49,7 @@ LIBSERVICES_SOURCES := \
 	named_endpoint.cc \
 	zookeeper_configuration_service.cc \
 	zmq_endpoint.cc \
+	shm_channel.cc \
 	async_event_source.cc \
 	async_writer_source.cc \
 	tcp_client.cc \
@@ -71,7 +72,7 @@ LIBSERVICES_SOURCES := \
 	event_subscriber.cc \
 	nsq_client.cc 
 
-LIBSERVICES_LINK := opstats curl curlpp boost_regex runner_common zeromq zookeeper_mt ACE arch utils jsoncpp boost_thread zmq types tinyxml2 boost_system value_description
+LIBSERVICES_LINK := opstats curl curlpp boost_regex runner_common zeromq zookeeper_mt ACE arch utils jsoncpp boost_thread zmq types tinyxml2 boost_system value_description rt
 
 $(eval $(call library,services,$(LIBSERVICES_SOURCES),$(LIBSERVICES_LINK)))
 $(eval $(call set_compile_option,runner.cc,-DBIN=\"$(BIN)\"))
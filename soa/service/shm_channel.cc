@@ -0,0 +1,589 @@
+/* shm_channel.cc
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Shared memory transport for multipart messages.
+*/
+
+#include "shm_channel.h"
+#include "jml/arch/exception.h"
+#include "jml/arch/format.h"
+#include "jml/utils/exc_assert.h"
+#include "jml/utils/exc_check.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+
+
+using namespace std;
+using namespace ML;
+
+
+namespace Datacratic {
+
+namespace {
+
+const uint64_t RingMagic = 0x31474e49524d4853ULL;  // "SHMRING1"
+const uint32_t SkipMarker = 0xffffffff;
+
+inline size_t align8(size_t n)
+{
+    return (n + 7) & ~size_t(7);
+}
+
+void closeFd(int & fd)
+{
+    if (fd != -1) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+/** Turn a shm:// uri into the address of the abstract unix socket. */
+sockaddr_un socketAddress(const std::string & name, socklen_t & len)
+{
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+
+    ExcCheckLess(name.size() + 1, sizeof(addr.sun_path),
+                 "shared memory channel name too long");
+
+    // Leading nul puts us in the abstract namespace; nothing on disk
+    memcpy(addr.sun_path + 1, name.data(), name.size());
+    len = offsetof(sockaddr_un, sun_path) + 1 + name.size();
+    return addr;
+}
+
+} // file scope
+
+
+/*****************************************************************************/
+/* SHM RING                                                                  */
+/*****************************************************************************/
+
+void
+ShmRing::
+init(void * mem, size_t capacity)
+{
+    ExcAssertEqual(capacity & (capacity - 1), 0);
+    ExcAssertGreaterEqual(capacity, 4096);
+
+    header = new (mem) Header();
+    header->magic = RingMagic;
+    header->capacity = capacity;
+    header->writePos = 0;
+    header->readPos = 0;
+    header->readerWaiting = 1;
+    data = (char *)mem + sizeof(Header);
+}
+
+void
+ShmRing::
+attach(void * mem)
+{
+    header = (Header *)mem;
+    if (header->magic != RingMagic)
+        throw ML::Exception("shared memory ring has wrong magic number");
+    data = (char *)mem + sizeof(Header);
+}
+
+bool
+ShmRing::
+tryWrite(const std::vector<std::string> & message)
+{
+    uint64_t capacity = header->capacity;
+
+    size_t bodySize = 4;
+    for (auto & part: message)
+        bodySize += 4 + part.size();
+    size_t recordSize = align8(4 + bodySize);
+
+    if (recordSize > capacity / 2)
+        throw ML::Exception("message of %zd bytes too large for shared "
+                            "memory ring", bodySize);
+
+    uint64_t writePos = header->writePos.load(std::memory_order_relaxed);
+    uint64_t readPos = header->readPos.load(std::memory_order_acquire);
+
+    uint64_t offset = writePos & (capacity - 1);
+    uint64_t skip = offset + recordSize > capacity ? capacity - offset : 0;
+
+    if (writePos + skip + recordSize - readPos > capacity)
+        return false;
+
+    if (skip) {
+        *(uint32_t *)(data + offset) = SkipMarker;
+        writePos += skip;
+        offset = 0;
+    }
+
+    char * p = data + offset;
+    auto put32 = [&] (uint32_t val) { memcpy(p, &val, 4);  p += 4; };
+
+    put32(bodySize);
+    put32(message.size());
+    for (auto & part: message) {
+        put32(part.size());
+        memcpy(p, part.data(), part.size());
+        p += part.size();
+    }
+
+    header->writePos.store(writePos + recordSize, std::memory_order_release);
+    return true;
+}
+
+bool
+ShmRing::
+tryRead(std::vector<std::string> & message)
+{
+    uint64_t capacity = header->capacity;
+
+    uint64_t readPos = header->readPos.load(std::memory_order_relaxed);
+    uint64_t writePos = header->writePos.load(std::memory_order_acquire);
+    if (readPos == writePos)
+        return false;
+
+    uint64_t offset = readPos & (capacity - 1);
+    const char * p = data + offset;
+    auto get32 = [&] () { uint32_t val;  memcpy(&val, p, 4);  p += 4;  return val; };
+
+    uint32_t bodySize = get32();
+    if (bodySize == SkipMarker) {
+        readPos += capacity - offset;
+        p = data;
+        bodySize = get32();
+    }
+
+    ExcAssertLessEqual(bodySize, capacity);
+
+    uint32_t numParts = get32();
+    message.resize(numParts);
+    for (auto & part: message) {
+        uint32_t size = get32();
+        part.assign(p, size);
+        p += size;
+    }
+
+    header->readPos.store(readPos + align8(4 + bodySize),
+                          std::memory_order_release);
+    return true;
+}
+
+
+/*****************************************************************************/
+/* SHM CHANNEL                                                               */
+/*****************************************************************************/
+
+ShmChannel::
+ShmChannel(int shmFd, int serverWakeupFd, int clientWakeupFd, bool isServer)
+    : mem(nullptr), memSize(0), shmFd(shmFd),
+      inFd(isServer ? serverWakeupFd : clientWakeupFd),
+      outFd(isServer ? clientWakeupFd : serverWakeupFd),
+      received(0), dropped(0)
+{
+    struct stat st;
+    if (fstat(shmFd, &st) == -1)
+        throw ML::Exception(errno, "fstat on shared memory channel");
+    memSize = st.st_size;
+
+    mem = mmap(nullptr, memSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+               shmFd, 0);
+    if (mem == MAP_FAILED)
+        throw ML::Exception(errno, "mmap of shared memory channel");
+
+    // The server writes into the first ring and reads from the second
+    ShmRing first, second;
+    first.attach(mem);
+    second.attach((char *)mem
+                  + ShmRing::bytesRequired(first.header->capacity));
+
+    ExcCheckEqual(ShmRing::bytesRequired(first.header->capacity)
+                  + ShmRing::bytesRequired(second.header->capacity),
+                  memSize, "shared memory channel has wrong size");
+
+    out = isServer ? first : second;
+    in = isServer ? second : first;
+}
+
+ShmChannel::
+~ShmChannel()
+{
+    if (mem)
+        munmap(mem, memSize);
+    closeFd(shmFd);
+    closeFd(inFd);
+    closeFd(outFd);
+}
+
+bool
+ShmChannel::
+send(const std::vector<std::string> & message)
+{
+    bool written;
+    {
+        std::lock_guard<ML::Spinlock> guard(writeLock);
+        written = out.tryWrite(message);
+    }
+
+    if (!written) {
+        dropped += 1;
+        return false;
+    }
+
+    // Pairs with the fence in processOne(); either we see that the reader
+    // is going to sleep or it sees our message.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (out.header->readerWaiting.load(std::memory_order_relaxed)
+        && out.header->readerWaiting.exchange(0))
+        eventfd_write(outFd, 1);
+
+    return true;
+}
+
+bool
+ShmChannel::
+processOne()
+{
+    std::vector<std::string> message;
+
+    // Don't monopolize the loop if the other end is flooding us
+    for (unsigned i = 0;  i < 256;  ++i) {
+        if (!in.tryRead(message))
+            break;
+        ++received;
+        if (onMessage)
+            onMessage(std::move(message));
+    }
+
+    eventfd_t val;
+    if (!in.empty()) {
+        // Make sure that we get called again
+        eventfd_write(inFd, 1);
+        return false;
+    }
+
+    int res = ::read(inFd, &val, sizeof(val));
+    (void)res;
+
+    in.header->readerWaiting.store(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    // A message may have arrived before the writer could see the flag
+    if (!in.empty())
+        eventfd_write(inFd, 1);
+
+    return false;
+}
+
+
+/*****************************************************************************/
+/* SHM CHANNEL LISTENER                                                      */
+/*****************************************************************************/
+
+ShmChannelListener::
+ShmChannelListener()
+    : fd(-1), ringCapacity(DefaultRingCapacity)
+{
+    handleEvent = [=] (epoll_event & event)
+        {
+            return this->handleListenerEvent(event);
+        };
+}
+
+ShmChannelListener::
+~ShmChannelListener()
+{
+    shutdown();
+}
+
+std::string
+ShmChannelListener::
+listen(const std::string & prefix, size_t ringCapacity)
+{
+    ExcCheckEqual(fd, -1, "shared memory listener already listening");
+
+    // The name is reused for the shared memory segments, which can't
+    // contain slashes
+    std::string base = prefix;
+    std::replace(base.begin(), base.end(), '/', '.');
+
+    static std::atomic<int> index(0);
+    std::string name = ML::format("%s.%d.%d", base.c_str(), getpid(),
+                                  index++);
+
+    this->ringCapacity = ringCapacity;
+
+    fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd == -1)
+        throw ML::Exception(errno, "socket for shared memory listener");
+
+    socklen_t len;
+    sockaddr_un addr = socketAddress(name, len);
+    if (::bind(fd, (sockaddr *)&addr, len) == -1
+        || ::listen(fd, 128) == -1) {
+        int err = errno;
+        closeFd(fd);
+        throw ML::Exception(err, "binding shared memory listener " + name);
+    }
+
+    Epoller::init(128);
+    addFd(fd);  // no data means the listening socket
+
+    uri_ = "shm://" + name;
+    return uri_;
+}
+
+void
+ShmChannelListener::
+shutdown()
+{
+    while (!pending.empty())
+        dropPending(pending.begin()->first);
+
+    if (fd != -1) {
+        removeFd(fd);
+        closeFd(fd);
+    }
+}
+
+bool
+ShmChannelListener::
+processOne()
+{
+    // Not done from within the handlers, as the events being handled may
+    // point to the entries that would be dropped
+    if (!pending.empty())
+        expirePending(Date::now());
+
+    return Epoller::processOne();
+}
+
+Epoller::HandleEventResult
+ShmChannelListener::
+handleListenerEvent(epoll_event & event)
+{
+    if (event.data.ptr == nullptr)
+        acceptConnections();
+    else handshake(*reinterpret_cast<PendingConnection *>(event.data.ptr));
+
+    return DONE;
+}
+
+void
+ShmChannelListener::
+acceptConnections()
+{
+    for (;;) {
+        int conn = accept4(fd, nullptr, nullptr,
+                           SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (conn == -1) {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                cerr << "ShmChannelListener: accept: " << strerror(errno)
+                     << endl;
+            return;
+        }
+
+        // The client sends its identity straight after connecting, but it
+        // may not be there yet; wait for it in the epoller
+        PendingConnection & entry = pending[conn];
+        entry.fd = conn;
+        entry.accepted = Date::now();
+        addFd(conn, &entry);
+    }
+}
+
+void
+ShmChannelListener::
+dropPending(int conn)
+{
+    removeFd(conn);
+    pending.erase(conn);
+    ::close(conn);
+}
+
+void
+ShmChannelListener::
+expirePending(Date now)
+{
+    for (auto it = pending.begin();  it != pending.end();) {
+        auto next = std::next(it);
+        if (it->second.accepted.plusSeconds(HandshakeTimeout) < now) {
+            cerr << "ShmChannelListener: client didn't send its identity"
+                 << endl;
+            dropPending(it->first);
+        }
+        it = next;
+    }
+}
+
+void
+ShmChannelListener::
+handshake(PendingConnection & entry)
+{
+    int conn = entry.fd;
+
+    char buf[1024];
+    ssize_t n = recv(conn, buf, sizeof(buf), 0);
+    if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK
+                    || errno == EINTR))
+        return;  // spurious wakeup; keep waiting
+
+    int err = errno;
+
+    // Either way we're done waiting on this connection.  The pending entry
+    // goes away with it, so entry can't be used after this.
+    removeFd(conn);
+    pending.erase(conn);
+
+    int shmFd = -1, serverFd = -1, clientFd = -1;
+
+    try {
+        if (n <= 0)
+            throw ML::Exception(n == 0 ? ECONNRESET : err,
+                                "reading shared memory client identity");
+        std::string identity(buf, n);
+
+        static std::atomic<int> index(0);
+        std::string shmName = ML::format("/%s.%d", uri_.c_str() + 6,
+                                         index++);
+        shmFd = shm_open(shmName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (shmFd == -1)
+            throw ML::Exception(errno, "shm_open " + shmName);
+
+        // Nobody else needs to find it by name; it goes away with its fds
+        shm_unlink(shmName.c_str());
+
+        size_t ringBytes = ShmRing::bytesRequired(ringCapacity);
+        if (ftruncate(shmFd, 2 * ringBytes) == -1)
+            throw ML::Exception(errno, "sizing shared memory channel");
+
+        void * mem = mmap(nullptr, 2 * ringBytes, PROT_READ | PROT_WRITE,
+                          MAP_SHARED, shmFd, 0);
+        if (mem == MAP_FAILED)
+            throw ML::Exception(errno, "mmap of shared memory channel");
+        ShmRing ring;
+        ring.init(mem, ringCapacity);
+        ring.init((char *)mem + ringBytes, ringCapacity);
+        munmap(mem, 2 * ringBytes);
+
+        serverFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        clientFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (serverFd == -1 || clientFd == -1)
+            throw ML::Exception(errno, "eventfd for shared memory channel");
+
+        int fds[3] = { shmFd, serverFd, clientFd };
+        char control[CMSG_SPACE(sizeof(fds))];
+        memset(control, 0, sizeof(control));
+
+        char ok = 1;
+        iovec iov = { &ok, 1 };
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        cmsghdr * cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+        memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+        // Nothing else has been written to this socket, so there's always
+        // room for the reply and this doesn't block
+        if (sendmsg(conn, &msg, MSG_NOSIGNAL | MSG_DONTWAIT) == -1)
+            throw ML::Exception(errno, "sending shared memory channel fds");
+
+        auto channel = std::make_shared<ShmChannel>(shmFd, serverFd, clientFd,
+                                                    true /* isServer */);
+        shmFd = serverFd = clientFd = -1;  // owned by the channel now
+        closeFd(conn);
+
+        if (onNewChannel)
+            onNewChannel(identity, channel);
+    } catch (const std::exception & exc) {
+        cerr << "ShmChannelListener: error accepting connection: "
+             << exc.what() << endl;
+        closeFd(conn);
+        closeFd(shmFd);
+        closeFd(serverFd);
+        closeFd(clientFd);
+    }
+}
+
+
+/*****************************************************************************/
+/* FREE FUNCTIONS                                                            */
+/*****************************************************************************/
+
+std::shared_ptr<ShmChannel>
+connectShmChannel(const std::string & uri, const std::string & identity)
+{
+    ExcCheck(isShmUri(uri), "not a shared memory uri: " + uri);
+    ExcCheck(!identity.empty(), "shared memory channel needs an identity");
+
+    int conn = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (conn == -1)
+        throw ML::Exception(errno, "socket for shared memory channel");
+
+    int fds[3] = { -1, -1, -1 };
+
+    try {
+        socklen_t len;
+        sockaddr_un addr = socketAddress(uri.substr(6), len);
+        if (connect(conn, (sockaddr *)&addr, len) == -1)
+            throw ML::Exception(errno, "connecting to " + uri);
+
+        timeval tv = { 1, 0 };
+        setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+        if (::send(conn, identity.data(), identity.size(), MSG_NOSIGNAL)
+            == -1)
+            throw ML::Exception(errno, "sending identity to " + uri);
+
+        char control[CMSG_SPACE(sizeof(fds))];
+        char ok = 0;
+        iovec iov = { &ok, 1 };
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        if (recvmsg(conn, &msg, MSG_CMSG_CLOEXEC) <= 0)
+            throw ML::Exception(errno, "receiving channel from " + uri);
+
+        cmsghdr * cmsg = CMSG_FIRSTHDR(&msg);
+        if (!ok || !cmsg || cmsg->cmsg_type != SCM_RIGHTS
+            || cmsg->cmsg_len != CMSG_LEN(sizeof(fds)))
+            throw ML::Exception("bad shared memory handshake from " + uri);
+        memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+
+        closeFd(conn);
+
+        auto result = std::make_shared<ShmChannel>(fds[0], fds[1], fds[2],
+                                                   false /* isServer */);
+        return result;
+    } catch (...) {
+        closeFd(conn);
+        for (int & fd: fds)
+            closeFd(fd);
+        throw;
+    }
+}
+
+} // namespace Datacratic
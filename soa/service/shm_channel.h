@@ -0,0 +1,243 @@
+/* shm_channel.h                                                   -*- C++ -*-
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Shared memory transport for multipart messages between processes on the
+   same host.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "soa/service/async_event_source.h"
+#include "soa/service/epoller.h"
+#include "soa/types/date.h"
+#include "jml/arch/spinlock.h"
+#include "jml/compiler/compiler.h"
+
+
+namespace Datacratic {
+
+
+/*****************************************************************************/
+/* SHM RING                                                                  */
+/*****************************************************************************/
+
+/** Single producer, single consumer ring of multipart messages that lives in
+    a block of (possibly shared) memory.  The ring itself has no pointers in
+    it, so that both ends can map it at different addresses.
+
+    Each record is a 32 bit length followed by the number of parts and then
+    each part as a 32 bit length and its bytes.  Records are aligned on 8
+    bytes and never wrap around; a record that doesn't fit at the end of the
+    buffer is preceded by a skip marker.
+*/
+
+struct ShmRing {
+
+    struct Header {
+        uint64_t magic;
+        uint64_t capacity;
+        std::atomic<uint64_t> writePos JML_ALIGNED(64);
+        std::atomic<uint64_t> readPos JML_ALIGNED(64);
+
+        /// Set by the reader before it goes to sleep on its wakeup fd
+        std::atomic<uint32_t> readerWaiting JML_ALIGNED(64);
+    } JML_ALIGNED(64);
+
+    ShmRing()
+        : header(nullptr), data(nullptr)
+    {
+    }
+
+    /** Number of bytes of memory needed for a ring with the given capacity,
+        which must be a power of two.
+    */
+    static size_t bytesRequired(size_t capacity)
+    {
+        return sizeof(Header) + capacity;
+    }
+
+    /** Initialize a new ring in the given memory. */
+    void init(void * mem, size_t capacity);
+
+    /** Attach to a ring that was initialized by the other end. */
+    void attach(void * mem);
+
+    /** Append a message to the ring.  Returns false if there isn't room
+        for it.  Only one thread may write at once.
+    */
+    bool tryWrite(const std::vector<std::string> & message);
+
+    /** Remove the next message from the ring.  Returns false if it is
+        empty.  Only one thread may read at once.
+    */
+    bool tryRead(std::vector<std::string> & message);
+
+    bool empty() const
+    {
+        return header->readPos.load(std::memory_order_relaxed)
+            == header->writePos.load(std::memory_order_acquire);
+    }
+
+    Header * header;
+    char * data;
+};
+
+
+/*****************************************************************************/
+/* SHM CHANNEL                                                               */
+/*****************************************************************************/
+
+/** One end of a bidirectional shared memory connection.  Messages are
+    written into the peer's ring and the peer is only woken up via its
+    eventfd if it was sleeping, so a busy receiver doesn't cost a system
+    call per message.
+
+    It's an event source that calls onMessage for each message received.
+*/
+
+struct ShmChannel : public AsyncEventSource {
+
+    /** Set up from a shared memory segment containing two rings and the
+        two eventfds.  The server end writes into the first ring and the
+        client end into the second.
+    */
+    ShmChannel(int shmFd, int serverWakeupFd, int clientWakeupFd,
+               bool isServer);
+
+    ~ShmChannel();
+
+    /** Send a message to the other end.  Returns false if the other end is
+        too far behind and the ring is full.  Thread safe.
+    */
+    bool send(const std::vector<std::string> & message);
+
+    typedef std::function<void (std::vector<std::string> && message)>
+        OnMessage;
+    OnMessage onMessage;
+
+    /** Number of messages received since construction. */
+    uint64_t numReceived() const { return received; }
+
+    /** Number of messages dropped since the ring was full. */
+    uint64_t numDropped() const { return dropped; }
+
+    /* AsyncEventSource interface */
+    virtual int selectFd() const { return inFd; }
+    virtual bool poll() const { return !in.empty(); }
+    virtual bool processOne();
+
+private:
+    void * mem;
+    size_t memSize;
+    int shmFd;
+    int inFd;
+    int outFd;
+
+    ShmRing in;
+    ShmRing out;
+
+    ML::Spinlock writeLock;
+    uint64_t received;
+    std::atomic<uint64_t> dropped;
+};
+
+
+/*****************************************************************************/
+/* SHM CHANNEL LISTENER                                                      */
+/*****************************************************************************/
+
+/** Accepts shared memory connections from other processes on the same host.
+    Clients connect to a unix socket in the abstract namespace and send their
+    identity; the listener replies with the file descriptors of a new shared
+    memory segment and its wakeup fds.
+
+    The listening socket and the connections that haven't sent their
+    identity yet are all multiplexed in the epoller, so accepting never
+    blocks the message loop that it's attached to.
+*/
+
+struct ShmChannelListener : public Epoller {
+
+    ShmChannelListener();
+    ~ShmChannelListener();
+
+    /** Start listening on a new, unique address.  Returns the uri that
+        connectShmChannel() can connect to.
+    */
+    std::string listen(const std::string & prefix,
+                       size_t ringCapacity = DefaultRingCapacity);
+
+    void shutdown();
+
+    /// 4MB in each direction; enough for a few thousand bid requests
+    static constexpr size_t DefaultRingCapacity = 4 * 1024 * 1024;
+
+    /// Seconds that a client has to send its identity once connected
+    static constexpr double HandshakeTimeout = 1.0;
+
+    typedef std::function<void (const std::string & identity,
+                                std::shared_ptr<ShmChannel> channel)>
+        OnNewChannel;
+    OnNewChannel onNewChannel;
+
+    const std::string & uri() const { return uri_; }
+
+    /** Number of connections that are waiting on their identity. */
+    size_t numPending() const { return pending.size(); }
+
+    /* AsyncEventSource interface */
+    virtual bool processOne();
+
+private:
+    /** A connection that was accepted but whose identity hasn't arrived. */
+    struct PendingConnection {
+        int fd;
+        Date accepted;
+    };
+
+    HandleEventResult handleListenerEvent(epoll_event & event);
+
+    /** Accept everything that's waiting on the listening socket. */
+    void acceptConnections();
+
+    /** Read the identity of a pending connection and, once it's there, set
+        up its channel.
+    */
+    void handshake(PendingConnection & conn);
+
+    /** Stop waiting on a pending connection and close it. */
+    void dropPending(int fd);
+
+    /** Drop the connections that have been pending for too long.  That's
+        only noticed the next time the listener wakes up.
+    */
+    void expirePending(Date now);
+
+    int fd;
+    size_t ringCapacity;
+    std::string uri_;
+
+    /// Connections waiting on their identity, by fd
+    std::map<int, PendingConnection> pending;
+};
+
+
+/** Connect to a ShmChannelListener at the given uri, identifying ourselves
+    with the given name.  Throws if the connection can't be made.
+*/
+std::shared_ptr<ShmChannel>
+connectShmChannel(const std::string & uri, const std::string & identity);
+
+/** Returns true if the given uri is a shared memory channel uri. */
+inline bool isShmUri(const std::string & uri)
+{
+    return uri.compare(0, 6, "shm://") == 0;
+}
+
+} // namespace Datacratic
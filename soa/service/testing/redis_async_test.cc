@@ -23,6 +23,7 @@
 #include "jml/arch/timers.h"
 #include <linux/futex.h>
 #include <unistd.h>
+#include <cstring>
 #include <sys/syscall.h>
 #include "jml/arch/futex.h"
 
@@ -351,3 +352,83 @@ BOOST_AUTO_TEST_CASE( test_redis_timeout )
 
     redis.shutdown();
 }
+
+BOOST_AUTO_TEST_CASE( test_redis_reply_copy )
+{
+    redisReply str, num, nil, arr;
+    memset(&str, 0, sizeof(str));
+    memset(&num, 0, sizeof(num));
+    memset(&nil, 0, sizeof(nil));
+    memset(&arr, 0, sizeof(arr));
+
+    char abc[] = "abc";
+    str.type = REDIS_REPLY_STRING;
+    str.str = abc;
+    str.len = 3;
+    num.type = REDIS_REPLY_INTEGER;
+    num.integer = 42;
+    nil.type = REDIS_REPLY_NIL;
+
+    redisReply * elements[3] = { &str, &num, &nil };
+    arr.type = REDIS_REPLY_ARRAY;
+    arr.elements = 3;
+    arr.element = elements;
+
+    // The copy has to outlive the reply that it was made from
+    Reply copy = Reply(&arr, false).deepCopy();
+    abc[0] = 'x';
+    num.integer = 0;
+
+    BOOST_CHECK_EQUAL(copy.length(), 3);
+    BOOST_CHECK_EQUAL(copy[0].getString(), "abc");
+    BOOST_CHECK_EQUAL(copy[1].asInt(), 42);
+    BOOST_CHECK_EQUAL(copy[2].type(), Redis::NIL);
+
+    // A reply that's already owned is shared rather than copied again
+    Reply again = copy.deepCopy();
+    BOOST_CHECK(again.asJson() == copy.asJson());
+}
+
+BOOST_AUTO_TEST_CASE( test_redis_coalesce )
+{
+    RedisTemporaryServer redis;
+    Redis::AsyncConnection connection(redis);
+    connection.coalesce(0.001, 64);
+
+    enum { NumCommands = 10000 };
+
+    int done = 0;
+    int errors = 0;
+    int outOfOrder = 0;
+    int next = 0;
+
+    for (unsigned i = 0;  i < NumCommands;  ++i) {
+        string key = ML::format("key%d", i % 100);
+
+        auto onResult = [&, i] (const Redis::Result & result)
+            {
+                if (!result) ++errors;
+                if (i != next++) ++outOfOrder;
+                if (__sync_add_and_fetch(&done, 1) == NumCommands)
+                    futex_wake(done);
+            };
+
+        if (i % 2)
+            connection.queue(GET(key), onResult);
+        else connection.queue(SET(key, i), onResult);
+    }
+
+    while (done != NumCommands)
+        futex_wait(done, done);
+
+    BOOST_CHECK_EQUAL(errors, 0);
+    BOOST_CHECK_EQUAL(outOfOrder, 0);
+
+    // The last SET of a key wins
+    auto result = connection.exec(GET("key42"), 2.0);
+    BOOST_CHECK(result);
+    BOOST_CHECK_EQUAL(result.reply().asString(),
+                      to_string(NumCommands - 100 + 42));
+
+    BOOST_CHECK_EQUAL(connection.numRequestsPending(), 0);
+}
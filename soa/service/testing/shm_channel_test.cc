@@ -0,0 +1,198 @@
+/* shm_channel_test.cc
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Test for the shared memory message channel.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include "soa/service/shm_channel.h"
+#include "soa/service/message_loop.h"
+#include "jml/utils/testing/watchdog.h"
+#include "jml/arch/timers.h"
+#include "soa/types/date.h"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+
+
+using namespace std;
+using namespace ML;
+using namespace Datacratic;
+
+
+BOOST_AUTO_TEST_CASE( test_shm_ring_wraparound )
+{
+    const size_t capacity = 4096;
+    std::vector<char> mem(ShmRing::bytesRequired(capacity) + 64);
+    void * aligned = (void *)(((size_t)mem.data() + 63) & ~size_t(63));
+
+    ShmRing ring;
+    ring.init(aligned, capacity);
+    BOOST_CHECK(ring.empty());
+
+    std::vector<std::string> message, received;
+    BOOST_CHECK(!ring.tryRead(received));
+
+    // Odd sized messages so that records wrap at every possible offset
+    unsigned written = 0, read = 0;
+    for (unsigned i = 0;  i < 10000;  ++i) {
+        message = { "topic", std::string(i % 301, 'a' + i % 26),
+                    std::to_string(written) };
+        if (ring.tryWrite(message))
+            ++written;
+        else {
+            // Full; drain a few
+            for (unsigned j = 0;  j < 3 && ring.tryRead(received);  ++j) {
+                BOOST_REQUIRE_EQUAL(received.size(), 3);
+                BOOST_CHECK_EQUAL(received[2], std::to_string(read));
+                ++read;
+            }
+        }
+    }
+
+    while (ring.tryRead(received)) {
+        BOOST_CHECK_EQUAL(received[2], std::to_string(read));
+        ++read;
+    }
+
+    BOOST_CHECK_EQUAL(read, written);
+    BOOST_CHECK(ring.empty());
+
+    // Empty messages and parts are preserved
+    BOOST_CHECK(ring.tryWrite({ "", "" }));
+    BOOST_CHECK(ring.tryWrite({}));
+    BOOST_CHECK(ring.tryRead(received));
+    BOOST_CHECK_EQUAL(received.size(), 2);
+    BOOST_CHECK(ring.tryRead(received));
+    BOOST_CHECK_EQUAL(received.size(), 0);
+
+    // Messages that could never fit are an error rather than a full ring
+    BOOST_CHECK_THROW(ring.tryWrite({ std::string(capacity, 'x') }),
+                      std::exception);
+}
+
+BOOST_AUTO_TEST_CASE( test_shm_channel_ping_pong )
+{
+    ML::Watchdog watchdog(30.0);
+
+    MessageLoop loop;
+
+    ShmChannelListener listener;
+    std::string uri = listener.listen("shm_channel_test");
+    BOOST_CHECK(isShmUri(uri));
+
+    std::string clientIdentity;
+    std::shared_ptr<ShmChannel> server;
+
+    listener.onNewChannel = [&] (const std::string & identity,
+                                 std::shared_ptr<ShmChannel> channel)
+        {
+            clientIdentity = identity;
+            server = channel;
+            ShmChannel * c = channel.get();
+            channel->onMessage = [=] (std::vector<std::string> && message)
+                {
+                    message.insert(message.begin(), "echo");
+                    c->send(message);
+                };
+            loop.addSource("server", channel);
+        };
+
+    loop.addSource("listener", listener);
+    loop.start();
+
+    auto client = connectShmChannel(uri, "client1");
+
+    // Fewer than fit in the ring, so that echoes are never dropped
+    const unsigned numMessages = 20000;
+    std::atomic<unsigned> numReceived(0);
+    std::atomic<unsigned> numErrors(0);
+
+    client->onMessage = [&] (std::vector<std::string> && message)
+        {
+            if (message.size() != 3 || message[0] != "echo"
+                || message[2] != std::to_string(numReceived))
+                ++numErrors;
+            ++numReceived;
+        };
+    loop.addSource("client", client);
+
+    for (unsigned i = 0;  i < numMessages;  ++i) {
+        // Back off if the other end can't keep up
+        while (!client->send({ "hello", std::to_string(i) }))
+            ML::sleep(0.0001);
+    }
+
+    while (numReceived < numMessages)
+        ML::sleep(0.01);
+
+    BOOST_CHECK_EQUAL(clientIdentity, "client1");
+    BOOST_CHECK_EQUAL(numErrors, 0);
+    BOOST_CHECK_EQUAL(client->numReceived(), numMessages);
+    BOOST_CHECK_EQUAL(server->numReceived(), numMessages);
+
+    loop.shutdown();
+
+    BOOST_CHECK_THROW(connectShmChannel("shm://no_such_channel", "client2"),
+                      std::exception);
+}
+
+BOOST_AUTO_TEST_CASE( test_shm_channel_listener_slow_client )
+{
+    ML::Watchdog watchdog(30.0);
+
+    MessageLoop loop;
+
+    ShmChannelListener listener;
+    std::string uri = listener.listen("shm_channel_test");
+
+    std::atomic<unsigned> numChannels(0);
+    listener.onNewChannel = [&] (const std::string & identity,
+                                 std::shared_ptr<ShmChannel> channel)
+        {
+            ++numChannels;
+        };
+
+    loop.addSource("listener", listener);
+    loop.start();
+
+    // Connect but don't send an identity, like a client that got stuck
+    std::string name = uri.substr(6);
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path + 1, name.data(), name.size());
+    socklen_t len = offsetof(sockaddr_un, sun_path) + 1 + name.size();
+
+    int silent = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    BOOST_REQUIRE_NE(silent, -1);
+    BOOST_REQUIRE_EQUAL(connect(silent, (sockaddr *)&addr, len), 0);
+
+    // Other clients don't have to wait for it
+    Date before = Date::now();
+    auto client = connectShmChannel(uri, "client1");
+    BOOST_CHECK(client);
+    BOOST_CHECK_LT(Date::now().secondsSince(before), 0.5);
+
+    // Once it's been too long, it's hung up on the next time the listener
+    // wakes up
+    ML::sleep(ShmChannelListener::HandshakeTimeout + 0.1);
+    connectShmChannel(uri, "client2");
+
+    char buf[16];
+    BOOST_CHECK_EQUAL(recv(silent, buf, sizeof(buf), 0), 0);
+    close(silent);
+
+    while (numChannels < 2)
+        ML::sleep(0.001);
+
+    loop.shutdown();
+
+    BOOST_CHECK_EQUAL(listener.numPending(), 0);
+}
@@ -39,3 +39,100 @@ BOOST_AUTO_TEST_CASE( test_no_connect )
     ML::sleep(1.0);
     socket.shutdown();
 }
+
+namespace {
+
+/** Echo messages from a client through a bus, and return how many clients
+    the bus had over shared memory.
+*/
+size_t echoThroughBus(const std::string & busName,
+                      bool busShm, bool clientShm)
+{
+    auto proxies = std::make_shared<ServiceProxies>();
+
+    ZmqNamedClientBus bus(proxies->zmqContext);
+    bus.init(proxies->config, busName);
+    bus.clientMessageHandler = [&] (const std::vector<std::string> & message)
+        {
+            // identity, topic, payload
+            bus.sendMessage(message.at(0), "REPLY", message.at(2));
+        };
+    bus.bindTcp();
+    if (busShm)
+        bus.bindShm();
+    bus.start();
+
+    // Whatever else it offers, the bus publishes its tcp address only
+    auto children = proxies->config->getChildren(busName);
+    BOOST_CHECK_EQUAL(children.size(), 1);
+    BOOST_CHECK_EQUAL(children.at(0), "tcp");
+
+    std::atomic<int> numReplies(0);
+
+    ZmqNamedClientBusProxy proxy(proxies->zmqContext);
+    proxy.useShm = clientShm;
+    proxy.init(proxies->config, busName + "Client");
+    proxy.messageHandler = [&] (const std::vector<std::string> & message)
+        {
+            BOOST_CHECK_EQUAL(message.at(0), "REPLY");
+            BOOST_CHECK_EQUAL(message.at(1), std::to_string(numReplies));
+            ++numReplies;
+        };
+    BOOST_CHECK(proxy.connect(busName, CS_MUST_SUCCEED));
+    proxy.start();
+
+    const int numMessages = 1000;
+    for (int i = 0;  i < numMessages;  ++i)
+        proxy.sendMessage("ECHO", std::to_string(i));
+
+    while (numReplies < numMessages)
+        ML::sleep(0.01);
+
+    size_t result = bus.numShmConnections();
+
+    proxy.shutdown();
+    bus.shutdown();
+
+    return result;
+}
+
+} // file scope
+
+/** Clients on the same host as a bus that offers shared memory should talk
+    to it that way, transparently.
+ */
+BOOST_AUTO_TEST_CASE( test_shm_client_bus )
+{
+    Watchdog watchdog(30.0);
+
+    BOOST_CHECK_EQUAL(echoThroughBus("shmTest/bus", true, true), 1);
+}
+
+/** Without shared memory on either side, everything goes over zeromq. */
+BOOST_AUTO_TEST_CASE( test_zmq_client_bus )
+{
+    Watchdog watchdog(30.0);
+
+    BOOST_CHECK_EQUAL(echoThroughBus("zmqTest/bus", false, true), 0);
+    BOOST_CHECK_EQUAL(echoThroughBus("zmqTest/bus2", true, false), 0);
+}
+
+/** A client that can't find a usable address stays pending. */
+BOOST_AUTO_TEST_CASE( test_client_bus_pending )
+{
+    Watchdog watchdog(10.0);
+
+    auto proxies = std::make_shared<ServiceProxies>();
+
+    // An address for another host only
+    Json::Value config;
+    config[0]["zmqConnectUri"] = "tcp://127.0.0.1:1";
+    config[0]["transports"][0]["name"] = "tcp";
+    config[0]["transports"][0]["hostScope"] = "no-such-host";
+    proxies->config->setUnique("pendingTest/bus/tcp", config);
+
+    ZmqNamedClientBusProxy proxy(proxies->zmqContext);
+    proxy.init(proxies->config, "pendingTestClient");
+    BOOST_CHECK(!proxy.connect("pendingTest/bus", CS_MUST_SUCCEED));
+    BOOST_CHECK(!proxy.isConnected());
+}
@@ -16,6 +16,21 @@ using namespace std;
 
 namespace Datacratic {
 
+namespace {
+
+/** Name of this host, as used in the host scope of published addresses. */
+std::string nodeName()
+{
+    utsname name;
+    if (uname(&name)) {
+        THROW(ZmqLogs::error)
+            << "uname error: " << strerror(errno) << std::endl;
+    }
+    return name.nodename;
+}
+
+} // file scope
+
 /******************************************************************************/
 /* ZMQ LOGS                                                                   */
 /******************************************************************************/
@@ -397,18 +412,48 @@ bindTcp(PortRange const & portRange, std::string host)
         for (unsigned i = 0;  i < interfaces.size();  ++i) {
             addEntry(interfaces[i].addr, interfaces[i].hostScope);
         }
-        publishAddress("tcp", config);
+        publishedTcp = config;
+        publishAddress("tcp", withShm(config));
         return getUri(host);
     }
     else {
         string host2 = addrToIp(host);
         // TODO: compute the host scope; don't just assume "*"
         addEntry(host2, "*");
-        publishAddress("tcp", config);
+        publishedTcp = config;
+        publishAddress("tcp", withShm(config));
         return getUri(host2);
     }
 }
 
+void
+ZmqNamedEndpoint::
+advertiseShm(const std::string & uri)
+{
+    std::unique_lock<Lock> guard(lock);
+
+    shmUri = uri;
+    if (!publishedTcp.isNull())
+        republishAddress("tcp", withShm(publishedTcp));
+}
+
+Json::Value
+ZmqNamedEndpoint::
+withShm(Json::Value config) const
+{
+    if (shmUri.empty())
+        return config;
+
+    // Only clients on this host can map our memory
+    string host = nodeName();
+    for (auto & entry: config) {
+        entry["shmConnectUri"] = shmUri;
+        entry["shmHostScope"] = host;
+    }
+
+    return config;
+}
+
  
 
 /*****************************************************************************/
@@ -418,6 +463,7 @@ bindTcp(PortRange const & portRange, std::string host)
 ZmqNamedProxy::
 ZmqNamedProxy() :
     context_(new zmq::context_t(1)),
+    shmConnected(false),
     local(true),
     shardIndex(-1)
 {
@@ -426,6 +472,7 @@ ZmqNamedProxy() :
 ZmqNamedProxy::
 ZmqNamedProxy(std::shared_ptr<zmq::context_t> context, int shardIndex) :
     context_(context),
+    shmConnected(false),
     local(true),
     shardIndex(shardIndex)
 {
@@ -441,6 +488,7 @@ init(std::shared_ptr<ConfigurationService> config,
     this->connectionState = NOT_CONNECTED;
 
     this->config = config;
+    this->identity = identity;
     socket_.reset(new zmq::socket_t(*context_, socketType));
     if (identity != "")
         setIdentity(*socket_, identity);
@@ -515,7 +563,19 @@ connect(const std::string & endpointName,
                     continue;  // wrong host scope
             }
 
-            {
+            // The endpoint may also take clients on its own host over
+            // shared memory, which we prefer
+            if (entry.isMember("shmConnectUri")
+                && entry["shmHostScope"].asString() == nodeName()
+                && connectShm(entry["shmConnectUri"].asString())) {
+                uri = entry["shmConnectUri"].asString();
+
+                std::lock_guard<ZmqEventSource::SocketLock> guard(socketLock_);
+                connectedUri = uri;
+                shmConnected = true;
+                connectionState = CONNECTED;
+            }
+            else {
                 std::lock_guard<ZmqEventSource::SocketLock> guard(socketLock_);
                 socket().connect(uri.c_str());
                 connectedUri = uri;
@@ -637,6 +697,127 @@ onEndpointNodeChange(const std::string & path,
 }
 
 
+/*****************************************************************************/
+/* ZMQ NAMED CLIENT BUS                                                      */
+/*****************************************************************************/
+
+std::string
+ZmqNamedClientBus::
+bindShm(size_t ringCapacity)
+{
+    ExcCheck(!shmListener, "already bound to shared memory");
+
+    shmListener = std::make_shared<ShmChannelListener>();
+    shmListener->onNewChannel
+        = [=] (const std::string & identity,
+               std::shared_ptr<ShmChannel> channel)
+        {
+            this->onShmChannel(identity, channel);
+        };
+
+    std::string uri = shmListener->listen(shmPrefix, ringCapacity);
+    addSource("ZmqNamedClientBus::shmListener", shmListener);
+
+    advertiseShm(uri);
+
+    return uri;
+}
+
+void
+ZmqNamedClientBus::
+onShmChannel(const std::string & identity,
+             std::shared_ptr<ShmChannel> channel)
+{
+    LOG(ZmqLogs::print) << "client " << identity
+                        << " connected over shared memory" << endl;
+
+    // Make it look like it came in on the router socket
+    channel->onMessage = [=] (std::vector<std::string> && message)
+        {
+            message.insert(message.begin(), identity);
+            this->handleMessage(std::move(message));
+        };
+
+    std::shared_ptr<ShmChannel> old;
+    {
+        std::unique_lock<ShmLock> guard(shmLock);
+        old = shmClients[identity];
+        shmClients[identity] = channel;
+        numShmClients = shmClients.size();
+    }
+
+    if (old)
+        removeSource(old.get());
+    addSource("ZmqNamedClientBus::shm::" + identity, channel);
+}
+
+void
+ZmqNamedClientBus::
+dropShmClient(const std::string & identity)
+{
+    std::shared_ptr<ShmChannel> channel;
+    {
+        std::unique_lock<ShmLock> guard(shmLock);
+        auto it = shmClients.find(identity);
+        if (it == shmClients.end())
+            return;
+        channel = it->second;
+        shmClients.erase(it);
+        numShmClients = shmClients.size();
+    }
+
+    removeSource(channel.get());
+}
+
+
+/*****************************************************************************/
+/* ZMQ NAMED CLIENT BUS PROXY                                                */
+/*****************************************************************************/
+
+bool
+ZmqNamedClientBusProxy::
+connectShm(const std::string & uri)
+{
+    // The service addresses us by our identity, so we need one
+    if (!useShm || identity.empty())
+        return false;
+
+    std::shared_ptr<ShmChannel> channel;
+    try {
+        channel = connectShmChannel(uri, identity);
+    } catch (const std::exception & exc) {
+        LOG(ZmqLogs::error)
+            << "couldn't connect to " << uri << ", using zeromq: "
+            << exc.what() << endl;
+        return false;
+    }
+
+    channel->onMessage = [=] (std::vector<std::string> && message)
+        {
+            this->doMessage(message);
+        };
+
+    {
+        std::lock_guard<ZmqEventSource::SocketLock> guard(socketLock_);
+        shmChannel = channel;
+    }
+
+    addSource("ZmqNamedClientBusProxy::shm", channel);
+    return true;
+}
+
+void
+ZmqNamedClientBusProxy::
+disconnectShm()
+{
+    // Called with the socket lock held
+    if (!shmChannel)
+        return;
+    removeSource(shmChannel.get());
+    shmChannel.reset();
+}
+
+
 /******************************************************************************/
 /* ZMQ MULTIPLE NAMED CLIENT BUS PROXY                                        */
 /******************************************************************************/
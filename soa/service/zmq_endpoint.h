@@ -11,6 +11,7 @@
 #include "named_endpoint.h"
 #include "message_loop.h"
 #include "logs.h"
+#include <atomic>
 #include <set>
 #include <type_traits>
 #include "jml/utils/smart_ptr_utils.h"
@@ -20,6 +21,7 @@
 #include "jml/arch/timers.h"
 #include "jml/arch/cmp_xchg.h"
 #include "zmq_utils.h"
+#include "shm_channel.h"
 
 namespace Datacratic {
 
@@ -471,6 +473,60 @@ private:
 };
 
 
+/*****************************************************************************/
+/* MESSAGE PARTS                                                             */
+/*****************************************************************************/
+
+/** Convert the arguments of a sendMessage() call into the parts that would
+    have been sent over zeromq, for transports that don't use a socket.
+*/
+inline void appendMessageParts(std::vector<std::string> & parts)
+{
+}
+
+template<typename... Args>
+void appendMessageParts(std::vector<std::string> & parts,
+                        const std::string & arg,
+                        Args&&... args);
+
+template<typename... Args>
+void appendMessageParts(std::vector<std::string> & parts,
+                        const std::vector<std::string> & arg,
+                        Args&&... args);
+
+template<typename Arg, typename... Args>
+void appendMessageParts(std::vector<std::string> & parts,
+                        const Arg & arg,
+                        Args&&... args);
+
+template<typename... Args>
+void appendMessageParts(std::vector<std::string> & parts,
+                        const std::string & arg,
+                        Args&&... args)
+{
+    parts.push_back(arg);
+    appendMessageParts(parts, std::forward<Args>(args)...);
+}
+
+template<typename... Args>
+void appendMessageParts(std::vector<std::string> & parts,
+                        const std::vector<std::string> & arg,
+                        Args&&... args)
+{
+    parts.insert(parts.end(), arg.begin(), arg.end());
+    appendMessageParts(parts, std::forward<Args>(args)...);
+}
+
+template<typename Arg, typename... Args>
+void appendMessageParts(std::vector<std::string> & parts,
+                        const Arg & arg,
+                        Args&&... args)
+{
+    parts.push_back(encodeMessage(arg).toString());
+    appendMessageParts(parts, std::forward<Args>(args)...);
+}
+
+
 /*****************************************************************************/
 /* ZEROMQ NAMED ENDPOINT                                                     */
 /*****************************************************************************/
@@ -511,6 +567,13 @@ struct ZmqNamedEndpoint : public NamedEndpoint, public MessageLoop {
     */
     std::string bindTcp(PortRange const & portRange = PortRange(), std::string host = "");
 
+    /** Advertise a shared memory channel in the tcp addresses, for clients
+        on this host.  The addresses are republished if bindTcp() was
+        already called.  Clients that don't know about it keep connecting
+        over tcp.
+    */
+    void advertiseShm(const std::string & uri);
+
     /** Bind to the given zeromq uri, but don't publish it. */
     void bind(const std::string & address)
     {
@@ -685,6 +748,15 @@ private:
 
     /// Zeromq socket type
     int socketType;
+
+    /// Addresses published by bindTcp(), without the shared memory channel
+    Json::Value publishedTcp;
+
+    /// Shared memory channel to advertise to clients on this host
+    std::string shmUri;
+
+    /** Add the shared memory channel, if any, to the tcp addresses. */
+    Json::Value withShm(Json::Value config) const;
 };
 
 
@@ -699,7 +771,8 @@ struct ZmqNamedClientBus: public ZmqNamedEndpoint {
 
     ZmqNamedClientBus(std::shared_ptr<zmq::context_t> context,
                       double deadClientDelay = 5.0)
-        : ZmqNamedEndpoint(context), deadClientDelay(deadClientDelay)
+        : ZmqNamedEndpoint(context), deadClientDelay(deadClientDelay),
+          numShmClients(0)
     {
     }
 
@@ -707,10 +780,24 @@ struct ZmqNamedClientBus: public ZmqNamedEndpoint {
               const std::string & endpointName)
     {
         ZmqNamedEndpoint::init(config, ZMQ_XREP, endpointName);
+        shmPrefix = endpointName;
         addPeriodic("ZmqNamedClientBus::checkClient", 1.0,
                     [=] (uint64_t v) { this->onCheckClient(v); });
     }
 
+    /** Also accept connections over shared memory from clients on the same
+        host, and advertise it with the tcp addresses so that they will
+        prefer it over zeromq.  Returns the uri that is listened on.
+    */
+    std::string bindShm(size_t ringCapacity
+                        = ShmChannelListener::DefaultRingCapacity);
+
+    /** Number of clients currently connected over shared memory. */
+    size_t numShmConnections() const
+    {
+        return numShmClients;
+    }
+
     virtual ~ZmqNamedClientBus()
     {
         shutdown();
@@ -720,6 +807,13 @@ struct ZmqNamedClientBus: public ZmqNamedEndpoint {
     {
         MessageLoop::shutdown();
         ZmqNamedEndpoint::shutdown();
+
+        if (shmListener)
+            shmListener->shutdown();
+
+        std::unique_lock<ShmLock> guard(shmLock);
+        shmClients.clear();
+        numShmClients = 0;
     }
 
     /** How long until we decide a client that's not sending a heartbeat is
@@ -742,6 +836,23 @@ struct ZmqNamedClientBus: public ZmqNamedEndpoint {
                      const std::string & topic,
                      Args&&... args)
     {
+        if (numShmClients) {
+            auto channel = getShmClient(address);
+            if (channel) {
+                std::vector<std::string> message;
+                message.reserve(sizeof...(Args) + 1);
+                appendMessageParts(message, topic,
+                                   std::forward<Args>(args)...);
+                // Like a zeromq router socket at its high water mark, we
+                // drop rather than block when the client is too slow
+                if (!channel->send(message))
+                    LOG(ZmqLogs::error)
+                        << "dropping " << topic << " for " << address
+                        << ": shared memory ring is full" << std::endl;
+                return;
+            }
+        }
+
         ZmqNamedEndpoint::sendMessage(address, topic,
                                       std::forward<Args>(args)...);
     }
@@ -824,9 +935,40 @@ private:
             if (onDisconnection)
                 onDisconnection(d);
             clientInfo.erase(d);
+            dropShmClient(d);
         }
     }
 
+    /** A client connected over shared memory. */
+    void onShmChannel(const std::string & identity,
+                      std::shared_ptr<ShmChannel> channel);
+
+    /** Forget about the shared memory channel to the given client. */
+    void dropShmClient(const std::string & identity);
+
+    std::shared_ptr<ShmChannel> getShmClient(const std::string & address) const
+    {
+        std::unique_lock<ShmLock> guard(shmLock);
+        auto it = shmClients.find(address);
+        if (it == shmClients.end())
+            return nullptr;
+        return it->second;
+    }
+
+    /// Prefix for the names of our shared memory channels
+    std::string shmPrefix;
+
+    std::shared_ptr<ShmChannelListener> shmListener;
+
+    typedef ML::Spinlock ShmLock;
+    mutable ShmLock shmLock;
+
+    /// Clients that are connected over shared memory, by identity
+    std::map<std::string, std::shared_ptr<ShmChannel> > shmClients;
+
+    /// Avoids taking the lock when nothing is connected over shared memory
+    std::atomic<int> numShmClients;
+
     struct ClientInfo {
         ClientInfo()
             : lastHeartbeat(Date::now())
@@ -977,9 +1119,13 @@ struct ZmqNamedProxy: public MessageLoop {
         {
             std::lock_guard<ZmqEventSource::SocketLock> guard(socketLock_);
 
-            if (connectionState == CONNECTED)
-                socket_->disconnect(connectedUri);
+            if (connectionState == CONNECTED) {
+                if (shmConnected)
+                    disconnectShm();
+                else socket_->disconnect(connectedUri);
+            }
 
+            shmConnected = false;
             connectionState = NOT_CONNECTED;
         }
 
@@ -992,6 +1138,20 @@ struct ZmqNamedProxy: public MessageLoop {
     }
 
 protected:
+    /** Connect over a shared memory channel advertised by a service on
+        the same host instead of over zeromq.  Returns false if that isn't
+        supported or possible, in which case zeromq is used.
+    */
+    virtual bool connectShm(const std::string & uri)
+    {
+        return false;
+    }
+
+    /** Tear down the connection made by connectShm(). */
+    virtual void disconnectShm()
+    {
+    }
+
     ConfigurationService::Watch serviceWatch, endpointWatch;
     std::shared_ptr<ConfigurationService> config;
     std::shared_ptr<zmq::context_t> context_;
@@ -1020,6 +1180,10 @@ protected:
     std::string endpointName;      ///< Name of endpoint to connect to
     std::string connectedService;  ///< Name of service we're connected to
     std::string connectedUri;      ///< URI we're connected to
+    std::string identity;          ///< Identity we connect with
+    /// Connected via connectShm().  Set under the socket lock by the loop
+    /// but read without it by the threads that send messages.
+    std::atomic<bool> shmConnected;
     bool local;
     int shardIndex;
 };
@@ -1038,12 +1202,12 @@ protected:
 struct ZmqNamedClientBusProxy : public ZmqNamedProxy {
 
     ZmqNamedClientBusProxy()
-        : timeout(2.0)
+        : timeout(2.0), useShm(true)
     {
     }
 
     ZmqNamedClientBusProxy(std::shared_ptr<zmq::context_t> context, int shardIndex = -1)
-        : ZmqNamedProxy(context, shardIndex), timeout(2.0)
+        : ZmqNamedProxy(context, shardIndex), timeout(2.0), useShm(true)
     {
     }
 
@@ -1057,16 +1221,14 @@ struct ZmqNamedClientBusProxy : public ZmqNamedProxy {
     {
         ZmqNamedProxy::init(config, ZMQ_XREQ, identity);
 
-        auto doMessage = [=] (const std::vector<std::string> & message)
-            {
-                const std::string & topic = message.at(0);
-                if (topic == "HEARTBEAT")
-                    this->lastHeartbeat = Date::now();
-                else handleMessage(message);
-            };
-
         addSource("ZmqNamedClientBusProxy::doMessage",
-                  std::make_shared<ZmqEventSource>(socket(), doMessage, socketLock()));
+                  std::make_shared<ZmqEventSource>
+                  (socket(),
+                   [=] (const std::vector<std::string> & message)
+                   {
+                       this->doMessage(message);
+                   },
+                   socketLock()));
  
         auto doHeartbeat = [=] (int64_t skipped)
             {
@@ -1082,6 +1244,31 @@ struct ZmqNamedClientBusProxy : public ZmqNamedProxy {
     {
         MessageLoop::shutdown();
         ZmqNamedProxy::shutdown();
+        shmChannel.reset();
+    }
+
+    /** Send a message to the service, over shared memory if we're connected
+        that way and otherwise over zeromq.
+    */
+    template<typename... Args>
+    void sendMessage(Args&&... args)
+    {
+        if (shmConnected) {
+            std::vector<std::string> message;
+            message.reserve(sizeof...(Args));
+            appendMessageParts(message, std::forward<Args>(args)...);
+
+            std::lock_guard<ZmqEventSource::SocketLock> guard(socketLock_);
+            if (shmChannel) {
+                if (!shmChannel->send(message))
+                    LOG(ZmqLogs::error)
+                        << "dropping message for " << connectedUri
+                        << ": shared memory ring is full" << std::endl;
+                return;
+            }
+        }
+
+        ZmqNamedProxy::sendMessage(std::forward<Args>(args)...);
     }
 
     virtual void onConnect(const std::string & where)
@@ -1112,6 +1299,26 @@ struct ZmqNamedClientBusProxy : public ZmqNamedProxy {
 
     Date lastHeartbeat;
     double timeout;
+
+    /** Whether to use a shared memory channel when the service is on the
+        same host and offers one.
+    */
+    bool useShm;
+
+protected:
+    virtual bool connectShm(const std::string & uri);
+    virtual void disconnectShm();
+
+private:
+    void doMessage(const std::vector<std::string> & message)
+    {
+        const std::string & topic = message.at(0);
+        if (topic == "HEARTBEAT")
+            this->lastHeartbeat = Date::now();
+        else handleMessage(message);
+    }
+
+    std::shared_ptr<ShmChannel> shmChannel;
 };
 
 
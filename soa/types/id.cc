@@ -5,12 +5,18 @@
 */
 
 #include "id.h"
+#include "jml/arch/arch.h"
 #include "jml/arch/bit_range_ops.h"
 #include "jml/arch/format.h"
 #include "jml/arch/exception.h"
 #include "jml/db/persistent.h"
 #include "jml/utils/exc_assert.h"
 #include "soa/jsoncpp/value.h"
+#include <cstring>
+
+#if JML_INTEL_ISA
+# include <emmintrin.h>
+#endif
 
 using namespace ML;
 using namespace std;
@@ -68,30 +74,117 @@ JML_ALWAYS_INLINE int base64ToDec(unsigned c)
     return base64ToDecLookups[c & 0x7f] * mask - 1 + mask;
 }
 
-inline int hexToDec3(int c)
+// Google's base64 alphabet, in ASCII order: 0-9A-Za-z-_
+static const signed char goog64ToDecLookups[128] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 62, -1, -1,
+     0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1,
+
+    -1, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24,
+    25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, -1, -1, -1, -1, 63,
+    -1, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 50,
+    51, 52, 53, 54, 55, 56, 57, 58, 59, 60, 61, -1, -1, -1, -1, -1,
+};
+
+JML_ALWAYS_INLINE int goog64ToDec(unsigned c)
+{
+    int mask = (c <= 0x7f);
+    return goog64ToDecLookups[c & 0x7f] * mask - 1 + mask;
+}
+
+/** Decode 16 hex characters (either case) into the 64 bit integer they
+    represent.  Returns false if any of them is not a hex digit.
+*/
+JML_ALWAYS_INLINE bool decodeHex16(const char * p, uint64_t & result)
+{
+#if JML_INTEL_ISA
+    __m128i c = _mm_loadu_si128((const __m128i *)p);
+
+    // Unsigned x <= k is max(x, k) == k
+    auto lessEqual = [] (__m128i x, char k)
+        {
+            __m128i kk = _mm_set1_epi8(k);
+            return _mm_cmpeq_epi8(_mm_max_epu8(x, kk), kk);
+        };
+
+    __m128i digits = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+    __m128i letters = _mm_sub_epi8(_mm_or_si128(c, _mm_set1_epi8(0x20)),
+                                   _mm_set1_epi8('a' - 10));
+    __m128i isDigit = lessEqual(digits, 9);
+    __m128i isLetter = lessEqual(_mm_sub_epi8(letters, _mm_set1_epi8(10)), 5);
+
+    if (_mm_movemask_epi8(_mm_or_si128(isDigit, isLetter)) != 0xffff)
+        return false;
+
+    __m128i nibbles = _mm_or_si128(_mm_and_si128(isDigit, digits),
+                                   _mm_and_si128(isLetter, letters));
+
+    // Each 16 bit lane holds the high nibble in its low byte and the low
+    // nibble in its high byte; combine them and pack down to bytes
+    __m128i low = _mm_and_si128(nibbles, _mm_set1_epi16(0xff));
+    __m128i bytes = _mm_or_si128(_mm_slli_epi16(low, 4),
+                                 _mm_srli_epi16(nibbles, 8));
+    bytes = _mm_packus_epi16(bytes, bytes);
+
+    result = __builtin_bswap64(_mm_cvtsi128_si64(bytes));
+    return true;
+#else
+    uint64_t val = 0;
+    int error = 0;
+    for (unsigned i = 0;  i < 16;  ++i) {
+        int v = hexToDec(p[i]);
+        error |= v;
+        val = (val << 4) | (v & 15);
+    }
+    result = val;
+    return error >= 0;
+#endif
+}
+
+/** Check that the 8 characters packed into the word are all decimal
+    digits.
+*/
+JML_ALWAYS_INLINE bool isEightDigits(uint64_t chars)
 {
-    int d = c & 0x1f;
-    int i = (c & 0x60) >> 5;
-    d += (i == 1) * -16;
-    d += (i >= 2) * 9;
-    bool h = __builtin_isxdigit(c);
-    return h * d - (!h);
+    return ((chars & 0xf0f0f0f0f0f0f0f0ULL)
+            | (((chars + 0x0606060606060606ULL) & 0xf0f0f0f0f0f0f0f0ULL) >> 4))
+        == 0x3333333333333333ULL;
 }
 
-inline int hexToDec2(int c)
+/** Convert 8 decimal digits, loaded little-endian into a word, into their
+    value with three multiplies rather than eight.
+*/
+JML_ALWAYS_INLINE uint64_t decodeEightDigits(uint64_t chars)
+{
+    chars = (chars & 0x0f0f0f0f0f0f0f0fULL) * 2561 >> 8;
+    chars = (chars & 0x00ff00ff00ff00ffULL) * 6553601 >> 16;
+    return (chars & 0x0000ffff0000ffffULL) * 42949672960001ULL >> 32;
+}
+
+/** Parse a string of decimal digits, eight at a time.  Returns false if
+    there is a non-digit character.  Overflow wraps around.
+*/
+template<typename Int>
+bool decodeDecimal(const char * p, size_t len, Int & result)
 {
-    int v;
-
-    if (c >= '0' && c <= '9')
-        v = c - '0';
-    else if (c >= 'a' && c <= 'f')
-        v = c + 10 - 'a';
-    else if (c >= 'A' && c <= 'F')
-        v = c + 10 - 'A';
-    else
-        v = -1;
-
-    return v;
+    Int val = 0;
+    size_t i = 0;
+    for (;  i + 8 <= len;  i += 8) {
+        uint64_t chars;
+        std::memcpy(&chars, p + i, 8);
+        if (!isEightDigits(chars))
+            return false;
+        val = val * 100000000 + decodeEightDigits(chars);
+    }
+    for (;  i < len;  ++i) {
+        unsigned d = (unsigned char)p[i] - '0';
+        if (d > 9)
+            return false;
+        val = val * 10 + d;
+    }
+    result = val;
+    return true;
 }
 
 void
@@ -145,38 +238,25 @@ parse(const char * value, size_t len, Type type)
         if (value[18] != '-') break;
         if (value[23] != '-') break;
 
-        unsigned f1;
-        short f2, f3, f4;
-        unsigned long long f5;
-
-        const char * p = value;
-        bool failed = false;
-
-        auto scanRange = [&] (int start, int len) -> unsigned long long
-            {
-                unsigned long long val = 0;
-                for (unsigned i = start;  i != start + len;  ++i) {
-                    int c = p[i];
-                    int v = hexToDec(c);
-                    if (v == -1) {
-                        failed = true;
-                        return val;
-                    }
-                    val = (val << 4) + v;
-                }
-                return val;
-            };
+        // Gather the 32 hex digits together so they can be decoded
+        // 16 at a time
+        char digits[32];
+        std::memcpy(digits,      value,      8);
+        std::memcpy(digits + 8,  value + 9,  4);
+        std::memcpy(digits + 12, value + 14, 4);
+        std::memcpy(digits + 16, value + 19, 4);
+        std::memcpy(digits + 20, value + 24, 12);
 
-        f1 = scanRange(0, 8);
-        f2 = scanRange(9, 4);
-        f3 = scanRange(14, 4);
-        if (failed) break;
-        f4 = scanRange(19, 4);
-        f5 = scanRange(24, 12);
-        if (failed) break;
+        uint64_t high, low;
+        if (!decodeHex16(digits, high) || !decodeHex16(digits + 16, low))
+            break;
 
         r.type = UUID;
-        r.f1 = f1;  r.f2 = f2;  r.f3 = f3;  r.f4 = f4;  r.f5 = f5;
+        r.f1 = high >> 32;
+        r.f2 = high >> 16;
+        r.f3 = high;
+        r.f4 = low >> 48;
+        r.f5 = low;
         //r.val1 = ((uint64_t)f1 << 32) | ((uint64_t)f2 << 16) | f3;
         //r.val2 = ((uint64_t)f4 << 48) | f5;
         finish();
@@ -190,30 +270,14 @@ parse(const char * value, size_t len, Type type)
         // Google ID: --> CAESEAYra3NIxLT9C8twKrzqaA
 
         __uint128_t res = 0;
-
-        auto b64Decode = [] (int c) -> int
-            {
-                if (c >= '0' && c <= '9')
-                    return c - '0';
-                else if (c >= 'A' && c <= 'Z')
-                    return 10 + c - 'A';
-                else if (c >= 'a' && c <= 'z')
-                    return 36 + c - 'a';
-                else if (c == '-')
-                    return 62;
-                else if (c == '_')
-                    return 63;
-                else return -1;
-            };
-
-        bool error = false;
-        for (unsigned i = 5;  i < 26 && !error;  ++i) {
-            int v = b64Decode(value[i]);
-            if (v == -1) error = true;
-            res = (res << 6) | v;
+        int error = 0;
+        for (unsigned i = 5;  i < 26;  ++i) {
+            int v = goog64ToDec(value[i]);
+            error |= v;
+            res = (res << 6) | (v & 63);
         }
 
-        if (!error) {
+        if (error >= 0) {
             r.type = GOOG128;
             r.val = res;
             finish();
@@ -225,64 +289,42 @@ parse(const char * value, size_t len, Type type)
         && value[0] != '0' && len < 40 /* TODO: better condition */) {
         // Try a big integer
         //ANID: --> 7394206091425759590
-        uint64_t res64(0);
-        bool error = false;
-
-        int maxLowLen = min(len, max64_base10_len);
-        for (unsigned i = 0; i < maxLowLen; ++i) {
-            if (!isdigit(value[i])) {
-                error = true;
-                break;
-            }
-            res64 = 10 * res64 + value[i] - '0';
-        }
-
-        if (!error) {
-            if (len <= max64_base10_len) {
+        if (len <= max64_base10_len) {
+            uint64_t res64;
+            if (decodeDecimal(value, len, res64)) {
                 r.type = BIGDEC;
                 r.val1 = res64;
                 finish();
                 return;
             }
-            else {
-                __uint128_t res128 = res64;
-                for (unsigned i = maxLowLen; i < len; ++i) {
-                    if (!isdigit(value[i])) {
-                        error = true;
-                        break;
-                    }
-                    res128 = res128 * 10 + value[i] - '0';
-                }
-                if (!error) {
-                    r.type = BIGDEC;
-                    r.val = res128;
-                    finish();
-                    return;
-                }
+        }
+        else {
+            __uint128_t res128;
+            if (decodeDecimal(value, len, res128)) {
+                r.type = BIGDEC;
+                r.val = res128;
+                finish();
+                return;
             }
         }
     }
 
     if ((type == UNKNOWN || type == BASE64_96) && len == 16) {
-        auto scanRange = [&] (const char * p, size_t l) -> int64_t
-            {
-                uint64_t res = 0;
-                for (unsigned i = 0;  i < l;  ++i) {
-                    int c = base64ToDec(p[i]);
-                    if (c == -1) return -1;
-                    res = res << 6 | c;
-                }
-                return res;
-            };
-        
-        int64_t high = scanRange(value, 8);
-        int64_t low  = scanRange(value + 8, 8);
+        uint64_t high = 0, low = 0;
+        int error = 0;
+        for (unsigned i = 0;  i < 8;  ++i) {
+            int ch = base64ToDec(value[i]);
+            int cl = base64ToDec(value[i + 8]);
+            error |= ch | cl;
+            high = (high << 6) | (ch & 63);
+            low = (low << 6) | (cl & 63);
+        }
 
-        if (low != -1 && high != -1) {
-            __int128_t val = high;
+        if (error >= 0) {
+            __uint128_t val = high;
             val <<= 48;
             val |= low;
-            
+
             r.type = BASE64_96;
             r.val = val;
             finish();
@@ -293,60 +335,41 @@ parse(const char * value, size_t len, Type type)
     //cerr << "len = " << len
     //     << " value = " << value << " type = " << (int)type << endl;
 
-    while ((type == UNKNOWN || type == HEX128LC) && len == 32) {
+    if ((type == UNKNOWN || type == HEX128LC) && len == 32) {
         uint64_t high, low;
+        if (decodeHex16(value, high) && decodeHex16(value + 16, low)) {
+            r.type = HEX128LC;
+            r.val1 = high;
+            r.val2 = low;
+            finish();
+            return;
+        }
+    }
 
-        const char * p = value;
-        bool failed = false;
-
-        auto scanRange = [&] (int start, int len) -> unsigned long long
-            {
-                uint64_t val = 0;
-                for (unsigned i = start;  i != start + len;  ++i) {
-                    int c = p[i];
-                    int v = hexToDec(c);
-
-                    //cerr << "c = " << c << " " << p[i] << " v = " << v << endl;
-
-                    if (v == -1) {
-                        failed = true;
-                        return val;
-                    }
-                    val = (val << 4) + v;
-                }
-
-                //cerr << "val = " << val << " failed = " << failed << endl;
-
-                return val;
-            };
-
-        high = scanRange(0, 16);
-        if (failed)
-            break;
-        low = scanRange(16, 16);
-        if (failed)
-            break;
+    // Fall back to string
+    r.initString(value, len);
+    finish();
+    return;
+}
 
-        r.type = HEX128LC;
-        r.val1 = high;
-        r.val2 = low;
-        finish();
+void
+Id::
+initString(const char * value, size_t len)
+{
+    type = STR;
+    if (len <= MaxInlineLength) {
+        val1 = val2 = 0;
+        shortLen = len;
+        std::copy(value, value + len, shortStr);
         return;
     }
 
-    // Fall back to string
-    r.type = STR;
-    r.len = len;
-    char * s = new char[r.len];
-    r.str = s;
-    r.ownstr = true;
-#if 0
-    memcpy(s, value, len);
-#else
+    shortLen = 0;
+    this->len = len;
+    char * s = new char[len];
+    str = s;
+    ownstr = true;
     std::copy(value, value + len, s);
-#endif
-    finish();
-    return;
 }
 
 const Id &
@@ -453,7 +476,7 @@ toString() const
     case COMPOUND2:
         return compoundId1().toString() + ":" + compoundId2().toString();
     case STR:
-        return std::string(str, str + len);
+        return std::string(stringData(), stringData() + stringLength());
     default:
         throw ML::Exception("unknown ID type");
     }
@@ -463,8 +486,11 @@ bool
 Id::
 complexEqual(const Id & other) const
 {
-    if (type == STR)
-        return len == other.len && (str == other.str || std::equal(str, str + len, other.str));
+    if (type == STR) {
+        size_t l = stringLength();
+        const char * s = stringData(), * os = other.stringData();
+        return l == other.stringLength() && (s == os || std::equal(s, s + l, os));
+    }
     else if (type == COMPOUND2) {
         return compoundId1() == other.compoundId1()
             && compoundId2() == other.compoundId2();
@@ -477,8 +503,11 @@ Id::
 complexLess(const Id & other) const
 {
     if (type == STR)
-        return std::lexicographical_compare(str, str + len,
-                                            other.str, other.str + other.len);
+        return std::lexicographical_compare(stringData(),
+                                            stringData() + stringLength(),
+                                            other.stringData(),
+                                            other.stringData()
+                                            + other.stringLength());
     else if (type == COMPOUND2) {
         return ML::less_all(compoundId1(), other.compoundId1(),
                             compoundId2(), other.compoundId2());
@@ -491,7 +520,7 @@ Id::
 complexHash() const
 {
     if (type == STR)
-        return CityHash64(str, len);
+        return CityHash64(stringData(), stringLength());
     else if (type == COMPOUND2) {
         return Hash128to64(make_pair(compoundId1().hash(),
                                      compoundId2().hash()));
@@ -507,6 +536,7 @@ complexDestroy()
 {
     if (type < STR) return;
     if (type == STR) {
+        if (shortLen) return;
         if (ownstr) delete[] str;
         str = 0;
         ownstr = false;
@@ -526,7 +556,7 @@ Id::
 complexFinishCopy()
 {
     if (type == STR) {
-        if (!ownstr) return;
+        if (shortLen || !ownstr) return;
         const char * oldStr = str;
         char * s = new char[len];
         str = s;
@@ -567,7 +597,7 @@ serialize(ML::DB::Store_Writer & store) const
         store.save_binary(&val2, 8);
         break;
     case STR:
-        store << string(str, str + len);
+        store << string(stringData(), stringData() + stringLength());
         break;
     case COMPOUND2:
         compoundId1().serialize(store);
@@ -635,11 +665,7 @@ reconstitute(ML::DB::Store_Reader & store)
     case STR: {
         std::string s;
         store >> s;
-        r.len = s.size();
-        r.ownstr = true;
-        char * s2 = new char[s.size()];
-        r.str = s2;
-        std::copy(s.begin(), s.end(), s2);
+        r.initString(s.c_str(), s.size());
         break;
     }
     case COMPOUND2: {
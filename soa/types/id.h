@@ -67,33 +67,36 @@ struct Id {
         UNKNOWN = 255
     };
 
+    /// Maximum length of a STR Id that is stored inline without allocation
+    static constexpr size_t MaxInlineLength = 16;
+
     Id()
-        : type(NONE), val1(0), val2(0)
+        : type(NONE), shortLen(0), val1(0), val2(0)
     {
     }
 
     ~Id()
     {
-        if (type >= STR)
+        if (isComplex())
             complexDestroy();
     }
 
     explicit Id(const std::string & value,
                 Type type = UNKNOWN)
-        : type(NONE), val1(0), val2(0)
+        : type(NONE), shortLen(0), val1(0), val2(0)
     {
         parse(value, type);
     }
     
     explicit Id(const char * value, size_t len,
                 Type type = UNKNOWN)
-        : type(NONE), val1(0), val2(0)
+        : type(NONE), shortLen(0), val1(0), val2(0)
     {
         parse(value, len, type);
     }
     
     explicit Id(uint64_t value):
-    		type(BIGDEC),
+    		type(BIGDEC), shortLen(0),
     		val1(value),val2(0)
     {
     }
@@ -101,46 +104,50 @@ struct Id {
 
     // Construct a compound ID from two others
     Id(const Id & underlying1, const Id & underlying2)
-        : type(COMPOUND2),
+        : type(COMPOUND2), shortLen(0),
           cmp1(new Id(underlying1)),
           cmp2(new Id(underlying2))
     {
     }
 
     Id(Id && other)
-        : type(other.type),
+        : type(other.type), shortLen(other.shortLen),
           val1(other.val1), val2(other.val2)
     {
         other.type = NONE;
+        other.shortLen = 0;
     }
 
     Id(const Id & other)
-        : type(other.type),
+        : type(other.type), shortLen(other.shortLen),
           val1(other.val1), val2(other.val2)
     {
-        if (other.type >= STR)
+        if (other.isComplex())
             complexFinishCopy();
     }
 
     Id & operator = (Id && other)
     {
-        if (type >= STR)
+        if (isComplex())
             complexDestroy();
         type = other.type;
+        shortLen = other.shortLen;
         val1 = other.val1;
         val2 = other.val2;
         other.type = NONE;
+        other.shortLen = 0;
         return *this;
     }
 
     Id & operator = (const Id & other)
     {
-        if (type >= STR)
+        if (isComplex())
             complexDestroy();
         type = other.type;
+        shortLen = other.shortLen;
         val1 = other.val1;
         val2 = other.val2;
-        if (other.type >= STR)
+        if (other.isComplex())
             complexFinishCopy();
         return *this;
     }
@@ -179,7 +186,12 @@ struct Id {
     {
         if (type != other.type) return false;
         if (type == NONE || type == NULLID) return true;
-        if (JML_UNLIKELY(type >= STR)) return complexEqual(other);
+        if (JML_UNLIKELY(type >= STR)) {
+            // Inline strings are zero padded, so compare like integers
+            if (shortLen || other.shortLen)
+                return shortLen == other.shortLen && val == other.val;
+            return complexEqual(other);
+        }
         return val == other.val;
     }
 
@@ -208,6 +220,29 @@ struct Id {
         return Hash128to64(std::make_pair(val1, val2));
     }
 
+    /** Does this Id hold out-of-line storage that needs to be deep copied
+        and freed?  Short strings are stored inline and don't.
+    */
+    bool isComplex() const
+    {
+        return JML_UNLIKELY(type >= STR) && !shortLen;
+    }
+
+    /// Return the characters of a STR Id
+    const char * stringData() const
+    {
+        return shortLen ? shortStr : str;
+    }
+
+    /// Return the length of a STR Id
+    size_t stringLength() const
+    {
+        return shortLen ? shortLen : len;
+    }
+
+    /// Initialize as a STR Id, inline if short enough
+    void initString(const char * value, size_t len);
+
     bool complexEqual(const Id & other) const;
     bool complexLess(const Id & other) const;
     uint64_t complexHash() const;
@@ -215,7 +250,8 @@ struct Id {
     void complexFinishCopy();
 
     uint8_t type;
-    uint8_t unused[3];
+    uint8_t shortLen;  ///< Length of an inline STR; 0 otherwise
+    uint8_t unused[2];
 
     union {
         // 128 byte integer
@@ -247,6 +283,9 @@ struct Id {
             const char * str;
         };
 
+        // short string, stored inline and zero padded
+        char shortStr[MaxInlineLength];
+
         // compound2
         struct {
             Id * cmp1;
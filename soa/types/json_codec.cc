@@ -0,0 +1,95 @@
+/* json_codec.cc
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Field name table for the compiled JSON codecs.
+*/
+
+#include "json_codec.h"
+
+
+using namespace std;
+
+
+namespace Datacratic {
+
+
+/*****************************************************************************/
+/* FIELD NAME TABLE                                                          */
+/*****************************************************************************/
+
+void
+FieldNameTable::
+init(const std::vector<std::string> & newNames)
+{
+    size_t maxLength = 0;
+    for (auto & n: newNames)
+        maxLength = std::max(maxLength, n.length());
+
+    vector<vector<int> > byLength(newNames.empty() ? 0 : maxLength + 1);
+    for (unsigned i = 0;  i < newNames.size();  ++i) {
+        auto & indexes = byLength[newNames[i].length()];
+        for (int j: indexes)
+            if (newNames[j] == newNames[i])
+                throw ML::Exception("field name '%s' is there twice",
+                                    newNames[i].c_str());
+        indexes.push_back(i);
+    }
+
+    vector<Bucket> newBuckets(byLength.size());
+    vector<int> newSlots;
+
+    for (unsigned len = 0;  len < byLength.size();  ++len) {
+        const vector<int> & indexes = byLength[len];
+        if (indexes.empty())
+            continue;
+
+        /* Start with a table twice the size of the number of names, and
+           try a few seeds at each size before doubling it.  The names are
+           distinct, so there is always a size that works.
+        */
+        uint32_t size = 1;
+        while (size < 2 * indexes.size())
+            size *= 2;
+        if (indexes.size() == 1)
+            size = 1;
+
+        vector<int> slots;
+        uint32_t seed = 0;
+
+        for (bool found = false;  !found;) {
+            for (unsigned attempt = 0;  attempt < 256 && !found;  ++attempt) {
+                seed = attempt * 0x9e3779b9U;
+                slots.assign(size, -1);
+                found = true;
+                for (int i: indexes) {
+                    uint32_t slot = hash(newNames[i].c_str(), len, seed)
+                        & (size - 1);
+                    if (slots[slot] != -1) {
+                        found = false;
+                        break;
+                    }
+                    slots[slot] = i;
+                }
+            }
+
+            if (!found) {
+                size *= 2;
+                if (size > 65536)
+                    throw ML::Exception("couldn't find a perfect hash for "
+                                        "the field names");
+            }
+        }
+
+        Bucket & bucket = newBuckets[len];
+        bucket.seed = seed;
+        bucket.mask = size - 1;
+        bucket.firstSlot = newSlots.size();
+        newSlots.insert(newSlots.end(), slots.begin(), slots.end());
+    }
+
+    buckets.swap(newBuckets);
+    slots.swap(newSlots);
+    names = newNames;
+}
+
+} // namespace Datacratic
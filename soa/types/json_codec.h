@@ -0,0 +1,750 @@
+/* json_codec.h                                                    -*- C++ -*-
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Structure descriptions that parse and print JSON through code generated
+   at compile time for the structure, rather than by walking the fields.
+*/
+
+#pragma once
+
+#include <typeinfo>
+#include <cstring>
+#include "basic_value_descriptions.h"
+
+
+namespace Datacratic {
+
+
+/*****************************************************************************/
+/* FIELD NAME TABLE                                                          */
+/*****************************************************************************/
+
+/** Perfect hash of a fixed set of field names onto their index.
+
+    The names are first split by their length, which is used as a direct
+    index the same way a switch on the length would be.  Within each length
+    the names are hashed with a seed that is searched for when the table is
+    built so that no two of them fall into the same slot, and so a lookup is
+    one hash and one comparison, with no allocation.
+*/
+struct FieldNameTable {
+
+    FieldNameTable()
+    {
+    }
+
+    FieldNameTable(const std::vector<std::string> & names)
+    {
+        init(names);
+    }
+
+    /** Build the table.  Throws if a name is there twice. */
+    void init(const std::vector<std::string> & names);
+
+    /** Return the index of the name, or -1 if it's not in the table. */
+    int find(const char * name, size_t len) const
+    {
+        if (len >= buckets.size())
+            return -1;
+
+        const Bucket & bucket = buckets[len];
+        if (bucket.firstSlot == -1)
+            return -1;
+
+        int index = slots[bucket.firstSlot + (hash(name, len, bucket.seed)
+                                              & bucket.mask)];
+        if (index == -1 || memcmp(names[index].c_str(), name, len) != 0)
+            return -1;
+        return index;
+    }
+
+    int find(const char * name) const
+    {
+        return find(name, strlen(name));
+    }
+
+    int find(const std::string & name) const
+    {
+        return find(name.c_str(), name.length());
+    }
+
+    size_t size() const
+    {
+        return names.size();
+    }
+
+    static uint32_t hash(const char * name, size_t len, uint32_t seed)
+    {
+        // FNV-1a, with the seed mixed into the offset basis
+        uint32_t result = 2166136261U ^ seed;
+        for (size_t i = 0;  i < len;  ++i) {
+            result ^= (unsigned char)name[i];
+            result *= 16777619U;
+        }
+        return result;
+    }
+
+private:
+    struct Bucket {
+        Bucket()
+            : seed(0), mask(0), firstSlot(-1)
+        {
+        }
+
+        uint32_t seed;
+        uint32_t mask;
+        int firstSlot;     ///< Where the slots start, or -1 if none
+    };
+
+    std::vector<Bucket> buckets;   ///< Indexed by the length of the name
+    std::vector<int> slots;        ///< Index of the name in each slot or -1
+    std::vector<std::string> names;
+};
+
+
+/*****************************************************************************/
+/* JSON CODEC TRAITS                                                         */
+/*****************************************************************************/
+
+/** How the code generated for a structure parses and prints a member of
+    type T, without going through its value description.
+
+    A member is only handled here when the description that it was
+    registered with is one whose behaviour these functions reproduce, which
+    inlineMode() checks and returns as a non-zero value that is passed back
+    in to the other functions.  Members of any other type, or with any
+    other description, go through their description as before.
+*/
+template<typename T>
+struct JsonCodecTraits {
+    static int inlineMode(const ValueDescription & desc)
+    {
+        return 0;
+    }
+
+    static void parse(T & val, int mode, JsonParsingContext & context)
+    {
+    }
+
+    static void print(const T & val, int mode, JsonPrintingContext & context)
+    {
+    }
+
+    static bool isDefault(const T & val, int mode)
+    {
+        return false;
+    }
+};
+
+/** Traits for the types whose only inlined description is their
+    DefaultDescription.
+*/
+template<typename T>
+struct JsonCodecDefaultTraits {
+    static int inlineMode(const ValueDescription & desc)
+    {
+        return typeid(desc) == typeid(DefaultDescription<T>);
+    }
+
+    static bool isDefault(const T & val, int mode)
+    {
+        return false;
+    }
+};
+
+#define DATACRATIC_JSON_CODEC_NUMBER(T, expect, write)                   \
+    template<>                                                          \
+    struct JsonCodecTraits<T>: public JsonCodecDefaultTraits<T> {       \
+        static void parse(T & val, int mode, JsonParsingContext & context) \
+        {                                                               \
+            val = context.expect();                                     \
+        }                                                               \
+                                                                        \
+        static void print(const T & val, int mode,                      \
+                          JsonPrintingContext & context)                \
+        {                                                               \
+            context.write(val);                                         \
+        }                                                               \
+    }
+
+DATACRATIC_JSON_CODEC_NUMBER(signed int, expectInt, writeInt);
+DATACRATIC_JSON_CODEC_NUMBER(unsigned int, expectInt, writeInt);
+DATACRATIC_JSON_CODEC_NUMBER(signed long, expectLong, writeLong);
+DATACRATIC_JSON_CODEC_NUMBER(unsigned long,
+                             expectUnsignedLong, writeUnsignedLong);
+DATACRATIC_JSON_CODEC_NUMBER(signed long long,
+                             expectLongLong, writeLongLong);
+DATACRATIC_JSON_CODEC_NUMBER(unsigned long long,
+                             expectUnsignedLongLong, writeUnsignedLongLong);
+DATACRATIC_JSON_CODEC_NUMBER(float, expectFloat, writeFloat);
+DATACRATIC_JSON_CODEC_NUMBER(double, expectDouble, writeDouble);
+DATACRATIC_JSON_CODEC_NUMBER(bool, expectBool, writeBool);
+
+#undef DATACRATIC_JSON_CODEC_NUMBER
+
+template<>
+struct JsonCodecTraits<std::string>
+    : public JsonCodecDefaultTraits<std::string> {
+
+    static void parse(std::string & val, int mode,
+                      JsonParsingContext & context)
+    {
+        val = context.expectStringAscii();
+    }
+
+    static void print(const std::string & val, int mode,
+                      JsonPrintingContext & context)
+    {
+        context.writeString(val);
+    }
+
+    static bool isDefault(const std::string & val, int mode)
+    {
+        return val.empty();
+    }
+};
+
+template<>
+struct JsonCodecTraits<Utf8String>
+    : public JsonCodecDefaultTraits<Utf8String> {
+
+    static void parse(Utf8String & val, int mode,
+                      JsonParsingContext & context)
+    {
+        val = context.expectStringUtf8();
+    }
+
+    static void print(const Utf8String & val, int mode,
+                      JsonPrintingContext & context)
+    {
+        context.writeStringUtf8(val);
+    }
+
+    static bool isDefault(const Utf8String & val, int mode)
+    {
+        return val.empty();
+    }
+};
+
+template<>
+struct JsonCodecTraits<Json::Value>
+    : public JsonCodecDefaultTraits<Json::Value> {
+
+    static void parse(Json::Value & val, int mode,
+                      JsonParsingContext & context)
+    {
+        Datacratic::parseJson(&val, context);
+    }
+
+    static void print(const Json::Value & val, int mode,
+                      JsonPrintingContext & context)
+    {
+        context.writeJson(val);
+    }
+
+    static bool isDefault(const Json::Value & val, int mode)
+    {
+        return val.isNull();
+    }
+};
+
+/** Ids are inlined for both the default description, which prints small
+    integer ids as numbers (mode 1), and the StringIdDescription, which
+    always prints them as strings (mode 2).
+*/
+template<>
+struct JsonCodecTraits<Id> {
+    static int inlineMode(const ValueDescription & desc)
+    {
+        if (typeid(desc) == typeid(DefaultDescription<Id>))
+            return 1;
+        if (typeid(desc) == typeid(StringIdDescription))
+            return 2;
+        return 0;
+    }
+
+    static void parse(Id & val, int mode, JsonParsingContext & context)
+    {
+        Datacratic::parseJson(&val, context);
+    }
+
+    static void print(const Id & val, int mode, JsonPrintingContext & context)
+    {
+        if (mode == 1 && val.type == Id::Type::BIGDEC && val.val2 == 0
+            && val.val1 <= std::numeric_limits<int32_t>::max())
+            context.writeInt(val.val1);
+        else context.writeString(val.toString());
+    }
+
+    static bool isDefault(const Id & val, int mode)
+    {
+        return !val.notNull();
+    }
+};
+
+template<>
+struct JsonCodecTraits<TaggedInt>
+    : public JsonCodecDefaultTraits<TaggedInt> {
+
+    static void parse(TaggedInt & val, int mode, JsonParsingContext & context)
+    {
+        if (context.isString()) {
+            std::string s = context.expectStringAscii();
+            val.val = boost::lexical_cast<int>(s);
+        }
+        else val.val = context.expectInt();
+    }
+
+    static void print(const TaggedInt & val, int mode,
+                      JsonPrintingContext & context)
+    {
+        context.writeInt(val.val);
+    }
+
+    static bool isDefault(const TaggedInt & val, int mode)
+    {
+        return val.val == -1;
+    }
+};
+
+template<int defValue>
+struct JsonCodecTraits<TaggedIntDef<defValue> >
+    : public JsonCodecDefaultTraits<TaggedIntDef<defValue> > {
+
+    static void parse(TaggedIntDef<defValue> & val, int mode,
+                      JsonParsingContext & context)
+    {
+        if (context.isString()) {
+            std::string s = context.expectStringAscii();
+            val.val = boost::lexical_cast<int>(s);
+        }
+        else val.val = context.expectInt();
+    }
+
+    static void print(const TaggedIntDef<defValue> & val, int mode,
+                      JsonPrintingContext & context)
+    {
+        context.writeInt(val.val);
+    }
+
+    static bool isDefault(const TaggedIntDef<defValue> & val, int mode)
+    {
+        return val.val == defValue;
+    }
+};
+
+template<>
+struct JsonCodecTraits<TaggedBool>
+    : public JsonCodecDefaultTraits<TaggedBool> {
+
+    static void parse(TaggedBool & val, int mode,
+                      JsonParsingContext & context)
+    {
+        if (context.isBool())
+            val.val = context.expectBool();
+        else val.val = context.expectInt();
+    }
+
+    static void print(const TaggedBool & val, int mode,
+                      JsonPrintingContext & context)
+    {
+        context.writeInt(val.val);
+    }
+
+    static bool isDefault(const TaggedBool & val, int mode)
+    {
+        return val.val == -1;
+    }
+};
+
+template<int defValue>
+struct JsonCodecTraits<TaggedBoolDef<defValue> >
+    : public JsonCodecDefaultTraits<TaggedBoolDef<defValue> > {
+
+    static void parse(TaggedBoolDef<defValue> & val, int mode,
+                      JsonParsingContext & context)
+    {
+        if (context.isBool())
+            val.val = context.expectBool();
+        else val.val = context.expectInt();
+    }
+
+    static void print(const TaggedBoolDef<defValue> & val, int mode,
+                      JsonPrintingContext & context)
+    {
+        context.writeInt(val.val);
+    }
+
+    static bool isDefault(const TaggedBoolDef<defValue> & val, int mode)
+    {
+        return val.val == defValue;
+    }
+};
+
+template<>
+struct JsonCodecTraits<TaggedDouble>
+    : public JsonCodecDefaultTraits<TaggedDouble> {
+
+    static void parse(TaggedDouble & val, int mode,
+                      JsonParsingContext & context)
+    {
+        val.val = context.expectDouble();
+    }
+
+    static void print(const TaggedDouble & val, int mode,
+                      JsonPrintingContext & context)
+    {
+        context.writeDouble(val.val);
+    }
+
+    static bool isDefault(const TaggedDouble & val, int mode)
+    {
+        return std::isnan(val.val);
+    }
+};
+
+template<int num, int den>
+struct JsonCodecTraits<TaggedDoubleDef<num, den> >
+    : public JsonCodecDefaultTraits<TaggedDoubleDef<num, den> > {
+
+    static void parse(TaggedDoubleDef<num, den> & val, int mode,
+                      JsonParsingContext & context)
+    {
+        val.val = context.expectDouble();
+    }
+
+    static void print(const TaggedDoubleDef<num, den> & val, int mode,
+                      JsonPrintingContext & context)
+    {
+        context.writeDouble(val.val);
+    }
+
+    static bool isDefault(const TaggedDoubleDef<num, den> & val, int mode)
+    {
+        return val.val == (double)num / den;
+    }
+};
+
+
+/*****************************************************************************/
+/* JSON CODEC FIELD                                                          */
+/*****************************************************************************/
+
+/** A member of a structure whose parsing and printing is generated at
+    compile time.  Normally named through the JSON_CODEC_FIELD macro.
+*/
+template<typename MemberPtr, MemberPtr Member>
+struct JsonCodecField;
+
+template<typename V, typename Base, V Base::* Member>
+struct JsonCodecField<V Base::*, Member> {
+    typedef V Value;
+    typedef JsonCodecTraits<V> Traits;
+
+    /** Offset of the member, calculated the same way that addField() does
+        so that the two can be matched up.
+    */
+    template<typename Struct>
+    static size_t offset()
+    {
+        Struct * p = nullptr;
+        return (size_t)&(p->*Member);
+    }
+
+    static const std::type_info & type()
+    {
+        return typeid(V);
+    }
+
+    static int inlineMode(const ValueDescription & desc)
+    {
+        return Traits::inlineMode(desc);
+    }
+
+    template<typename Struct>
+    static void parse(Struct * output, int mode, JsonParsingContext & context)
+    {
+        Traits::parse(output->*Member, mode, context);
+    }
+
+    template<typename Struct>
+    static void print(const Struct * input, int mode, const std::string & name,
+                      JsonPrintingContext & context)
+    {
+        const V & val = input->*Member;
+        if (Traits::isDefault(val, mode))
+            return;
+        context.startMember(name);
+        Traits::print(val, mode, context);
+    }
+};
+
+#define JSON_CODEC_FIELD(Struct, member)                                \
+    Datacratic::JsonCodecField<decltype(&Struct::member), &Struct::member>
+
+
+/** One field of a compiled structure, in the order in which the fields are
+    printed.
+*/
+struct JsonCodecEntry {
+    std::string name;
+    const ValueDescription::FieldDescription * field;
+    int compiled;       ///< Index in the list of compiled fields, or -1
+    int mode;           ///< Inline mode of the member, or 0 if not inlined
+};
+
+/** Selects the compiled field with the given index.  The recursion turns
+    into a chain of compares or a jump table once inlined, with the code of
+    each field inlined at its case.
+*/
+template<typename Struct, int I, typename... Fields>
+struct JsonCodecDispatch {
+    static void parse(const JsonCodecEntry & entry, Struct * output,
+                      JsonParsingContext & context)
+    {
+    }
+
+    static void print(const JsonCodecEntry & entry, const Struct * input,
+                      JsonPrintingContext & context)
+    {
+    }
+};
+
+template<typename Struct, int I, typename Field, typename... Rest>
+struct JsonCodecDispatch<Struct, I, Field, Rest...> {
+    static void parse(const JsonCodecEntry & entry, Struct * output,
+                      JsonParsingContext & context)
+    {
+        if (entry.compiled == I)
+            Field::parse(output, entry.mode, context);
+        else JsonCodecDispatch<Struct, I + 1, Rest...>
+                 ::parse(entry, output, context);
+    }
+
+    static void print(const JsonCodecEntry & entry, const Struct * input,
+                      JsonPrintingContext & context)
+    {
+        if (entry.compiled == I)
+            Field::print(input, entry.mode, entry.name, context);
+        else JsonCodecDispatch<Struct, I + 1, Rest...>
+                 ::print(entry, input, context);
+    }
+};
+
+
+/*****************************************************************************/
+/* COMPILED STRUCTURE DESCRIPTION                                            */
+/*****************************************************************************/
+
+/** Structure description that parses and prints its JSON through code
+    generated for the structure.
+
+    The description is set up with addField() exactly as for a
+    StructureDescription, and then compile() is called at the end of the
+    constructor with the members to generate code for:
+
+        compile<JSON_CODEC_FIELD(Bid, id),
+                JSON_CODEC_FIELD(Bid, price)>();
+
+    Everything apart from parseJson() and printJson() still goes through
+    the fields that were added, and so do the fields that aren't listed, the
+    ones of a type that JsonCodecTraits doesn't know and the ones that were
+    added with a description of their own.  For the others, a key is looked
+    up with a FieldNameTable rather than the map and the member is parsed,
+    printed and checked for its default value by inlined code, so that the
+    only virtual call into the description is for the structure itself.
+
+    The JSON produced and accepted is the same as StructureDescription's;
+    onEntry(), onExit() and the unknown field handlers are called as
+    before.  If fields are added after compile(), the description goes back
+    to the generic code.
+*/
+template<typename Struct>
+struct CompiledStructureDescription
+    : public StructureDescription<Struct> {
+
+    CompiledStructureDescription(bool nullAccepted = false,
+                                 const std::string & structName = "")
+        : StructureDescription<Struct>(nullAccepted, structName),
+          parseFn(nullptr), printFn(nullptr), compiledFieldCount(0)
+    {
+    }
+
+    typedef ValueDescription::FieldDescription FieldDescription;
+
+    /** Generate the code for the given members, each of which must have
+        been added as a field.
+    */
+    template<typename... Fields>
+    void compile()
+    {
+        std::vector<size_t> offsets = { Fields::template offset<Struct>()... };
+        std::vector<const std::type_info *> types = { &Fields::type()... };
+        std::vector<int (*)(const ValueDescription &)> modes
+            = { &Fields::inlineMode... };
+        std::vector<bool> found(offsets.size());
+
+        std::vector<JsonCodecEntry> newEntries;
+        std::vector<std::string> names;
+
+        for (auto & it: this->orderedFields) {
+            const FieldDescription & fd = it->second;
+
+            JsonCodecEntry entry;
+            entry.name = fd.fieldName;
+            entry.field = &fd;
+            entry.compiled = -1;
+            entry.mode = 0;
+
+            for (unsigned i = 0;  i < offsets.size();  ++i) {
+                if (offsets[i] != fd.offset
+                    || *types[i] != *fd.description->type)
+                    continue;
+                entry.compiled = i;
+                entry.mode = modes[i](*fd.description);
+                found[i] = true;
+                break;
+            }
+
+            newEntries.push_back(entry);
+            names.push_back(entry.name);
+        }
+
+        for (unsigned i = 0;  i < found.size();  ++i) {
+            if (!found[i])
+                throw ML::Exception("compiled field %d of %s was not added "
+                                    "with addField()",
+                                    i, this->structName.c_str());
+        }
+
+        table.init(names);
+        entries.swap(newEntries);
+        parseFn = &parseObject<Fields...>;
+        printFn = &printObject<Fields...>;
+        compiledFieldCount = this->fields.size();
+    }
+
+    /** Whether the compiled code is used for parsing and printing. */
+    bool isCompiled() const
+    {
+        return parseFn && compiledFieldCount == this->fields.size();
+    }
+
+    virtual void parseJson(void * output, JsonParsingContext & context) const
+    {
+        if (!isCompiled()) {
+            StructureDescription<Struct>::parseJson(output, context);
+            return;
+        }
+
+        try {
+            if (!this->onEntry(output, context)) return;
+
+            if (this->nullAccepted && context.isNull()) {
+                context.expectNull();
+                return;
+            }
+
+            if (!context.isObject())
+                context.exception("expected structure of type "
+                                  + this->structName);
+
+            parseFn(*this, (Struct *)output, context);
+
+            this->onExit(output, context);
+        }
+        catch (const StructureDescriptionBase::Exception & exc) {
+            throw;
+        }
+        catch (const std::exception & exc) {
+            throw StructureDescriptionBase::Exception(context, exc.what());
+        }
+    }
+
+    virtual void printJson(const void * input,
+                           JsonPrintingContext & context) const
+    {
+        if (!isCompiled()) {
+            StructureDescription<Struct>::printJson(input, context);
+            return;
+        }
+
+        printFn(*this, (const Struct *)input, context);
+    }
+
+private:
+    typedef void (*ParseFn) (const CompiledStructureDescription & desc,
+                             Struct * output,
+                             JsonParsingContext & context);
+    typedef void (*PrintFn) (const CompiledStructureDescription & desc,
+                             const Struct * input,
+                             JsonPrintingContext & context);
+
+    ParseFn parseFn;
+    PrintFn printFn;
+    size_t compiledFieldCount;
+    std::vector<JsonCodecEntry> entries;
+    FieldNameTable table;
+
+    template<typename... Fields>
+    static void parseObject(const CompiledStructureDescription & desc,
+                            Struct * output,
+                            JsonParsingContext & context)
+    {
+        auto onMember = [&] ()
+            {
+                try {
+                    int i = desc.table.find(context.fieldNamePtr());
+                    if (i == -1) {
+                        context.onUnknownField(desc.owner);
+                        return;
+                    }
+
+                    const JsonCodecEntry & entry = desc.entries[i];
+                    if (entry.mode)
+                        JsonCodecDispatch<Struct, 0, Fields...>
+                            ::parse(entry, output, context);
+                    else entry.field->description
+                             ->parseJson(addOffset(output,
+                                                   entry.field->offset),
+                                         context);
+                }
+                catch (const StructureDescriptionBase::Exception & exc) {
+                    throw;
+                }
+                catch (const std::exception & exc) {
+                    throw StructureDescriptionBase::Exception(context,
+                                                              exc.what());
+                }
+            };
+
+        context.forEachMember(onMember);
+    }
+
+    template<typename... Fields>
+    static void printObject(const CompiledStructureDescription & desc,
+                            const Struct * input,
+                            JsonPrintingContext & context)
+    {
+        context.startObject();
+
+        for (const JsonCodecEntry & entry: desc.entries) {
+            if (entry.mode) {
+                JsonCodecDispatch<Struct, 0, Fields...>
+                    ::print(entry, input, context);
+                continue;
+            }
+
+            auto & fd = *entry.field;
+            auto mbr = addOffset(input, fd.offset);
+            if (fd.description->isDefault(mbr))
+                continue;
+            context.startMember(entry.name);
+            fd.description->printJson(mbr, context);
+        }
+
+        context.endObject();
+    }
+};
+
+} // namespace Datacratic
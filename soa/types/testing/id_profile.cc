@@ -5,8 +5,10 @@
 */
 
 #include <iostream>
+#include <vector>
 #include "soa/types/id.h"
 #include "soa/types/date.h"
+#include "jml/arch/format.h"
 
 using namespace ML;
 using namespace std;
@@ -105,37 +107,121 @@ void profile3()
          << 1.0 * n / elapsed << " per second)" << endl;
 }
 
-int main(int argc, char ** argv)
-{
-    //profile1();
-    //profile2();
-    //profile3();
+static const int nIterations = 10000000;
 
-    string ids[5] = {
-        "2fa07c3c-1ac1-4001-15e8-42e6000003a1",
-        "a78e802f-1ac1-4001-15e8-c6b0000003a0",
-        "f8ece33b-1ac1-4001-15e8-42e6000003a1",
-        "e46ead3d-1ac1-4001-15e8-ade2000003a1",
-        "7081463e-1ac1-4001-15e8-01e8000003a0"
-    };
+void report(const std::string & name, const char * what, Date before)
+{
+    double elapsed = Date::now().secondsSince(before);
+    cerr << ML::format("%-10s %-6s %12.0f per second (%6.1fns each)",
+                       name.c_str(), what,
+                       1.0 * nIterations / elapsed,
+                       1e9 * elapsed / nIterations)
+         << endl;
+}
 
-    int nids = 5;
+/** Time copying and hashing a set of Ids, alone and as the pairs that are
+    used as keys in the post auction loop.
+*/
+void profileIds(const std::string & name, const std::vector<Id> & ids)
+{
+    int nids = ids.size();
 
     Date before = Date::now();
-    
-    int n = 10000000;
-    
-    for (unsigned i = 0;  i < n;  ++i) {
+    for (unsigned i = 0;  i < nIterations;  ++i) {
         Id id(ids[i % nids]);
-        //if (id.type != Id::UUID)
-        //    cerr << "bad type" << endl;
-        //if (id.toString() != ids[i % nids])
-        //    cerr << "bad parse" << endl;
     }
+    report(name, "copy", before);
 
-    Date after = Date::now();
-    double elapsed = after.secondsSince(before);
-    
-    cerr << "processed " << n << " in " << elapsed << "s ("
-         << 1.0 * n / elapsed << " per second)" << endl;
+    uint64_t total = 0;
+    before = Date::now();
+    for (unsigned i = 0;  i < nIterations;  ++i) {
+        total += ids[i % nids].hash();
+    }
+    report(name, "hash", before);
+
+    before = Date::now();
+    for (unsigned i = 0;  i < nIterations;  ++i) {
+        total += Hash128to64(std::make_pair(ids[i % nids].hash(),
+                                            ids[(i + 1) % nids].hash()));
+    }
+    report(name, "pair", before);
+
+    if (total == 0)
+        cerr << "hash total was zero" << endl;
+}
+
+/** Time parsing a set of strings, which should all parse to the given
+    type, then profile the resulting Ids.
+*/
+void profileType(const std::string & name, Id::Type type,
+                 const std::vector<std::string> & strings)
+{
+    int nstrings = strings.size();
+
+    std::vector<Id> ids;
+    for (auto & s: strings) {
+        ids.push_back(Id(s));
+        if (ids.back().type != type)
+            cerr << "bad type for " << s << endl;
+    }
+
+    Date before = Date::now();
+    for (unsigned i = 0;  i < nIterations;  ++i) {
+        Id id(strings[i % nstrings]);
+    }
+    report(name, "parse", before);
+
+    profileIds(name, ids);
+}
+
+int main(int argc, char ** argv)
+{
+    //profile1();
+    //profile2();
+    //profile3();
+
+    profileType("UUID", Id::UUID, {
+            "2fa07c3c-1ac1-4001-15e8-42e6000003a1",
+            "a78e802f-1ac1-4001-15e8-c6b0000003a0",
+            "f8ece33b-1ac1-4001-15e8-42e6000003a1",
+            "e46ead3d-1ac1-4001-15e8-ade2000003a1",
+            "7081463e-1ac1-4001-15e8-01e8000003a0" });
+
+    profileType("GOOG128", Id::GOOG128, {
+            "CAESEAYra3NIxLT9C8twKrzqaA",
+            "CAESEHJ6pC0vzdUDmQMy2bmL0F",
+            "CAESEFbGQ2dLPkD5QyLSKoL6Nj",
+            "CAESENpXw6ChXl2GSWOpTXDfIB" });
+
+    profileType("BIGDEC", Id::BIGDEC, {
+            "7394206091425759590",
+            "394206091425759590",
+            "999999999999",
+            "123456789012345678901234567890" });
+
+    profileType("BASE64_96", Id::BASE64_96, {
+            "++++VpWW999gvYaw",
+            "+++/uRXa99O0T0+w",
+            "+++0Rk1K99Oe/3aw",
+            "jDhUJMWW9997leCw" });
+
+    profileType("HEX128LC", Id::HEX128LC, {
+            "0123456789abcdeffedcba9876543210",
+            "a78e802f1ac1400115e8c6b0000003a0",
+            "f8ece33b1ac1400115e842e6000003a1" });
+
+    profileType("STR", Id::STR, {
+            "hello",
+            "user:12345",
+            "x-4f2a",
+            "short.id.14ch" });
+
+    profileType("LONGSTR", Id::STR, {
+            "this is a rather longer string id",
+            "http://www.example.com/some/page.html",
+            "yet-another-user-id-that-wont-fit-inline" });
+
+    profileIds("COMPOUND2", {
+            Id(Id("hello"), Id("world")),
+            Id(Id("0828398c-5965-11e0-84c8-0026b937c8e1"), Id("1234")) });
 }
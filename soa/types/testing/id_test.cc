@@ -329,3 +329,100 @@ BOOST_AUTO_TEST_CASE( test_compound_id )
 {
     Id id(Id("hello"), Id("world"));
 }
+
+BOOST_AUTO_TEST_CASE( test_short_string_id_inline )
+{
+    string s16 = "abcdefghijklmn-p";
+    string s17 = "abcdefghijklmn-pq";
+
+    Id id16(s16), id17(s17);
+    BOOST_CHECK_EQUAL(id16.type, Id::STR);
+    BOOST_CHECK_EQUAL(id17.type, Id::STR);
+    BOOST_CHECK(!id16.isComplex());
+    BOOST_CHECK(id17.isComplex());
+    BOOST_CHECK_EQUAL(id16.toString(), s16);
+    BOOST_CHECK_EQUAL(id17.toString(), s17);
+    checkSerializeReconstitute(id16);
+    checkSerializeReconstitute(id17);
+
+    // Inline and out of line strings hash and sort as strings
+    BOOST_CHECK_EQUAL(id16.hash(), CityHash64(s16.c_str(), s16.size()));
+    BOOST_CHECK_EQUAL(id17.hash(), CityHash64(s17.c_str(), s17.size()));
+    BOOST_CHECK_LT(id16, id17);
+    BOOST_CHECK_LT(Id("abcdefghijklmnopa"), Id("abcdefghijklmnp"));
+    BOOST_CHECK_NE(id16, id17);
+
+    // Embedded nulls are not confused with padding
+    Id withNull(string("ab\0", 3));
+    BOOST_CHECK_EQUAL(withNull.type, Id::STR);
+    BOOST_CHECK_NE(withNull, Id("ab"));
+    BOOST_CHECK_EQUAL(withNull.toString(), string("ab\0", 3));
+
+    Id copied = id16;
+    BOOST_CHECK_EQUAL(copied, id16);
+    copied = id17;
+    BOOST_CHECK_EQUAL(copied, id17);
+    copied = Id("hello");
+    BOOST_CHECK_EQUAL(copied, Id("hello"));
+    BOOST_CHECK_EQUAL(copied.toString(), "hello");
+
+    Id compound(id16, id17);
+    BOOST_CHECK_EQUAL(compound.toString(), s16 + ":" + s17);
+}
+
+BOOST_AUTO_TEST_CASE( test_hex_id_formats )
+{
+    string lc = "0123456789abcdeffedcba9876543210";
+    Id id(lc);
+    BOOST_CHECK_EQUAL(id.type, Id::HEX128LC);
+    BOOST_CHECK_EQUAL(id.val1, 0x0123456789abcdefULL);
+    BOOST_CHECK_EQUAL(id.val2, 0xfedcba9876543210ULL);
+    BOOST_CHECK_EQUAL(id.toString(), lc);
+
+    // Upper case digits parse to the same value
+    Id uc("0123456789ABCDEFFEDCBA9876543210");
+    BOOST_CHECK_EQUAL(uc.type, Id::HEX128LC);
+    BOOST_CHECK_EQUAL(uc, id);
+
+    // Characters either side of the hex ranges fall back to strings
+    for (const char * bad: { "0123456789abcdeffedcba987654321g",
+                             "/123456789abcdeffedcba9876543210",
+                             "0123456789abcde:fedcba9876543210",
+                             "0123456789abcdef`edcba9876543210",
+                             "0123456789abcdeffedcba987654321@",
+                             "0123456789abcdeffedcba987654321G" }) {
+        BOOST_CHECK_EQUAL(Id(bad).type, Id::STR);
+        BOOST_CHECK_EQUAL(Id(bad).toString(), bad);
+    }
+
+    string uuid = "0828398C-5965-11E0-84C8-0026B937C8E1";
+    Id uuidId(uuid);
+    BOOST_CHECK_EQUAL(uuidId.type, Id::UUID);
+    BOOST_CHECK_EQUAL(uuidId, Id("0828398c-5965-11e0-84c8-0026b937c8e1"));
+    BOOST_CHECK_EQUAL(uuidId.f1, 0x0828398c);
+    BOOST_CHECK_EQUAL(uuidId.f5, 0x0026b937c8e1ULL);
+
+    string badUuid = "0828398c-5965-11e0-84x8-0026b937c8e1";
+    BOOST_CHECK_EQUAL(Id(badUuid).type, Id::STR);
+    BOOST_CHECK_EQUAL(Id(badUuid).toString(), badUuid);
+}
+
+BOOST_AUTO_TEST_CASE( test_bigdec_lengths )
+{
+    // Exercise every length across the 8 digit chunks and the switch from
+    // 64 to 128 bits
+    string digits = "123456789012345678901234567890123456789";
+    for (unsigned len = 1;  len < digits.size();  ++len) {
+        string s = digits.substr(0, len);
+        Id id(s);
+        BOOST_CHECK_EQUAL(id.type, Id::BIGDEC);
+        BOOST_CHECK_EQUAL(id.toString(), s);
+
+        // A non-digit anywhere makes it a string
+        for (unsigned i = 0;  i < len;  ++i) {
+            string s2 = s;
+            s2[i] = (i % 2 ? ':' : '/');
+            BOOST_CHECK_NE(Id(s2).type, Id::BIGDEC);
+        }
+    }
+}
@@ -0,0 +1,303 @@
+/* json_codec_test.cc
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Test that the compiled JSON codecs parse and print the same as the
+   structure descriptions they are compiled from.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include <sstream>
+#include <string>
+
+#include "soa/types/json_codec.h"
+#include "jml/arch/format.h"
+
+
+using namespace std;
+using namespace ML;
+using namespace Datacratic;
+
+
+namespace {
+
+struct Inner {
+    Inner()
+        : count(0)
+    {
+    }
+
+    int count;
+    std::vector<std::string> tags;
+};
+
+struct Record {
+    Record()
+        : flag(false), ratio(0.0), big(0)
+    {
+    }
+
+    Id id;
+    Id sid;
+    std::string name;
+    Utf8String label;
+    bool flag;
+    double ratio;
+    long long big;
+    TaggedInt w;
+    TaggedBoolDef<0> instl;
+    TaggedDouble price;
+    TaggedDoubleDef<0> floor;
+    Json::Value ext;
+    Inner inner;
+    std::vector<int> sizes;
+    std::string custom;
+    int hidden;
+};
+
+/** Prints the custom field upper case, so that we can tell that it went
+    through its own description. */
+struct UpperCaseDescription
+    : public ValueDescriptionI<std::string, ValueKind::STRING> {
+
+    virtual void parseJsonTyped(std::string * val,
+                                JsonParsingContext & context) const
+    {
+        *val = context.expectStringAscii();
+    }
+
+    virtual void printJsonTyped(const std::string * val,
+                                JsonPrintingContext & context) const
+    {
+        string s = *val;
+        for (auto & c: s)
+            c = toupper(c);
+        context.writeString(s);
+    }
+};
+
+struct InnerDescription
+    : public StructureDescription<Inner> {
+    InnerDescription()
+    {
+        addField("count", &Inner::count, "count");
+        addField("tags", &Inner::tags, "tags");
+    }
+};
+
+/** Adds the fields of Record, and the compiled version generates code
+    for most of them. */
+template<typename Base>
+struct RecordDescriptionT: public Base {
+    RecordDescriptionT()
+    {
+        this->addField("id", &Record::id, "id");
+        this->addField("sid", &Record::sid, "string id",
+                       new StringIdDescription());
+        this->addField("name", &Record::name, "name");
+        this->addField("label", &Record::label, "label");
+        this->addField("flag", &Record::flag, "flag");
+        this->addField("ratio", &Record::ratio, "ratio");
+        this->addField("big", &Record::big, "big");
+        this->addField("w", &Record::w, "w");
+        this->addField("instl", &Record::instl, "instl");
+        this->addField("price", &Record::price, "price");
+        this->addField("floor", &Record::floor, "floor");
+        this->addField("ext", &Record::ext, "ext");
+        this->addField("inner", &Record::inner, "inner",
+                       new InnerDescription());
+        this->addField("sizes", &Record::sizes, "sizes");
+        this->addField("custom", &Record::custom, "custom",
+                       new UpperCaseDescription());
+        // Not compiled
+        this->addField("hidden", &Record::hidden, "hidden");
+    }
+};
+
+typedef RecordDescriptionT<StructureDescription<Record> >
+    RuntimeRecordDescription;
+
+struct CompiledRecordDescription
+    : public RecordDescriptionT<CompiledStructureDescription<Record> > {
+    CompiledRecordDescription()
+    {
+        compile<JSON_CODEC_FIELD(Record, id),
+                JSON_CODEC_FIELD(Record, sid),
+                JSON_CODEC_FIELD(Record, name),
+                JSON_CODEC_FIELD(Record, label),
+                JSON_CODEC_FIELD(Record, flag),
+                JSON_CODEC_FIELD(Record, ratio),
+                JSON_CODEC_FIELD(Record, big),
+                JSON_CODEC_FIELD(Record, w),
+                JSON_CODEC_FIELD(Record, instl),
+                JSON_CODEC_FIELD(Record, price),
+                JSON_CODEC_FIELD(Record, floor),
+                JSON_CODEC_FIELD(Record, ext),
+                JSON_CODEC_FIELD(Record, inner),
+                JSON_CODEC_FIELD(Record, sizes),
+                JSON_CODEC_FIELD(Record, custom)>();
+    }
+};
+
+template<typename Desc>
+string print(const Desc & desc, const Record & record)
+{
+    ostringstream stream;
+    StreamJsonPrintingContext context(stream);
+    desc.printJson(&record, context);
+    return stream.str();
+}
+
+template<typename Desc>
+Record parse(const Desc & desc, const string & json)
+{
+    Record result;
+    StreamingJsonParsingContext context(json, json.c_str(),
+                                        json.c_str() + json.size());
+    desc.parseJson(&result, context);
+    return result;
+}
+
+} // file scope
+
+BOOST_AUTO_TEST_CASE( test_field_name_table )
+{
+    vector<string> names = { "id", "w", "h", "impid", "price", "adid",
+                             "nurl", "adm", "iurl", "cid", "crid", "ext",
+                             "attr", "adomain", "", "x" };
+    FieldNameTable table(names);
+
+    for (unsigned i = 0;  i < names.size();  ++i)
+        BOOST_CHECK_EQUAL(table.find(names[i]), i);
+
+    BOOST_CHECK_EQUAL(table.find("ids"), -1);
+    BOOST_CHECK_EQUAL(table.find("di"), -1);
+    BOOST_CHECK_EQUAL(table.find("y"), -1);
+    BOOST_CHECK_EQUAL(table.find("averyveryverylongname"), -1);
+    BOOST_CHECK_EQUAL(table.find("ext", 2), -1);
+
+    // Lots of names of the same length
+    vector<string> many;
+    for (unsigned i = 0;  i < 1000;  ++i)
+        many.push_back(ML::format("f%04d", i));
+    FieldNameTable table2(many);
+    for (unsigned i = 0;  i < many.size();  ++i)
+        BOOST_CHECK_EQUAL(table2.find(many[i]), i);
+    BOOST_CHECK_EQUAL(table2.find("f1000"), -1);
+
+    BOOST_CHECK_THROW(FieldNameTable({ "a", "b", "a" }), ML::Exception);
+}
+
+BOOST_AUTO_TEST_CASE( test_compiled_matches_runtime )
+{
+    RuntimeRecordDescription runtime;
+    CompiledRecordDescription compiled;
+
+    BOOST_CHECK(compiled.isCompiled());
+
+    Record empty;
+    BOOST_CHECK_EQUAL(print(compiled, empty), print(runtime, empty));
+
+    Record record;
+    record.id = Id(12);
+    record.sid = Id(13);
+    record.name = "hello \"world\"";
+    record.label = Utf8String("caf\xc3\xa9");
+    record.flag = true;
+    record.ratio = 0.25;
+    record.big = 1LL << 40;
+    record.w.val = 300;
+    record.instl.val = 1;
+    record.price.val = 1.5;
+    record.floor.val = 0.0;
+    record.ext["a"] = 1;
+    record.inner.count = 3;
+    record.inner.tags = { "x", "y" };
+    record.sizes = { 1, 2, 3 };
+    record.custom = "shout";
+    record.hidden = 7;
+
+    string expected = print(runtime, record);
+    string json = print(compiled, record);
+    BOOST_CHECK_EQUAL(json, expected);
+    cerr << json << endl;
+
+    Record parsedRuntime = parse(runtime, json);
+    Record parsedCompiled = parse(compiled, json);
+
+    BOOST_CHECK_EQUAL(print(runtime, parsedCompiled),
+                      print(runtime, parsedRuntime));
+    BOOST_CHECK_EQUAL(parsedCompiled.id, record.id);
+    BOOST_CHECK_EQUAL(parsedCompiled.sid, record.sid);
+    BOOST_CHECK_EQUAL(parsedCompiled.name, record.name);
+    BOOST_CHECK_EQUAL(parsedCompiled.big, record.big);
+    BOOST_CHECK_EQUAL(parsedCompiled.w.val, 300);
+    BOOST_CHECK_EQUAL(parsedCompiled.inner.tags.size(), 2);
+    BOOST_CHECK_EQUAL(parsedCompiled.custom, "SHOUT");
+    BOOST_CHECK_EQUAL(parsedCompiled.hidden, 7);
+
+    // Tagged values can be given as strings and bools
+    Record tagged = parse(compiled, "{\"w\":\"40\",\"instl\":true}");
+    BOOST_CHECK_EQUAL(tagged.w.val, 40);
+    BOOST_CHECK_EQUAL(tagged.instl.val, 1);
+}
+
+BOOST_AUTO_TEST_CASE( test_compiled_unknown_fields )
+{
+    CompiledRecordDescription compiled;
+
+    string json = "{\"id\":1,\"unknown\":{\"x\":[1,2]},\"name\":\"n\"}";
+
+    // By default, unknown fields are an error
+    BOOST_CHECK_THROW(parse(compiled, json), ML::Exception);
+
+    // With a handler, the handler is called
+    int numUnknown = 0;
+    compiled.onUnknownField = [&] (Record * record,
+                                   JsonParsingContext & context)
+        {
+            BOOST_CHECK_EQUAL(context.fieldName(), "unknown");
+            context.skip();
+            ++numUnknown;
+        };
+
+    Record record = parse(compiled, json);
+    BOOST_CHECK_EQUAL(numUnknown, 1);
+    BOOST_CHECK_EQUAL(record.id, Id(1));
+    BOOST_CHECK_EQUAL(record.name, "n");
+}
+
+BOOST_AUTO_TEST_CASE( test_compiled_field_added_later )
+{
+    struct Desc: public CompiledStructureDescription<Record> {
+        Desc()
+        {
+            addField("id", &Record::id, "id");
+            compile<JSON_CODEC_FIELD(Record, id)>();
+            addField("name", &Record::name, "name");
+        }
+    };
+
+    Desc desc;
+    BOOST_CHECK(!desc.isCompiled());
+
+    Record record = parse(desc, "{\"id\":\"hello\",\"name\":\"n\"}");
+    BOOST_CHECK_EQUAL(record.id, Id("hello"));
+    BOOST_CHECK_EQUAL(record.name, "n");
+}
+
+BOOST_AUTO_TEST_CASE( test_compiled_field_not_added )
+{
+    struct Desc: public CompiledStructureDescription<Record> {
+        Desc()
+        {
+            addField("id", &Record::id, "id");
+            compile<JSON_CODEC_FIELD(Record, id),
+                    JSON_CODEC_FIELD(Record, name)>();
+        }
+    };
+
+    BOOST_CHECK_THROW(Desc(), ML::Exception);
+}
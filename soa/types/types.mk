@@ -32,6 +32,7 @@ LIBVALUE_DESCRIPTION_SOURCES := \
 	value_description.cc \
 	json_parsing.cc \
 	json_printing.cc \
+	json_codec.cc \
 	periodic_utils_value_descriptions.cc
 
 LIBVALUE_DESCRIPTION_LINK := \
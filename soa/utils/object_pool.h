@@ -0,0 +1,327 @@
+/* object_pool.h                                                   -*- C++ -*-
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Pools of fixed size memory blocks for objects that are created and
+   destroyed at a high rate, such as auctions.
+
+   Each thread keeps its own cache of free blocks, so allocating and freeing
+   is a few instructions with no locking in the common case.  Objects are
+   often freed on a different thread than the one that created them (eg, the
+   router's auction graveyard); the freeing thread's cache then fills up and
+   hands its blocks back in batches via a shared list, from which the
+   allocating thread refills its own cache.  The lock is only taken once per
+   batch.
+
+   Blocks are carved out of slabs that are never returned to the system, so
+   the memory used is bounded by the peak number of live objects.
+
+   There are three ways to use it:
+   - makePooled<T>(args...) is a drop-in for std::make_shared<T>(args...);
+     the object and its reference count share a single pooled block.
+   - PoolAllocator<T> is a standard allocator for the same.
+   - Deriving from PooledNew<T> makes "new T" and "delete" use the pool,
+     which is useful for objects created by code that can't be changed.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <stdlib.h>
+#include "jml/arch/exception.h"
+#include "jml/arch/spinlock.h"
+#include "jml/arch/thread_specific.h"
+#include "jml/compiler/compiler.h"
+
+
+namespace Datacratic {
+
+
+/*****************************************************************************/
+/* BLOCK POOL                                                                */
+/*****************************************************************************/
+
+/** Pool of blocks of Size bytes aligned on Align bytes.  There is one pool
+    per size and alignment for the whole process.
+*/
+
+template<size_t Size, size_t Align>
+struct BlockPool {
+
+    /// Number of blocks passed between threads at once
+    static constexpr size_t BatchSize = 128;
+
+    /// Size of each block, rounded up so that each is aligned
+    static constexpr size_t BlockSize
+        = ((Size < sizeof(void *) ? sizeof(void *) : Size) + Align - 1)
+        / Align * Align;
+
+    static void * allocate()
+    {
+        Cache & cache = getCache();
+        if (JML_UNLIKELY(!cache.head))
+            cache.refill();
+
+        Block * block = cache.head;
+        cache.head = block->next;
+        --cache.count;
+        return block;
+    }
+
+    static void deallocate(void * mem)
+    {
+        Cache & cache = getCache();
+        Block * block = reinterpret_cast<Block *>(mem);
+        block->next = cache.head;
+        cache.head = block;
+        if (JML_UNLIKELY(++cache.count >= 2 * BatchSize))
+            cache.spill(BatchSize);
+    }
+
+    /** Total number of blocks allocated from the system so far. */
+    static size_t numBlocks()
+    {
+        return getShared().numBlocks;
+    }
+
+private:
+    struct Block {
+        Block * next;
+    };
+
+    /** Free blocks that are available to every thread, in batches. */
+    struct Shared {
+        Shared()
+            : partial(nullptr), partialCount(0), numBlocks(0)
+        {
+        }
+
+        ML::Spinlock lock;
+        std::vector<Block *> batches;  ///< Each is BatchSize blocks
+        Block * partial;               ///< Incomplete batch
+        size_t partialCount;
+        std::atomic<size_t> numBlocks;
+    };
+
+    /** Free blocks private to one thread. */
+    struct Cache {
+        Cache()
+            : head(nullptr), count(0)
+        {
+        }
+
+        /// Give back our blocks when the thread exits
+        ~Cache()
+        {
+            while (count)
+                spill(std::min(count, BatchSize));
+        }
+
+        void refill()
+        {
+            Shared & shared = getShared();
+            {
+                std::unique_lock<ML::Spinlock> guard(shared.lock);
+                if (!shared.batches.empty()) {
+                    head = shared.batches.back();
+                    count = BatchSize;
+                    shared.batches.pop_back();
+                    return;
+                }
+            }
+
+            // Nothing to share; carve out a new slab
+            void * mem;
+            if (posix_memalign(&mem, Align < sizeof(void *)
+                                     ? sizeof(void *) : Align,
+                               BlockSize * BatchSize))
+                throw std::bad_alloc();
+
+            char * slab = reinterpret_cast<char *>(mem);
+            for (size_t i = 0;  i < BatchSize;  ++i) {
+                Block * block = reinterpret_cast<Block *>(slab + i * BlockSize);
+                block->next = head;
+                head = block;
+            }
+            count = BatchSize;
+            shared.numBlocks += BatchSize;
+        }
+
+        /** Move n blocks to the shared list. */
+        void spill(size_t n)
+        {
+            Block * batch = head;
+            Block * last = head;
+            for (size_t i = 1;  i < n;  ++i)
+                last = last->next;
+            head = last->next;
+            last->next = nullptr;
+            count -= n;
+
+            Shared & shared = getShared();
+            std::unique_lock<ML::Spinlock> guard(shared.lock);
+            if (n == BatchSize) {
+                shared.batches.push_back(batch);
+                return;
+            }
+
+            // Short batches only come from exiting threads; gather them
+            // until they make up a full batch.
+            while (batch) {
+                Block * next = batch->next;
+                batch->next = shared.partial;
+                shared.partial = batch;
+                batch = next;
+                if (++shared.partialCount == BatchSize) {
+                    shared.batches.push_back(shared.partial);
+                    shared.partial = nullptr;
+                    shared.partialCount = 0;
+                }
+            }
+        }
+
+        Block * head;
+        size_t count;
+    };
+
+    static Shared & getShared()
+    {
+        // Never destroyed, as blocks can be freed during static destruction
+        static Shared * shared = new Shared();
+        return *shared;
+    }
+
+    static Cache & getCache()
+    {
+        static ML::Thread_Specific<Cache, BlockPool> * cache
+            = new ML::Thread_Specific<Cache, BlockPool>();
+        return **cache;
+    }
+};
+
+template<size_t Size, size_t Align>
+constexpr size_t BlockPool<Size, Align>::BatchSize;
+
+template<size_t Size, size_t Align>
+constexpr size_t BlockPool<Size, Align>::BlockSize;
+
+
+/*****************************************************************************/
+/* POOL ALLOCATOR                                                            */
+/*****************************************************************************/
+
+/** Standard allocator that allocates single objects from a BlockPool. */
+
+template<typename T>
+struct PoolAllocator {
+    typedef T value_type;
+    typedef T * pointer;
+    typedef const T * const_pointer;
+    typedef T & reference;
+    typedef const T & const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    template<typename U>
+    struct rebind {
+        typedef PoolAllocator<U> other;
+    };
+
+    typedef BlockPool<sizeof(T), alignof(T)> Pool;
+
+    PoolAllocator()
+    {
+    }
+
+    template<typename U>
+    PoolAllocator(const PoolAllocator<U> &)
+    {
+    }
+
+    T * allocate(size_t n)
+    {
+        if (JML_UNLIKELY(n != 1))
+            return static_cast<T *>(::operator new(n * sizeof(T)));
+        return static_cast<T *>(Pool::allocate());
+    }
+
+    void deallocate(T * p, size_t n)
+    {
+        if (JML_UNLIKELY(n != 1))
+            ::operator delete(p);
+        else Pool::deallocate(p);
+    }
+
+    template<typename U, typename... Args>
+    void construct(U * p, Args &&... args)
+    {
+        new (p) U(std::forward<Args>(args)...);
+    }
+
+    template<typename U>
+    void destroy(U * p)
+    {
+        p->~U();
+    }
+
+    size_t max_size() const
+    {
+        return size_t(-1) / sizeof(T);
+    }
+
+    template<typename U>
+    bool operator == (const PoolAllocator<U> &) const
+    {
+        return true;
+    }
+
+    template<typename U>
+    bool operator != (const PoolAllocator<U> &) const
+    {
+        return false;
+    }
+};
+
+/** Equivalent of std::make_shared<T>(args...) that takes the memory for the
+    object and its reference count from a pool.  The object may be released
+    on any thread.
+*/
+template<typename T, typename... Args>
+std::shared_ptr<T> makePooled(Args &&... args)
+{
+    return std::allocate_shared<T>(PoolAllocator<T>(),
+                                   std::forward<Args>(args)...);
+}
+
+
+/*****************************************************************************/
+/* POOLED NEW                                                                */
+/*****************************************************************************/
+
+/** Base class that makes new and delete of T use a pool.  Classes derived
+    from T with a different size fall back on the global allocator.
+*/
+
+template<typename T>
+struct PooledNew {
+    static void * operator new(size_t size)
+    {
+        if (JML_UNLIKELY(size != sizeof(T)))
+            return ::operator new(size);
+        return BlockPool<sizeof(T), alignof(T)>::allocate();
+    }
+
+    static void operator delete(void * mem, size_t size)
+    {
+        if (!mem)
+            return;
+        if (JML_UNLIKELY(size != sizeof(T)))
+            ::operator delete(mem);
+        else BlockPool<sizeof(T), alignof(T)>::deallocate(mem);
+    }
+};
+
+} // namespace Datacratic
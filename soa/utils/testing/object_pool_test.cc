@@ -0,0 +1,129 @@
+/* object_pool_test.cc
+   Copyright (c) 2015 Datacratic Inc.  All rights reserved.
+
+   Tests for the object pools.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include "soa/utils/object_pool.h"
+#include "jml/utils/ring_buffer.h"
+
+#include <boost/test/unit_test.hpp>
+#include <thread>
+#include <set>
+
+using namespace std;
+using namespace Datacratic;
+
+namespace {
+
+struct Tracked : public std::enable_shared_from_this<Tracked> {
+    Tracked(int value)
+        : value(value), payload(value % 100, 'x')
+    {
+        ++live;
+    }
+
+    ~Tracked()
+    {
+        --live;
+    }
+
+    int value;
+    std::string payload;
+
+    static std::atomic<int> live;
+};
+
+std::atomic<int> Tracked::live(0);
+
+struct PooledThing : public PooledNew<PooledThing> {
+    char data[200];
+};
+
+struct BiggerThing : public PooledThing {
+    char more[100];
+};
+
+} // file scope
+
+BOOST_AUTO_TEST_CASE( test_make_pooled_reuses_memory )
+{
+    std::set<const void *> addresses;
+
+    for (unsigned i = 0;  i < 10000;  ++i) {
+        auto p = makePooled<Tracked>(i);
+        BOOST_CHECK_EQUAL(p->value, i);
+        BOOST_CHECK_EQUAL(p->shared_from_this(), p);
+        addresses.insert(p.get());
+    }
+
+    BOOST_CHECK_EQUAL(Tracked::live, 0);
+
+    // Objects are freed straight back to this thread's cache
+    BOOST_CHECK_EQUAL(addresses.size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE( test_pooled_new )
+{
+    typedef BlockPool<sizeof(PooledThing), alignof(PooledThing)> Pool;
+    size_t before = Pool::numBlocks();
+
+    std::vector<PooledThing *> things;
+    for (unsigned i = 0;  i < 1000;  ++i)
+        things.push_back(new PooledThing());
+    for (auto t: things)
+        delete t;
+
+    size_t allocated = Pool::numBlocks() - before;
+    BOOST_CHECK_GE(allocated, 1000);
+
+    // Reusing the freed blocks doesn't need any more memory
+    things.clear();
+    for (unsigned i = 0;  i < 1000;  ++i)
+        things.push_back(new PooledThing());
+    for (auto t: things)
+        delete t;
+
+    BOOST_CHECK_EQUAL(Pool::numBlocks() - before, allocated);
+
+    // Derived classes of another size use the normal allocator
+    PooledThing * bigger = new BiggerThing();
+    delete static_cast<BiggerThing *>(bigger);
+    BOOST_CHECK_EQUAL(Pool::numBlocks() - before, allocated);
+}
+
+BOOST_AUTO_TEST_CASE( test_cross_thread_free )
+{
+    // Objects created on one thread and freed on another, like the router's
+    // auction graveyard.  The memory needs to make it back to the producer
+    // so that the pool stops growing.
+    typedef std::shared_ptr<Tracked> Ptr;
+    typedef BlockPool<sizeof(Tracked), alignof(Tracked)> Pool;
+
+    ML::RingBufferSWMR<Ptr> graveyard(1024);
+    std::atomic<bool> finished(false);
+
+    auto deleter = [&] ()
+        {
+            Ptr p;
+            while (!finished || graveyard.tryPop(p))
+                graveyard.tryPop(p, 0.001);
+        };
+
+    std::thread deleterThread(deleter);
+
+    const unsigned numObjects = 1000000;
+    for (unsigned i = 0;  i < numObjects;  ++i)
+        graveyard.push(makePooled<Tracked>(i));
+
+    finished = true;
+    deleterThread.join();
+
+    BOOST_CHECK_EQUAL(Tracked::live, 0);
+
+    // Bounded by what was in flight, not by the number of objects
+    BOOST_CHECK_LT(Pool::numBlocks(), numObjects / 10);
+}
@@ -11,3 +11,4 @@ $(eval $(call test,print_utils_test,,boost))
 $(eval $(call test,variadic_hash_test,variadic_hash,boost))
 $(eval $(call test,type_traits_test,,boost))
 $(eval $(call test,scope_test,arch,boost))
+$(eval $(call test,object_pool_test,arch boost_thread,boost))